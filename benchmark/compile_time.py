@@ -0,0 +1,157 @@
+#!/usr/bin/env python3
+"""Measure how the compile time and memory of remniw scale with the program size.
+
+For each shape of gen_program.py and each size step, the generated program is
+compiled by `remniw -emit-llvm` (frontend, semantic analysis, IR codegen and
+optimizations) and by `remniw-llc` (asm codegen). The wall time and the peak RSS
+of each step are written as JSON, together with the report of -time-phases for
+each phase of the step, e.g. frontend and type-analysis, so a regression can be
+attributed to a phase.
+"""
+
+import argparse
+import json
+import os
+import platform
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+
+import gen_program
+
+DEFAULT_SIZES = {
+    'functions': [100, 1000, 10000],
+    'straightline': [1000, 10000, 100000],
+    'loops': [4, 16, 64],
+    'arrays': [1000, 100000, 10000000],
+    'fanout': [100, 1000, 10000],
+}
+
+
+def run(cmd, timeout):
+    """Runs cmd and returns its exit code, wall time in seconds and peak RSS in KiB."""
+    start = time.monotonic()
+    proc = subprocess.Popen(cmd, stdout=subprocess.DEVNULL, stderr=subprocess.PIPE)
+    # Drain stderr while the child runs, a child which fills the pipe would block.
+    stderr_chunks = []
+    reader = threading.Thread(target=lambda: stderr_chunks.append(proc.stderr.read()))
+    reader.start()
+    killer = threading.Timer(timeout, proc.kill)
+    killer.start()
+    # Reap the child with wait4 for its resource usage.
+    _, status, rusage = os.wait4(proc.pid, 0)
+    wall = time.monotonic() - start
+    killer.cancel()
+    reader.join()
+    proc.stderr.close()
+    proc.returncode = os.waitstatus_to_exitcode(status)
+    if proc.returncode != 0:
+        stderr = b''.join(stderr_chunks).decode(errors='replace')
+        sys.stderr.write(stderr[-2000:])
+    # ru_maxrss is in KiB on Linux.
+    return proc.returncode, wall, rusage.ru_maxrss
+
+
+def read_phases(filename):
+    """Returns the phases of a -time-phases JSON report, by name."""
+    try:
+        with open(filename) as f:
+            report = json.load(f)
+    except (OSError, ValueError):
+        return {}
+    phases = {}
+    for phase in report['phases']:
+        name = phase.pop('name')
+        phase.pop('description', None)
+        phases[name] = phase
+    return phases
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument('--remniw', required=True, help='path to remniw')
+    parser.add_argument('--remniw-llc', required=True, help='path to remniw-llc')
+    parser.add_argument('--shapes', default=','.join(DEFAULT_SIZES),
+                        help='comma separated shapes to run (default: all)')
+    parser.add_argument('--sizes', help='comma separated sizes, for all shapes')
+    parser.add_argument('--timeout', type=float, default=600,
+                        help='seconds before a step is killed (default: 600)')
+    parser.add_argument('--keep', help='keep the generated files in this directory')
+    parser.add_argument('-o', '--output', help='JSON output file (default: stdout)')
+    parser.add_argument('extra_args', nargs='*',
+                        help='extra arguments passed to remniw and remniw-llc')
+    args = parser.parse_args()
+
+    shapes = args.shapes.split(',')
+    for shape in shapes:
+        if shape not in gen_program.SHAPES:
+            parser.error('unknown shape %s' % shape)
+
+    workdir = args.keep or tempfile.mkdtemp(prefix='remniw-compile-time-')
+    os.makedirs(workdir, exist_ok=True)
+
+    results = []
+    for shape in shapes:
+        if args.sizes:
+            sizes = [int(s) for s in args.sizes.split(',')]
+        else:
+            sizes = DEFAULT_SIZES[shape]
+        for size in sizes:
+            base = os.path.join(workdir, '%s-%d' % (shape, size))
+            with open(base + '.rw', 'w') as f:
+                f.write(gen_program.generate(shape, size))
+            steps = [
+                ('remniw', [args.remniw, '-emit-llvm', base + '.rw', '-o', base + '.ll']),
+                ('remniw-llc', [args.remniw_llc, base + '.ll', '-o', base + '.s']),
+            ]
+            for step, cmd in steps:
+                phases_file = '%s.%s.phases.json' % (base, step)
+                cmd = cmd + ['-time-phases', '-time-phases-format=json',
+                             '-time-phases-file=' + phases_file]
+                code, wall, rss = run(cmd + args.extra_args, args.timeout)
+                phases = read_phases(phases_file)
+                results.append({
+                    'shape': shape,
+                    'size': size,
+                    'step': step,
+                    'exit_code': code,
+                    'wall_seconds': round(wall, 4),
+                    'peak_rss_kib': rss,
+                    'phases': phases,
+                })
+                sys.stderr.write('%-12s %10d %-10s %10.3fs %10d KiB%s\n' %
+                                 (shape, size, step, wall, rss,
+                                  '' if code == 0 else '  FAILED (%d)' % code))
+                for name, phase in phases.items():
+                    sys.stderr.write('%35s %10.3fs %10d KiB\n' %
+                                     (name, phase['wall_seconds'],
+                                      phase['peak_rss_bytes'] // 1024))
+                # The backend needs the output of the frontend.
+                if code != 0:
+                    break
+
+    report = {
+        'host': platform.node(),
+        'remniw': os.path.abspath(args.remniw),
+        'remniw_llc': os.path.abspath(args.remniw_llc),
+        'extra_args': args.extra_args,
+        'results': results,
+    }
+    output = json.dumps(report, indent=2) + '\n'
+    if args.output:
+        with open(args.output, 'w') as f:
+            f.write(output)
+    else:
+        sys.stdout.write(output)
+
+    if not args.keep:
+        for name in os.listdir(workdir):
+            os.remove(os.path.join(workdir, name))
+        os.rmdir(workdir)
+    return 1 if any(r['exit_code'] != 0 for r in results) else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
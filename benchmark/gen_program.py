@@ -0,0 +1,147 @@
+#!/usr/bin/env python3
+"""Generate synthetic remniw programs which stress one dimension of the compiler.
+
+Shapes:
+  functions     N small functions, each calling the previous one
+  straightline  one function with N statements in a single basic block
+  loops         a loop nest of depth N
+  arrays        an array of N elements indexed with constants up to N - 1
+  fanout        main calling N distinct functions
+
+Usage: gen_program.py SHAPE SIZE [-o OUTPUT]
+"""
+
+import argparse
+import sys
+
+
+def gen_functions(n):
+    lines = []
+    for i in range(n):
+        lines.append('func f%d(x int) int {' % i)
+        lines.append('    var a, b int;')
+        lines.append('    a = x * %d + 1;' % (i % 7 + 1))
+        lines.append('    b = a - x;')
+        if i > 0:
+            lines.append('    if (a > b) {')
+            lines.append('        b = f%d(b);' % (i - 1))
+            lines.append('    }')
+        lines.append('    return a + b;')
+        lines.append('}')
+        lines.append('')
+    lines.append('func main() int {')
+    lines.append('    %%output f%d(%%input);' % (n - 1))
+    lines.append('    return 0;')
+    lines.append('}')
+    return lines
+
+
+def gen_straightline(n):
+    num_vars = 16
+    names = ['v%d' % i for i in range(num_vars)]
+    lines = ['func main() int {']
+    lines.append('    var %s int;' % ', '.join(names))
+    for v in names:
+        lines.append('    %s = %%input;' % v)
+    for i in range(n):
+        dst = names[i % num_vars]
+        lhs = names[(i + 1) % num_vars]
+        rhs = names[(i * 7 + 3) % num_vars]
+        op = '+-*'[i % 3]
+        lines.append('    %s = %s %s %s;' % (dst, lhs, op, rhs))
+    lines.append('    %%output %s;' % ' + '.join(names))
+    lines.append('    return 0;')
+    lines.append('}')
+    return lines
+
+
+def gen_loops(n):
+    counters = ['i%d' % i for i in range(n)]
+    lines = ['func main() int {']
+    lines.append('    var sum, %s int;' % ', '.join(counters))
+    lines.append('    sum = 0;')
+    indent = '    '
+    for c in counters:
+        lines.append('%s%s = 2;' % (indent, c))
+        lines.append('%swhile (%s > 0) {' % (indent, c))
+        indent += '    '
+    lines.append('%ssum = sum + %s;' % (indent, ' * '.join(counters)))
+    for c in reversed(counters):
+        lines.append('%s%s = %s - 1;' % (indent, c, c))
+        indent = indent[:-4]
+        lines.append('%s}' % indent)
+    lines.append('    %output sum;')
+    lines.append('    return 0;')
+    lines.append('}')
+    return lines
+
+
+def gen_arrays(n):
+    num_accesses = 1000
+    indices = sorted({k * (n - 1) // (num_accesses - 1) for k in range(num_accesses)})
+    lines = ['func main() int {']
+    lines.append('    var sum int;')
+    lines.append('    var arr[%d] int;' % n)
+    lines.append('    sum = 0;')
+    for k, index in enumerate(indices):
+        lines.append('    arr[%d] = %d;' % (index, k))
+    for index in indices:
+        lines.append('    sum = sum + arr[%d];' % index)
+    lines.append('    %output sum;')
+    lines.append('    return 0;')
+    lines.append('}')
+    return lines
+
+
+def gen_fanout(n):
+    lines = []
+    for i in range(n):
+        lines.append('func g%d(x int) int {' % i)
+        lines.append('    return x + %d;' % i)
+        lines.append('}')
+        lines.append('')
+    lines.append('func main() int {')
+    lines.append('    var x int;')
+    lines.append('    x = %input;')
+    for i in range(n):
+        lines.append('    x = g%d(x);' % i)
+    lines.append('    %output x;')
+    lines.append('    return 0;')
+    lines.append('}')
+    return lines
+
+
+SHAPES = {
+    'functions': gen_functions,
+    'straightline': gen_straightline,
+    'loops': gen_loops,
+    'arrays': gen_arrays,
+    'fanout': gen_fanout,
+}
+
+
+def generate(shape, size):
+    """Returns the source of a program of the given shape and size."""
+    return '\n'.join(SHAPES[shape](size)) + '\n'
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('shape', choices=sorted(SHAPES))
+    parser.add_argument('size', type=int)
+    parser.add_argument('-o', '--output', help='output file (default: stdout)')
+    args = parser.parse_args()
+    if args.size < 1:
+        parser.error('size must be positive')
+
+    source = generate(args.shape, args.size)
+    if args.output:
+        with open(args.output, 'w') as f:
+            f.write(source)
+    else:
+        sys.stdout.write(source)
+
+
+if __name__ == '__main__':
+    main()
@@ -5,7 +5,6 @@
 #include "codegen/asm/AsmInstruction.h"
 #include "codegen/asm/AsmOperand.h"
 #include "codegen/asm/BrgTreeBuilder.h"
-#include "codegen/asm/LiveInterval.h"
 #include "codegen/asm/Register.h"
 #include "codegen/asm/TargetInfo.h"
 #include "llvm/ADT/DenseMap.h"
@@ -16,7 +15,6 @@
 #include "llvm/IR/InstVisitor.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/Support/Debug.h"
-#include <unordered_map>
 #include <vector>
 
 #define DEBUG_TYPE "remniw-AsmBuilder"
@@ -26,17 +24,22 @@ namespace remniw {
 class AsmBuilder {
 private:
     llvm::SmallVector<std::unique_ptr<AsmFunction>> AsmFunctions;
-    llvm::SmallVector<uint32_t> CurrentCallInstIndexes;
     AsmFunction *CurrentFunction {nullptr};
 
+    struct PhiCopy {
+        AsmOperand Src;
+        AsmOperand::RegOp Dst;
+    };
+    // Copies to the phi nodes of the successors of the current block. They are
+    // conceptually executed in parallel, see lowerPhiCopies().
+    llvm::SmallVector<PhiCopy> PendingPhiCopies;
+
 public:
     virtual ~AsmBuilder() = default;
 
     void build(const llvm::SmallVectorImpl<BrgFunction *> &BrgFunctions) {
-        for (auto *BrgFunc : BrgFunctions) {
-            CurrentCallInstIndexes.clear();
-            buildAsmFunction(BrgFunc);
-        }
+        for (auto *BrgFunc : BrgFunctions)
+            AsmFunctions.push_back(buildAsmFunction(BrgFunc));
         LLVM_DEBUG({
             for (auto &F : AsmFunctions)
                 F->print(llvm::outs());
@@ -45,18 +48,70 @@ public:
 
     virtual const TargetInfo &getTargetInfo() const = 0;
 
-    void buildAsmFunction(const BrgFunction *);
+    // Select instructions for a single function. It only touches the state of
+    // this AsmBuilder and of the given BrgFunction, so different functions can
+    // be built concurrently by different AsmBuilders.
+    std::unique_ptr<AsmFunction> buildAsmFunction(const BrgFunction *);
 
     llvm::SmallVector<std::unique_ptr<AsmFunction>> &getAsmFunctions() {
         return AsmFunctions;
     }
-    llvm::SmallVector<uint32_t> &getCurrentCallInstIndexes() {
-        return CurrentCallInstIndexes;
-    };
     AsmFunction *getCurrentFunction() { return CurrentFunction; }
 
+    Register createVirtReg() { return CurrentFunction->createVirtReg(); }
+
     virtual AsmOperand::MemOp handleALLOCA(uint32_t StackObjectIndex) = 0;
 
+    virtual AsmOperand::RegOp handleFUNCARG(llvm::Argument *FuncArg) = 0;
+
+    // The value of a phi node lives in a virtual register, which is written by
+    // the copies at the end of the predecessors.
+    AsmOperand::RegOp handlePHI(llvm::Instruction *I) {
+        return AsmOperand::createReg(createVirtReg());
+    }
+
+    void addPhiCopy(AsmOperand Src, AsmOperand::RegOp Dst) {
+        PendingPhiCopies.push_back({Src, Dst});
+    }
+
+    // Sequentialize the pending phi copies. A copy is emitted once no other
+    // pending copy reads its destination. When only cycles are left, e.g. for
+    // `a, b = b, a`, the destination of one copy is saved in a new virtual
+    // register first, which breaks the cycle.
+    void lowerPhiCopies() {
+        auto IsSelfCopy = [](const PhiCopy &C) {
+            return C.Src.isReg() && C.Src.getReg() == C.Dst.RegNo;
+        };
+        PendingPhiCopies.erase(std::remove_if(PendingPhiCopies.begin(),
+                                              PendingPhiCopies.end(), IsSelfCopy),
+                               PendingPhiCopies.end());
+
+        while (!PendingPhiCopies.empty()) {
+            auto Ready = llvm::find_if(PendingPhiCopies, [&](const PhiCopy &C) {
+                return llvm::none_of(PendingPhiCopies, [&](const PhiCopy &Other) {
+                    return &Other != &C && readsReg(Other.Src, C.Dst.RegNo);
+                });
+            });
+            if (Ready != PendingPhiCopies.end()) {
+                emitCopy(Ready->Src, Ready->Dst);
+                PendingPhiCopies.erase(Ready);
+                continue;
+            }
+            AsmOperand::RegOp Saved = PendingPhiCopies.front().Dst;
+            AsmOperand::RegOp Tmp = AsmOperand::createReg(createVirtReg());
+            handleCOPY(Saved, Tmp);
+            for (auto &C : PendingPhiCopies)
+                replaceReg(C.Src, Saved.RegNo, Tmp.RegNo);
+        }
+    }
+
+    bool hasPendingPhiCopies() const { return !PendingPhiCopies.empty(); }
+
+    virtual void handleCOPY(AsmOperand::RegOp Src, AsmOperand::RegOp Dst) = 0;
+    virtual void handleCOPY(AsmOperand::ImmOp Src, AsmOperand::RegOp Dst) = 0;
+    virtual void handleCOPY(AsmOperand::MemOp Src, AsmOperand::RegOp Dst) = 0;
+    virtual void handleCOPY(AsmOperand::LabelOp Src, AsmOperand::RegOp Dst) = 0;
+
     virtual AsmOperand::RegOp handleLOAD(llvm::Instruction *I, AsmOperand::MemOp Mem) = 0;
     virtual AsmOperand::RegOp handleLOAD(llvm::Instruction *I, AsmOperand::RegOp Reg) = 0;
 
@@ -97,6 +152,8 @@ public:
                             AsmOperand::ImmOp Imm) = 0;
     virtual void handleICMP(llvm::Instruction *I, AsmOperand::ImmOp Imm,
                             AsmOperand::RegOp Reg) = 0;
+    virtual void handleICMP(llvm::Instruction *I, AsmOperand::RegOp Reg,
+                            AsmOperand::LabelOp Label) = 0;
 
     virtual void handleBR(llvm::Instruction *I, AsmOperand::LabelOp Label1,
                           AsmOperand::LabelOp Label2) = 0;
@@ -154,106 +211,31 @@ public:
 
     virtual void handleLABEL(AsmOperand::LabelOp Label) = 0;
 
-    void updateRegLiveRanges(uint32_t Reg) {
-        uint32_t StartPoint = static_cast<uint32_t>(CurrentFunction->size());
-        uint32_t EndPoint = StartPoint + 1;
-        bool UsedAcrossCall = false;
-        std::unordered_map<uint32_t, remniw::LiveRanges> &CurrentRegLiveRangesMap =
-            CurrentFunction->getRegLiveRangesMap();
-        // For virtual registers, we simply do not consider lifetime holes.
-        // The lifetime interval of virtual register is the segment of the program that
-        // starts where the virtual register is first live in the static linear order
-        // of the code and ends where it is last live.
-        // So when we use `struct LiveRanges` to represent the lifetime of virtual
-        // registers, the `struct LiveRanges` only consists of one `struct LiveRange`.
-        if (Register::isVirtualRegister(Reg)) {
-            if (CurrentRegLiveRangesMap.count(Reg)) {
-                CurrentRegLiveRangesMap[Reg].Ranges.back().EndPoint = EndPoint;
-                StartPoint = CurrentRegLiveRangesMap[Reg].Ranges.back().StartPoint;
-            } else {
-                CurrentRegLiveRangesMap[Reg].Ranges.push_back(
-                    {StartPoint, EndPoint, false});
-            }
-
-            if (std::find_if(CurrentCallInstIndexes.begin(), CurrentCallInstIndexes.end(),
-                             [&](uint32_t Index) {
-                                 return StartPoint <= Index && Index < EndPoint;
-                             }) != CurrentCallInstIndexes.end())
-                CurrentRegLiveRangesMap[Reg].Ranges.back().UsedAcrossCall = true;
-
-            LLVM_DEBUG({
-                for (const auto &Range : CurrentRegLiveRangesMap[Reg].Ranges) {
-                    llvm::outs() << "VirtualRegister: " << Reg << ", LiveRange: ";
-                    Range.print(llvm::outs());
-                    llvm::outs() << "\n";
-                }
-            });
-        }
-        // For physical register, we consider lifetime holes.
-        // For the segment of the program that starts where the physical register
-        // is first live in the static linear order of the code and ends where
-        // it is last live, there are one or more holes during which physical register
-        // is not used.
-        // So when we use `struct LiveRanges` to represent the lifetime of physical
-        // registers, the `struct LiveRanges` usually consists of multiple
-        // `struct LiveRange`s.
-        else if (Register::isPhysicalRegister(Reg)) {
-            if (!CurrentRegLiveRangesMap[Reg].Ranges.empty()) {
-                auto &LastActiveRange = CurrentRegLiveRangesMap[Reg].Ranges.back();
-                if (LastActiveRange.StartPoint == StartPoint &&
-                    LastActiveRange.EndPoint == EndPoint) {
-                    // Do nothing
-                } else if (LastActiveRange.EndPoint == StartPoint) {
-                    LastActiveRange.EndPoint = EndPoint;
-                    StartPoint = LastActiveRange.StartPoint;
-                } else {
-                    CurrentRegLiveRangesMap[Reg].Ranges.push_back(
-                        {StartPoint, EndPoint, false});
-                }
-            } else {
-                CurrentRegLiveRangesMap[Reg].Ranges.push_back(
-                    {StartPoint, EndPoint, false});
-            }
-
-            if (std::find_if(CurrentCallInstIndexes.begin(), CurrentCallInstIndexes.end(),
-                             [&](uint32_t Index) {
-                                 return StartPoint <= Index && Index < EndPoint;
-                             }) != CurrentCallInstIndexes.end())
-                CurrentRegLiveRangesMap[Reg].Ranges.back().UsedAcrossCall = true;
-            LLVM_DEBUG({
-                for (const auto &Range : CurrentRegLiveRangesMap[Reg].Ranges) {
-                    llvm::outs() << "PhysicalRegister: " << Reg << ", LiveRange: ";
-                    Range.print(llvm::outs());
-                    llvm::outs() << "\n";
-                }
-            });
-        }
-    }
-
-    void updateAsmOperandLiveRanges(const AsmOperand &Op) {
-        if (Op.isReg()) {
-            updateRegLiveRanges(Op.getReg());
-        }
-        if (Op.isMem()) {
-            uint32_t MemBaseReg = Op.getMemBaseReg();
-            if (MemBaseReg != Register::NoRegister) {
-                updateRegLiveRanges(MemBaseReg);
-            }
-            uint32_t MemIndexReg = Op.getMemIndexReg();
-            if (MemIndexReg != Register::NoRegister) {
-                updateRegLiveRanges(MemIndexReg);
-            }
+private:
+    void emitCopy(const AsmOperand &Src, AsmOperand::RegOp Dst) {
+        switch (Src.Kind) {
+        case AsmOperand::AO_Register: handleCOPY(Src.Reg, Dst); break;
+        case AsmOperand::AO_Immediate: handleCOPY(Src.Imm, Dst); break;
+        case AsmOperand::AO_Memory: handleCOPY(Src.Mem, Dst); break;
+        case AsmOperand::AO_Label: handleCOPY(Src.Lbl, Dst); break;
         }
     }
 
-    void updateAsmOperandLiveRanges(const AsmOperand::RegOp &Reg) {
-        updateRegLiveRanges(Reg.RegNo);
+    static bool readsReg(const AsmOperand &Op, uint32_t Reg) {
+        if (Op.isReg())
+            return Op.getReg() == Reg;
+        if (Op.isMem())
+            return Op.getMemBaseReg() == Reg || Op.getMemIndexReg() == Reg;
+        return false;
     }
 
-    void updateAsmOperandLiveRanges(const AsmOperand::MemOp &Mem) {
-        updateRegLiveRanges(Mem.BaseReg);
-        if (Mem.IndexReg != Register::NoRegister)
-            updateRegLiveRanges(Mem.IndexReg);
+    static void replaceReg(AsmOperand &Op, uint32_t From, uint32_t To) {
+        if (Op.isReg() && Op.Reg.RegNo == From)
+            Op.Reg.RegNo = To;
+        if (Op.isMem() && Op.Mem.BaseReg == From)
+            Op.Mem.BaseReg = To;
+        if (Op.isMem() && Op.Mem.IndexReg == From)
+            Op.Mem.IndexReg = To;
     }
 };
 
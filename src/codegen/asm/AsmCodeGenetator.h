@@ -12,47 +12,141 @@
 #include "codegen/asm/X86/X86AsmBuilder.h"
 #include "codegen/asm/X86/X86AsmPrinter.h"
 #include "codegen/asm/X86/X86AsmRewriter.h"
+#include "codegen/asm/X86/X86ObjectEmitter.h"
+#include "support/PhaseTimer.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Threading.h"
+#include <atomic>
 
 namespace remniw {
 
+// The code generator of LLVM, which is linked for the JIT, has a -regalloc option
+// as well. Rename it, so that the -regalloc option of the remniw tools chooses the
+// register allocator of AsmRewriter. The option of the tools must be created
+// after this is called, otherwise the names conflict.
+inline void renameLLVMRegAllocOption() {
+    if (llvm::cl::Option *O = llvm::cl::getRegisteredOptions().lookup("regalloc"))
+        O->setArgStr("llvm-regalloc");
+}
+
 class AsmCodeGenerator {
 public:
-    AsmCodeGenerator(Target TheTarget): TheTarget(TheTarget) { initializeTarget(); }
+    // NumThreads is the number of threads used to select instructions and
+    // allocate registers, 0 means using all available hardware threads. If PT is
+    // not null, the phases of compile() are measured by it.
+    AsmCodeGenerator(Target TheTarget, unsigned NumThreads = 1,
+                     RegAllocKind RegAlloc = GreedyRegAlloc, PhaseTimer *PT = nullptr):
+        TheTarget(TheTarget),
+        NumThreads(NumThreads), RegAlloc(RegAlloc), PT(PT) {
+        initializeTarget();
+    }
+
+    void compile(llvm::Module *M, llvm::raw_fd_ostream &OS,
+                 FileType FT = FileType::AssemblyFile) {
+        assert((FT == FileType::AssemblyFile || TheTarget == Target::x86) &&
+               "Object file emission is only supported for x86");
 
-    void compile(llvm::Module *M, llvm::raw_fd_ostream &OS) {
         // LLVM IR -> BrgTree
-        BB->build(*M);
+        {
+            PhaseTimer::Scope S(PT, "brg-tree-builder", "BrgTreeBuilder");
+            BB->build(*M);
+        }
         const auto &BrgFunctions = BB->getFunctions();
 
-        // BrgTree -> Assembly
-        AB->build(BrgFunctions);
-        auto &AsmFunctions = AB->getAsmFunctions();
+        if (NumThreads == 1 || BrgFunctions.size() <= 1) {
+            // BrgTree -> Assembly
+            {
+                PhaseTimer::Scope S(PT, "asm-builder", "AsmBuilder");
+                AB->build(BrgFunctions);
+            }
+            auto &AsmFunctions = AB->getAsmFunctions();
+
+            // Register allocation, insert prologue and epilogue
+            {
+                PhaseTimer::Scope S(PT, "asm-rewriter", "AsmRewriter");
+                AR->rewrite(AsmFunctions);
+            }
+
+            // Emit assembly or object to file stream
+            emit(OS, AsmFunctions, FT);
+            return;
+        }
+
+        // Functions are independent after BrgTree building, select instructions
+        // and allocate registers for them in parallel. Each worker owns an
+        // AsmBuilder and an AsmRewriter, results are kept in the original order.
+        llvm::SmallVector<std::unique_ptr<AsmFunction>> AsmFunctions;
+        AsmFunctions.resize(BrgFunctions.size());
+        llvm::ThreadPoolStrategy Strategy = llvm::hardware_concurrency(NumThreads);
+        unsigned NumWorkers =
+            std::min<size_t>(Strategy.compute_thread_count(), BrgFunctions.size());
+        std::atomic<size_t> NextFunction {0};
+        {
+            // The workers interleave the two phases, they are measured together.
+            PhaseTimer::Scope S(PT, "asm-builder-rewriter",
+                                "AsmBuilder and AsmRewriter (parallel)");
+            llvm::ThreadPool Pool(Strategy);
+            for (unsigned W = 0; W < NumWorkers; ++W) {
+                Pool.async([&]() {
+                    auto WorkerAB = createAsmBuilder();
+                    auto WorkerAR = createAsmRewriter(AB->getTargetInfo());
+                    for (size_t I = NextFunction++; I < BrgFunctions.size();
+                         I = NextFunction++) {
+                        AsmFunctions[I] = WorkerAB->buildAsmFunction(BrgFunctions[I]);
+                        WorkerAR->rewrite(AsmFunctions[I].get());
+                    }
+                });
+            }
+            Pool.wait();
+        }
 
-        // Register allocation, insert prologue and epilogue
-        AR->rewrite(AsmFunctions);
+        emit(OS, AsmFunctions, FT);
+    }
 
-        // Emit assembly to file stream
+private:
+    void emit(llvm::raw_fd_ostream &OS,
+              const llvm::SmallVector<std::unique_ptr<AsmFunction>> &AsmFunctions,
+              FileType FT) {
+        if (FT == FileType::ObjectFile) {
+            PhaseTimer::Scope S(PT, "object-emitter", "X86ObjectEmitter");
+            X86ObjectEmitter OE;
+            OE.emitToStreamer(OS, AsmFunctions, BB->getConstantStrings(),
+                              BB->getGlobalCtors());
+            return;
+        }
+        PhaseTimer::Scope S(PT, "asm-printer", "AsmPrinter");
         AP->emitToStreamer(OS, AsmFunctions, BB->getConstantStrings(),
                            BB->getGlobalCtors());
     }
 
-private:
     void initializeTarget() {
-        if (TheTarget == Target::x86) {
-            AB = std::make_unique<X86AsmBuilder>();
-            AR = std::make_unique<X86AsmRewriter>(AB->getTargetInfo());
+        AB = createAsmBuilder();
+        AR = createAsmRewriter(AB->getTargetInfo());
+        if (TheTarget == Target::x86)
             AP = std::make_unique<X86AsmPrinter>(AB->getTargetInfo());
-            BB = std::make_unique<BrgTreeBuilder>(AB->getTargetInfo(), AsmCtx);
-        } else if (TheTarget == Target::riscv) {
-            AB = std::make_unique<RISCVAsmBuilder>();
-            AR = std::make_unique<RISCVAsmRewriter>(AB->getTargetInfo());
+        else if (TheTarget == Target::riscv)
             AP = std::make_unique<RISCVAsmPrinter>(AB->getTargetInfo());
-            BB = std::make_unique<BrgTreeBuilder>(AB->getTargetInfo(), AsmCtx);
-        }
+        BB = std::make_unique<BrgTreeBuilder>(AB->getTargetInfo(), AsmCtx);
+    }
+
+    std::unique_ptr<AsmBuilder> createAsmBuilder() const {
+        if (TheTarget == Target::riscv)
+            return std::make_unique<RISCVAsmBuilder>();
+        return std::make_unique<X86AsmBuilder>();
+    }
+
+    std::unique_ptr<AsmRewriter> createAsmRewriter(const TargetInfo &TI) const {
+        if (TheTarget == Target::riscv)
+            return std::make_unique<RISCVAsmRewriter>(TI, RegAlloc);
+        return std::make_unique<X86AsmRewriter>(TI, RegAlloc);
     }
 
 private:
     Target TheTarget;
+    unsigned NumThreads;
+    RegAllocKind RegAlloc;
+    PhaseTimer *PT;
     AsmContext AsmCtx;
     std::unique_ptr<AsmBuilder> AB;
     std::unique_ptr<AsmRewriter> AR;
@@ -5,6 +5,7 @@
 namespace remniw {
 
 AsmSymbol* AsmContext::getOrCreateSymbol(llvm::Value* V) {
+    std::lock_guard<std::mutex> Lock(Mutex);
     if (SymbolTable.count(V))
         return SymbolTable[V].get();
 
@@ -4,14 +4,19 @@
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/IR/Value.h"
+#include <mutex>
 
 namespace remniw {
 
 class AsmContext {
 public:
+    // Thread-safe. Note the name of a newly created symbol depends on the order
+    // of creation, symbols are created by BrgTreeBuilder which visits the
+    // module sequentially, so that the emitted assembly is deterministic.
     AsmSymbol *getOrCreateSymbol(llvm::Value *V);
 
 private:
+    std::mutex Mutex;
     llvm::DenseMap<llvm::Value *, std::unique_ptr<AsmSymbol>> SymbolTable;
     llvm::StringMap<bool> UsedNames;
     // The next ID to dole out to an unnamed assembler temporary symbol with
@@ -1 +1,25 @@
 #include "AsmFunction.h"
+#include "support/PhaseTimer.h"
+
+namespace remniw {
+
+static PhaseCounter NumInstsCreated("asm-insts-created", "AsmInstructions created");
+static PhaseCounter NumInstsRecycled("asm-insts-recycled",
+                                     "AsmInstructions reusing erased ones");
+
+AsmInstruction *AsmFunction::allocateInst() {
+    ++NumInstsCreated;
+    if (NumFreeInsts) {
+        ++NumInstsRecycled;
+        --NumFreeInsts;
+    }
+    return InstAllocator.Allocate();
+}
+
+void AsmFunction::deallocateInst(AsmInstruction *I) {
+    I->~AsmInstruction();
+    InstAllocator.Deallocate(I);
+    ++NumFreeInsts;
+}
+
+}  // namespace remniw
@@ -1,13 +1,14 @@
 #pragma once
 
 #include "AsmInstruction.h"
-#include "LiveInterval.h"
+#include "Register.h"
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/ilist.h"
 #include "llvm/IR/Function.h"
+#include "llvm/Support/Allocator.h"
+#include "llvm/Support/RecyclingAllocator.h"
 #include <cstdint>
 #include <string>
-#include <unordered_map>
 
 namespace remniw {
 
@@ -28,17 +29,36 @@ public:
     int64_t MaxCallFrameSize;
     llvm::SmallVector<StackObject> StackObjects;
 
+    // Owns the memory of the instructions, must outlive InstList. The instructions
+    // erased from InstList are put on its free list and reused by the next ones
+    // created, e.g. the copies removed and the moves inserted by the rewriters.
+    // The slabs are small at first and grow every 16 slabs, so that the many
+    // small functions of a module don't each waste most of a large slab.
+    llvm::RecyclingAllocator<
+        llvm::BumpPtrAllocatorImpl<llvm::MallocAllocator, 1024, 1024, 16>, AsmInstruction>
+        InstAllocator;
+    // The number of instructions on the free list of InstAllocator.
+    size_t NumFreeInsts {0};
+
     InstListType InstList;
-    std::unordered_map<uint32_t, remniw::LiveRanges> RegLiveRangesMap;
+    // Virtual registers are numbered per function, so that functions can be
+    // built independently of each other and the numbering does not depend on
+    // the order in which functions are built.
+    uint32_t NumVirtRegs {0};
 
     AsmFunction(const AsmFunction &) = delete;
     AsmFunction &operator=(const AsmFunction &) = delete;
 
     llvm::StringRef getName() const { return F->getName(); }
 
-    std::unordered_map<uint32_t, remniw::LiveRanges> &getRegLiveRangesMap() {
-        return RegLiveRangesMap;
-    }
+    // Returns the memory for a new instruction of this function, which is given
+    // back to the function by deallocateInst() when the instruction is erased.
+    AsmInstruction *allocateInst();
+    void deallocateInst(AsmInstruction *I);
+
+    Register createVirtReg() { return Register::index2VirtReg(NumVirtRegs++); }
+
+    uint32_t getNumVirtRegs() const { return NumVirtRegs; }
 
     void print(llvm::raw_ostream &OS) const {
         OS << "AsmFunction: " << getName() << "\n";
@@ -30,33 +30,42 @@ void ilist_traits<remniw::AsmInstruction>::transferNodesFromList(ilist_traits &F
 }
 
 void ilist_traits<remniw::AsmInstruction>::deleteNode(remniw::AsmInstruction *I) {
-    I->deleteValue();
+    // I has been removed from the list and no longer knows its parent.
+    Parent->deallocateInst(I);
 }
 
 };  // namespace llvm
 
 namespace remniw {
 
+AsmInstruction *AsmInstruction::create(unsigned Opcode, AsmFunction *InsertAtEnd) {
+    assert(InsertAtEnd && "Function to append to must not be NULL!");
+    return new (InsertAtEnd->allocateInst()) AsmInstruction(Opcode, InsertAtEnd);
+}
+
+AsmInstruction *AsmInstruction::create(unsigned Opcode, AsmInstruction *InsertBefore) {
+    assert(InsertBefore && "Instruction to insert before must not be NULL!");
+    AsmFunction *F = InsertBefore->getParent();
+    assert(F && "Instruction to insert before is not in a Function!");
+    return new (F->allocateInst()) AsmInstruction(Opcode, InsertBefore);
+}
+
 AsmInstruction::AsmInstruction(unsigned Opcode, AsmFunction *InsertAtEnd):
     Opcode(Opcode), Parent(nullptr) {
-    assert(InsertAtEnd && "Function to append to must not be NULL!");
     InsertAtEnd->getInstList().push_back(this);
 }
 
 AsmInstruction::AsmInstruction(unsigned Opcode, AsmInstruction *InsertBefore):
     Opcode(Opcode), Parent(nullptr) {
-    assert(InsertBefore && "Instruction to insert before must not be NULL!");
-    AsmFunction *F = InsertBefore->getParent();
-    assert(F && "Instruction to insert before is not in a Function!");
-    F->getInstList().insert(InsertBefore->getIterator(), this);
+    InsertBefore->getParent()->getInstList().insert(InsertBefore->getIterator(), this);
 }
 
 void AsmInstruction::removeFromParent() {
     getParent()->getInstList().remove(getIterator());
 }
 
-void AsmInstruction::deleteValue() {
-    delete this;
+void AsmInstruction::eraseFromParent() {
+    getParent()->getInstList().erase(getIterator());
 }
 
 void AsmInstruction::print(llvm::raw_ostream &OS) const {
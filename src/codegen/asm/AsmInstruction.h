@@ -36,15 +36,13 @@ public:
 
 namespace remniw {
 
+// AsmInstructions are allocated by the AsmFunction they are inserted into, and are
+// recycled by it when they are erased, see AsmFunction::allocateInst().
 class AsmInstruction: public llvm::ilist_node_with_parent<AsmInstruction, AsmFunction> {
 public:
-    static AsmInstruction *create(unsigned Opcode, AsmFunction *InsertAtEnd) {
-        return new AsmInstruction(Opcode, InsertAtEnd);
-    }
+    static AsmInstruction *create(unsigned Opcode, AsmFunction *InsertAtEnd);
 
-    static AsmInstruction *create(unsigned Opcode, AsmInstruction *InsertBefore) {
-        return new AsmInstruction(Opcode, InsertBefore);
-    }
+    static AsmInstruction *create(unsigned Opcode, AsmInstruction *InsertBefore);
 
     inline const AsmFunction *getParent() const { return Parent; }
 
@@ -54,6 +52,8 @@ public:
 
     void removeFromParent();
 
+    void eraseFromParent();
+
     unsigned getNumOperands() const { return Operands.size(); }
 
     void setOperand(unsigned i, AsmOperand Op) { Operands[i] = std::move(Op); }
@@ -66,8 +66,6 @@ public:
     void setOpcode(unsigned Op) { Opcode = Op; }
     unsigned getOpcode() const { return Opcode; }
 
-    void deleteValue();
-
     void print(llvm::raw_ostream &OS) const;
 
 private:
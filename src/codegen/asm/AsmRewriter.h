@@ -1,67 +1,113 @@
 #pragma once
 
 #include "codegen/asm/AsmFunction.h"
+#include "codegen/asm/BinpackingRegisterAllocator.h"
+#include "codegen/asm/GraphColoringRegisterAllocator.h"
 #include "codegen/asm/RegisterAllocator.h"
 #include "codegen/asm/TargetInfo.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/SetVector.h"
 #include "llvm/Support/Alignment.h"
+#include <memory>
 
 namespace remniw {
 
 class AsmRewriter {
 private:
     const TargetInfo &TI;
-    LinearScanRegisterAllocator LSRA;
+    std::unique_ptr<RegisterAllocator> RA;
     AsmFunction *CurrentFunction;
+    // The spill code inserted by the graph coloring allocator while it runs, when
+    // the saved registers are not known yet, see rewrite().
+    llvm::SmallVector<AsmInstruction *> MovesInsertedByRegAlloc;
 
 protected:
     uint32_t NumSpilledReg;
     uint32_t NumReversedStackSlotForReg;
     uint32_t MaxNumReversedStackSlotForReg;
+    // The size of the area between the frame pointer and the local frame, where
+    // registers are saved by the prologue.
+    int64_t SavedRegsAreaSize;
 
 public:
-    AsmRewriter(const TargetInfo &TI): TI(TI), LSRA(TI) {}
+    AsmRewriter(const TargetInfo &TI, RegAllocKind Kind):
+        TI(TI), RA(createRegisterAllocator(TI, Kind)) {}
     virtual ~AsmRewriter() = default;
 
     void rewrite(llvm::SmallVector<std::unique_ptr<AsmFunction>> &AsmFunctions) {
-        for (auto &F : AsmFunctions) {
-            if (F->empty())
-                continue;
-
-            CurrentFunction = F.get();
-            NumSpilledReg = 0;
-            NumReversedStackSlotForReg = 0;
-            MaxNumReversedStackSlotForReg = 0;
-
-            // Register allocation, assign physical registers or spilled stack slots to
-            // virtual registers.
-            LSRA.doRegAlloc(CurrentFunction->RegLiveRangesMap);
-            const llvm::DenseMap<uint32_t, uint32_t> &VirtToAllocRegMap =
-                LSRA.getVirtRegToAllocatedRegMap();
-            NumSpilledReg = LSRA.getSpilledRegCount();
-
-            // Rewrite virtual registers to physical registers or spilled stack slots.
-            // First, if any virtual regsiters are assigned to physical registers, rewrite
-            // instructions.
-            for (auto &AsmInst : *CurrentFunction)
-                rewriteAsmInstVirtRegToPhysReg(&AsmInst, VirtToAllocRegMap);
-            // At this point, if there is any virtual register still used in instructions,
-            // the virtual register must be spilled to stack slot.
-            for (auto &AsmInst : *CurrentFunction)
-                rewriteAsmInstSpilledRegToStackSlot(&AsmInst, VirtToAllocRegMap);
-
-            // Insert prologue and epilogue.
-            llvm::SetVector<uint32_t> UsedCalleeSavedRegs;
-            for (auto p : VirtToAllocRegMap) {
-                if (TI.isCalleeSavedRegister(p.second))
-                    UsedCalleeSavedRegs.insert(p.second);
-            }
-            insertPrologue(CurrentFunction, UsedCalleeSavedRegs);
-            insertEpilogue(CurrentFunction, UsedCalleeSavedRegs);
+        for (auto &F : AsmFunctions)
+            rewrite(F.get());
+    }
 
-            adjustStackFrame(CurrentFunction);
+    // Rewrite a single function. The register allocator and the rewriter keep
+    // per-function state, so each thread needs its own AsmRewriter to rewrite
+    // functions concurrently.
+    void rewrite(AsmFunction *F) {
+        if (F->empty())
+            return;
+
+        CurrentFunction = F;
+        NumSpilledReg = 0;
+        NumReversedStackSlotForReg = 0;
+        MaxNumReversedStackSlotForReg = 0;
+        SavedRegsAreaSize = 0;
+
+        // Register allocation, assign physical registers or spilled stack slots to
+        // virtual registers.
+        RA->doRegAlloc(CurrentFunction);
+        const llvm::DenseMap<uint32_t, uint32_t> &VirtToAllocRegMap =
+            RA->getVirtRegToAllocatedRegMap();
+        NumSpilledReg = RA->getSpilledRegCount();
+
+        // The spill slots are addressed from the frame pointer, below the saved
+        // registers and the local frame, so the saved registers must be known
+        // before the spilled registers are rewritten.
+        llvm::SetVector<uint32_t> UsedCalleeSavedRegs;
+        for (auto p : VirtToAllocRegMap) {
+            if (TI.isCalleeSavedRegister(p.second))
+                UsedCalleeSavedRegs.insert(p.second);
+        }
+        SavedRegsAreaSize = getSavedRegsAreaSize(CurrentFunction, UsedCalleeSavedRegs);
+        for (auto *I : MovesInsertedByRegAlloc) {
+            for (unsigned i = 0; i < I->getNumOperands(); ++i) {
+                AsmOperand &Op = I->getOperand(i);
+                if (Op.isMem() && Op.Mem.BaseReg == TI.getFramePointerRegister())
+                    Op.Mem.Disp -= SavedRegsAreaSize;
+            }
         }
+        MovesInsertedByRegAlloc.clear();
+
+        // Insert the moves between the parts of split live intervals, which spill
+        // and reload values or move them between registers.
+        for (const auto &M : RA->getMoves())
+            insertMove(M.InsertBefore, M.Src, M.Dst);
+
+        // Remove the copies between registers which are assigned the same location,
+        // e.g. the copies coalesced by the register allocator.
+        for (auto It = CurrentFunction->begin(); It != CurrentFunction->end();) {
+            AsmInstruction &AsmInst = *It++;
+            uint32_t Src, Dst;
+            if (TI.isRegisterCopy(AsmInst, Src, Dst) &&
+                getAllocatedReg(Src, VirtToAllocRegMap) ==
+                    getAllocatedReg(Dst, VirtToAllocRegMap))
+                AsmInst.eraseFromParent();
+        }
+
+        // Rewrite virtual registers to physical registers or spilled stack slots.
+        // First, if any virtual regsiters are assigned to physical registers, rewrite
+        // instructions.
+        for (auto &AsmInst : *CurrentFunction)
+            rewriteAsmInstVirtRegToPhysReg(&AsmInst, VirtToAllocRegMap);
+        // At this point, if there is any virtual register still used in instructions,
+        // the virtual register must be spilled to stack slot.
+        for (auto &AsmInst : *CurrentFunction)
+            rewriteAsmInstSpilledRegToStackSlot(&AsmInst, VirtToAllocRegMap);
+
+        // Insert prologue and epilogue.
+        insertPrologue(CurrentFunction, UsedCalleeSavedRegs);
+        insertEpilogue(CurrentFunction, UsedCalleeSavedRegs);
+
+        adjustStackFrame(CurrentFunction);
     }
 
     void rewriteAsmOperandVirtRegToPhysReg(
@@ -91,22 +137,46 @@ public:
         }
     }
 
+    static uint32_t
+    getAllocatedReg(uint32_t Reg,
+                    const llvm::DenseMap<uint32_t, uint32_t> &VirtToAllocRegMap) {
+        if (Register::isVirtualRegister(Reg))
+            return VirtToAllocRegMap.lookup(Reg);
+        return Reg;
+    }
+
     int64_t getStackSlotOffsetForSpilledReg(uint32_t RegNo) {
         assert(Register::isStackSlot(RegNo) && "Must be StackSlot");
         uint32_t StackSlotIndex = Register::stackSlot2Index(RegNo);
-        return -(CurrentFunction->LocalFrameSize +
+        return -(SavedRegsAreaSize + CurrentFunction->LocalFrameSize +
                  TI.getRegisterSize() * (StackSlotIndex + 1));
     }
 
     int64_t getReservedStackSlotOffsetForReg() {
         NumReversedStackSlotForReg++;
         int64_t Offset =
-            -(CurrentFunction->LocalFrameSize + TI.getRegisterSize() * NumSpilledReg +
+            -(SavedRegsAreaSize + CurrentFunction->LocalFrameSize +
+              TI.getRegisterSize() * NumSpilledReg +
               TI.getRegisterSize() * NumReversedStackSlotForReg);
         return Offset;
     }
 
 private:
+    std::unique_ptr<RegisterAllocator> createRegisterAllocator(const TargetInfo &TI,
+                                                               RegAllocKind Kind) {
+        switch (Kind) {
+        case GreedyRegAlloc: return std::make_unique<BinpackingRegisterAllocator>(TI);
+        case LinearScanRegAlloc: return std::make_unique<LinearScanRegisterAllocator>(TI);
+        case GraphColoringRegAlloc:
+            return std::make_unique<GraphColoringRegisterAllocator>(
+                TI, [this](AsmInstruction *InsertBefore, uint32_t Src, uint32_t Dst) {
+                    insertMove(InsertBefore, Src, Dst);
+                    MovesInsertedByRegAlloc.push_back(InsertBefore->getPrevNode());
+                });
+        }
+        llvm_unreachable("Invalid register allocator");
+    }
+
     virtual void rewriteAsmInstVirtRegToPhysReg(
         AsmInstruction *I,
         const llvm::DenseMap<uint32_t, uint32_t> &VirtToAllocRegMap) = 0;
@@ -115,6 +185,13 @@ private:
         AsmInstruction *I,
         const llvm::DenseMap<uint32_t, uint32_t> &VirtToAllocRegMap) = 0;
 
+    // Insert a move between physical registers or stack slots before InsertBefore.
+    virtual void insertMove(AsmInstruction *InsertBefore, uint32_t Src, uint32_t Dst) = 0;
+
+    virtual int64_t
+    getSavedRegsAreaSize(AsmFunction *F,
+                         const llvm::SetVector<uint32_t> &UsedCalleeSavedRegs) const = 0;
+
     virtual void insertPrologue(AsmFunction *F,
                                 llvm::SetVector<uint32_t> &UsedCalleeSavedRegs) = 0;
 
@@ -0,0 +1,621 @@
+#pragma once
+
+#include "codegen/asm/AsmFunction.h"
+#include "codegen/asm/AsmInstruction.h"
+#include "codegen/asm/LivenessAnalysis.h"
+#include "codegen/asm/Register.h"
+#include "codegen/asm/RegisterAllocator.h"
+#include "codegen/asm/TargetInfo.h"
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/ErrorHandling.h"
+#include <algorithm>
+#include <memory>
+#include <queue>
+#include <vector>
+
+#define DEBUG_TYPE "remniw-BinpackingRegisterAllocator"
+
+namespace remniw {
+
+// Second-chance binpacking register allocation, a linear scan allocator which
+// keeps lifetime holes and splits lifetime intervals, in the style of Wimmer and
+// Franz.
+//
+// The instruction with index i is numbered 2*i. An instruction reads its operands
+// at 2*i and writes its results at 2*i+1, so a value which dies at an instruction
+// and the value defined by it can share a register. The lifetime interval of each
+// register is built from the liveness on the control flow graph, so a register
+// that is not live, e.g. between its last use in a loop and its redefinition at
+// the end of the loop, leaves a hole which can be filled by other intervals.
+//
+// When no register is free for a whole interval, the interval is split at an
+// instruction boundary. A part without uses lives in the stack slot of its
+// virtual register, and the value gets a second chance to be in a register
+// right before its next use. Each part is renamed to a new virtual register.
+// Moves between the locations of adjacent parts are inserted at the split
+// positions inside blocks, and on the control flow edges where the location of
+// a value at the end of the predecessor and at the beginning of the successor
+// differ. Critical edges must have been split.
+class BinpackingRegisterAllocator: public RegisterAllocator {
+private:
+    static constexpr unsigned MaxPosition = ~0U;
+
+    struct Range {
+        unsigned Start;
+        unsigned End;
+    };
+
+    struct Interval {
+        uint32_t Reg;
+        // The physical register or the stack slot assigned to this interval.
+        uint32_t Location {Register::NoRegister};
+        bool Fixed {false};
+        llvm::SmallVector<Range, 4> Ranges;
+        llvm::SmallVector<unsigned, 8> UsePositions;
+        Interval *Parent {this};
+        // The parts of a split interval ordered by position, only valid for the
+        // parent, which is the first part.
+        llvm::SmallVector<Interval *, 1> Children {this};
+        uint32_t SpillSlot {Register::NoRegister};
+
+        unsigned start() const { return Ranges.front().Start; }
+        unsigned end() const { return Ranges.back().End; }
+
+        bool covers(unsigned Pos) const {
+            for (const auto &R : Ranges) {
+                if (Pos < R.Start)
+                    return false;
+                if (Pos < R.End)
+                    return true;
+            }
+            return false;
+        }
+
+        unsigned nextUseAfter(unsigned Pos) const {
+            auto It = std::lower_bound(UsePositions.begin(), UsePositions.end(), Pos);
+            return It == UsePositions.end() ? MaxPosition : *It;
+        }
+
+        unsigned nextIntersection(const Interval &Other) const {
+            auto I = Ranges.begin(), IE = Ranges.end();
+            auto J = Other.Ranges.begin(), JE = Other.Ranges.end();
+            while (I != IE && J != JE) {
+                if (I->End <= J->Start)
+                    ++I;
+                else if (J->End <= I->Start)
+                    ++J;
+                else
+                    return std::max(I->Start, J->Start);
+            }
+            return MaxPosition;
+        }
+    };
+
+    struct IntervalStartPointGreaterCompare {
+        bool operator()(const Interval *LHS, const Interval *RHS) const {
+            return LHS->start() > RHS->start() ||
+                   (LHS->start() == RHS->start() && LHS->Reg > RHS->Reg);
+        }
+    };
+
+    using Block = LivenessAnalysis::Block;
+
+    const TargetInfo &TI;
+    LivenessAnalysis LA;
+    const std::vector<AsmInstruction *> &Insts;
+    const std::vector<Block> &Blocks;
+    AsmFunction *F;
+    unsigned NumVirtRegs;
+    unsigned NumPhysRegs;
+    std::vector<std::unique_ptr<Interval>> Intervals;
+    std::vector<Interval *> VirtRegIntervals;
+    std::vector<Interval *> FixedIntervals;
+    std::priority_queue<Interval *, std::vector<Interval *>,
+                        IntervalStartPointGreaterCompare>
+        Unhandled;
+    llvm::SmallVector<Interval *> Active;
+    llvm::SmallVector<Interval *> Inactive;
+    llvm::DenseMap<uint32_t, uint32_t> VirtRegToAllocatedRegMap;
+    llvm::SmallVector<Move> Moves;
+    unsigned NumStackSlots;
+    uint32_t ScratchStackSlot;
+
+public:
+    BinpackingRegisterAllocator(const TargetInfo &TI):
+        TI(TI), LA(TI), Insts(LA.getInstructions()), Blocks(LA.getBlocks()),
+        NumPhysRegs(LA.getNumPhysRegs()) {}
+
+    // Allocate registers for AsmFunction F. The virtual registers of split
+    // intervals are renamed in the instructions of F, the moves between the parts
+    // are returned by getMoves() and must be inserted by the caller.
+    void doRegAlloc(AsmFunction *AsmFn) override {
+        // Reset the internal states
+        F = AsmFn;
+        NumVirtRegs = F->getNumVirtRegs();
+        Intervals.clear();
+        VirtRegIntervals.assign(NumVirtRegs, nullptr);
+        FixedIntervals.assign(NumPhysRegs, nullptr);
+        Unhandled = {};
+        Active.clear();
+        Inactive.clear();
+        VirtRegToAllocatedRegMap.clear();
+        Moves.clear();
+        NumStackSlots = 0;
+        ScratchStackSlot = Register::NoRegister;
+
+        LA.compute(F);
+        buildIntervals();
+        linearScan();
+        resolveMoves();
+        renameVirtRegs();
+
+        LLVM_DEBUG(printRegAllocResults(););
+    }
+
+    const llvm::DenseMap<uint32_t, uint32_t> &getVirtRegToAllocatedRegMap() override {
+        return VirtRegToAllocatedRegMap;
+    }
+
+    std::size_t getSpilledRegCount() override { return NumStackSlots; }
+
+    llvm::ArrayRef<Move> getMoves() override { return Moves; }
+
+    void printRegAllocResults() override {
+        for (const auto &I : Intervals) {
+            llvm::outs()
+                << (I->Fixed ? "Fixed Physical Register: " : "Virtual Register: ")
+                << I->Reg;
+            if (!I->Fixed) {
+                llvm::outs() << " (parent " << I->Parent->Reg << ") assigned "
+                             << I->Location;
+            }
+            llvm::outs() << ",";
+            for (const auto &R : I->Ranges)
+                llvm::outs() << " [" << R.Start << "," << R.End << ")";
+            llvm::outs() << "\n";
+        }
+        for (const auto &M : Moves)
+            llvm::outs() << "Move " << M.Src << " -> " << M.Dst << "\n";
+    }
+
+private:
+    Interval *getOrCreateInterval(unsigned LivenessIndex) {
+        bool IsVirtReg = LivenessIndex < NumVirtRegs;
+        Interval *&I = IsVirtReg ? VirtRegIntervals[LivenessIndex]
+                                 : FixedIntervals[LivenessIndex - NumVirtRegs];
+        if (!I) {
+            Intervals.push_back(std::make_unique<Interval>());
+            I = Intervals.back().get();
+            if (IsVirtReg) {
+                I->Reg = Register::index2VirtReg(LivenessIndex);
+            } else {
+                I->Reg = I->Location = LivenessIndex - NumVirtRegs;
+                I->Fixed = true;
+            }
+        }
+        return I;
+    }
+
+    // The intervals are built by walking the blocks and instructions backwards, so
+    // ranges and use positions are added in decreasing order. They are kept in
+    // reverse order while building, with the lowest one at the back.
+    static void addRange(Interval *I, unsigned Start, unsigned End) {
+        if (!I->Ranges.empty() && I->Ranges.back().Start <= End) {
+            I->Ranges.back().Start = std::min(I->Ranges.back().Start, Start);
+            I->Ranges.back().End = std::max(I->Ranges.back().End, End);
+        } else {
+            I->Ranges.push_back({Start, End});
+        }
+    }
+
+    static void addDef(Interval *I, unsigned Pos) {
+        // A value which is not live after its definition still occupies the
+        // register while it is written.
+        if (!I->Ranges.empty() && I->Ranges.back().Start <= Pos)
+            I->Ranges.back().Start = Pos;
+        else
+            I->Ranges.push_back({Pos, Pos + 1});
+    }
+
+    static void addUsePosition(Interval *I, unsigned Pos) {
+        if (I->Fixed)
+            return;
+        if (I->UsePositions.empty() || I->UsePositions.back() != Pos)
+            I->UsePositions.push_back(Pos);
+    }
+
+    void buildIntervals() {
+        llvm::SmallVector<uint32_t, 8> Uses, Defs;
+        for (auto &B : llvm::reverse(Blocks)) {
+            unsigned BlockFrom = 2 * B.Begin, BlockTo = 2 * B.End;
+            llvm::BitVector LiveOut = LA.getLiveOut(B);
+            for (unsigned Index : LiveOut.set_bits())
+                addRange(getOrCreateInterval(Index), BlockFrom, BlockTo);
+
+            for (unsigned i = B.End; i-- > B.Begin;) {
+                Uses.clear();
+                Defs.clear();
+                LA.getUsesAndDefs(*Insts[i], Uses, Defs);
+                for (uint32_t Reg : Defs) {
+                    Interval *I = getOrCreateInterval(LA.getLivenessIndex(Reg));
+                    addDef(I, 2 * i + 1);
+                    addUsePosition(I, 2 * i + 1);
+                }
+                for (uint32_t Reg : Uses) {
+                    Interval *I = getOrCreateInterval(LA.getLivenessIndex(Reg));
+                    addRange(I, BlockFrom, 2 * i + 1);
+                    addUsePosition(I, 2 * i);
+                }
+            }
+        }
+
+        for (auto &I : Intervals) {
+            std::reverse(I->Ranges.begin(), I->Ranges.end());
+            std::reverse(I->UsePositions.begin(), I->UsePositions.end());
+        }
+    }
+
+    void linearScan() {
+        for (auto &I : Intervals) {
+            if (I->Fixed)
+                Inactive.push_back(I.get());
+            else
+                Unhandled.push(I.get());
+        }
+
+        while (!Unhandled.empty()) {
+            Interval *Current = Unhandled.top();
+            Unhandled.pop();
+            unsigned Position = Current->start();
+
+            // Intervals which have ended are dropped, intervals in a lifetime hole
+            // at Position are inactive.
+            llvm::SmallVector<Interval *> NewActive, NewInactive;
+            for (Interval *I : Active) {
+                if (I->end() <= Position)
+                    continue;
+                (I->covers(Position) ? NewActive : NewInactive).push_back(I);
+            }
+            for (Interval *I : Inactive) {
+                if (I->end() <= Position)
+                    continue;
+                (I->covers(Position) ? NewActive : NewInactive).push_back(I);
+            }
+            Active = std::move(NewActive);
+            Inactive = std::move(NewInactive);
+
+            if (!tryAllocateFreeReg(Current))
+                allocateBlockedReg(Current);
+            if (Register::isPhysicalRegister(Current->Location))
+                Active.push_back(Current);
+        }
+    }
+
+    bool tryAllocateFreeReg(Interval *Current) {
+        llvm::SmallVector<unsigned, 32> FreeUntilPos(NumPhysRegs, MaxPosition);
+        for (Interval *I : Active)
+            FreeUntilPos[I->Location] = 0;
+        for (Interval *I : Inactive) {
+            unsigned Pos = I->nextIntersection(*Current);
+            FreeUntilPos[I->Location] = std::min(FreeUntilPos[I->Location], Pos);
+        }
+
+        // Best fit: prefer the register which is free for the whole interval and
+        // gets occupied first after it, so that registers which are free for a long
+        // time, e.g. callee-saved registers, are left for longer intervals.
+        uint32_t Reg = Register::NoRegister;
+        for (uint32_t R : TI.getFreeRegistersForRegisterAllocator()) {
+            if (FreeUntilPos[R] >= Current->end() &&
+                (Reg == Register::NoRegister || FreeUntilPos[R] < FreeUntilPos[Reg]))
+                Reg = R;
+        }
+        if (Reg != Register::NoRegister) {
+            Current->Location = Reg;
+            return true;
+        }
+
+        // Otherwise the register which is free for the longest time gets the first
+        // part of the interval. Intervals are split before instructions.
+        unsigned SplitPos = 0;
+        for (uint32_t R : TI.getFreeRegistersForRegisterAllocator()) {
+            unsigned Pos = FreeUntilPos[R] & ~1U;
+            if (Pos > Current->start() && Pos > SplitPos) {
+                Reg = R;
+                SplitPos = Pos;
+            }
+        }
+        if (Reg == Register::NoRegister)
+            return false;
+        Current->Location = Reg;
+        Unhandled.push(splitInterval(Current, SplitPos));
+        return true;
+    }
+
+    void allocateBlockedReg(Interval *Current) {
+        unsigned Start = Current->start();
+        // Intervals occupying the register are split before the instruction at
+        // Start, so their uses by this instruction count as well.
+        unsigned EvictPos = Start & ~1U;
+        llvm::SmallVector<unsigned, 32> NextUsePos(NumPhysRegs, MaxPosition);
+        llvm::SmallVector<unsigned, 32> BlockPos(NumPhysRegs, MaxPosition);
+        for (Interval *I : Active) {
+            if (I->Fixed) {
+                NextUsePos[I->Location] = BlockPos[I->Location] = 0;
+            } else {
+                NextUsePos[I->Location] =
+                    std::min(NextUsePos[I->Location], I->nextUseAfter(EvictPos));
+            }
+        }
+        for (Interval *I : Inactive) {
+            unsigned Pos = I->nextIntersection(*Current);
+            if (Pos == MaxPosition)
+                continue;
+            if (I->Fixed) {
+                BlockPos[I->Location] = std::min(BlockPos[I->Location], Pos);
+                NextUsePos[I->Location] = std::min(NextUsePos[I->Location], Pos);
+            } else {
+                NextUsePos[I->Location] =
+                    std::min(NextUsePos[I->Location], I->nextUseAfter(EvictPos));
+            }
+        }
+
+        // Pick the register whose next use is farthest away, a register blocked by
+        // a fixed interval before the next instruction can not be used at all.
+        uint32_t Reg = Register::NoRegister;
+        for (uint32_t R : TI.getFreeRegistersForRegisterAllocator()) {
+            if ((BlockPos[R] & ~1U) <= Start)
+                NextUsePos[R] = 0;
+            if (Reg == Register::NoRegister || NextUsePos[R] > NextUsePos[Reg])
+                Reg = R;
+        }
+
+        unsigned FirstUse = Current->nextUseAfter(Start);
+        if (NextUsePos[Reg] <= FirstUse) {
+            // All other intervals are used before current, spill current until its
+            // first use, unless current needs a register immediately.
+            if (FirstUse == MaxPosition) {
+                assignSpillSlot(Current);
+                return;
+            }
+            unsigned SplitPos = FirstUse & ~1U;
+            if (SplitPos > Start) {
+                Unhandled.push(splitInterval(Current, SplitPos));
+                assignSpillSlot(Current);
+                return;
+            }
+        }
+        // Intervals which are used before Start can not be split before their use
+        // any more.
+        if (NextUsePos[Reg] == 0 || NextUsePos[Reg] < Start)
+            llvm::report_fatal_error("ran out of registers during register allocation");
+
+        // Spill the intervals occupying Reg, current takes it until it is blocked by
+        // a fixed interval.
+        Current->Location = Reg;
+        if (BlockPos[Reg] < Current->end())
+            Unhandled.push(splitInterval(Current, BlockPos[Reg] & ~1U));
+        llvm::erase_if(Active, [&](Interval *I) {
+            if (I->Fixed || I->Location != Reg)
+                return false;
+            splitAndSpillInterval(I, EvictPos);
+            return true;
+        });
+        llvm::erase_if(Inactive, [&](Interval *I) {
+            if (I->Fixed || I->Location != Reg ||
+                I->nextIntersection(*Current) == MaxPosition)
+                return false;
+            // I is in a lifetime hole at Start.
+            splitAndSpillInterval(I, (Start + 1) & ~1U);
+            return true;
+        });
+    }
+
+    // Split I at Pos, which must be the position of an instruction. The part of
+    // I after Pos is returned as a new interval.
+    Interval *splitInterval(Interval *I, unsigned Pos) {
+        assert(Pos % 2 == 0 && I->start() < Pos && Pos < I->end());
+        Intervals.push_back(std::make_unique<Interval>());
+        Interval *Child = Intervals.back().get();
+        Child->Reg = F->createVirtReg();
+        Child->Parent = I->Parent;
+        Child->Children.clear();
+
+        auto RangeIt =
+            llvm::find_if(I->Ranges, [&](const Range &R) { return Pos < R.End; });
+        Child->Ranges.append(RangeIt, I->Ranges.end());
+        I->Ranges.erase(RangeIt, I->Ranges.end());
+        if (Child->Ranges.front().Start < Pos) {
+            I->Ranges.push_back({Child->Ranges.front().Start, Pos});
+            Child->Ranges.front().Start = Pos;
+        }
+
+        auto UseIt =
+            std::lower_bound(I->UsePositions.begin(), I->UsePositions.end(), Pos);
+        Child->UsePositions.append(UseIt, I->UsePositions.end());
+        I->UsePositions.erase(UseIt, I->UsePositions.end());
+
+        auto &Children = I->Parent->Children;
+        Children.insert(llvm::find(Children, I) + 1, Child);
+        return Child;
+    }
+
+    // Spill I from Pos until its next use, where it is reloaded.
+    void splitAndSpillInterval(Interval *I, unsigned Pos) {
+        Interval *Spilled = I;
+        if (Pos > I->start())
+            Spilled = splitInterval(I, Pos);
+        unsigned NextUse = Spilled->nextUseAfter(Spilled->start());
+        if (NextUse == MaxPosition) {
+            assignSpillSlot(Spilled);
+            return;
+        }
+        unsigned ReloadPos = NextUse & ~1U;
+        if (ReloadPos > Spilled->start()) {
+            Unhandled.push(splitInterval(Spilled, ReloadPos));
+            assignSpillSlot(Spilled);
+        } else {
+            Spilled->Location = Register::NoRegister;
+            Unhandled.push(Spilled);
+        }
+    }
+
+    void assignSpillSlot(Interval *I) {
+        if (I->Parent->SpillSlot == Register::NoRegister)
+            I->Parent->SpillSlot = Register::index2StackSlot(NumStackSlots++);
+        I->Location = I->Parent->SpillSlot;
+    }
+
+    // Return the part of the interval of a virtual register which covers Pos.
+    Interval *getIntervalAt(Interval *Parent, unsigned Pos) const {
+        auto &Children = Parent->Children;
+        auto It = std::upper_bound(
+            Children.begin(), Children.end(), Pos,
+            [](unsigned Pos, const Interval *I) { return Pos < I->start(); });
+        if (It == Children.begin() || !(*std::prev(It))->covers(Pos))
+            return nullptr;
+        return *std::prev(It);
+    }
+
+    struct PendingMove {
+        unsigned InsertBefore;
+        // Moves before the same instruction are ordered by the position at which
+        // they take effect: moves at the beginning of a block, moves at split
+        // positions, then moves at the end of a block.
+        unsigned Order;
+        uint32_t Src;
+        uint32_t Dst;
+    };
+
+    void resolveMoves() {
+        llvm::SmallVector<PendingMove> PendingMoves;
+        llvm::BitVector IsBlockBegin(Insts.size() + 1);
+        for (const auto &B : Blocks)
+            IsBlockBegin.set(B.Begin);
+
+        // Moves at the split positions inside blocks. Values which are live at the
+        // beginning of a block are handled with the control flow edges.
+        for (Interval *Parent : VirtRegIntervals) {
+            if (!Parent)
+                continue;
+            for (unsigned i = 1; i < Parent->Children.size(); ++i) {
+                Interval *Prev = Parent->Children[i - 1];
+                Interval *Next = Parent->Children[i];
+                unsigned Pos = Next->start();
+                if (Prev->end() != Pos || IsBlockBegin.test(Pos / 2) ||
+                    Prev->Location == Next->Location)
+                    continue;
+                PendingMoves.push_back({Pos / 2, 1, Prev->Location, Next->Location});
+            }
+        }
+
+        // Moves on the control flow edges.
+        for (const auto &B : Blocks) {
+            for (unsigned SuccIndex : B.Succs) {
+                const Block &Succ = Blocks[SuccIndex];
+                unsigned InsertBefore, Order;
+                if (B.Succs.size() == 1 && !B.HasConditionalBranch) {
+                    InsertBefore = B.FirstTerminator;
+                    Order = 2;
+                } else {
+                    InsertBefore = Succ.Begin + 1;
+                    Order = 0;
+                }
+                for (unsigned Index : Succ.LiveIn.set_bits()) {
+                    if (Index >= NumVirtRegs)
+                        break;
+                    Interval *From =
+                        getIntervalAt(VirtRegIntervals[Index], 2 * B.End - 1);
+                    Interval *To = getIntervalAt(VirtRegIntervals[Index], 2 * Succ.Begin);
+                    assert(From && To && "Live-in value is not covered");
+                    if (From->Location == To->Location)
+                        continue;
+                    if (Order == 0 && Succ.Preds.size() != 1)
+                        llvm::report_fatal_error(
+                            "can not insert moves on a critical edge");
+                    assert(InsertBefore < Insts.size());
+                    PendingMoves.push_back(
+                        {InsertBefore, Order, From->Location, To->Location});
+                }
+            }
+        }
+
+        std::stable_sort(PendingMoves.begin(), PendingMoves.end(),
+                         [](const PendingMove &LHS, const PendingMove &RHS) {
+                             return std::make_pair(LHS.InsertBefore, LHS.Order) <
+                                    std::make_pair(RHS.InsertBefore, RHS.Order);
+                         });
+        for (auto It = PendingMoves.begin(); It != PendingMoves.end();) {
+            auto GroupEnd = std::find_if(It, PendingMoves.end(), [&](const auto &M) {
+                return M.InsertBefore != It->InsertBefore || M.Order != It->Order;
+            });
+            llvm::SmallVector<std::pair<uint32_t, uint32_t>> Group;
+            for (auto MoveIt = It; MoveIt != GroupEnd; ++MoveIt)
+                Group.push_back({MoveIt->Src, MoveIt->Dst});
+            sequentializeMoves(Insts[It->InsertBefore], Group);
+            It = GroupEnd;
+        }
+    }
+
+    // The moves of a group take effect at the same position. Emit a move once no
+    // other pending move reads its destination. When only cycles are left, which
+    // consist of registers, as each interval has its own stack slot, one register
+    // is saved in a scratch stack slot first.
+    void sequentializeMoves(AsmInstruction *InsertBefore,
+                            llvm::SmallVectorImpl<std::pair<uint32_t, uint32_t>> &Group) {
+        while (!Group.empty()) {
+            auto Ready = llvm::find_if(Group, [&](const auto &M) {
+                return llvm::none_of(Group, [&](const auto &Other) {
+                    return &Other != &M && Other.first == M.second;
+                });
+            });
+            if (Ready != Group.end()) {
+                Moves.push_back({InsertBefore, Ready->first, Ready->second});
+                Group.erase(Ready);
+                continue;
+            }
+            if (ScratchStackSlot == Register::NoRegister)
+                ScratchStackSlot = Register::index2StackSlot(NumStackSlots++);
+            uint32_t Saved = Group.front().first;
+            Moves.push_back({InsertBefore, Saved, ScratchStackSlot});
+            for (auto &M : Group)
+                if (M.first == Saved)
+                    M.first = ScratchStackSlot;
+        }
+    }
+
+    void renameVirtRegs() {
+        auto Rename = [&](uint32_t &Reg, unsigned Pos) {
+            if (!Register::isVirtualRegister(Reg))
+                return;
+            Interval *I =
+                getIntervalAt(VirtRegIntervals[Register::virtReg2Index(Reg)], Pos);
+            assert(I && Register::isPhysicalRegister(I->Location) &&
+                   "A used virtual register must be in a physical register");
+            Reg = I->Reg;
+        };
+        for (unsigned i = 0; i < Insts.size(); ++i) {
+            AsmInstruction &I = *Insts[i];
+            for (unsigned OpNo = 0; OpNo < I.getNumOperands(); ++OpNo) {
+                AsmOperand &Op = I.getOperand(OpNo);
+                if (Op.isReg())
+                    Rename(Op.Reg.RegNo, TI.readsRegOperand(I, OpNo) ? 2 * i : 2 * i + 1);
+                if (Op.isMem()) {
+                    Rename(Op.Mem.BaseReg, 2 * i);
+                    Rename(Op.Mem.IndexReg, 2 * i);
+                }
+            }
+        }
+
+        for (const auto &I : Intervals)
+            if (!I->Fixed)
+                VirtRegToAllocatedRegMap[I->Reg] = I->Location;
+    }
+};
+
+}  // namespace remniw
+
+#undef DEBUG_TYPE
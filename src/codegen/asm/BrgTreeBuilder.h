@@ -9,6 +9,7 @@
 #include "codegen/asm/AsmSymbol.h"
 #include "codegen/asm/Register.h"
 #include "codegen/asm/TargetInfo.h"
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallVector.h"
@@ -17,6 +18,8 @@
 #include "llvm/IR/InstIterator.h"
 #include "llvm/IR/InstVisitor.h"
 #include "llvm/IR/Instructions.h"
+#include "llvm/Support/Allocator.h"
+#include "llvm/Transforms/Utils/BasicBlockUtils.h"
 
 struct burm_state;
 
@@ -29,13 +32,19 @@ enum BrgTerm {
     Reg,
     CallArgs,
     FuncArg,
+    PhiCopy,
 #define HANDLE_INST(N, OPC, CLASS) OPC,
 #include "llvm/IR/Instruction.def"
 #undef HANDLE_INST
 };
 
+// BrgTreeNodes are allocated in the arena of their BrgFunction and are never
+// destroyed one by one, see BrgFunction::Alloc.
 class BrgTreeNode {
 public:
+    // The largest number of kids of a node, e.g. a conditional BrgTerm::Br.
+    static constexpr unsigned MaxKids = 3;
+
     enum KindTy {
         UndefNode,
         InstNode,
@@ -46,13 +55,15 @@ public:
         CallArgsNode,  // actual call arguments
         FuncArgNode,   // formal function arguments
         AllocaNode,    // stack object
+        PhiCopyNode,   // copy of an incoming value to a phi node
     };
 
 private:
     burm_state *State;
     KindTy Kind;
     int Op;
-    std::vector<BrgTreeNode *> Kids;
+    BrgTreeNode *Kids[MaxKids];
+    uint8_t NumKids;
     bool ActionExecuted;
     union {
         llvm::Instruction *Inst;            // InstNode
@@ -62,17 +73,23 @@ private:
         remniw::AsmOperand::LabelOp Label;  // LabelNode
         llvm::Argument *FuncArg;            // FuncArgNode
         uint32_t StackObjectIndex;          // AllocaNode
-        // CallArgsNode make use of std::vector<BrgTreeNode *> Kids
+        // CallArgsNode make use of Kids
+        // PhiCopyNode make use of Kids
     };
 
-    BrgTreeNode(KindTy Kind, int Op): Kind(Kind), Op(Op), ActionExecuted(false) {}
+    BrgTreeNode(KindTy Kind, int Op, llvm::ArrayRef<BrgTreeNode *> Kids = {}):
+        Kind(Kind), Op(Op), ActionExecuted(false) {
+        setKids(Kids);
+    }
 
-    BrgTreeNode(KindTy Kind, int Op, std::vector<BrgTreeNode *> Kids):
-        Kind(Kind), Op(Op), Kids(Kids), ActionExecuted(false) {}
+    static BrgTreeNode *create(llvm::BumpPtrAllocator &Alloc, KindTy Kind, int Op,
+                               llvm::ArrayRef<BrgTreeNode *> Kids = {}) {
+        static_assert(std::is_trivially_destructible_v<BrgTreeNode>,
+                      "BrgTreeNodes are never destroyed");
+        return new (Alloc.Allocate<BrgTreeNode>()) BrgTreeNode(Kind, Op, Kids);
+    }
 
 public:
-    ~BrgTreeNode() {}
-
     KindTy getNodeKind() const { return Kind; }
 
     const char *getNodeKindString() {
@@ -86,6 +103,7 @@ public:
         case CallArgsNode: return "ArgsNode";
         case FuncArgNode: return "FuncArgNode";
         case AllocaNode: return "AllocaNode";
+        case PhiCopyNode: return "PhiCopyNode";
         }
         llvm_unreachable("Invalid NodeKind");
     };
@@ -96,29 +114,34 @@ public:
 
     void setState(burm_state *S) { State = S; }
 
-    // Note: The elements of std::vector are stored contiguously, so elements
-    // can be accessed using offsets to regular pointers to elements
-    BrgTreeNode **getKids() { return &Kids[0]; }
+    // olive accesses the kids using offsets to the returned pointer.
+    BrgTreeNode **getKids() { return Kids; }
 
-    std::vector<BrgTreeNode *> getKidsVector() { return Kids; }
+    llvm::ArrayRef<BrgTreeNode *> kids() const {
+        return llvm::ArrayRef<BrgTreeNode *>(Kids, NumKids);
+    }
 
-    void setKids(const std::vector<BrgTreeNode *> &Nodes) { Kids = Nodes; }
+    void setKids(llvm::ArrayRef<BrgTreeNode *> Nodes) {
+        assert(Nodes.size() <= MaxKids && "Too many kids");
+        std::copy(Nodes.begin(), Nodes.end(), Kids);
+        NumKids = static_cast<uint8_t>(Nodes.size());
+    }
 
     bool isActionExecuted() { return ActionExecuted; }
 
     void setActionExecuted() { ActionExecuted = true; }
 
-    static BrgTreeNode *getUndefNode() {
-        static BrgTreeNode Undef(KindTy::UndefNode, BrgTerm::Undef);
-        return &Undef;
+    static BrgTreeNode *createUndefNode(llvm::BumpPtrAllocator &Alloc) {
+        return create(Alloc, KindTy::UndefNode, BrgTerm::Undef);
     }
 
-    static BrgTreeNode *createInstNode(llvm::Instruction *I,
-                                       std::vector<BrgTreeNode *> Kids) {
+    static BrgTreeNode *createInstNode(llvm::BumpPtrAllocator &Alloc,
+                                       llvm::Instruction *I,
+                                       llvm::ArrayRef<BrgTreeNode *> Kids) {
         switch (I->getOpcode()) {
 #define HANDLE_INST(NUM, OPCODE, CLASS)                                                  \
     case llvm::Instruction::OPCODE: {                                                    \
-        auto *Ret = new BrgTreeNode(KindTy::InstNode, BrgTerm::OPCODE, Kids);            \
+        auto *Ret = create(Alloc, KindTy::InstNode, BrgTerm::OPCODE, Kids);              \
         Ret->Inst = I;                                                                   \
         return Ret;                                                                      \
     }
@@ -129,16 +152,17 @@ public:
         return nullptr;
     }
 
-    static BrgTreeNode *createRegNode(uint32_t RegNo) {
-        auto *Ret = new BrgTreeNode(KindTy::RegNode, BrgTerm::Reg);
+    static BrgTreeNode *createRegNode(llvm::BumpPtrAllocator &Alloc, uint32_t RegNo) {
+        auto *Ret = create(Alloc, KindTy::RegNode, BrgTerm::Reg);
         Ret->Reg.RegNo = RegNo;
         return Ret;
     }
 
-    static BrgTreeNode *createMemNode(int64_t Offset, uint32_t BaseReg,
+    static BrgTreeNode *createMemNode(llvm::BumpPtrAllocator &Alloc, int64_t Offset,
+                                      uint32_t BaseReg,
                                       uint32_t IndexReg = remniw::Register::NoRegister,
                                       uint32_t Scale = 1) {
-        auto *Ret = new BrgTreeNode(KindTy::MemNode, BrgTerm::Alloca);
+        auto *Ret = create(Alloc, KindTy::MemNode, BrgTerm::Alloca);
         Ret->Mem.Disp = Offset;
         Ret->Mem.BaseReg = BaseReg;
         Ret->Mem.IndexReg = IndexReg;
@@ -146,31 +170,39 @@ public:
         return Ret;
     }
 
-    static BrgTreeNode *createImmNode(int64_t Val) {
-        auto *Ret = new BrgTreeNode(KindTy::ImmNode, BrgTerm::Const);
+    static BrgTreeNode *createImmNode(llvm::BumpPtrAllocator &Alloc, int64_t Val) {
+        auto *Ret = create(Alloc, KindTy::ImmNode, BrgTerm::Const);
         Ret->Imm.Val = Val;
         return Ret;
     }
 
-    static BrgTreeNode *createLabelNode(remniw::AsmSymbol *Symbol) {
-        auto *Ret = new BrgTreeNode(KindTy::LabelNode, BrgTerm::Label);
+    static BrgTreeNode *createLabelNode(llvm::BumpPtrAllocator &Alloc,
+                                        remniw::AsmSymbol *Symbol) {
+        auto *Ret = create(Alloc, KindTy::LabelNode, BrgTerm::Label);
         Ret->Label.Symbol = Symbol;
         return Ret;
     }
 
-    static BrgTreeNode *createCallArgsNode(std::vector<BrgTreeNode *> Kids) {
-        auto *Ret = new BrgTreeNode(KindTy::CallArgsNode, BrgTerm::CallArgs, Kids);
-        return Ret;
+    static BrgTreeNode *createCallArgsNode(llvm::BumpPtrAllocator &Alloc,
+                                           llvm::ArrayRef<BrgTreeNode *> Kids) {
+        return create(Alloc, KindTy::CallArgsNode, BrgTerm::CallArgs, Kids);
     }
 
-    static BrgTreeNode *createFuncArgNode(llvm::Argument *FuncArg) {
-        auto *Ret = new BrgTreeNode(KindTy::FuncArgNode, BrgTerm::FuncArg);
+    static BrgTreeNode *createFuncArgNode(llvm::BumpPtrAllocator &Alloc,
+                                          llvm::Argument *FuncArg) {
+        auto *Ret = create(Alloc, KindTy::FuncArgNode, BrgTerm::FuncArg);
         Ret->FuncArg = FuncArg;
         return Ret;
     }
 
-    static BrgTreeNode *createAllocaNode(uint32_t Index) {
-        auto *Ret = new BrgTreeNode(KindTy::AllocaNode, BrgTerm::Alloca);
+    // Src is the incoming value, Dst is the node of the phi node.
+    static BrgTreeNode *createPhiCopyNode(llvm::BumpPtrAllocator &Alloc,
+                                          BrgTreeNode *Src, BrgTreeNode *Dst) {
+        return create(Alloc, KindTy::PhiCopyNode, BrgTerm::PhiCopy, {Src, Dst});
+    }
+
+    static BrgTreeNode *createAllocaNode(llvm::BumpPtrAllocator &Alloc, uint32_t Index) {
+        auto *Ret = create(Alloc, KindTy::AllocaNode, BrgTerm::Alloca);
         Ret->StackObjectIndex = Index;
         return Ret;
     }
@@ -215,8 +247,12 @@ public:
         Reg.RegNo = RegNo;
     }
 
+    // Once the value of a node is in a register, later users of the value only
+    // need the register, so turn the node into a leaf. Otherwise the whole
+    // expression tree would be labelled again for every user.
     void setReg(remniw::AsmOperand::RegOp R) {
         Kind = KindTy::RegNode;
+        Op = BrgTerm::Reg;
         Reg = R;
     }
 
@@ -313,22 +349,16 @@ static void burm_trace(NODEPTR, int, COST);
 namespace remniw {
 
 struct BrgFunction {
-    BrgFunction(llvm::Function *F): F(F) {}
+    BrgFunction(llvm::Function *F):
+        F(F), UndefNode(BrgTreeNode::createUndefNode(Alloc)) {}
 
     BrgFunction(const BrgFunction &) = delete;
     BrgFunction &operator=(const BrgFunction &) = delete;
 
-    ~BrgFunction() {
-        for (const auto &DM : InstToNodeMap)
-            delete DM.second;
-        for (const auto &DM : BasicBlockToNodeMap)
-            delete DM.second;
-        for (const auto &DM : ArgToNodeMap)
-            delete DM.second;
-        for (auto *Node : TmpArgNode)
-            delete Node;
-    }
+    BrgTreeNode *getUndefNode() { return UndefNode; }
 
+    // Owns all the BrgTreeNodes of the function, they are freed together with it.
+    llvm::BumpPtrAllocator Alloc;
     llvm::Function *F;
     int64_t LocalFrameSize {0};
     int64_t MaxCallFrameSize {0};
@@ -338,7 +368,12 @@ struct BrgFunction {
     llvm::DenseMap<llvm::Instruction *, BrgTreeNode *> InstToNodeMap;
     llvm::DenseMap<llvm::BasicBlock *, BrgTreeNode *> BasicBlockToNodeMap;
     llvm::DenseMap<llvm::Argument *, BrgTreeNode *> ArgToNodeMap;
-    llvm::SmallVector<BrgTreeNode *> TmpArgNode;
+    // Leaf nodes are not shared between functions: the instruction selector
+    // stores its state in the nodes, and functions may be selected concurrently.
+    llvm::DenseMap<llvm::GlobalVariable *, BrgTreeNode *> GlobalVariableToNodeMap;
+    llvm::DenseMap<llvm::Function *, BrgTreeNode *> FunctionToNodeMap;
+    llvm::DenseMap<llvm::ConstantInt *, BrgTreeNode *> ConstantIntToNodeMap;
+    BrgTreeNode *UndefNode;
 };
 
 class BrgTreeBuilder: public llvm::InstVisitor<BrgTreeBuilder, BrgTreeNode *> {
@@ -346,10 +381,7 @@ private:
     llvm::DenseMap<remniw::AsmSymbol *, llvm::StringRef> ConstantStrings;
     llvm::SmallVector<llvm::Function *> GlobalCtors;
     llvm::SmallVector<BrgFunction *> Functions;
-    llvm::DenseMap<llvm::GlobalVariable *, BrgTreeNode *> GlobalVariableToNodeMap;
-    llvm::DenseMap<llvm::Function *, BrgTreeNode *> FunctionToNodeMap;
-    llvm::DenseMap<llvm::ConstantInt *, BrgTreeNode *> ConstantIntToNodeMap;
-    llvm::DenseMap<uint64_t, BrgTreeNode *> ImmToNodeMap;
+    llvm::DenseMap<llvm::GlobalVariable *, remniw::AsmSymbol *> GlobalVariableToSymbolMap;
     const TargetInfo &TI;
     AsmContext &AsmCtx;
     BrgFunction *CurrentFunction {nullptr};
@@ -366,14 +398,6 @@ public:
     ~BrgTreeBuilder() {
         for (auto *F : Functions)
             delete F;
-        for (const auto &DM : GlobalVariableToNodeMap)
-            delete DM.second;
-        for (const auto &DM : FunctionToNodeMap)
-            delete DM.second;
-        for (const auto &DM : ConstantIntToNodeMap)
-            delete DM.second;
-        for (const auto &DM : ImmToNodeMap)
-            delete DM.second;
     }
 
     llvm::DenseMap<remniw::AsmSymbol *, llvm::StringRef> getConstantStrings() {
@@ -399,8 +423,7 @@ public:
             if (llvm::ConstantDataArray *CDA =
                     llvm::dyn_cast<llvm::ConstantDataArray>(GV.getInitializer())) {
                 if (CDA->isCString()) {
-                    GlobalVariableToNodeMap[&GV] =
-                        BrgTreeNode::createLabelNode(AsmCtx.getOrCreateSymbol(&GV));
+                    GlobalVariableToSymbolMap[&GV] = AsmCtx.getOrCreateSymbol(&GV);
                     ConstantStrings[AsmCtx.getOrCreateSymbol(&GV)] = CDA->getAsCString();
                 }
             }
@@ -429,7 +452,8 @@ public:
                    "The Type of funtion argument must be integerType or PointerType");
             assert(SizeInBytes <= TI.getRegisterSize() &&
                    "Size of function argument must be less or equal than register size");
-            auto *FuncArgNode = BrgTreeNode::createFuncArgNode(Arg);
+            auto *FuncArgNode =
+                BrgTreeNode::createFuncArgNode(CurrentFunction->Alloc, Arg);
             CurrentFunction->ArgToNodeMap[Arg] = FuncArgNode;
             if (i >= TI.getNumArgRegisters()) /* incomming arg on stack */ {
                 int FuncArgOnStackIndex = TI.getNumArgRegisters() - i - 1;
@@ -438,9 +462,16 @@ public:
             }
         }
 
+        splitCriticalEdges(F);
+        preparePhiNodes(F);
+
         for (auto &BB : F) {
             CurrentFunction->Insts.push_back(getBrgNodeForValue(&BB));
+            if (BB.isEntryBlock())
+                addFuncArgRoots(F);
             for (auto &I : BB) {
+                if (I.isTerminator())
+                    addPhiCopyRoots(BB);
                 auto *InstNode = InstVisitor::visit(I);
                 CurrentFunction->Insts.push_back(InstNode);
             }
@@ -456,37 +487,42 @@ public:
         CurrentFunction->StackObjects.push_back(
             {CurrentFunctionAllocaInstIndex++, AllocaSizeInBytes, 0, &AI});
         uint32_t Index = (uint32_t)CurrentFunction->StackObjects.size() - 1;
-        auto *Node = BrgTreeNode::createAllocaNode(Index);
+        auto *Node = BrgTreeNode::createAllocaNode(CurrentFunction->Alloc, Index);
         CurrentFunction->InstToNodeMap[&AI] = Node;
         return Node;
     }
 
     BrgTreeNode *visitBranchInst(llvm::BranchInst &BI) {
         BrgTreeNode *InstNode = nullptr;
+        auto &Alloc = CurrentFunction->Alloc;
         if (BI.isUnconditional()) {
             InstNode = BrgTreeNode::createInstNode(
-                &BI, {getBrgNodeForValue(BI.getSuccessor(0)), BrgTreeNode::getUndefNode(),
-                      BrgTreeNode::getUndefNode()});
+                Alloc, &BI,
+                {getBrgNodeForValue(BI.getSuccessor(0)), CurrentFunction->getUndefNode(),
+                 CurrentFunction->getUndefNode()});
         } else {
             auto *Int1Ty = llvm::Type::getInt1Ty(BI.getContext());
             auto *ConstantIntTrue = llvm::ConstantInt::getTrue(Int1Ty);
             auto *ConstantIntFalse = llvm::ConstantInt::getFalse(Int1Ty);
             if (BI.getCondition() == ConstantIntTrue) {
                 InstNode = BrgTreeNode::createInstNode(
-                    &BI, {getBrgNodeForValue(BI.getSuccessor(0)),
-                          BrgTreeNode::getUndefNode(), BrgTreeNode::getUndefNode()});
+                    Alloc, &BI,
+                    {getBrgNodeForValue(BI.getSuccessor(0)),
+                     CurrentFunction->getUndefNode(), CurrentFunction->getUndefNode()});
             } else if (BI.getCondition() == ConstantIntFalse) {
                 InstNode = BrgTreeNode::createInstNode(
-                    &BI, {getBrgNodeForValue(BI.getSuccessor(1)),
-                          BrgTreeNode::getUndefNode(), BrgTreeNode::getUndefNode()});
+                    Alloc, &BI,
+                    {getBrgNodeForValue(BI.getSuccessor(1)),
+                     CurrentFunction->getUndefNode(), CurrentFunction->getUndefNode()});
             } else {
                 auto *ICI = llvm::cast<llvm::ICmpInst>(BI.getCondition());
                 assert(CurrentFunction->InstToNodeMap.count(ICI) &&
                        "BI.getCondition() must in InstToNodeMap");
                 InstNode = BrgTreeNode::createInstNode(
-                    &BI, {CurrentFunction->InstToNodeMap[ICI],
-                          getBrgNodeForValue(BI.getSuccessor(0)),
-                          getBrgNodeForValue(BI.getSuccessor(1))});
+                    Alloc, &BI,
+                    {CurrentFunction->InstToNodeMap[ICI],
+                     getBrgNodeForValue(BI.getSuccessor(0)),
+                     getBrgNodeForValue(BI.getSuccessor(1))});
             }
         }
         CurrentFunction->InstToNodeMap[&BI] = InstNode;
@@ -494,16 +530,15 @@ public:
     }
 
     BrgTreeNode *visitCallInst(llvm::CallInst &CI) {
-        std::vector<BrgTreeNode *> Kids;
+        auto &Alloc = CurrentFunction->Alloc;
         BrgTreeNode *Args = BrgTreeNode::createCallArgsNode(
-            {BrgTreeNode::getUndefNode(), BrgTreeNode::getUndefNode()});
-        CurrentFunction->TmpArgNode.push_back(Args);
+            Alloc, {CurrentFunction->getUndefNode(), CurrentFunction->getUndefNode()});
         BrgTreeNode *CurrentNode = Args;
         int64_t NeededStackSizeForCallArgs = 0;
         for (unsigned i = 0, e = CI.arg_size(); i != e; ++i) {
             BrgTreeNode *ArgsTmp = BrgTreeNode::createCallArgsNode(
-                {BrgTreeNode::getUndefNode(), BrgTreeNode::getUndefNode()});
-            CurrentFunction->TmpArgNode.push_back(ArgsTmp);
+                Alloc,
+                {CurrentFunction->getUndefNode(), CurrentFunction->getUndefNode()});
             CurrentNode->setKids({getBrgNodeForValue(CI.getArgOperand(i)), ArgsTmp});
             CurrentNode = ArgsTmp;
             if (i >= TI.getNumArgRegisters()) /* push arg on stack */ {
@@ -517,11 +552,11 @@ public:
             CurrentFunctionMaxCallFrameSize = NeededStackSizeForCallArgs;
         BrgTreeNode *InstNode = nullptr;
         if (auto *Callee = CI.getCalledFunction()) /*direct call*/ {
-            InstNode =
-                BrgTreeNode::createInstNode(&CI, {getBrgNodeForValue(Callee), Args});
+            InstNode = BrgTreeNode::createInstNode(Alloc, &CI,
+                                                   {getBrgNodeForValue(Callee), Args});
         } else /* indirect call */ {
             InstNode = BrgTreeNode::createInstNode(
-                &CI, {getBrgNodeForValue(CI.getCalledOperand()), Args});
+                Alloc, &CI, {getBrgNodeForValue(CI.getCalledOperand()), Args});
         }
         CurrentFunction->InstToNodeMap[&CI] = InstNode;
         return InstNode;
@@ -536,26 +571,31 @@ public:
         // See IRCodeGeneratorImpl::codegenArraySubscriptExpr() for more info.
         assert(I.getNumIndices() >= 1);
         // Only care the pointer operand and last index, i.e. the first and last operand
-        std::vector<BrgTreeNode *> Kids {
-            getBrgNodeForValue(I.getOperand(0)),
-            getBrgNodeForValue(I.getOperand(I.getNumOperands() - 1))};
-        auto *InstNode = BrgTreeNode::createInstNode(&I, Kids);
+        BrgTreeNode *Kids[] {getBrgNodeForValue(I.getOperand(0)),
+                             getBrgNodeForValue(I.getOperand(I.getNumOperands() - 1))};
+        auto *InstNode = BrgTreeNode::createInstNode(CurrentFunction->Alloc, &I, Kids);
         CurrentFunction->InstToNodeMap[&I] = InstNode;
         return InstNode;
     }
 
     BrgTreeNode *visitReturnInst(llvm::ReturnInst &I) {
-        std::vector<BrgTreeNode *> Kids;
+        BrgTreeNode *Kid;
         if (llvm::Value *RetVal = I.getReturnValue()) {
-            Kids.push_back(getBrgNodeForValue(RetVal));
+            Kid = getBrgNodeForValue(RetVal);
         } else {
-            Kids.push_back(BrgTreeNode::getUndefNode());
+            Kid = CurrentFunction->getUndefNode();
         }
-        auto *InstNode = BrgTreeNode::createInstNode(&I, Kids);
+        auto *InstNode = BrgTreeNode::createInstNode(CurrentFunction->Alloc, &I, Kid);
         CurrentFunction->InstToNodeMap[&I] = InstNode;
         return InstNode;
     }
 
+    BrgTreeNode *visitPHINode(llvm::PHINode &PN) {
+        // The node is created in preparePhiNodes(), since a phi node may be used
+        // before it is visited, e.g. by another phi node of the same block.
+        return CurrentFunction->InstToNodeMap[&PN];
+    }
+
     // BrgTreeNode* visitLoadInst(llvm::LoadInst &I);
     // BrgTreeNode* visitStoreInst(llvm::StoreInst &I);
     // BrgTreeNode* visitICmpInst(llvm::ICmpInst &I);
@@ -566,31 +606,29 @@ public:
 
     /// Specify what to return for unhandled instructions.
     BrgTreeNode *visitInstruction(llvm::Instruction &I) {
-        std::vector<BrgTreeNode *> Kids;
+        llvm::SmallVector<BrgTreeNode *, BrgTreeNode::MaxKids> Kids;
         for (unsigned i = 0, e = I.getNumOperands(); i != e; ++i) {
             Kids.push_back(getBrgNodeForValue(I.getOperand(i)));
         }
-        auto *InstNode = BrgTreeNode::createInstNode(&I, Kids);
+        auto *InstNode = BrgTreeNode::createInstNode(CurrentFunction->Alloc, &I, Kids);
         CurrentFunction->InstToNodeMap[&I] = InstNode;
         return InstNode;
     }
 
 private:
-    BrgTreeNode *getBrgNodeForImm(uint64_t V) {
-        if (!ImmToNodeMap.count(V))
-            ImmToNodeMap[V] = BrgTreeNode::createImmNode(V);
-        return ImmToNodeMap[V];
-    }
-
     BrgTreeNode *getBrgNodeForValue(llvm::Value *V) {
         if (auto *CE = llvm::dyn_cast<llvm::ConstantExpr>(V)) {
             // FIXME
             return getBrgNodeForValue(CE->getOperand(0));
         } else if (auto *GV = llvm::dyn_cast<llvm::GlobalVariable>(V)) {
-            auto it = GlobalVariableToNodeMap.find(GV);
-            assert(it != GlobalVariableToNodeMap.end() &&
-                   "GlobalVariable operand must in GlobalVariableToNodeMap");
-            return it->second;
+            if (!CurrentFunction->GlobalVariableToNodeMap.count(GV)) {
+                auto it = GlobalVariableToSymbolMap.find(GV);
+                assert(it != GlobalVariableToSymbolMap.end() &&
+                       "GlobalVariable operand must in GlobalVariableToSymbolMap");
+                CurrentFunction->GlobalVariableToNodeMap[GV] =
+                    BrgTreeNode::createLabelNode(CurrentFunction->Alloc, it->second);
+            }
+            return CurrentFunction->GlobalVariableToNodeMap[GV];
         } else if (auto *I = llvm::dyn_cast<llvm::Instruction>(V)) {
             auto it = CurrentFunction->InstToNodeMap.find(I);
             assert(it != CurrentFunction->InstToNodeMap.end() &&
@@ -602,27 +640,89 @@ private:
                    "Argument operand must in ArgToNodeMap");
             return it->second;
         } else if (auto *F = llvm::dyn_cast<llvm::Function>(V)) {
-            if (!FunctionToNodeMap.count(F)) {
-                FunctionToNodeMap[F] =
-                    BrgTreeNode::createLabelNode(AsmCtx.getOrCreateSymbol(F));
+            if (!CurrentFunction->FunctionToNodeMap.count(F)) {
+                CurrentFunction->FunctionToNodeMap[F] = BrgTreeNode::createLabelNode(
+                    CurrentFunction->Alloc, AsmCtx.getOrCreateSymbol(F));
             }
-            return FunctionToNodeMap[F];
+            return CurrentFunction->FunctionToNodeMap[F];
         } else if (auto *BB = llvm::dyn_cast<llvm::BasicBlock>(V)) {
             if (!CurrentFunction->BasicBlockToNodeMap.count(BB)) {
-                CurrentFunction->BasicBlockToNodeMap[BB] =
-                    BrgTreeNode::createLabelNode(AsmCtx.getOrCreateSymbol(BB));
+                CurrentFunction->BasicBlockToNodeMap[BB] = BrgTreeNode::createLabelNode(
+                    CurrentFunction->Alloc, AsmCtx.getOrCreateSymbol(BB));
             }
             return CurrentFunction->BasicBlockToNodeMap[BB];
         } else if (auto *CI = llvm::dyn_cast<llvm::ConstantInt>(V)) {
-            if (!ConstantIntToNodeMap.count(CI)) {
-                ConstantIntToNodeMap[CI] = BrgTreeNode::createImmNode(CI->getSExtValue());
+            if (!CurrentFunction->ConstantIntToNodeMap.count(CI)) {
+                CurrentFunction->ConstantIntToNodeMap[CI] = BrgTreeNode::createImmNode(
+                    CurrentFunction->Alloc, CI->getSExtValue());
             }
-            return ConstantIntToNodeMap[CI];
+            return CurrentFunction->ConstantIntToNodeMap[CI];
         }
         llvm_unreachable("unhandled operand");
         return nullptr;
     }
 
+    // Split the edges from blocks with several successors to blocks with several
+    // predecessors. Phi nodes are lowered to copies at the end of the predecessors,
+    // and the register allocator inserts moves on control flow edges. Such code
+    // placed before the terminator of a block with several successors would also
+    // be executed on the paths to the other successors.
+    void splitCriticalEdges(llvm::Function &F) {
+        llvm::SmallVector<llvm::BasicBlock *> Blocks;
+        for (auto &BB : F)
+            Blocks.push_back(&BB);
+
+        for (auto *BB : Blocks) {
+            llvm::Instruction *TI = BB->getTerminator();
+            // SplitCriticalEdge() leaves edges that are not critical alone.
+            for (unsigned i = 0, e = TI->getNumSuccessors(); i != e; ++i)
+                if (llvm::BasicBlock *NewBB = llvm::SplitCriticalEdge(TI, i))
+                    NewBB->moveAfter(BB);
+        }
+    }
+
+    // Phi nodes of blocks with a single predecessor are simply replaced by their
+    // incoming value.
+    void preparePhiNodes(llvm::Function &F) {
+        for (auto &BB : F)
+            if (BB.getSinglePredecessor())
+                llvm::FoldSingleEntryPHINodes(&BB);
+
+        for (auto &BB : F)
+            for (auto &PN : BB.phis())
+                CurrentFunction->InstToNodeMap[&PN] =
+                    BrgTreeNode::createInstNode(CurrentFunction->Alloc, &PN, {});
+    }
+
+    // Formal arguments that are used as values, rather than only stored to
+    // their stack slots, are copied out of the argument registers at the
+    // beginning of the function, before any call may clobber them.
+    void addFuncArgRoots(llvm::Function &F) {
+        for (auto &Arg : F.args()) {
+            bool UsedAsValue = llvm::any_of(Arg.uses(), [](const llvm::Use &U) {
+                auto *SI = llvm::dyn_cast<llvm::StoreInst>(U.getUser());
+                return !SI || U.getOperandNo() != 0;
+            });
+            if (UsedAsValue)
+                CurrentFunction->Insts.push_back(getBrgNodeForValue(&Arg));
+        }
+    }
+
+    // Copy the incoming values of the phi nodes in the successors of BB.
+    void addPhiCopyRoots(llvm::BasicBlock &BB) {
+        for (auto *Succ : llvm::successors(&BB)) {
+            for (auto &PN : Succ->phis()) {
+                llvm::Value *Incoming = PN.getIncomingValueForBlock(&BB);
+                if (llvm::isa<llvm::UndefValue>(Incoming))
+                    continue;
+                auto *Node = BrgTreeNode::createPhiCopyNode(
+                    CurrentFunction->Alloc, getBrgNodeForValue(Incoming),
+                    CurrentFunction->InstToNodeMap[&PN]);
+                CurrentFunction->Insts.push_back(Node);
+            }
+        }
+    }
+
     uint64_t getAllocaSizeInBytes(const llvm::AllocaInst &AI) const {
         uint64_t ArraySize = 1;
         if (AI.isArrayAllocation()) {
@@ -0,0 +1,318 @@
+#pragma once
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/BinaryFormat/ELF.h"
+#include "llvm/Support/EndianStream.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace remniw {
+
+// A minimal writer of 64-bit little-endian relocatable ELF object files.
+// The target specific emitter fills in the contents of sections, defines
+// symbols and records relocations, ELFObjectWriter only does the file layout.
+class ELFObjectWriter {
+public:
+    struct Section;
+
+    struct Symbol {
+        std::string Name;
+        // nullptr if the symbol is undefined
+        Section *Sec {nullptr};
+        uint64_t Value {0};
+        uint64_t Size {0};
+        uint8_t Binding {llvm::ELF::STB_GLOBAL};
+        uint8_t Type {llvm::ELF::STT_NOTYPE};
+    };
+
+    struct Relocation {
+        uint64_t Offset;
+        Symbol *Sym;
+        uint32_t Type;
+        int64_t Addend;
+    };
+
+    struct Section {
+        std::string Name;
+        uint32_t Type;
+        uint64_t Flags;
+        uint64_t Alignment;
+        llvm::SmallVector<char, 0> Data;
+        std::vector<Relocation> Relocations;
+        // The STT_SECTION symbol of this section, created on demand.
+        Symbol *SectionSymbol {nullptr};
+    };
+
+    ELFObjectWriter(uint16_t Machine): Machine(Machine) {}
+
+    ELFObjectWriter(const ELFObjectWriter &) = delete;
+    ELFObjectWriter &operator=(const ELFObjectWriter &) = delete;
+
+    Section *createSection(llvm::StringRef Name, uint32_t Type, uint64_t Flags,
+                           uint64_t Alignment) {
+        Sections.push_back(std::make_unique<Section>());
+        Section *S = Sections.back().get();
+        S->Name = Name.str();
+        S->Type = Type;
+        S->Flags = Flags;
+        S->Alignment = Alignment;
+        return S;
+    }
+
+    // Return the global symbol named Name, it stays undefined unless
+    // defineSymbol is called on it.
+    Symbol *getOrCreateSymbol(llvm::StringRef Name) {
+        auto It = SymbolTable.find(Name);
+        if (It != SymbolTable.end())
+            return It->second;
+        Symbols.push_back(std::make_unique<Symbol>());
+        Symbol *Sym = Symbols.back().get();
+        Sym->Name = Name.str();
+        SymbolTable[Name] = Sym;
+        return Sym;
+    }
+
+    void defineSymbol(Symbol *Sym, Section *Sec, uint64_t Value, uint64_t Size,
+                      uint8_t Type) {
+        Sym->Sec = Sec;
+        Sym->Value = Value;
+        Sym->Size = Size;
+        Sym->Type = Type;
+    }
+
+    Symbol *getSectionSymbol(Section *Sec) {
+        if (!Sec->SectionSymbol) {
+            Symbols.push_back(std::make_unique<Symbol>());
+            Symbol *Sym = Symbols.back().get();
+            Sym->Sec = Sec;
+            Sym->Binding = llvm::ELF::STB_LOCAL;
+            Sym->Type = llvm::ELF::STT_SECTION;
+            Sec->SectionSymbol = Sym;
+        }
+        return Sec->SectionSymbol;
+    }
+
+    void addRelocation(Section *Sec, uint64_t Offset, Symbol *Sym, uint32_t Type,
+                       int64_t Addend) {
+        Sec->Relocations.push_back({Offset, Sym, Type, Addend});
+    }
+
+    // The file layout:
+    //
+    // +-------------------------+
+    // | ELF header              |
+    // +-------------------------+
+    // | section contents        |
+    // | relocation sections     |
+    // | .symtab                 |
+    // | .strtab                 |
+    // | .shstrtab               |
+    // +-------------------------+
+    // | section header table    |
+    // +-------------------------+
+    //
+    void write(llvm::raw_ostream &OS) {
+        using namespace llvm::ELF;
+
+        // Assign section header indexes, a relocation section directly follows
+        // the section it applies to.
+        llvm::DenseMap<const Section *, unsigned> SectionIndex, RelaSectionIndex;
+        unsigned NumSections = 1;  // index 0 is the null section
+        for (auto &S : Sections) {
+            SectionIndex[S.get()] = NumSections++;
+            if (!S->Relocations.empty())
+                RelaSectionIndex[S.get()] = NumSections++;
+        }
+        unsigned SymTabIndex = NumSections++;
+        unsigned StrTabIndex = NumSections++;
+        unsigned ShStrTabIndex = NumSections++;
+
+        // Local symbols must precede global symbols in the symbol table.
+        std::vector<Symbol *> SortedSymbols;
+        for (auto &Sym : Symbols)
+            if (Sym->Binding == STB_LOCAL)
+                SortedSymbols.push_back(Sym.get());
+        unsigned FirstGlobalIndex = SortedSymbols.size() + 1;
+        for (auto &Sym : Symbols)
+            if (Sym->Binding != STB_LOCAL)
+                SortedSymbols.push_back(Sym.get());
+        llvm::DenseMap<const Symbol *, unsigned> SymbolIndex;
+        for (unsigned i = 0; i < SortedSymbols.size(); ++i)
+            SymbolIndex[SortedSymbols[i]] = i + 1;
+
+        std::string StrTab(1, '\0');
+        auto AddString = [](std::string &Table, llvm::StringRef Str) -> uint32_t {
+            if (Str.empty())
+                return 0;
+            uint32_t Offset = Table.size();
+            Table += Str.str();
+            Table += '\0';
+            return Offset;
+        };
+
+        llvm::SmallString<0> Buffer;
+        llvm::raw_svector_ostream BOS(Buffer);
+        llvm::support::endian::Writer W(BOS, llvm::support::little);
+        auto Align = [&](uint64_t Alignment) {
+            while (Alignment > 1 && Buffer.size() % Alignment)
+                W.write<uint8_t>(0);
+        };
+
+        // The ELF header is patched once the offset of the section header table
+        // is known.
+        Buffer.resize(sizeof(Elf64_Ehdr));
+
+        struct SectionHeader {
+            uint32_t Name;
+            uint32_t Type;
+            uint64_t Flags;
+            uint64_t Offset;
+            uint64_t Size;
+            uint32_t Link;
+            uint32_t Info;
+            uint64_t Alignment;
+            uint64_t EntrySize;
+        };
+        std::string ShStrTab(1, '\0');
+        std::vector<SectionHeader> Headers(NumSections, SectionHeader {});
+
+        for (auto &S : Sections) {
+            Align(S->Alignment);
+            Headers[SectionIndex[S.get()]] = {AddString(ShStrTab, S->Name),
+                                              S->Type,
+                                              S->Flags,
+                                              Buffer.size(),
+                                              S->Data.size(),
+                                              0,
+                                              0,
+                                              S->Alignment,
+                                              0};
+            BOS << llvm::StringRef(S->Data.data(), S->Data.size());
+        }
+
+        for (auto &S : Sections) {
+            if (S->Relocations.empty())
+                continue;
+            Align(8);
+            Headers[RelaSectionIndex[S.get()]] = {
+                AddString(ShStrTab, ".rela" + S->Name),
+                SHT_RELA,
+                SHF_INFO_LINK,
+                Buffer.size(),
+                S->Relocations.size() * sizeof(Elf64_Rela),
+                SymTabIndex,
+                SectionIndex[S.get()],
+                8,
+                sizeof(Elf64_Rela)};
+            for (auto &R : S->Relocations) {
+                W.write<uint64_t>(R.Offset);
+                W.write<uint64_t>((uint64_t(SymbolIndex[R.Sym]) << 32) | R.Type);
+                W.write<int64_t>(R.Addend);
+            }
+        }
+
+        Align(8);
+        Headers[SymTabIndex] = {AddString(ShStrTab, ".symtab"),
+                                SHT_SYMTAB,
+                                0,
+                                Buffer.size(),
+                                (SortedSymbols.size() + 1) * sizeof(Elf64_Sym),
+                                StrTabIndex,
+                                FirstGlobalIndex,
+                                8,
+                                sizeof(Elf64_Sym)};
+        Buffer.append(sizeof(Elf64_Sym), '\0');  // the null symbol
+        for (auto *Sym : SortedSymbols) {
+            W.write<uint32_t>(AddString(StrTab, Sym->Name));
+            W.write<uint8_t>((Sym->Binding << 4) | (Sym->Type & 0xf));
+            W.write<uint8_t>(STV_DEFAULT);
+            W.write<uint16_t>(Sym->Sec ? SectionIndex[Sym->Sec] : SHN_UNDEF);
+            W.write<uint64_t>(Sym->Value);
+            W.write<uint64_t>(Sym->Size);
+        }
+
+        Headers[StrTabIndex] = {AddString(ShStrTab, ".strtab"),
+                                SHT_STRTAB,
+                                0,
+                                Buffer.size(),
+                                StrTab.size(),
+                                0,
+                                0,
+                                1,
+                                0};
+        BOS << StrTab;
+
+        // The name of .shstrtab must be added before .shstrtab is emitted.
+        uint32_t ShStrTabName = AddString(ShStrTab, ".shstrtab");
+        Headers[ShStrTabIndex] = {ShStrTabName,
+                                  SHT_STRTAB,
+                                  0,
+                                  Buffer.size(),
+                                  ShStrTab.size(),
+                                  0,
+                                  0,
+                                  1,
+                                  0};
+        BOS << ShStrTab;
+
+        Align(8);
+        uint64_t SectionHeaderOffset = Buffer.size();
+        for (auto &H : Headers) {
+            W.write<uint32_t>(H.Name);
+            W.write<uint32_t>(H.Type);
+            W.write<uint64_t>(H.Flags);
+            W.write<uint64_t>(0);  // sh_addr
+            W.write<uint64_t>(H.Offset);
+            W.write<uint64_t>(H.Size);
+            W.write<uint32_t>(H.Link);
+            W.write<uint32_t>(H.Info);
+            W.write<uint64_t>(H.Alignment);
+            W.write<uint64_t>(H.EntrySize);
+        }
+
+        // Patch the ELF header.
+        llvm::SmallString<sizeof(Elf64_Ehdr)> Header;
+        llvm::raw_svector_ostream HOS(Header);
+        llvm::support::endian::Writer HW(HOS, llvm::support::little);
+        HOS << ElfMagic;
+        HW.write<uint8_t>(ELFCLASS64);
+        HW.write<uint8_t>(ELFDATA2LSB);
+        HW.write<uint8_t>(EV_CURRENT);
+        HW.write<uint8_t>(ELFOSABI_NONE);
+        Header.resize(EI_NIDENT, '\0');
+        HW.write<uint16_t>(ET_REL);
+        HW.write<uint16_t>(Machine);
+        HW.write<uint32_t>(EV_CURRENT);
+        HW.write<uint64_t>(0);  // e_entry
+        HW.write<uint64_t>(0);  // e_phoff
+        HW.write<uint64_t>(SectionHeaderOffset);
+        HW.write<uint32_t>(0);  // e_flags
+        HW.write<uint16_t>(sizeof(Elf64_Ehdr));
+        HW.write<uint16_t>(0);  // e_phentsize
+        HW.write<uint16_t>(0);  // e_phnum
+        HW.write<uint16_t>(sizeof(Elf64_Shdr));
+        HW.write<uint16_t>(NumSections);
+        HW.write<uint16_t>(ShStrTabIndex);
+        assert(Header.size() == sizeof(Elf64_Ehdr));
+        std::copy(Header.begin(), Header.end(), Buffer.begin());
+
+        OS << Buffer;
+    }
+
+private:
+    uint16_t Machine;
+    std::vector<std::unique_ptr<Section>> Sections;
+    std::vector<std::unique_ptr<Symbol>> Symbols;
+    llvm::StringMap<Symbol *> SymbolTable;
+};
+
+}  // namespace remniw
@@ -0,0 +1,590 @@
+#pragma once
+
+#include "codegen/asm/AsmFunction.h"
+#include "codegen/asm/AsmInstruction.h"
+#include "codegen/asm/LivenessAnalysis.h"
+#include "codegen/asm/Register.h"
+#include "codegen/asm/RegisterAllocator.h"
+#include "codegen/asm/TargetInfo.h"
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/Debug.h"
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <vector>
+
+#define DEBUG_TYPE "remniw-GraphColoringRegisterAllocator"
+
+namespace remniw {
+
+// Iterated register coalescing of George and Appel.
+//
+// The interference graph is built from the liveness on the control flow graph.
+// Each allocatable physical register is a precolored node, so the registers read
+// and written implicitly by calls and other instructions constrain the virtual
+// registers which are live across them. Copies between registers are coalesced
+// if the Briggs or George test shows that the graph stays colorable, and the
+// coalesced copies are removed by AsmRewriter.
+//
+// Nodes with the lowest spill cost, which is the number of uses and definitions
+// weighted by the loop depth, divided by the degree, are chosen as potential
+// spills first. Nodes which can not be colored live in a stack slot: they are
+// loaded into a new virtual register before each use and stored after each
+// definition, and the allocation is repeated. The new virtual registers have short
+// live ranges and are never chosen to be spilled.
+class GraphColoringRegisterAllocator: public RegisterAllocator {
+public:
+    // Insert a move between a register and a stack slot before an instruction.
+    using MoveInserter = std::function<void(AsmInstruction *, uint32_t, uint32_t)>;
+
+private:
+    enum NodeState : uint8_t {
+        Unused,
+        Initial,
+        Precolored,
+        SimplifyWorklist,
+        FreezeWorklist,
+        SpillWorklist,
+        OnStack,
+        Coalesced,
+        Colored,
+        Spilled
+    };
+
+    enum MoveState : uint8_t {
+        WorklistMove,
+        ActiveMove,
+        CoalescedMove,
+        ConstrainedMove,
+        FrozenMove
+    };
+
+    struct MoveInfo {
+        unsigned Src;
+        unsigned Dst;
+        MoveState State;
+    };
+
+    const TargetInfo &TI;
+    MoveInserter InsertMove;
+    LivenessAnalysis LA;
+    unsigned NumColors;
+    unsigned NumNodes;
+    std::vector<NodeState> State;
+    std::vector<unsigned> Degree;
+    std::vector<unsigned> Alias;
+    std::vector<uint32_t> Color;
+    std::vector<double> SpillWeight;
+    std::vector<llvm::SmallVector<unsigned, 8>> AdjList;
+    std::vector<llvm::SmallVector<unsigned, 2>> MoveList;
+    llvm::DenseSet<std::pair<unsigned, unsigned>> AdjSet;
+    std::vector<MoveInfo> Moves;
+    // The worklists may contain stale entries, an entry is only valid if the
+    // node or the move is still in the state of the worklist.
+    std::vector<unsigned> SimplifyNodes;
+    std::vector<unsigned> FreezeNodes;
+    std::vector<unsigned> SpillNodes;
+    std::vector<unsigned> WorklistMoves;
+    std::vector<unsigned> SelectStack;
+    std::vector<unsigned> SpilledNodes;
+    // The virtual registers holding spilled values between their stack slot and
+    // the instructions using them.
+    llvm::DenseSet<uint32_t> SpillTemps;
+    llvm::DenseMap<uint32_t, uint32_t> VirtRegToAllocatedRegMap;
+    unsigned NumStackSlots;
+
+public:
+    GraphColoringRegisterAllocator(const TargetInfo &TI, MoveInserter InsertMove):
+        TI(TI), InsertMove(std::move(InsertMove)), LA(TI) {
+        NumColors = TI.getFreeRegistersForRegisterAllocator().size();
+    }
+
+    void doRegAlloc(AsmFunction *F) override {
+        SpillTemps.clear();
+        VirtRegToAllocatedRegMap.clear();
+        NumStackSlots = 0;
+
+        while (true) {
+            LA.compute(F);
+            colorGraph();
+            // Spill temporaries can only be left uncolored if an instruction uses
+            // more registers than available, AsmRewriter handles them then.
+            if (llvm::all_of(SpilledNodes, [&](unsigned N) {
+                    return SpillTemps.count(LA.getRegister(N));
+                }))
+                break;
+            rewriteProgram(F);
+        }
+
+        // Coalesced virtual registers share the register or stack slot of the
+        // node they are merged into.
+        for (unsigned N = 0; N < LA.getNumVirtRegs(); ++N) {
+            if (State[N] == Unused)
+                continue;
+            unsigned Root = getAlias(N);
+            if (State[Root] == Spilled && Color[Root] == Register::NoRegister)
+                Color[Root] = Register::index2StackSlot(NumStackSlots++);
+            VirtRegToAllocatedRegMap[LA.getRegister(N)] = Color[Root];
+        }
+
+        LLVM_DEBUG(printRegAllocResults(););
+    }
+
+    const llvm::DenseMap<uint32_t, uint32_t> &getVirtRegToAllocatedRegMap() override {
+        return VirtRegToAllocatedRegMap;
+    }
+
+    std::size_t getSpilledRegCount() override { return NumStackSlots; }
+
+    void printRegAllocResults() override {
+        for (auto p : VirtRegToAllocatedRegMap) {
+            llvm::outs() << "Virtual Register: " << p.first << " assigned " << p.second
+                         << "\n";
+        }
+        unsigned NumCoalesced = llvm::count_if(
+            Moves, [](const MoveInfo &M) { return M.State == CoalescedMove; });
+        llvm::outs() << "Coalesced " << NumCoalesced << " of " << Moves.size()
+                     << " copies\n";
+    }
+
+private:
+    void colorGraph() {
+        NumNodes = LA.getNumTrackedRegs();
+
+        // Reset the internal states
+        State.assign(NumNodes, Unused);
+        Degree.assign(NumNodes, 0);
+        Alias.assign(NumNodes, 0);
+        Color.assign(NumNodes, Register::NoRegister);
+        SpillWeight.assign(NumNodes, 0);
+        AdjList.assign(NumNodes, {});
+        MoveList.assign(NumNodes, {});
+        AdjSet.clear();
+        Moves.clear();
+        SimplifyNodes.clear();
+        FreezeNodes.clear();
+        SpillNodes.clear();
+        WorklistMoves.clear();
+        SelectStack.clear();
+        SpilledNodes.clear();
+
+        for (uint32_t Reg : TI.getFreeRegistersForRegisterAllocator()) {
+            unsigned N = LA.getLivenessIndex(Reg);
+            State[N] = Precolored;
+            Color[N] = Reg;
+        }
+
+        build();
+        makeWorklist();
+        unsigned N, M;
+        while (true) {
+            if (popNode(SimplifyNodes, SimplifyWorklist, N))
+                simplify(N);
+            else if (popMove(M))
+                coalesce(M);
+            else if (popNode(FreezeNodes, FreezeWorklist, N))
+                freeze(N);
+            else if (!selectSpill())
+                break;
+        }
+        assignColors();
+    }
+
+    bool isPrecolored(unsigned N) const { return State[N] == Precolored; }
+
+    // The loop depth of each block, a back edge goes from a block to a block at or
+    // before it in the layout, and all blocks between them are in the loop.
+    std::vector<unsigned> computeLoopDepths() const {
+        const auto &Blocks = LA.getBlocks();
+        std::vector<int> Delta(Blocks.size() + 1, 0);
+        for (unsigned b = 0; b < Blocks.size(); ++b) {
+            for (unsigned Succ : Blocks[b].Succs) {
+                if (Succ <= b) {
+                    ++Delta[Succ];
+                    --Delta[b + 1];
+                }
+            }
+        }
+        std::vector<unsigned> Depths(Blocks.size());
+        int Depth = 0;
+        for (unsigned b = 0; b < Blocks.size(); ++b) {
+            Depth += Delta[b];
+            Depths[b] = Depth;
+        }
+        return Depths;
+    }
+
+    void addEdge(unsigned U, unsigned V) {
+        if (U == V || (isPrecolored(U) && isPrecolored(V)))
+            return;
+        if (!AdjSet.insert({std::min(U, V), std::max(U, V)}).second)
+            return;
+        if (!isPrecolored(U)) {
+            AdjList[U].push_back(V);
+            ++Degree[U];
+        }
+        if (!isPrecolored(V)) {
+            AdjList[V].push_back(U);
+            ++Degree[V];
+        }
+    }
+
+    bool isAdjacent(unsigned U, unsigned V) const {
+        return AdjSet.count({std::min(U, V), std::max(U, V)});
+    }
+
+    void build() {
+        const auto &Insts = LA.getInstructions();
+        const auto &Blocks = LA.getBlocks();
+        std::vector<unsigned> LoopDepths = computeLoopDepths();
+        llvm::SmallVector<uint32_t, 8> Uses, Defs;
+        for (unsigned b = Blocks.size(); b-- > 0;) {
+            const auto &B = Blocks[b];
+            double Weight = std::pow(10.0, std::min(LoopDepths[b], 8U));
+            llvm::BitVector Live = LA.getLiveOut(B);
+            for (unsigned i = B.End; i-- > B.Begin;) {
+                const AsmInstruction &I = *Insts[i];
+                Uses.clear();
+                Defs.clear();
+                LA.getUsesAndDefs(I, Uses, Defs);
+                for (uint32_t Reg : Uses) {
+                    unsigned N = LA.getLivenessIndex(Reg);
+                    if (State[N] == Unused)
+                        State[N] = Initial;
+                    SpillWeight[N] += Weight;
+                }
+                for (uint32_t Reg : Defs) {
+                    unsigned N = LA.getLivenessIndex(Reg);
+                    if (State[N] == Unused)
+                        State[N] = Initial;
+                    SpillWeight[N] += Weight;
+                }
+
+                // The source and the destination of a copy do not interfere, they
+                // hold the same value.
+                uint32_t Src, Dst;
+                if (TI.isRegisterCopy(I, Src, Dst) && Src != Dst &&
+                    LA.isTrackedReg(Src) && LA.isTrackedReg(Dst) &&
+                    !(Register::isPhysicalRegister(Src) &&
+                      Register::isPhysicalRegister(Dst))) {
+                    unsigned S = LA.getLivenessIndex(Src);
+                    unsigned D = LA.getLivenessIndex(Dst);
+                    Live.reset(S);
+                    unsigned M = Moves.size();
+                    Moves.push_back({S, D, WorklistMove});
+                    MoveList[S].push_back(M);
+                    MoveList[D].push_back(M);
+                    WorklistMoves.push_back(M);
+                }
+
+                for (uint32_t Reg : Defs)
+                    Live.set(LA.getLivenessIndex(Reg));
+                for (uint32_t Reg : Defs) {
+                    unsigned D = LA.getLivenessIndex(Reg);
+                    for (unsigned L : Live.set_bits())
+                        addEdge(L, D);
+                }
+                for (uint32_t Reg : Defs)
+                    Live.reset(LA.getLivenessIndex(Reg));
+                for (uint32_t Reg : Uses)
+                    Live.set(LA.getLivenessIndex(Reg));
+            }
+        }
+    }
+
+    bool isMoveRelated(unsigned N) const {
+        return llvm::any_of(MoveList[N], [&](unsigned M) {
+            return Moves[M].State == WorklistMove || Moves[M].State == ActiveMove;
+        });
+    }
+
+    template<typename Callback>
+    void forEachAdjacent(unsigned N, Callback CB) const {
+        for (unsigned A : AdjList[N])
+            if (State[A] != OnStack && State[A] != Coalesced)
+                CB(A);
+    }
+
+    void pushNode(unsigned N, NodeState NewState) {
+        State[N] = NewState;
+        if (NewState == SimplifyWorklist)
+            SimplifyNodes.push_back(N);
+        else if (NewState == FreezeWorklist)
+            FreezeNodes.push_back(N);
+        else if (NewState == SpillWorklist)
+            SpillNodes.push_back(N);
+    }
+
+    bool popNode(std::vector<unsigned> &Worklist, NodeState WorklistState,
+                 unsigned &N) {
+        while (!Worklist.empty()) {
+            N = Worklist.back();
+            Worklist.pop_back();
+            if (State[N] == WorklistState)
+                return true;
+        }
+        return false;
+    }
+
+    bool popMove(unsigned &M) {
+        while (!WorklistMoves.empty()) {
+            M = WorklistMoves.back();
+            WorklistMoves.pop_back();
+            if (Moves[M].State == WorklistMove)
+                return true;
+        }
+        return false;
+    }
+
+    void makeWorklist() {
+        for (unsigned N = 0; N < NumNodes; ++N) {
+            if (State[N] != Initial)
+                continue;
+            if (Degree[N] >= NumColors)
+                pushNode(N, SpillWorklist);
+            else if (isMoveRelated(N))
+                pushNode(N, FreezeWorklist);
+            else
+                pushNode(N, SimplifyWorklist);
+        }
+    }
+
+    void simplify(unsigned N) {
+        State[N] = OnStack;
+        SelectStack.push_back(N);
+        forEachAdjacent(N, [&](unsigned A) { decrementDegree(A); });
+    }
+
+    void decrementDegree(unsigned N) {
+        if (isPrecolored(N))
+            return;
+        unsigned D = Degree[N]--;
+        if (D != NumColors)
+            return;
+        enableMoves(N);
+        forEachAdjacent(N, [&](unsigned A) { enableMoves(A); });
+        if (State[N] == SpillWorklist)
+            pushNode(N, isMoveRelated(N) ? FreezeWorklist : SimplifyWorklist);
+    }
+
+    void enableMoves(unsigned N) {
+        for (unsigned M : MoveList[N]) {
+            if (Moves[M].State == ActiveMove) {
+                Moves[M].State = WorklistMove;
+                WorklistMoves.push_back(M);
+            }
+        }
+    }
+
+    unsigned getAlias(unsigned N) const {
+        while (State[N] == Coalesced)
+            N = Alias[N];
+        return N;
+    }
+
+    void addWorklist(unsigned N) {
+        if (!isPrecolored(N) && !isMoveRelated(N) && Degree[N] < NumColors &&
+            State[N] == FreezeWorklist)
+            pushNode(N, SimplifyWorklist);
+    }
+
+    // George: V can be merged into the precolored node U if every neighbor of V
+    // has an insignificant degree or already interferes with U.
+    bool canMergeIntoPrecolored(unsigned U, unsigned V) const {
+        bool OK = true;
+        forEachAdjacent(V, [&](unsigned T) {
+            if (Degree[T] >= NumColors && !isPrecolored(T) && !isAdjacent(T, U))
+                OK = false;
+        });
+        return OK;
+    }
+
+    // Briggs: the merged node has fewer than NumColors neighbors of significant
+    // degree.
+    bool isConservative(unsigned U, unsigned V) const {
+        llvm::SmallDenseSet<unsigned, 32> Neighbors;
+        unsigned NumSignificant = 0;
+        auto Count = [&](unsigned T) {
+            if (Neighbors.insert(T).second &&
+                (isPrecolored(T) || Degree[T] >= NumColors))
+                ++NumSignificant;
+        };
+        forEachAdjacent(U, Count);
+        forEachAdjacent(V, Count);
+        return NumSignificant < NumColors;
+    }
+
+    void coalesce(unsigned M) {
+        unsigned X = getAlias(Moves[M].Src);
+        unsigned Y = getAlias(Moves[M].Dst);
+        unsigned U = X, V = Y;
+        if (isPrecolored(Y))
+            std::swap(U, V);
+
+        if (U == V) {
+            Moves[M].State = CoalescedMove;
+            addWorklist(U);
+        } else if (isPrecolored(V) || isAdjacent(U, V)) {
+            Moves[M].State = ConstrainedMove;
+            addWorklist(U);
+            addWorklist(V);
+        } else if (isPrecolored(U) ? canMergeIntoPrecolored(U, V)
+                                   : isConservative(U, V)) {
+            Moves[M].State = CoalescedMove;
+            combine(U, V);
+            addWorklist(U);
+        } else {
+            Moves[M].State = ActiveMove;
+        }
+    }
+
+    void combine(unsigned U, unsigned V) {
+        State[V] = Coalesced;
+        Alias[V] = U;
+        MoveList[U].append(MoveList[V].begin(), MoveList[V].end());
+        SpillWeight[U] += SpillWeight[V];
+        enableMoves(V);
+        forEachAdjacent(V, [&](unsigned T) {
+            addEdge(T, U);
+            decrementDegree(T);
+        });
+        if (Degree[U] >= NumColors && State[U] == FreezeWorklist)
+            pushNode(U, SpillWorklist);
+    }
+
+    void freeze(unsigned N) {
+        pushNode(N, SimplifyWorklist);
+        freezeMoves(N);
+    }
+
+    void freezeMoves(unsigned U) {
+        for (unsigned M : MoveList[U]) {
+            if (Moves[M].State != WorklistMove && Moves[M].State != ActiveMove)
+                continue;
+            unsigned X = getAlias(Moves[M].Src);
+            unsigned Y = getAlias(Moves[M].Dst);
+            unsigned V = Y == getAlias(U) ? X : Y;
+            Moves[M].State = FrozenMove;
+            if (State[V] == FreezeWorklist && !isMoveRelated(V) &&
+                Degree[V] < NumColors)
+                pushNode(V, SimplifyWorklist);
+        }
+    }
+
+    // Pick the node with the lowest spill cost as a potential spill, it is pushed
+    // on the stack and only spilled if no color is left for it.
+    bool selectSpill() {
+        llvm::erase_if(SpillNodes, [&](unsigned N) { return State[N] != SpillWorklist; });
+        if (SpillNodes.empty())
+            return false;
+        auto Cost = [&](unsigned N) {
+            if (SpillTemps.count(LA.getRegister(N)))
+                return std::numeric_limits<double>::infinity();
+            return SpillWeight[N] / Degree[N];
+        };
+        auto It = std::min_element(SpillNodes.begin(), SpillNodes.end(),
+                                   [&](unsigned LHS, unsigned RHS) {
+                                       return Cost(LHS) < Cost(RHS);
+                                   });
+        unsigned N = *It;
+        SpillNodes.erase(It);
+        pushNode(N, SimplifyWorklist);
+        freezeMoves(N);
+        return true;
+    }
+
+    void assignColors() {
+        llvm::BitVector UsedColors(LA.getNumPhysRegs());
+        while (!SelectStack.empty()) {
+            unsigned N = SelectStack.back();
+            SelectStack.pop_back();
+            UsedColors.reset();
+            for (unsigned A : AdjList[N]) {
+                unsigned T = getAlias(A);
+                if (State[T] == Colored || isPrecolored(T))
+                    UsedColors.set(Color[T]);
+            }
+            State[N] = Spilled;
+            // Registers are tried in the order of the target, which prefers the
+            // caller-saved registers.
+            for (uint32_t Reg : TI.getFreeRegistersForRegisterAllocator()) {
+                if (!UsedColors.test(Reg)) {
+                    State[N] = Colored;
+                    Color[N] = Reg;
+                    break;
+                }
+            }
+            if (State[N] == Spilled)
+                SpilledNodes.push_back(N);
+        }
+    }
+
+    // Give each spilled node a stack slot, and rewrite the instructions to load
+    // the virtual registers of spilled nodes from their stack slot into a new
+    // virtual register before they are read, and store them after they are
+    // written.
+    void rewriteProgram(AsmFunction *F) {
+        llvm::DenseMap<uint32_t, uint32_t> SpillSlots;
+        for (unsigned N : SpilledNodes)
+            Color[N] = Register::index2StackSlot(NumStackSlots++);
+        for (unsigned N = 0; N < LA.getNumVirtRegs(); ++N) {
+            if (State[N] != Unused && State[getAlias(N)] == Spilled)
+                SpillSlots[LA.getRegister(N)] = Color[getAlias(N)];
+        }
+
+        for (AsmInstruction *I : LA.getInstructions()) {
+            // Copies between virtual registers in the same stack slot are removed.
+            uint32_t Src, Dst;
+            if (TI.isRegisterCopy(*I, Src, Dst) && SpillSlots.count(Src) &&
+                SpillSlots.lookup(Src) == SpillSlots.lookup(Dst)) {
+                I->eraseFromParent();
+                continue;
+            }
+
+            llvm::SmallDenseMap<uint32_t, uint32_t, 4> Temps;
+            llvm::SmallVector<uint32_t, 4> Loads, Stores;
+            auto Rewrite = [&](uint32_t &Reg, bool Read, bool Write) {
+                if (!SpillSlots.count(Reg))
+                    return;
+                auto [It, Inserted] = Temps.try_emplace(Reg);
+                if (Inserted) {
+                    It->second = F->createVirtReg();
+                    SpillTemps.insert(It->second);
+                }
+                if (Read && !llvm::is_contained(Loads, Reg))
+                    Loads.push_back(Reg);
+                if (Write && !llvm::is_contained(Stores, Reg))
+                    Stores.push_back(Reg);
+                Reg = It->second;
+            };
+            for (unsigned OpNo = 0; OpNo < I->getNumOperands(); ++OpNo) {
+                AsmOperand &Op = I->getOperand(OpNo);
+                if (Op.isReg())
+                    Rewrite(Op.Reg.RegNo, TI.readsRegOperand(*I, OpNo),
+                            TI.writesRegOperand(*I, OpNo));
+                if (Op.isMem()) {
+                    Rewrite(Op.Mem.BaseReg, true, false);
+                    Rewrite(Op.Mem.IndexReg, true, false);
+                }
+            }
+
+            for (uint32_t Reg : Loads)
+                InsertMove(I, SpillSlots.lookup(Reg), Temps.lookup(Reg));
+            if (Stores.empty())
+                continue;
+            AsmInstruction *Next = I->getNextNode();
+            assert(Next && "A spilled register is written by the last instruction");
+            for (uint32_t Reg : Stores)
+                InsertMove(Next, Temps.lookup(Reg), SpillSlots.lookup(Reg));
+        }
+    }
+};
+
+}  // namespace remniw
+
+#undef DEBUG_TYPE
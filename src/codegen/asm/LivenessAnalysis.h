@@ -0,0 +1,295 @@
+#pragma once
+
+#include "codegen/asm/AsmFunction.h"
+#include "codegen/asm/AsmInstruction.h"
+#include "codegen/asm/LiveInterval.h"
+#include "codegen/asm/Register.h"
+#include "codegen/asm/TargetInfo.h"
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+
+namespace remniw {
+
+// The control flow graph of an AsmFunction and the liveness of registers at the
+// beginning of its blocks, computed by the register allocators.
+//
+// A block starts at the first instruction or at a label. The successors of a
+// block are the targets of the branches at its end, and the next block unless
+// the block ends with an unconditional branch.
+//
+// Physical registers which are not allocatable, e.g. the stack pointer and the
+// frame pointer, are not tracked. The liveness of virtual register V is kept at
+// bit virtReg2Index(V), the one of physical register R at bit NumVirtRegs + R.
+class LivenessAnalysis {
+public:
+    struct Block {
+        unsigned Begin;
+        unsigned End;
+        // The index of the first branch at the end of the block.
+        unsigned FirstTerminator;
+        bool HasConditionalBranch {false};
+        llvm::SmallVector<unsigned, 2> Succs;
+        llvm::SmallVector<unsigned, 2> Preds;
+        llvm::BitVector Gen, Kill, LiveIn;
+    };
+
+private:
+    const TargetInfo &TI;
+    unsigned NumVirtRegs;
+    unsigned NumPhysRegs;
+    llvm::BitVector AllocatableRegs;
+    std::vector<AsmInstruction *> Insts;
+    std::vector<Block> Blocks;
+
+public:
+    LivenessAnalysis(const TargetInfo &TI): TI(TI) {
+        llvm::ArrayRef<uint32_t> FreeRegs = TI.getFreeRegistersForRegisterAllocator();
+        NumPhysRegs = *std::max_element(FreeRegs.begin(), FreeRegs.end()) + 1;
+        AllocatableRegs.resize(NumPhysRegs);
+        for (auto Reg : FreeRegs)
+            AllocatableRegs.set(Reg);
+    }
+
+    // Virtual registers created after compute() are not tracked.
+    void compute(AsmFunction *F) {
+        NumVirtRegs = F->getNumVirtRegs();
+        Insts.clear();
+        Blocks.clear();
+        buildControlFlowGraph(F);
+        computeLiveness();
+    }
+
+    const std::vector<AsmInstruction *> &getInstructions() const { return Insts; }
+
+    const std::vector<Block> &getBlocks() const { return Blocks; }
+
+    unsigned getNumVirtRegs() const { return NumVirtRegs; }
+
+    unsigned getNumPhysRegs() const { return NumPhysRegs; }
+
+    // The size of the bit vectors holding live registers.
+    unsigned getNumTrackedRegs() const { return NumVirtRegs + NumPhysRegs; }
+
+    bool isTrackedReg(uint32_t Reg) const {
+        if (Register::isVirtualRegister(Reg))
+            return Register::virtReg2Index(Reg) < NumVirtRegs;
+        return Register::isPhysicalRegister(Reg) && Reg < NumPhysRegs &&
+               AllocatableRegs.test(Reg);
+    }
+
+    unsigned getLivenessIndex(uint32_t Reg) const {
+        if (Register::isVirtualRegister(Reg))
+            return Register::virtReg2Index(Reg);
+        return NumVirtRegs + Reg;
+    }
+
+    uint32_t getRegister(unsigned LivenessIndex) const {
+        if (LivenessIndex < NumVirtRegs)
+            return Register::index2VirtReg(LivenessIndex);
+        return LivenessIndex - NumVirtRegs;
+    }
+
+    // The tracked registers read and written by I, including the physical
+    // registers it reads or writes implicitly.
+    void getUsesAndDefs(const AsmInstruction &I, llvm::SmallVectorImpl<uint32_t> &Uses,
+                        llvm::SmallVectorImpl<uint32_t> &Defs) const {
+        for (unsigned OpNo = 0; OpNo < I.getNumOperands(); ++OpNo) {
+            const AsmOperand &Op = I.getOperand(OpNo);
+            if (Op.isReg()) {
+                if (TI.readsRegOperand(I, OpNo))
+                    Uses.push_back(Op.getReg());
+                if (TI.writesRegOperand(I, OpNo))
+                    Defs.push_back(Op.getReg());
+            }
+            if (Op.isMem()) {
+                Uses.push_back(Op.getMemBaseReg());
+                Uses.push_back(Op.getMemIndexReg());
+            }
+        }
+        TI.getImplicitRegisters(I, Uses, Defs);
+        llvm::erase_if(Uses, [&](uint32_t Reg) { return !isTrackedReg(Reg); });
+        llvm::erase_if(Defs, [&](uint32_t Reg) { return !isTrackedReg(Reg); });
+    }
+
+    llvm::BitVector getLiveOut(const Block &B) const {
+        llvm::BitVector LiveOut(getNumTrackedRegs());
+        for (unsigned Succ : B.Succs)
+            LiveOut |= Blocks[Succ].LiveIn;
+        return LiveOut;
+    }
+
+    // Build the live ranges used by the linear scan register allocator from the
+    // liveness, the instruction with index i covers [i, i + 1). The ranges of a
+    // physical register are the segments of instructions where it is live, a
+    // dead definition gets a range of its own. A virtual register gets a single
+    // range from the first to the last instruction where it is live, i.e. its
+    // lifetime holes are filled, which extends it to the end of the loops it is
+    // live around. It is used across a call if it is live after a call in one of
+    // its segments, not just somewhere in the filled range.
+    void
+    computeLiveRanges(std::unordered_map<uint32_t, LiveRanges> &RegLiveRangesMap) const {
+        unsigned NumRegs = getNumTrackedRegs();
+        std::vector<unsigned> CallPositions;
+        for (unsigned i = 0; i < Insts.size(); ++i)
+            if (TI.isCallInstruction(*Insts[i]))
+                CallPositions.push_back(i);
+        // A segment crosses the first call after its start, if any, when it is
+        // still live after that call.
+        auto CrossesCall = [&](const LiveRange &Segment) {
+            auto It = llvm::upper_bound(CallPositions, Segment.StartPoint);
+            return It != CallPositions.end() && *It + 1 < Segment.EndPoint;
+        };
+
+        // The segments of each register, collected block by block walking the
+        // instructions backwards, and the end of the segment of a live register.
+        std::vector<llvm::SmallVector<LiveRange, 1>> Segments(NumRegs);
+        std::vector<unsigned> SegmentEnd(NumRegs);
+        llvm::SmallVector<uint32_t, 8> Uses, Defs;
+        for (const auto &B : Blocks) {
+            llvm::BitVector Live = getLiveOut(B);
+            for (unsigned Idx : Live.set_bits())
+                SegmentEnd[Idx] = B.End;
+            for (unsigned i = B.End; i-- > B.Begin;) {
+                Uses.clear();
+                Defs.clear();
+                getUsesAndDefs(*Insts[i], Uses, Defs);
+                for (uint32_t Reg : Defs) {
+                    unsigned Idx = getLivenessIndex(Reg);
+                    Segments[Idx].push_back(
+                        {i, Live.test(Idx) ? SegmentEnd[Idx] : i + 1, false});
+                    Live.reset(Idx);
+                }
+                for (uint32_t Reg : Uses) {
+                    unsigned Idx = getLivenessIndex(Reg);
+                    if (!Live.test(Idx)) {
+                        Live.set(Idx);
+                        SegmentEnd[Idx] = i + 1;
+                    }
+                }
+            }
+            for (unsigned Idx : Live.set_bits())
+                Segments[Idx].push_back({B.Begin, SegmentEnd[Idx], false});
+        }
+
+        for (unsigned Idx = 0; Idx < NumRegs; ++Idx) {
+            auto &RegSegments = Segments[Idx];
+            if (RegSegments.empty())
+                continue;
+            // Merge the overlapping and adjacent segments, e.g. the segment which
+            // ends at an instruction reading and writing a register and the one
+            // which starts there.
+            llvm::sort(RegSegments, [](const LiveRange &LHS, const LiveRange &RHS) {
+                return LHS.StartPoint < RHS.StartPoint;
+            });
+            auto Last = RegSegments.begin();
+            for (auto It = std::next(Last), E = RegSegments.end(); It != E; ++It) {
+                if (It->StartPoint <= Last->EndPoint)
+                    Last->EndPoint = std::max(Last->EndPoint, It->EndPoint);
+                else
+                    *++Last = *It;
+            }
+            RegSegments.erase(std::next(Last), RegSegments.end());
+            for (auto &Segment : RegSegments)
+                Segment.UsedAcrossCall = CrossesCall(Segment);
+
+            auto &Ranges = RegLiveRangesMap[getRegister(Idx)].Ranges;
+            if (Idx < NumVirtRegs) {
+                bool UsedAcrossCall = llvm::any_of(
+                    RegSegments, [](const LiveRange &S) { return S.UsedAcrossCall; });
+                Ranges.push_back({RegSegments.front().StartPoint,
+                                  RegSegments.back().EndPoint, UsedAcrossCall});
+            } else {
+                Ranges.assign(RegSegments.begin(), RegSegments.end());
+            }
+        }
+    }
+
+private:
+    void buildControlFlowGraph(AsmFunction *F) {
+        llvm::DenseMap<AsmSymbol *, unsigned> LabelToBlock;
+        for (auto &I : *F) {
+            unsigned Index = Insts.size();
+            Insts.push_back(&I);
+            if (Index != 0 && !TI.isLabelInstruction(I))
+                continue;
+            if (!Blocks.empty())
+                Blocks.back().End = Index;
+            Blocks.push_back({Index, Index, Index});
+            if (TI.isLabelInstruction(I))
+                LabelToBlock[I.getOperand(0).getLabel()] = Blocks.size() - 1;
+        }
+        Blocks.back().End = Insts.size();
+
+        auto AddEdge = [&](unsigned From, unsigned To) {
+            if (llvm::is_contained(Blocks[From].Succs, To))
+                return;
+            Blocks[From].Succs.push_back(To);
+            Blocks[To].Preds.push_back(From);
+        };
+        for (unsigned b = 0; b < Blocks.size(); ++b) {
+            Block &B = Blocks[b];
+            B.FirstTerminator = B.End;
+            while (B.FirstTerminator > B.Begin &&
+                   TI.isBranchInstruction(*Insts[B.FirstTerminator - 1]))
+                --B.FirstTerminator;
+            bool FallThrough = true;
+            for (unsigned i = B.FirstTerminator; i < B.End; ++i) {
+                const AsmInstruction &I = *Insts[i];
+                for (unsigned OpNo = 0; OpNo < I.getNumOperands(); ++OpNo) {
+                    if (!I.getOperand(OpNo).isLabel())
+                        continue;
+                    assert(LabelToBlock.count(I.getOperand(OpNo).getLabel()) &&
+                           "Branch to a label outside of the function");
+                    AddEdge(b, LabelToBlock.lookup(I.getOperand(OpNo).getLabel()));
+                }
+                if (TI.isUnconditionalBranchInstruction(I))
+                    FallThrough = false;
+                else
+                    B.HasConditionalBranch = true;
+            }
+            if (FallThrough && b + 1 < Blocks.size())
+                AddEdge(b, b + 1);
+        }
+    }
+
+    void computeLiveness() {
+        unsigned NumRegs = getNumTrackedRegs();
+        llvm::SmallVector<uint32_t, 8> Uses, Defs;
+        for (auto &B : Blocks) {
+            B.Gen.resize(NumRegs);
+            B.Kill.resize(NumRegs);
+            B.LiveIn.resize(NumRegs);
+            for (unsigned i = B.Begin; i < B.End; ++i) {
+                Uses.clear();
+                Defs.clear();
+                getUsesAndDefs(*Insts[i], Uses, Defs);
+                for (uint32_t Reg : Uses)
+                    if (!B.Kill.test(getLivenessIndex(Reg)))
+                        B.Gen.set(getLivenessIndex(Reg));
+                for (uint32_t Reg : Defs)
+                    B.Kill.set(getLivenessIndex(Reg));
+            }
+        }
+
+        bool Changed = true;
+        while (Changed) {
+            Changed = false;
+            for (auto &B : llvm::reverse(Blocks)) {
+                llvm::BitVector LiveIn = getLiveOut(B);
+                LiveIn.reset(B.Kill);
+                LiveIn |= B.Gen;
+                if (LiveIn != B.LiveIn) {
+                    B.LiveIn = std::move(LiveIn);
+                    Changed = true;
+                }
+            }
+        }
+    }
+};
+
+}  // namespace remniw
@@ -12,7 +12,7 @@ AsmOperand::MemOp RISCVAsmBuilder::handleALLOCA(uint32_t StackObjectIndex) {
 
 AsmOperand::RegOp RISCVAsmBuilder::handleLOAD(llvm::Instruction *I,
                                               AsmOperand::MemOp Mem) {
-    uint32_t VirtReg = Register::createVirtReg();
+    uint32_t VirtReg = createVirtReg();
     auto Reg = AsmOperand::createReg(VirtReg);
     createLDInst(
         /* destination register */ Reg,
@@ -22,7 +22,7 @@ AsmOperand::RegOp RISCVAsmBuilder::handleLOAD(llvm::Instruction *I,
 
 AsmOperand::RegOp RISCVAsmBuilder::handleLOAD(llvm::Instruction *I,
                                               AsmOperand::RegOp Reg) {
-    uint32_t VirtReg = Register::createVirtReg();
+    uint32_t VirtReg = createVirtReg();
     auto DstReg = AsmOperand::createReg(VirtReg);
     createLDInst(
         /* destination register */ DstReg,
@@ -55,7 +55,7 @@ void RISCVAsmBuilder::handleSTORE(llvm::Instruction *I, AsmOperand::RegOp Reg1,
 
 void RISCVAsmBuilder::handleSTORE(llvm::Instruction *I, AsmOperand::ImmOp Imm,
                                   AsmOperand::RegOp Reg) {
-    uint32_t VirtReg = Register::createVirtReg();
+    uint32_t VirtReg = createVirtReg();
     createLIInst(/* destination register */ AsmOperand::createReg(VirtReg),
                  /* immediate */ Imm);
     createSDInst(
@@ -65,7 +65,7 @@ void RISCVAsmBuilder::handleSTORE(llvm::Instruction *I, AsmOperand::ImmOp Imm,
 
 void RISCVAsmBuilder::handleSTORE(llvm::Instruction *I, AsmOperand::ImmOp Imm,
                                   AsmOperand::MemOp Mem) {
-    uint32_t VirtReg = Register::createVirtReg();
+    uint32_t VirtReg = createVirtReg();
     createLIInst(/* destination register */ AsmOperand::createReg(VirtReg),
                  /* immediate */ Imm);
     createSDInst(
@@ -75,7 +75,7 @@ void RISCVAsmBuilder::handleSTORE(llvm::Instruction *I, AsmOperand::ImmOp Imm,
 
 void RISCVAsmBuilder::handleSTORE(llvm::Instruction *I, AsmOperand::MemOp Mem1,
                                   AsmOperand::MemOp Mem2, bool DestIsArgument) {
-    uint32_t VirtReg = Register::createVirtReg();
+    uint32_t VirtReg = createVirtReg();
     storeMemoryAddressToReg(Mem1, AsmOperand::createReg(VirtReg));
     createSDInst(/* source register */ AsmOperand::createReg(VirtReg),
                  /* memory (base register and offset) */ Mem2);
@@ -83,7 +83,7 @@ void RISCVAsmBuilder::handleSTORE(llvm::Instruction *I, AsmOperand::MemOp Mem1,
 
 void RISCVAsmBuilder::handleSTORE(llvm::Instruction *I, AsmOperand::LabelOp Label,
                                   AsmOperand::MemOp Mem) {
-    uint32_t VirtReg = Register::createVirtReg();
+    uint32_t VirtReg = createVirtReg();
     createLAInst(/* destination register */ AsmOperand::createReg(VirtReg),
                  /* source SYMBOL */ Label);
     createSDInst(/* source register */ AsmOperand::createReg(VirtReg),
@@ -92,7 +92,7 @@ void RISCVAsmBuilder::handleSTORE(llvm::Instruction *I, AsmOperand::LabelOp Labe
 
 void RISCVAsmBuilder::handleSTORE(llvm::Instruction *I, llvm::Argument *FuncArg,
                                   AsmOperand::MemOp Mem) {
-    uint32_t VirtReg = Register::createVirtReg();
+    uint32_t VirtReg = createVirtReg();
     unsigned ArgNo = FuncArg->getArgNo();
     if (ArgNo < RISCV::NumArgRegs) {
         createSDInst(/* source register */ AsmOperand::createReg(RISCV::ArgRegs[ArgNo]),
@@ -108,6 +108,38 @@ void RISCVAsmBuilder::handleSTORE(llvm::Instruction *I, llvm::Argument *FuncArg,
     }
 }
 
+AsmOperand::RegOp RISCVAsmBuilder::handleFUNCARG(llvm::Argument *FuncArg) {
+    uint32_t VirtReg = createVirtReg();
+    unsigned ArgNo = FuncArg->getArgNo();
+    if (ArgNo < RISCV::NumArgRegs) {
+        createMVInst(/* destination register */ AsmOperand::createReg(VirtReg),
+                     /* source register */ AsmOperand::createReg(RISCV::ArgRegs[ArgNo]));
+    } else {
+        uint32_t FuncArgStackObjectIndex = ArgNo - RISCV::NumArgRegs;
+        createLDInst(
+            /* destination register */ AsmOperand::createReg(VirtReg),
+            /* memory (base register and offset) */ AsmOperand::createStackObject(
+                FuncArgStackObjectIndex));
+    }
+    return {VirtReg};
+}
+
+void RISCVAsmBuilder::handleCOPY(AsmOperand::RegOp Src, AsmOperand::RegOp Dst) {
+    createMVInst(/* destination register */ Dst, /* source register */ Src);
+}
+
+void RISCVAsmBuilder::handleCOPY(AsmOperand::ImmOp Src, AsmOperand::RegOp Dst) {
+    createLIInst(/* destination register */ Dst, /* immediate */ Src);
+}
+
+void RISCVAsmBuilder::handleCOPY(AsmOperand::MemOp Src, AsmOperand::RegOp Dst) {
+    storeMemoryAddressToReg(Src, Dst);
+}
+
+void RISCVAsmBuilder::handleCOPY(AsmOperand::LabelOp Src, AsmOperand::RegOp Dst) {
+    createLAInst(/* destination register */ Dst, /* symbol */ Src);
+}
+
 AsmOperand::MemOp RISCVAsmBuilder::handleGETELEMENTPTR(llvm::Instruction *I,
                                                        AsmOperand::MemOp Mem,
                                                        AsmOperand::ImmOp Imm) {
@@ -115,7 +147,7 @@ AsmOperand::MemOp RISCVAsmBuilder::handleGETELEMENTPTR(llvm::Instruction *I,
     uint32_t SizeInBytes =
         GEP->getFunction()->getParent()->getDataLayout().getTypeAllocSize(
             GEP->getResultElementType());
-    uint32_t VirtReg = Register::createVirtReg();
+    uint32_t VirtReg = createVirtReg();
     storeMemoryAddressToReg(Mem, AsmOperand::createReg(VirtReg));
     return AsmOperand::createMem(SizeInBytes * Imm.Val, VirtReg);
 }
@@ -127,9 +159,9 @@ AsmOperand::MemOp RISCVAsmBuilder::handleGETELEMENTPTR(llvm::Instruction *I,
     uint32_t SizeInBytes =
         GEP->getFunction()->getParent()->getDataLayout().getTypeAllocSize(
             GEP->getResultElementType());
-    uint32_t VirtReg1 = Register::createVirtReg();
+    uint32_t VirtReg1 = createVirtReg();
     storeMemoryAddressToReg(Mem, AsmOperand::createReg(VirtReg1));
-    uint32_t VirtReg2 = Register::createVirtReg();
+    uint32_t VirtReg2 = createVirtReg();
     createLIInst(
         /* destination register */ AsmOperand::createReg(VirtReg2),
         /* source immediate */ AsmOperand::createImm(SizeInBytes));
@@ -160,7 +192,7 @@ AsmOperand::MemOp RISCVAsmBuilder::handleGETELEMENTPTR(llvm::Instruction *I,
     uint32_t SizeInBytes =
         GEP->getFunction()->getParent()->getDataLayout().getTypeAllocSize(
             GEP->getResultElementType());
-    uint32_t VirtReg = Register::createVirtReg();
+    uint32_t VirtReg = createVirtReg();
     createLIInst(
         /* destination register */ AsmOperand::createReg(VirtReg),
         /* source immediate */ AsmOperand::createImm(SizeInBytes));
@@ -183,7 +215,7 @@ void RISCVAsmBuilder::handleICMP(llvm::Instruction *I, AsmOperand::RegOp Reg1,
 void RISCVAsmBuilder::handleICMP(llvm::Instruction *I, AsmOperand::RegOp Reg,
                                  AsmOperand::ImmOp Imm) {
     auto *CI = llvm::cast<llvm::CmpInst>(I);
-    uint32_t LIDstReg = Register::createVirtReg();
+    uint32_t LIDstReg = createVirtReg();
     createLIInst(/* destination register */ AsmOperand::createReg(LIDstReg),
                  /* immediate */ Imm);
     CondRegsMap.insert({CI, {Reg.RegNo, LIDstReg}});
@@ -192,12 +224,21 @@ void RISCVAsmBuilder::handleICMP(llvm::Instruction *I, AsmOperand::RegOp Reg,
 void RISCVAsmBuilder::handleICMP(llvm::Instruction *I, AsmOperand::ImmOp Imm,
                                  AsmOperand::RegOp Reg) {
     auto *CI = llvm::cast<llvm::CmpInst>(I);
-    uint32_t LIDstReg = Register::createVirtReg();
+    uint32_t LIDstReg = createVirtReg();
     createLIInst(/* destination register */ AsmOperand::createReg(LIDstReg),
                  /* immediate */ Imm);
     CondRegsMap.insert({CI, {LIDstReg, Reg.RegNo}});
 }
 
+void RISCVAsmBuilder::handleICMP(llvm::Instruction *I, AsmOperand::RegOp Reg,
+                                 AsmOperand::LabelOp Label) {
+    auto *CI = llvm::cast<llvm::CmpInst>(I);
+    uint32_t LADstReg = createVirtReg();
+    createLAInst(/* destination register */ AsmOperand::createReg(LADstReg),
+                 /* symbol */ Label);
+    CondRegsMap.insert({CI, {Reg.RegNo, LADstReg}});
+}
+
 void RISCVAsmBuilder::handleBR(llvm::Instruction *I, AsmOperand::LabelOp Label1,
                                AsmOperand::LabelOp Label2) {
     auto *BI = llvm::cast<llvm::BranchInst>(I);
@@ -208,40 +249,26 @@ void RISCVAsmBuilder::handleBR(llvm::Instruction *I, AsmOperand::LabelOp Label1,
             /* source register 1 */ AsmOperand::createReg(CondRegsMap[CI].first),
             /* source register 2 */ AsmOperand::createReg(CondRegsMap[CI].second),
             Label1);
-        createBNEInst(
-            /* source register 1 */ AsmOperand::createReg(CondRegsMap[CI].first),
-            /* source register 2 */ AsmOperand::createReg(CondRegsMap[CI].second),
-            Label2);
         break;
     case llvm::CmpInst::Predicate::ICMP_NE:
         createBNEInst(
             /* source register 1 */ AsmOperand::createReg(CondRegsMap[CI].first),
             /* source register 2 */ AsmOperand::createReg(CondRegsMap[CI].second),
             Label1);
-        createBEQInst(
-            /* source register 1 */ AsmOperand::createReg(CondRegsMap[CI].first),
-            /* source register 2 */ AsmOperand::createReg(CondRegsMap[CI].second),
-            Label2);
         break;
     case llvm::CmpInst::Predicate::ICMP_SGT:
         createBGTInst(
             /* source register 1 */ AsmOperand::createReg(CondRegsMap[CI].first),
             /* source register 2 */ AsmOperand::createReg(CondRegsMap[CI].second),
             Label1);
-        createBLEInst(
-            /* source register 1 */ AsmOperand::createReg(CondRegsMap[CI].first),
-            /* source register 2 */ AsmOperand::createReg(CondRegsMap[CI].second),
-            Label2);
         break;
     default: llvm_unreachable("Invalid CmpInst!\n");
     }
 
-    // TODO: optimize
+    // Fall through to the false successor if it is the next block.
     llvm::BasicBlock *NextBB = BI->getParent()->getNextNode();
-    if (NextBB == BI->getSuccessor(0)) {
-    } else if (NextBB == BI->getSuccessor(1)) {
-    } else {
-    }
+    if (NextBB != BI->getSuccessor(1))
+        createJInst(Label2);
 }
 
 void RISCVAsmBuilder::handleBR(llvm::Instruction *I, AsmOperand::LabelOp Label) {
@@ -250,7 +277,7 @@ void RISCVAsmBuilder::handleBR(llvm::Instruction *I, AsmOperand::LabelOp Label)
 
 AsmOperand::RegOp RISCVAsmBuilder::handleADD(llvm::Instruction *I, AsmOperand::RegOp Reg1,
                                              AsmOperand::RegOp Reg2) {
-    uint32_t VirtReg = Register::createVirtReg();
+    uint32_t VirtReg = createVirtReg();
     createADDInst(/* destination register */ AsmOperand::createReg(VirtReg),
                   /* source register 1 */ Reg1,
                   /* source register 2 */ Reg2);
@@ -259,7 +286,7 @@ AsmOperand::RegOp RISCVAsmBuilder::handleADD(llvm::Instruction *I, AsmOperand::R
 
 AsmOperand::RegOp RISCVAsmBuilder::handleADD(llvm::Instruction *I, AsmOperand::RegOp Reg,
                                              AsmOperand::ImmOp Imm) {
-    uint32_t VirtReg = Register::createVirtReg();
+    uint32_t VirtReg = createVirtReg();
     createLIInst(/* destination register */ AsmOperand::createReg(VirtReg),
                  /* immediate */ Imm);
     createADDInst(/* destination register */ AsmOperand::createReg(VirtReg),
@@ -270,7 +297,7 @@ AsmOperand::RegOp RISCVAsmBuilder::handleADD(llvm::Instruction *I, AsmOperand::R
 
 AsmOperand::RegOp RISCVAsmBuilder::handleADD(llvm::Instruction *I, AsmOperand::ImmOp Imm,
                                              AsmOperand::RegOp Reg) {
-    uint32_t VirtReg = Register::createVirtReg();
+    uint32_t VirtReg = createVirtReg();
     createLIInst(/* destination register */ AsmOperand::createReg(VirtReg),
                  /* immediate */ Imm);
     createADDInst(/* destination register */ AsmOperand::createReg(VirtReg),
@@ -281,13 +308,21 @@ AsmOperand::RegOp RISCVAsmBuilder::handleADD(llvm::Instruction *I, AsmOperand::I
 
 AsmOperand::RegOp RISCVAsmBuilder::handleADD(llvm::Instruction *I, AsmOperand::ImmOp Imm1,
                                              AsmOperand::ImmOp Imm2) {
-    llvm_unreachable("Unexpected handleADD(imm, imm)!\n");
-    return {Register::NoRegister};
+    uint32_t LIDstReg = createVirtReg();
+    createLIInst(/* destination register */ AsmOperand::createReg(LIDstReg),
+                 /* immediate */ Imm1);
+    uint32_t VirtReg = createVirtReg();
+    createLIInst(/* destination register */ AsmOperand::createReg(VirtReg),
+                 /* immediate */ Imm2);
+    createADDInst(/* destination register */ AsmOperand::createReg(VirtReg),
+                  /* source register 1 */ AsmOperand::createReg(LIDstReg),
+                  /* source register 2 */ AsmOperand::createReg(VirtReg));
+    return {VirtReg};
 }
 
 AsmOperand::RegOp RISCVAsmBuilder::handleSUB(llvm::Instruction *I, AsmOperand::RegOp Reg1,
                                              AsmOperand::RegOp Reg2) {
-    uint32_t VirtReg = Register::createVirtReg();
+    uint32_t VirtReg = createVirtReg();
     createSUBInst(/* destination register*/ AsmOperand::createReg(VirtReg),
                   /* source register 1*/ Reg1,
                   /* source register 2*/ Reg2);
@@ -296,7 +331,7 @@ AsmOperand::RegOp RISCVAsmBuilder::handleSUB(llvm::Instruction *I, AsmOperand::R
 
 AsmOperand::RegOp RISCVAsmBuilder::handleSUB(llvm::Instruction *I, AsmOperand::RegOp Reg,
                                              AsmOperand::ImmOp Imm) {
-    uint32_t VirtReg = Register::createVirtReg();
+    uint32_t VirtReg = createVirtReg();
     createLIInst(/* destination register */ AsmOperand::createReg(VirtReg),
                  /* immediate */ Imm);
     createSUBInst(/* destination register */ AsmOperand::createReg(VirtReg),
@@ -307,7 +342,7 @@ AsmOperand::RegOp RISCVAsmBuilder::handleSUB(llvm::Instruction *I, AsmOperand::R
 
 AsmOperand::RegOp RISCVAsmBuilder::handleSUB(llvm::Instruction *I, AsmOperand::ImmOp Imm,
                                              AsmOperand::RegOp Reg) {
-    uint32_t LIDstReg = Register::createVirtReg();
+    uint32_t LIDstReg = createVirtReg();
     createLIInst(/* destination register */ AsmOperand::createReg(LIDstReg),
                  /* immediate */ Imm);
     createSUBInst(/* destination register */ AsmOperand::createReg(LIDstReg),
@@ -318,13 +353,21 @@ AsmOperand::RegOp RISCVAsmBuilder::handleSUB(llvm::Instruction *I, AsmOperand::I
 
 AsmOperand::RegOp RISCVAsmBuilder::handleSUB(llvm::Instruction *I, AsmOperand::ImmOp Imm1,
                                              AsmOperand::ImmOp Imm2) {
-    llvm_unreachable("Unexpected handleSUB(imm, imm)!\n");
-    return {Register::NoRegister};
+    uint32_t LIDstReg = createVirtReg();
+    createLIInst(/* destination register */ AsmOperand::createReg(LIDstReg),
+                 /* immediate */ Imm1);
+    uint32_t VirtReg = createVirtReg();
+    createLIInst(/* destination register */ AsmOperand::createReg(VirtReg),
+                 /* immediate */ Imm2);
+    createSUBInst(/* destination register */ AsmOperand::createReg(VirtReg),
+                  /* source register 1 */ AsmOperand::createReg(LIDstReg),
+                  /* source register 2 */ AsmOperand::createReg(VirtReg));
+    return {VirtReg};
 }
 
 AsmOperand::RegOp RISCVAsmBuilder::handleMUL(llvm::Instruction *I, AsmOperand::RegOp Reg1,
                                              AsmOperand::RegOp Reg2) {
-    uint32_t VirtReg = Register::createVirtReg();
+    uint32_t VirtReg = createVirtReg();
     createMULInst(/*destination register */ AsmOperand::createReg(VirtReg),
                   /*source register 1*/ Reg1,
                   /*source register 2*/ Reg2);
@@ -333,7 +376,7 @@ AsmOperand::RegOp RISCVAsmBuilder::handleMUL(llvm::Instruction *I, AsmOperand::R
 
 AsmOperand::RegOp RISCVAsmBuilder::handleMUL(llvm::Instruction *I, AsmOperand::RegOp Reg,
                                              AsmOperand::ImmOp Imm) {
-    uint32_t VirtReg = Register::createVirtReg();
+    uint32_t VirtReg = createVirtReg();
     createLIInst(/* destination register */ AsmOperand::createReg(VirtReg),
                  /* immediate */ Imm);
     createMULInst(/* destination register */ AsmOperand::createReg(VirtReg),
@@ -344,7 +387,7 @@ AsmOperand::RegOp RISCVAsmBuilder::handleMUL(llvm::Instruction *I, AsmOperand::R
 
 AsmOperand::RegOp RISCVAsmBuilder::handleMUL(llvm::Instruction *I, AsmOperand::ImmOp Imm,
                                              AsmOperand::RegOp Reg) {
-    uint32_t VirtReg = Register::createVirtReg();
+    uint32_t VirtReg = createVirtReg();
     createLIInst(/* destination register */ AsmOperand::createReg(VirtReg),
                  /* immediate */ Imm);
     createMULInst(/* destination register */ AsmOperand::createReg(VirtReg),
@@ -355,14 +398,22 @@ AsmOperand::RegOp RISCVAsmBuilder::handleMUL(llvm::Instruction *I, AsmOperand::I
 
 AsmOperand::RegOp RISCVAsmBuilder::handleMUL(llvm::Instruction *I, AsmOperand::ImmOp Imm1,
                                              AsmOperand::ImmOp Imm2) {
-    llvm_unreachable("Unexpected handleMUL(imm, imm)!\n");
-    return {Register::NoRegister};
+    uint32_t LIDstReg = createVirtReg();
+    createLIInst(/* destination register */ AsmOperand::createReg(LIDstReg),
+                 /* immediate */ Imm1);
+    uint32_t VirtReg = createVirtReg();
+    createLIInst(/* destination register */ AsmOperand::createReg(VirtReg),
+                 /* immediate */ Imm2);
+    createMULInst(/* destination register */ AsmOperand::createReg(VirtReg),
+                  /* source register 1 */ AsmOperand::createReg(LIDstReg),
+                  /* source register 2 */ AsmOperand::createReg(VirtReg));
+    return {VirtReg};
 }
 
 AsmOperand::RegOp RISCVAsmBuilder::handleSDIV(llvm::Instruction *I,
                                               AsmOperand::RegOp Reg1,
                                               AsmOperand::RegOp Reg2) {
-    uint32_t VirtReg = Register::createVirtReg();
+    uint32_t VirtReg = createVirtReg();
     createDIVInst(/* destination register */ AsmOperand::createReg(VirtReg),
                   /* source register 1*/ Reg1,
                   /* source register 2*/ Reg2);
@@ -371,7 +422,7 @@ AsmOperand::RegOp RISCVAsmBuilder::handleSDIV(llvm::Instruction *I,
 
 AsmOperand::RegOp RISCVAsmBuilder::handleSDIV(llvm::Instruction *I, AsmOperand::RegOp Reg,
                                               AsmOperand::ImmOp Imm) {
-    uint32_t VirtReg = Register::createVirtReg();
+    uint32_t VirtReg = createVirtReg();
     createLIInst(/* destination register */ AsmOperand::createReg(VirtReg),
                  /* immediate */ Imm);
     createDIVInst(/* destination register */ AsmOperand::createReg(VirtReg),
@@ -382,7 +433,7 @@ AsmOperand::RegOp RISCVAsmBuilder::handleSDIV(llvm::Instruction *I, AsmOperand::
 
 AsmOperand::RegOp RISCVAsmBuilder::handleSDIV(llvm::Instruction *I, AsmOperand::ImmOp Imm,
                                               AsmOperand::RegOp Reg) {
-    uint32_t VirtReg = Register::createVirtReg();
+    uint32_t VirtReg = createVirtReg();
     createLIInst(/* destination register */ AsmOperand::createReg(VirtReg),
                  /* immediate */ Imm);
     createDIVInst(/* destination register */ AsmOperand::createReg(VirtReg),
@@ -394,8 +445,16 @@ AsmOperand::RegOp RISCVAsmBuilder::handleSDIV(llvm::Instruction *I, AsmOperand::
 AsmOperand::RegOp RISCVAsmBuilder::handleSDIV(llvm::Instruction *I,
                                               AsmOperand::ImmOp Imm1,
                                               AsmOperand::ImmOp Imm2) {
-    llvm_unreachable("Unexpected handleSDIV(imm, imm)!\n");
-    return {Register::NoRegister};
+    uint32_t LIDstReg = createVirtReg();
+    createLIInst(/* destination register */ AsmOperand::createReg(LIDstReg),
+                 /* immediate */ Imm1);
+    uint32_t VirtReg = createVirtReg();
+    createLIInst(/* destination register */ AsmOperand::createReg(VirtReg),
+                 /* immediate */ Imm2);
+    createDIVInst(/* destination register */ AsmOperand::createReg(VirtReg),
+                  /* source register 1 */ AsmOperand::createReg(LIDstReg),
+                  /* source register 2 */ AsmOperand::createReg(VirtReg));
+    return {VirtReg};
 }
 
 AsmOperand::RegOp RISCVAsmBuilder::handleCALL(llvm::Instruction *I,
@@ -403,7 +462,7 @@ AsmOperand::RegOp RISCVAsmBuilder::handleCALL(llvm::Instruction *I,
     CallArgOffsetFromStackPointer = 0;
     auto *CB = llvm::cast<llvm::CallBase>(I);
     createCALLInst(Label, /*DirectCall*/ true, CB->arg_size());
-    uint32_t VirtReg = Register::createVirtReg();
+    uint32_t VirtReg = createVirtReg();
     createMVInst(/* destination register */ AsmOperand::createReg(VirtReg),
                  /* source register */ AsmOperand::createReg(RISCV::A0));
     return {VirtReg};
@@ -414,7 +473,7 @@ AsmOperand::RegOp RISCVAsmBuilder::handleCALL(llvm::Instruction *I,
     CallArgOffsetFromStackPointer = 0;
     auto *CB = llvm::cast<llvm::CallBase>(I);
     createCALLInst(Reg, /*DirectCall*/ false, CB->arg_size());
-    uint32_t VirtReg = Register::createVirtReg();
+    uint32_t VirtReg = createVirtReg();
     createMVInst(/* destination register */ AsmOperand::createReg(VirtReg),
                  /* source register */ AsmOperand::createReg(RISCV::A0));
     return {VirtReg};
@@ -425,7 +484,7 @@ AsmOperand::RegOp RISCVAsmBuilder::handleCALL(llvm::Instruction *I,
     CallArgOffsetFromStackPointer = 0;
     auto *CB = llvm::cast<llvm::CallBase>(I);
     createCALLInst(Mem, /*DirectCall*/ false, CB->arg_size());
-    uint32_t VirtReg = Register::createVirtReg();
+    uint32_t VirtReg = createVirtReg();
     createMVInst(/* destination register */ AsmOperand::createReg(VirtReg),
                  /* source register */ AsmOperand::createReg(RISCV::A0));
     return {VirtReg};
@@ -458,7 +517,7 @@ void RISCVAsmBuilder::handleARG(llvm::Instruction *CI, unsigned ArgNo,
         auto *CB = llvm::cast<llvm::CallBase>(CI);
         llvm::Type *Ty = CB->getArgOperand(ArgNo)->getType();
         uint64_t SizeInBytes = CB->getModule()->getDataLayout().getTypeAllocSize(Ty);
-        uint32_t VirtReg = Register::createVirtReg();
+        uint32_t VirtReg = createVirtReg();
         createLIInst(/* destination register */ AsmOperand::createReg(VirtReg),
                      /* immediate */ Imm);
         createSDInst(/* source register */ AsmOperand::createReg(VirtReg),
@@ -470,7 +529,7 @@ void RISCVAsmBuilder::handleARG(llvm::Instruction *CI, unsigned ArgNo,
 
 void RISCVAsmBuilder::handleARG(llvm::Instruction *CI, unsigned ArgNo,
                                 AsmOperand::MemOp Mem) {
-    uint32_t VirtReg = Register::createVirtReg();
+    uint32_t VirtReg = createVirtReg();
     storeMemoryAddressToReg(Mem, AsmOperand::createReg(VirtReg));
     if (ArgNo < RISCV::NumArgRegs) {
         createMVInst(
@@ -489,7 +548,7 @@ void RISCVAsmBuilder::handleARG(llvm::Instruction *CI, unsigned ArgNo,
 
 void RISCVAsmBuilder::handleARG(llvm::Instruction *CI, unsigned ArgNo,
                                 AsmOperand::LabelOp Label) {
-    uint32_t LADstReg = Register::createVirtReg();
+    uint32_t LADstReg = createVirtReg();
     createLAInst(/* destination register */ AsmOperand::createReg(LADstReg),
                  /* source SYMBOL */ Label);
     if (ArgNo < RISCV::NumArgRegs) {
@@ -525,8 +584,6 @@ void RISCVAsmBuilder::storeMemoryAddressToReg(AsmOperand::MemOp SrcMem,
 
 AsmInstruction *RISCVAsmBuilder::createLDInst(AsmOperand DstReg, AsmOperand SrcMem) {
     assert(DstReg.isReg() && SrcMem.isMem());
-    updateAsmOperandLiveRanges(DstReg);
-    updateAsmOperandLiveRanges(SrcMem);
     auto *I = AsmInstruction::create(RISCV::LD, getCurrentFunction());
     I->addOperand(DstReg);
     I->addOperand(SrcMem);
@@ -535,8 +592,6 @@ AsmInstruction *RISCVAsmBuilder::createLDInst(AsmOperand DstReg, AsmOperand SrcM
 
 AsmInstruction *RISCVAsmBuilder::createSDInst(AsmOperand SrcReg, AsmOperand DstMem) {
     assert(SrcReg.isReg() && DstMem.isMem());
-    updateAsmOperandLiveRanges(SrcReg);
-    updateAsmOperandLiveRanges(DstMem);
     auto *I = AsmInstruction::create(RISCV::SD, getCurrentFunction());
     I->addOperand(SrcReg);
     I->addOperand(DstMem);
@@ -545,8 +600,6 @@ AsmInstruction *RISCVAsmBuilder::createSDInst(AsmOperand SrcReg, AsmOperand DstM
 
 AsmInstruction *RISCVAsmBuilder::createMVInst(AsmOperand DstReg, AsmOperand SrcReg) {
     assert(DstReg.isReg() && SrcReg.isReg());
-    updateAsmOperandLiveRanges(DstReg);
-    updateAsmOperandLiveRanges(SrcReg);
     auto *I = AsmInstruction::create(RISCV::MV, getCurrentFunction());
     I->addOperand(DstReg);
     I->addOperand(SrcReg);
@@ -555,7 +608,6 @@ AsmInstruction *RISCVAsmBuilder::createMVInst(AsmOperand DstReg, AsmOperand SrcR
 
 AsmInstruction *RISCVAsmBuilder::createLIInst(AsmOperand DstReg, AsmOperand Imm) {
     assert(DstReg.isReg() && Imm.isImm());
-    updateAsmOperandLiveRanges(DstReg);
     auto *I = AsmInstruction::create(RISCV::LI, getCurrentFunction());
     I->addOperand(DstReg);
     I->addOperand(Imm);
@@ -564,7 +616,6 @@ AsmInstruction *RISCVAsmBuilder::createLIInst(AsmOperand DstReg, AsmOperand Imm)
 
 AsmInstruction *RISCVAsmBuilder::createLAInst(AsmOperand DstReg, AsmOperand Label) {
     assert(DstReg.isReg() && Label.isLabel());
-    updateAsmOperandLiveRanges(DstReg);
     auto *I = AsmInstruction::create(RISCV::LA, getCurrentFunction());
     I->addOperand(DstReg);
     I->addOperand(Label);
@@ -574,8 +625,6 @@ AsmInstruction *RISCVAsmBuilder::createLAInst(AsmOperand DstReg, AsmOperand Labe
 AsmInstruction *RISCVAsmBuilder::createBEQInst(AsmOperand Reg1, AsmOperand Reg2,
                                                AsmOperand Label) {
     assert(Reg1.isReg() && Reg2.isReg() && Label.isLabel());
-    updateAsmOperandLiveRanges(Reg1);
-    updateAsmOperandLiveRanges(Reg2);
     auto *I = AsmInstruction::create(RISCV::BEQ, getCurrentFunction());
     I->addOperand(Reg1);
     I->addOperand(Reg2);
@@ -586,8 +635,6 @@ AsmInstruction *RISCVAsmBuilder::createBEQInst(AsmOperand Reg1, AsmOperand Reg2,
 AsmInstruction *RISCVAsmBuilder::createBNEInst(AsmOperand Reg1, AsmOperand Reg2,
                                                AsmOperand Label) {
     assert(Reg1.isReg() && Reg2.isReg() && Label.isLabel());
-    updateAsmOperandLiveRanges(Reg1);
-    updateAsmOperandLiveRanges(Reg2);
     auto *I = AsmInstruction::create(RISCV::BNE, getCurrentFunction());
     I->addOperand(Reg1);
     I->addOperand(Reg2);
@@ -598,8 +645,6 @@ AsmInstruction *RISCVAsmBuilder::createBNEInst(AsmOperand Reg1, AsmOperand Reg2,
 AsmInstruction *RISCVAsmBuilder::createBGTInst(AsmOperand Reg1, AsmOperand Reg2,
                                                AsmOperand Label) {
     assert(Reg1.isReg() && Reg2.isReg() && Label.isLabel());
-    updateAsmOperandLiveRanges(Reg1);
-    updateAsmOperandLiveRanges(Reg2);
     auto *I = AsmInstruction::create(RISCV::BGT, getCurrentFunction());
     I->addOperand(Reg1);
     I->addOperand(Reg2);
@@ -610,8 +655,6 @@ AsmInstruction *RISCVAsmBuilder::createBGTInst(AsmOperand Reg1, AsmOperand Reg2,
 AsmInstruction *RISCVAsmBuilder::createBLEInst(AsmOperand Reg1, AsmOperand Reg2,
                                                AsmOperand Label) {
     assert(Reg1.isReg() && Reg2.isReg() && Label.isLabel());
-    updateAsmOperandLiveRanges(Reg1);
-    updateAsmOperandLiveRanges(Reg2);
     auto *I = AsmInstruction::create(RISCV::BLE, getCurrentFunction());
     I->addOperand(Reg1);
     I->addOperand(Reg2);
@@ -622,9 +665,6 @@ AsmInstruction *RISCVAsmBuilder::createBLEInst(AsmOperand Reg1, AsmOperand Reg2,
 AsmInstruction *RISCVAsmBuilder::createADDInst(AsmOperand DstReg, AsmOperand SrcReg1,
                                                AsmOperand SrcReg2) {
     assert(DstReg.isReg() && SrcReg1.isReg() && SrcReg2.isReg());
-    updateAsmOperandLiveRanges(DstReg);
-    updateAsmOperandLiveRanges(SrcReg1);
-    updateAsmOperandLiveRanges(SrcReg2);
     auto *I = AsmInstruction::create(RISCV::ADD, getCurrentFunction());
     I->addOperand(DstReg);
     I->addOperand(SrcReg1);
@@ -635,8 +675,6 @@ AsmInstruction *RISCVAsmBuilder::createADDInst(AsmOperand DstReg, AsmOperand Src
 AsmInstruction *RISCVAsmBuilder::createADDIInst(AsmOperand DstReg, AsmOperand SrcReg,
                                                 AsmOperand SrcImm) {
     assert(DstReg.isReg() && SrcReg.isReg() && SrcImm.isImm());
-    updateAsmOperandLiveRanges(DstReg);
-    updateAsmOperandLiveRanges(SrcReg);
     if (SrcImm.Imm.Val >= -2048 && SrcImm.Imm.Val <= 2047) {
         auto *I = AsmInstruction::create(RISCV::ADDI, getCurrentFunction());
         I->addOperand(DstReg);
@@ -644,7 +682,7 @@ AsmInstruction *RISCVAsmBuilder::createADDIInst(AsmOperand DstReg, AsmOperand Sr
         I->addOperand(SrcImm);
         return I;
     } else {
-        uint32_t VirtReg = Register::createVirtReg();
+        uint32_t VirtReg = createVirtReg();
         createLIInst(AsmOperand::createReg(VirtReg), SrcImm);
         auto *I = createADDInst(DstReg, SrcReg, AsmOperand::createReg(VirtReg));
         return I;
@@ -654,9 +692,6 @@ AsmInstruction *RISCVAsmBuilder::createADDIInst(AsmOperand DstReg, AsmOperand Sr
 AsmInstruction *RISCVAsmBuilder::createSUBInst(AsmOperand DstReg, AsmOperand SrcReg1,
                                                AsmOperand SrcReg2) {
     assert(DstReg.isReg() && SrcReg1.isReg() && SrcReg2.isReg());
-    updateAsmOperandLiveRanges(DstReg);
-    updateAsmOperandLiveRanges(SrcReg1);
-    updateAsmOperandLiveRanges(SrcReg2);
     auto *I = AsmInstruction::create(RISCV::SUB, getCurrentFunction());
     I->addOperand(DstReg);
     I->addOperand(SrcReg1);
@@ -667,9 +702,6 @@ AsmInstruction *RISCVAsmBuilder::createSUBInst(AsmOperand DstReg, AsmOperand Src
 AsmInstruction *RISCVAsmBuilder::createMULInst(AsmOperand DstReg, AsmOperand SrcReg1,
                                                AsmOperand SrcReg2) {
     assert(DstReg.isReg() && SrcReg1.isReg() && SrcReg2.isReg());
-    updateAsmOperandLiveRanges(DstReg);
-    updateAsmOperandLiveRanges(SrcReg1);
-    updateAsmOperandLiveRanges(SrcReg2);
     auto *I = AsmInstruction::create(RISCV::MUL, getCurrentFunction());
     I->addOperand(DstReg);
     I->addOperand(SrcReg1);
@@ -680,9 +712,6 @@ AsmInstruction *RISCVAsmBuilder::createMULInst(AsmOperand DstReg, AsmOperand Src
 AsmInstruction *RISCVAsmBuilder::createDIVInst(AsmOperand DstReg, AsmOperand SrcReg1,
                                                AsmOperand SrcReg2) {
     assert(DstReg.isReg() && SrcReg1.isReg() && SrcReg2.isReg());
-    updateAsmOperandLiveRanges(DstReg);
-    updateAsmOperandLiveRanges(SrcReg1);
-    updateAsmOperandLiveRanges(SrcReg2);
     auto *I = AsmInstruction::create(RISCV::DIV, getCurrentFunction());
     I->addOperand(DstReg);
     I->addOperand(SrcReg1);
@@ -692,7 +721,6 @@ AsmInstruction *RISCVAsmBuilder::createDIVInst(AsmOperand DstReg, AsmOperand Src
 
 AsmInstruction *RISCVAsmBuilder::createCALLInst(AsmOperand Callee, bool DirectCall,
                                                 unsigned NumArgs) {
-    updateAsmOperandLiveRanges(Callee);
     AsmInstruction *I;
     if (DirectCall) {
         I = AsmInstruction::create(RISCV::CALL, getCurrentFunction());
@@ -701,7 +729,6 @@ AsmInstruction *RISCVAsmBuilder::createCALLInst(AsmOperand Callee, bool DirectCa
     }
     I->addOperand(Callee);
     I->addOperand(AsmOperand::createImm(NumArgs));
-    getCurrentCallInstIndexes().push_back(getCurrentFunction()->size());
     return I;
 }
 
@@ -722,8 +749,6 @@ AsmInstruction *RISCVAsmBuilder::createJInst(AsmOperand LabelOp) {
 AsmInstruction *RISCVAsmBuilder::createGetStackObjectAddressUserInst(AsmOperand DstReg,
                                                                      AsmOperand SrcMem) {
     assert(DstReg.isReg() && SrcMem.isStackObject());
-    updateAsmOperandLiveRanges(DstReg);
-    updateAsmOperandLiveRanges(SrcMem);
     auto *I = AsmInstruction::create(RISCV::GET_STACKOBJECT_ADDRESS_USER_INST,
                                      getCurrentFunction());
     I->addOperand(DstReg);
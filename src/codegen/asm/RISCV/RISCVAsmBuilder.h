@@ -18,6 +18,13 @@ public:
 
     AsmOperand::MemOp handleALLOCA(uint32_t StackObjectIndex) override;
 
+    AsmOperand::RegOp handleFUNCARG(llvm::Argument *FuncArg) override;
+
+    void handleCOPY(AsmOperand::RegOp Src, AsmOperand::RegOp Dst) override;
+    void handleCOPY(AsmOperand::ImmOp Src, AsmOperand::RegOp Dst) override;
+    void handleCOPY(AsmOperand::MemOp Src, AsmOperand::RegOp Dst) override;
+    void handleCOPY(AsmOperand::LabelOp Src, AsmOperand::RegOp Dst) override;
+
     AsmOperand::RegOp handleLOAD(llvm::Instruction *I, AsmOperand::MemOp Mem) override;
     AsmOperand::RegOp handleLOAD(llvm::Instruction *I, AsmOperand::RegOp Reg) override;
 
@@ -54,6 +61,8 @@ public:
                     AsmOperand::ImmOp Imm) override;
     void handleICMP(llvm::Instruction *I, AsmOperand::ImmOp Imm,
                     AsmOperand::RegOp Reg) override;
+    void handleICMP(llvm::Instruction *I, AsmOperand::RegOp Reg,
+                    AsmOperand::LabelOp Label) override;
 
     void handleBR(llvm::Instruction *I, AsmOperand::LabelOp Label1,
                   AsmOperand::LabelOp Label2) override;
@@ -11,7 +11,8 @@ private:
     int64_t TotalStackFrameSizeInBytes {0};
 
 public:
-    RISCVAsmRewriter(const TargetInfo &TI): AsmRewriter(TI) {}
+    RISCVAsmRewriter(const TargetInfo &TI, RegAllocKind Kind = GreedyRegAlloc):
+        AsmRewriter(TI, Kind) {}
 
 private:
     void rewriteAsmInstVirtRegToPhysReg(
@@ -101,6 +102,34 @@ private:
         }
     }
 
+    void insertMove(AsmInstruction *InsertBefore, uint32_t Src, uint32_t Dst) override {
+        assert(!(Register::isStackSlot(Src) && Register::isStackSlot(Dst)));
+        if (Register::isStackSlot(Src)) {
+            auto *MI = AsmInstruction::create(RISCV::LD, InsertBefore);
+            MI->addOperand(AsmOperand::createReg(Dst));
+            MI->addOperand(
+                AsmOperand::createMem(getStackSlotOffsetForSpilledReg(Src), RISCV::FP));
+        } else if (Register::isStackSlot(Dst)) {
+            auto *MI = AsmInstruction::create(RISCV::SD, InsertBefore);
+            MI->addOperand(AsmOperand::createReg(Src));
+            MI->addOperand(
+                AsmOperand::createMem(getStackSlotOffsetForSpilledReg(Dst), RISCV::FP));
+        } else {
+            auto *MI = AsmInstruction::create(RISCV::MV, InsertBefore);
+            MI->addOperand(AsmOperand::createReg(Dst));
+            MI->addOperand(AsmOperand::createReg(Src));
+        }
+    }
+
+    int64_t getSavedRegsAreaSize(AsmFunction *F,
+                                 const llvm::SetVector<uint32_t> &UsedCalleeSavedRegs)
+        const override {
+        int64_t Size = RISCV::RegisterSize /* ra */ + RISCV::RegisterSize /* fp */;
+        if (F->getName() != "main")
+            Size += UsedCalleeSavedRegs.size() * RISCV::RegisterSize;
+        return Size;
+    }
+
     void insertPrologue(AsmFunction *F,
                         llvm::SetVector<uint32_t> &UsedCalleeSavedRegs) override {
         AsmInstruction *InsertBefore = &F->front();
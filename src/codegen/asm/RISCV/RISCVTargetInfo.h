@@ -184,6 +184,64 @@ public:
     llvm::ArrayRef<uint32_t> getFreeRegistersForRegisterAllocator() const override {
         return RISCV::FreeRegs;
     }
+
+    bool readsRegOperand(const AsmInstruction &I, unsigned OpNo) const override {
+        return !writesRegOperand(I, OpNo);
+    }
+
+    bool writesRegOperand(const AsmInstruction &I, unsigned OpNo) const override {
+        switch (I.getOpcode()) {
+        case RISCV::LD:
+        case RISCV::MV:
+        case RISCV::LI:
+        case RISCV::LA:
+        case RISCV::ADD:
+        case RISCV::ADDI:
+        case RISCV::SUB:
+        case RISCV::MUL:
+        case RISCV::DIV:
+        case RISCV::GET_STACKOBJECT_ADDRESS_USER_INST: return OpNo == 0;
+        default: return false;
+        }
+    }
+
+    void getImplicitRegisters(const AsmInstruction &I,
+                              llvm::SmallVectorImpl<uint32_t> &Uses,
+                              llvm::SmallVectorImpl<uint32_t> &Defs) const override {
+        if (I.getOpcode() == RISCV::CALL || I.getOpcode() == RISCV::JALR) {
+            // Second operand of RISCV::CALL and RISCV::JALR instruction is NumArgs.
+            for (unsigned i = 0; i < I.getOperand(1).Imm.Val && i < RISCV::NumArgRegs;
+                 ++i)
+                Uses.push_back(RISCV::ArgRegs[i]);
+            Defs.append(std::begin(RISCV::CallerSavedRegs),
+                        std::end(RISCV::CallerSavedRegs));
+        }
+    }
+
+    bool isLabelInstruction(const AsmInstruction &I) const override {
+        return I.getOpcode() == RISCV::LABEL;
+    }
+
+    bool isBranchInstruction(const AsmInstruction &I) const override {
+        return RISCV::BEQ <= I.getOpcode() && I.getOpcode() <= RISCV::J;
+    }
+
+    bool isUnconditionalBranchInstruction(const AsmInstruction &I) const override {
+        return I.getOpcode() == RISCV::J;
+    }
+
+    bool isCallInstruction(const AsmInstruction &I) const override {
+        return I.getOpcode() == RISCV::CALL || I.getOpcode() == RISCV::JALR;
+    }
+
+    bool isRegisterCopy(const AsmInstruction &I, uint32_t &Src,
+                        uint32_t &Dst) const override {
+        if (I.getOpcode() != RISCV::MV)
+            return false;
+        Dst = I.getOperand(0).getReg();
+        Src = I.getOperand(1).getReg();
+        return true;
+    }
 };
 
 }  // namespace remniw
@@ -63,11 +63,6 @@ public:
         assert(Index < (1u << 31) && "Index too large for virtual register range.");
         return Index | VirtualRegFlag;
     }
-
-    static Register createVirtReg() {
-        static uint32_t VirtRegIndex = 0;
-        return index2VirtReg(VirtRegIndex++);
-    }
 };
 
 }  // namespace remniw
@@ -1,19 +1,53 @@
 #pragma once
 
+#include "codegen/asm/AsmFunction.h"
+#include "codegen/asm/AsmInstruction.h"
 #include "codegen/asm/LiveInterval.h"
+#include "codegen/asm/LivenessAnalysis.h"
 #include "codegen/asm/Register.h"
 #include "codegen/asm/TargetInfo.h"
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/Support/Allocator.h"
 #include "llvm/Support/Debug.h"
 #include <algorithm>
 #include <queue>
+#include <unordered_map>
 #include <vector>
 
 #define DEBUG_TYPE "remniw-RegisterAllocator"
 
 namespace remniw {
 
+// The interface of the register allocators used by AsmRewriter.
+class RegisterAllocator {
+public:
+    // A move from a physical register or stack slot to another one, which is
+    // inserted before InsertBefore.
+    struct Move {
+        AsmInstruction *InsertBefore;
+        uint32_t Src;
+        uint32_t Dst;
+    };
+
+    virtual ~RegisterAllocator() = default;
+
+    // Assign a physical register or a stack slot to each virtual register of F.
+    virtual void doRegAlloc(AsmFunction *F) = 0;
+
+    virtual const llvm::DenseMap<uint32_t, uint32_t> &getVirtRegToAllocatedRegMap() = 0;
+
+    // The number of stack slots used by the allocation.
+    virtual std::size_t getSpilledRegCount() = 0;
+
+    // The moves which must be inserted into the function after the allocation.
+    virtual llvm::ArrayRef<Move> getMoves() { return {}; }
+
+    virtual void printRegAllocResults() = 0;
+};
+
 struct LiveIntervalStartPointIncreasingOrderCompare
     : public std::binary_function<const LiveInterval &, const LiveInterval &, bool> {
     bool operator()(const LiveInterval &LHS, const LiveInterval &RHS) const {
@@ -29,47 +63,73 @@ struct LiveIntervalEndPointIncreasingOrderCompare
     }
 };
 
-class LinearScanRegisterAllocator {
+// Linear scan register allocation of Poletto and Sarkar on the live ranges computed
+// by LivenessAnalysis. The range of a virtual register does not have lifetime
+// holes. A virtual register is only assigned a physical register whose own live
+// ranges, e.g. from an argument register written before a call or from the
+// registers clobbered by a call, don't overlap its range.
+class LinearScanRegisterAllocator: public RegisterAllocator {
 private:
     const TargetInfo &TI;
+    LivenessAnalysis LA;
+    std::unordered_map<uint32_t, LiveRanges> RegLiveRangesMap;
     std::priority_queue<LiveInterval, std::vector<LiveInterval>,
                         LiveIntervalStartPointIncreasingOrderCompare>
         Unhandled;
-    llvm::SmallVector<LiveInterval> Fixed;
+    // The live ranges of each physical register sorted by start point, indexed by
+    // register number.
+    std::vector<std::vector<LiveRange>> FixedRanges;
+    // Intervals assigned to a physical register, sorted by increasing end point.
+    // There is at most one active interval per allocatable register.
     llvm::SmallVector<LiveInterval> Active;
     llvm::SmallVector<LiveInterval> Spilled;
-    llvm::DenseMap<uint32_t, bool> FreeRegisters;
+    // Allocatable registers in the order they are tried, the bitsets below are
+    // indexed by register number.
+    llvm::ArrayRef<uint32_t> AllocatableRegs;
+    llvm::BitVector FreeRegisters;
     llvm::DenseMap<uint32_t, uint32_t> VirtRegToAllocatedRegMap;
     uint32_t StackSlotIndex;
 
 public:
-    LinearScanRegisterAllocator(const TargetInfo &TI): TI(TI) {
-        llvm::ArrayRef<uint32_t> FreeRegs = TI.getFreeRegistersForRegisterAllocator();
-        for (auto Reg : FreeRegs)
-            FreeRegisters[Reg] = true;
+    LinearScanRegisterAllocator(const TargetInfo &TI): TI(TI), LA(TI) {
+        AllocatableRegs = TI.getFreeRegistersForRegisterAllocator();
+        unsigned NumPhysRegs =
+            *std::max_element(AllocatableRegs.begin(), AllocatableRegs.end()) + 1;
+        FreeRegisters.resize(NumPhysRegs);
+        FixedRanges.resize(NumPhysRegs);
+    }
+
+    void doRegAlloc(AsmFunction *F) override {
+        LA.compute(F);
+        RegLiveRangesMap.clear();
+        LA.computeLiveRanges(RegLiveRangesMap);
+        doRegAlloc(RegLiveRangesMap);
     }
 
     void
     doRegAlloc(const std::unordered_map<uint32_t, remniw::LiveRanges> &RegLiveRangesMap) {
         // Reset the internal states
-        Fixed.clear();
+        for (auto &Ranges : FixedRanges)
+            Ranges.clear();
         Active.clear();
         Spilled.clear();
         VirtRegToAllocatedRegMap.clear();
+        VirtRegToAllocatedRegMap.reserve(RegLiveRangesMap.size());
+        FreeRegisters.reset();
+        for (auto Reg : AllocatableRegs)
+            FreeRegisters.set(Reg);
         StackSlotIndex = 0;
         initIntervalSets(RegLiveRangesMap);
 
         // Do linear scan register allocation
         while (!Unhandled.empty()) {
             const LiveInterval &LI = Unhandled.top();
-            std::sort(Active.begin(), Active.end(),
-                      LiveIntervalEndPointIncreasingOrderCompare());
             expireOldIntervals(LI);
             uint32_t PhysReg = getFreePhysReg(LI);
             if (PhysReg != Register::NoRegister) {
-                FreeRegisters[PhysReg] = false;
+                FreeRegisters.reset(PhysReg);
                 VirtRegToAllocatedRegMap[LI.Reg] = PhysReg;
-                Active.push_back(LI);
+                insertActive(LI);
             } else {
                 spillAtInterval(LI);
             }
@@ -79,21 +139,23 @@ public:
         LLVM_DEBUG(printRegAllocResults(););
     }
 
-    const llvm::DenseMap<uint32_t, uint32_t> &getVirtRegToAllocatedRegMap() {
+    const llvm::DenseMap<uint32_t, uint32_t> &getVirtRegToAllocatedRegMap() override {
         return VirtRegToAllocatedRegMap;
     }
 
-    std::size_t getSpilledRegCount() { return Spilled.size(); }
+    std::size_t getSpilledRegCount() override { return Spilled.size(); }
 
-    void printRegAllocResults() {
+    void printRegAllocResults() override {
         for (auto p : VirtRegToAllocatedRegMap) {
             llvm::outs() << "Virtual Register: " << p.first << " assigned " << p.second
                          << "\n";
         }
-        for (const auto &LI : Fixed) {
-            llvm::outs() << "Fixed Physical Register: " << LI.Reg << ", ["
-                         << LI.StartPoint << "," << LI.EndPoint << ")"
-                         << "\n";
+        for (uint32_t Reg = 0; Reg < FixedRanges.size(); ++Reg) {
+            for (const auto &Range : FixedRanges[Reg]) {
+                llvm::outs() << "Fixed Physical Register: " << Reg << ", ["
+                             << Range.StartPoint << "," << Range.EndPoint << ")"
+                             << "\n";
+            }
         }
     }
 
@@ -106,53 +168,61 @@ private:
                                              p.second.Ranges.back().EndPoint, p.first,
                                              p.second.Ranges.back().UsedAcrossCall});
             }
-            if (Register::isPhysicalRegister(p.first)) {
-                for (const auto &Range : p.second.Ranges) {
-                    Fixed.push_back(LiveInterval {Range.StartPoint, Range.EndPoint,
-                                                  p.first, Range.UsedAcrossCall});
-                }
+            // Only the ranges of allocatable registers are of interest.
+            if (Register::isPhysicalRegister(p.first) && p.first < FixedRanges.size()) {
+                auto &Ranges = FixedRanges[p.first];
+                Ranges.assign(p.second.Ranges.begin(), p.second.Ranges.end());
+                llvm::sort(Ranges, [](const LiveRange &LHS, const LiveRange &RHS) {
+                    return LHS.StartPoint < RHS.StartPoint;
+                });
             }
         }
     }
 
+    bool overlapsFixedRanges(uint32_t Reg, const LiveInterval &LI) const {
+        const auto &Ranges = FixedRanges[Reg];
+        auto It = llvm::partition_point(
+            Ranges, [&](const LiveRange &R) { return R.EndPoint <= LI.StartPoint; });
+        return It != Ranges.end() && It->StartPoint < LI.EndPoint;
+    }
+
+    void insertActive(const LiveInterval &LI) {
+        Active.insert(llvm::upper_bound(Active, LI,
+                                        LiveIntervalEndPointIncreasingOrderCompare()),
+                      LI);
+    }
+
     void expireOldIntervals(const LiveInterval &LI) {
-        for (auto it = Active.begin(); it != Active.end();) {
-            LiveInterval &ActiveLI = *it;
-            if (ActiveLI.EndPoint > LI.StartPoint) {
-                return;
-            }
-            uint32_t AllocatedReg = VirtRegToAllocatedRegMap[ActiveLI.Reg];
+        auto End = llvm::find_if(Active, [&](const LiveInterval &ActiveLI) {
+            return ActiveLI.EndPoint > LI.StartPoint;
+        });
+        for (auto It = Active.begin(); It != End; ++It) {
+            uint32_t AllocatedReg = VirtRegToAllocatedRegMap[It->Reg];
             if (Register::isPhysicalRegister(AllocatedReg)) {
-                FreeRegisters[AllocatedReg] = true;
+                FreeRegisters.set(AllocatedReg);
             }
-            it = Active.erase(it);
         }
+        Active.erase(Active.begin(), End);
     }
 
     uint32_t getFreePhysReg(const LiveInterval &LI) {
-        for (const auto &Entry : FreeRegisters) {
-            if (Entry.second == false)
-                continue;
-            const auto &Reg = Entry.first;
-            bool ConflictWithFixed = false;
-            for (const auto &FixReg : Fixed) {
-                if (FixReg.Reg != Reg)
-                    continue;
-                if (FixReg.EndPoint > LI.StartPoint || FixReg.StartPoint < LI.EndPoint) {
-                    ConflictWithFixed = true;
-                    break;
-                }
+        auto IsFree = [&](uint32_t Reg) {
+            return FreeRegisters.test(Reg) && !overlapsFixedRanges(Reg, LI);
+        };
+        // A value which is live across a call needs a callee-saved register. Other
+        // values prefer the caller-saved registers, which the prologue does not
+        // save, but the filled range of a value can still contain a call, e.g. a
+        // value defined on both sides of an if-else whose one side calls.
+        for (auto Reg : AllocatableRegs) {
+            if (IsFree(Reg) && (LI.UsedAcrossCall ? TI.isCalleeSavedRegister(Reg)
+                                                  : TI.isCallerSavedRegister(Reg)))
+                return Reg;
+        }
+        if (!LI.UsedAcrossCall) {
+            for (auto Reg : AllocatableRegs) {
+                if (IsFree(Reg) && TI.isCalleeSavedRegister(Reg))
+                    return Reg;
             }
-            if (ConflictWithFixed)
-                continue;
-
-            if (LI.UsedAcrossCall && !TI.isCalleeSavedRegister(Reg))
-                continue;
-            if (!LI.UsedAcrossCall && !TI.isCallerSavedRegister(Reg))
-                continue;
-
-            // Find an available PhysReg
-            return Reg;
         }
 
         // No avaliable PhysReg
@@ -160,14 +230,15 @@ private:
     }
 
     void spillAtInterval(const LiveInterval &LI) {
-        if (!Active.empty() && Active.back().EndPoint > LI.EndPoint) {
+        if (!Active.empty() && Active.back().EndPoint > LI.EndPoint &&
+            !overlapsFixedRanges(VirtRegToAllocatedRegMap[Active.back().Reg], LI)) {
             VirtRegToAllocatedRegMap[LI.Reg] =
                 VirtRegToAllocatedRegMap[Active.back().Reg];
             VirtRegToAllocatedRegMap[Active.back().Reg] =
                 Register::index2StackSlot(StackSlotIndex++);
             Spilled.push_back(Active.back());
             Active.pop_back();
-            Active.push_back(LI);
+            insertActive(LI);
         } else {
             VirtRegToAllocatedRegMap[LI.Reg] =
                 Register::index2StackSlot(StackSlotIndex++);
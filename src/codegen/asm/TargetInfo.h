@@ -2,6 +2,7 @@
 
 #include "codegen/asm/AsmInstruction.h"
 #include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/SmallVector.h"
 #include <cstdint>
 
 namespace remniw {
@@ -11,6 +12,17 @@ enum Target {
     riscv
 };
 
+enum FileType {
+    AssemblyFile,
+    ObjectFile
+};
+
+enum RegAllocKind {
+    GreedyRegAlloc,
+    LinearScanRegAlloc,
+    GraphColoringRegAlloc
+};
+
 class TargetInfo {
 public:
     virtual ~TargetInfo() = default;
@@ -33,6 +45,30 @@ public:
     virtual uint32_t getFramePointerRegister() const = 0;
 
     virtual llvm::ArrayRef<uint32_t> getFreeRegistersForRegisterAllocator() const = 0;
+
+    // The register allocator computes the liveness of registers from the
+    // instructions. Registers in memory operands are always read.
+    virtual bool readsRegOperand(const AsmInstruction &I, unsigned OpNo) const = 0;
+    virtual bool writesRegOperand(const AsmInstruction &I, unsigned OpNo) const = 0;
+    // Physical registers read or written by I which are not its operands, e.g. the
+    // argument registers read by a call and the caller-saved registers it clobbers.
+    virtual void getImplicitRegisters(const AsmInstruction &I,
+                                      llvm::SmallVectorImpl<uint32_t> &Uses,
+                                      llvm::SmallVectorImpl<uint32_t> &Defs) const = 0;
+
+    // Basic blocks start at labels and end with branches, the target of a branch
+    // is its label operand.
+    virtual bool isLabelInstruction(const AsmInstruction &I) const = 0;
+    virtual bool isBranchInstruction(const AsmInstruction &I) const = 0;
+    virtual bool isUnconditionalBranchInstruction(const AsmInstruction &I) const = 0;
+
+    // Values in caller-saved registers don't survive a call instruction.
+    virtual bool isCallInstruction(const AsmInstruction &I) const = 0;
+
+    // Return true if I copies register Src to register Dst. Copies between
+    // registers which get the same location are removed after the allocation.
+    virtual bool isRegisterCopy(const AsmInstruction &I, uint32_t &Src,
+                                uint32_t &Dst) const = 0;
 };
 
 }  // namespace remniw
@@ -10,15 +10,45 @@ AsmOperand::MemOp X86AsmBuilder::handleALLOCA(uint32_t StackObjectIndex) {
     return AsmOperand::createStackObject(StackObjectIndex);
 }
 
+AsmOperand::RegOp X86AsmBuilder::handleFUNCARG(llvm::Argument *FuncArg) {
+    uint32_t VirtReg = createVirtReg();
+    unsigned ArgNo = FuncArg->getArgNo();
+    if (ArgNo < X86::NumArgRegs) {
+        createMOVInst(AsmOperand::createReg(X86::ArgRegs[ArgNo]),
+                      AsmOperand::createReg(VirtReg));
+    } else {
+        uint32_t FuncArgStackObjectIndex = ArgNo - X86::NumArgRegs;
+        createMOVInst(AsmOperand::createStackObject(FuncArgStackObjectIndex),
+                      AsmOperand::createReg(VirtReg));
+    }
+    return {VirtReg};
+}
+
+void X86AsmBuilder::handleCOPY(AsmOperand::RegOp Src, AsmOperand::RegOp Dst) {
+    createMOVInst(Src, Dst);
+}
+
+void X86AsmBuilder::handleCOPY(AsmOperand::ImmOp Src, AsmOperand::RegOp Dst) {
+    createMOVInst(Src, Dst);
+}
+
+void X86AsmBuilder::handleCOPY(AsmOperand::MemOp Src, AsmOperand::RegOp Dst) {
+    createLEAInst(Src, Dst);
+}
+
+void X86AsmBuilder::handleCOPY(AsmOperand::LabelOp Src, AsmOperand::RegOp Dst) {
+    createLEAInst(Src, Dst);
+}
+
 AsmOperand::RegOp X86AsmBuilder::handleLOAD(llvm::Instruction *I, AsmOperand::MemOp Mem) {
-    uint32_t VirtReg = Register::createVirtReg();
+    uint32_t VirtReg = createVirtReg();
     auto DstReg = AsmOperand::createReg(VirtReg);
     createMOVInst(Mem, DstReg);
     return DstReg;
 }
 
 AsmOperand::RegOp X86AsmBuilder::handleLOAD(llvm::Instruction *I, AsmOperand::RegOp Reg) {
-    uint32_t VirtReg = Register::createVirtReg();
+    uint32_t VirtReg = createVirtReg();
     auto DstReg = AsmOperand::createReg(VirtReg);
     createMOVInst(AsmOperand::createMem(0, Reg.RegNo), DstReg);
     return DstReg;
@@ -54,21 +84,21 @@ void X86AsmBuilder::handleSTORE(llvm::Instruction *I, AsmOperand::ImmOp Imm,
 
 void X86AsmBuilder::handleSTORE(llvm::Instruction *I, AsmOperand::MemOp Mem1,
                                 AsmOperand::MemOp Mem2, bool DestIsArgument) {
-    uint32_t VirtReg = Register::createVirtReg();
+    uint32_t VirtReg = createVirtReg();
     createLEAInst(Mem1, AsmOperand::createReg(VirtReg));
     createMOVInst(AsmOperand::createReg(VirtReg), Mem2);
 }
 
 void X86AsmBuilder::handleSTORE(llvm::Instruction *I, AsmOperand::LabelOp Label,
                                 AsmOperand::MemOp Mem) {
-    uint32_t VirtReg = Register::createVirtReg();
+    uint32_t VirtReg = createVirtReg();
     createLEAInst(Label, AsmOperand::createReg(VirtReg));
     createMOVInst(AsmOperand::createReg(VirtReg), Mem);
 }
 
 void X86AsmBuilder::handleSTORE(llvm::Instruction *I, llvm::Argument *FuncArg,
                                 AsmOperand::MemOp Mem) {
-    uint32_t VirtReg = Register::createVirtReg();
+    uint32_t VirtReg = createVirtReg();
     unsigned ArgNo = FuncArg->getArgNo();
     if (ArgNo < X86::NumArgRegs) {
         createMOVInst(AsmOperand::createReg(X86::ArgRegs[ArgNo]), Mem);
@@ -88,7 +118,7 @@ AsmOperand::MemOp X86AsmBuilder::handleGETELEMENTPTR(llvm::Instruction *I,
         GEP->getFunction()->getParent()->getDataLayout().getTypeAllocSize(
             GEP->getResultElementType());
     if (Mem.isStackObject()) {
-        uint32_t VirtReg = Register::createVirtReg();
+        uint32_t VirtReg = createVirtReg();
         createLEAInst(Mem, AsmOperand::createReg(VirtReg));
         return AsmOperand::createMem(SizeInBytes * Imm.Val, VirtReg);
     } else {
@@ -106,14 +136,14 @@ AsmOperand::MemOp X86AsmBuilder::handleGETELEMENTPTR(llvm::Instruction *I,
             GEP->getResultElementType());
     assert(SizeInBytes == 1 || SizeInBytes == 2 || SizeInBytes == 4 || SizeInBytes == 8);
     if (Mem.isStackObject()) {
-        uint32_t VirtReg = Register::createVirtReg();
+        uint32_t VirtReg = createVirtReg();
         createLEAInst(Mem, AsmOperand::createReg(VirtReg));
         return AsmOperand::createMem(0, VirtReg, Reg.RegNo, SizeInBytes);
     } else {
         if (Mem.IndexReg == Register::NoRegister) {
             return AsmOperand::createMem(Mem.Disp, Mem.BaseReg, Reg.RegNo, SizeInBytes);
         } else {
-            uint32_t VirtReg = Register::createVirtReg();
+            uint32_t VirtReg = createVirtReg();
             createLEAInst(Mem, AsmOperand::createReg(VirtReg));
             return AsmOperand::createMem(0, VirtReg, Reg.RegNo, SizeInBytes);
         }
@@ -153,11 +183,18 @@ void X86AsmBuilder::handleICMP(llvm::Instruction *I, AsmOperand::RegOp Reg,
 
 void X86AsmBuilder::handleICMP(llvm::Instruction *I, AsmOperand::ImmOp Imm,
                                AsmOperand::RegOp Reg) {
-    uint32_t VirtReg = Register::createVirtReg();
+    uint32_t VirtReg = createVirtReg();
     createMOVInst(Imm, AsmOperand::createReg(VirtReg));
     createCMPInst(Reg, AsmOperand::createReg(VirtReg));
 }
 
+void X86AsmBuilder::handleICMP(llvm::Instruction *I, AsmOperand::RegOp Reg,
+                               AsmOperand::LabelOp Label) {
+    uint32_t VirtReg = createVirtReg();
+    createLEAInst(Label, AsmOperand::createReg(VirtReg));
+    createCMPInst(AsmOperand::createReg(VirtReg), Reg);
+}
+
 void X86AsmBuilder::handleBR(llvm::Instruction *I, AsmOperand::LabelOp Label1,
                              AsmOperand::LabelOp Label2) {
     auto *BI = llvm::cast<llvm::BranchInst>(I);
@@ -185,57 +222,69 @@ void X86AsmBuilder::handleBR(llvm::Instruction *I, AsmOperand::LabelOp Label1,
         createJMPInst(JmpTrueOpcode, Label1);
     } else {
         createJMPInst(JmpTrueOpcode, Label1);
-        createJMPInst(JmpFalseOpcode, Label2);
+        createJMPInst(X86::JMP, Label2);
     }
 }
 
 void X86AsmBuilder::handleBR(llvm::Instruction *I, AsmOperand::LabelOp Label) {
     auto *BI = llvm::cast<llvm::BranchInst>(I);
     llvm::BasicBlock *NextBB = BI->getParent()->getNextNode();
-    if (NextBB != BI->getSuccessor(0)) {
+    // A conditional branch on constant false only goes to the second successor.
+    llvm::BasicBlock *Target = BI->getSuccessor(0);
+    if (BI->isConditional() && llvm::isa<llvm::ConstantInt>(BI->getCondition()) &&
+        llvm::cast<llvm::ConstantInt>(BI->getCondition())->isZero())
+        Target = BI->getSuccessor(1);
+    if (NextBB != Target) {
         createJMPInst(X86::JMP, Label);
     }
 }
 
 AsmOperand::RegOp X86AsmBuilder::handleADD(llvm::Instruction *I, AsmOperand::RegOp Reg1,
                                            AsmOperand::RegOp Reg2) {
+    Reg2 = getClobberableReg(I, 1, Reg2);
     createADDInst(Reg1, Reg2);
     return Reg2;
 }
 
 AsmOperand::RegOp X86AsmBuilder::handleADD(llvm::Instruction *I, AsmOperand::RegOp Reg,
                                            AsmOperand::ImmOp Imm) {
+    Reg = getClobberableReg(I, 0, Reg);
     createADDInst(Imm, Reg);
     return Reg;
 }
 
 AsmOperand::RegOp X86AsmBuilder::handleADD(llvm::Instruction *I, AsmOperand::ImmOp Imm,
                                            AsmOperand::RegOp Reg) {
+    Reg = getClobberableReg(I, 1, Reg);
     createADDInst(Imm, Reg);
     return Reg;
 }
 
 AsmOperand::RegOp X86AsmBuilder::handleADD(llvm::Instruction *I, AsmOperand::ImmOp Imm1,
                                            AsmOperand::ImmOp Imm2) {
-    llvm_unreachable("Unexpected handleADD(imm, imm)!\n");
-    return {Register::NoRegister};
+    uint32_t VirtReg = createVirtReg();
+    createMOVInst(Imm1, AsmOperand::createReg(VirtReg));
+    createADDInst(Imm2, AsmOperand::createReg(VirtReg));
+    return {VirtReg};
 }
 
 AsmOperand::RegOp X86AsmBuilder::handleSUB(llvm::Instruction *I, AsmOperand::RegOp Reg1,
                                            AsmOperand::RegOp Reg2) {
+    Reg1 = getClobberableReg(I, 0, Reg1);
     createSUBInst(Reg2, Reg1);
     return Reg1;
 }
 
 AsmOperand::RegOp X86AsmBuilder::handleSUB(llvm::Instruction *I, AsmOperand::RegOp Reg,
                                            AsmOperand::ImmOp Imm) {
+    Reg = getClobberableReg(I, 0, Reg);
     createSUBInst(Imm, Reg);
     return Reg;
 }
 
 AsmOperand::RegOp X86AsmBuilder::handleSUB(llvm::Instruction *I, AsmOperand::ImmOp Imm,
                                            AsmOperand::RegOp Reg) {
-    uint32_t VirtReg = Register::createVirtReg();
+    uint32_t VirtReg = createVirtReg();
     createMOVInst(Imm, AsmOperand::createReg(VirtReg));
     createSUBInst(Reg, AsmOperand::createReg(VirtReg));
     return {VirtReg};
@@ -243,32 +292,39 @@ AsmOperand::RegOp X86AsmBuilder::handleSUB(llvm::Instruction *I, AsmOperand::Imm
 
 AsmOperand::RegOp X86AsmBuilder::handleSUB(llvm::Instruction *I, AsmOperand::ImmOp Imm1,
                                            AsmOperand::ImmOp Imm2) {
-    llvm_unreachable("Unexpected handleSUB(imm, imm)!\n");
-    return {Register::NoRegister};
+    uint32_t VirtReg = createVirtReg();
+    createMOVInst(Imm1, AsmOperand::createReg(VirtReg));
+    createSUBInst(Imm2, AsmOperand::createReg(VirtReg));
+    return {VirtReg};
 }
 
 AsmOperand::RegOp X86AsmBuilder::handleMUL(llvm::Instruction *I, AsmOperand::RegOp Reg1,
                                            AsmOperand::RegOp Reg2) {
+    Reg2 = getClobberableReg(I, 1, Reg2);
     createIMULInst(Reg1, Reg2);
     return Reg2;
 }
 
 AsmOperand::RegOp X86AsmBuilder::handleMUL(llvm::Instruction *I, AsmOperand::RegOp Reg,
                                            AsmOperand::ImmOp Imm) {
+    Reg = getClobberableReg(I, 0, Reg);
     createIMULInst(Imm, Reg);
     return Reg;
 }
 
 AsmOperand::RegOp X86AsmBuilder::handleMUL(llvm::Instruction *I, AsmOperand::ImmOp Imm,
                                            AsmOperand::RegOp Reg) {
+    Reg = getClobberableReg(I, 1, Reg);
     createIMULInst(Imm, Reg);
     return Reg;
 }
 
 AsmOperand::RegOp X86AsmBuilder::handleMUL(llvm::Instruction *I, AsmOperand::ImmOp Imm1,
                                            AsmOperand::ImmOp Imm2) {
-    llvm_unreachable("Unexpected handleMUL(imm, imm)!\n");
-    return {Register::NoRegister};
+    uint32_t VirtReg = createVirtReg();
+    createMOVInst(Imm1, AsmOperand::createReg(VirtReg));
+    createIMULInst(Imm2, AsmOperand::createReg(VirtReg));
+    return {VirtReg};
 }
 
 AsmOperand::RegOp X86AsmBuilder::handleSDIV(llvm::Instruction *I, AsmOperand::RegOp Reg1,
@@ -276,17 +332,17 @@ AsmOperand::RegOp X86AsmBuilder::handleSDIV(llvm::Instruction *I, AsmOperand::Re
     createMOVInst(Reg1, AsmOperand::createReg(X86::RAX));
     createCQTOInst();
     createIDIVInst(Reg2);
-    return {X86::RAX};
+    return copyQuotient();
 }
 
 AsmOperand::RegOp X86AsmBuilder::handleSDIV(llvm::Instruction *I, AsmOperand::RegOp Reg,
                                             AsmOperand::ImmOp Imm) {
-    uint32_t VirtReg = Register::createVirtReg();
+    uint32_t VirtReg = createVirtReg();
     createMOVInst(Reg, AsmOperand::createReg(X86::RAX));
     createCQTOInst();
     createMOVInst(Imm, AsmOperand::createReg(VirtReg));
     createIDIVInst(AsmOperand::createReg(VirtReg));
-    return {X86::RAX};
+    return copyQuotient();
 }
 
 AsmOperand::RegOp X86AsmBuilder::handleSDIV(llvm::Instruction *I, AsmOperand::ImmOp Imm,
@@ -294,13 +350,17 @@ AsmOperand::RegOp X86AsmBuilder::handleSDIV(llvm::Instruction *I, AsmOperand::Im
     createMOVInst(Imm, AsmOperand::createReg(X86::RAX));
     createCQTOInst();
     createIDIVInst(Reg);
-    return {X86::RAX};
+    return copyQuotient();
 }
 
 AsmOperand::RegOp X86AsmBuilder::handleSDIV(llvm::Instruction *I, AsmOperand::ImmOp Imm1,
                                             AsmOperand::ImmOp Imm2) {
-    llvm_unreachable("Unexpected handleSDIV(imm, imm)!\n");
-    return {Register::NoRegister};
+    uint32_t VirtReg = createVirtReg();
+    createMOVInst(Imm1, AsmOperand::createReg(X86::RAX));
+    createCQTOInst();
+    createMOVInst(Imm2, AsmOperand::createReg(VirtReg));
+    createIDIVInst(AsmOperand::createReg(VirtReg));
+    return copyQuotient();
 }
 
 AsmOperand::RegOp X86AsmBuilder::handleCALL(llvm::Instruction *I,
@@ -311,7 +371,7 @@ AsmOperand::RegOp X86AsmBuilder::handleCALL(llvm::Instruction *I,
     if (CalleeName == "printf" || CalleeName == "scanf") {
         createXORInst(AsmOperand::createReg(X86::RAX), AsmOperand::createReg(X86::RAX));
     }
-    uint32_t VirtReg = Register::createVirtReg();
+    uint32_t VirtReg = createVirtReg();
     createCALLInst(Label, /*DirectCall*/ true, CB->arg_size());
     createMOVInst(AsmOperand::createReg(X86::RAX), AsmOperand::createReg(VirtReg));
     return {VirtReg};
@@ -321,7 +381,7 @@ AsmOperand::RegOp X86AsmBuilder::handleCALL(llvm::Instruction *I, AsmOperand::Re
     CallArgOffsetFromStackPointer = 0;
     auto *CB = llvm::cast<llvm::CallBase>(I);
     createCALLInst(Reg, /*DirectCall*/ false, CB->arg_size());
-    uint32_t VirtReg = Register::createVirtReg();
+    uint32_t VirtReg = createVirtReg();
     createMOVInst(AsmOperand::createReg(X86::RAX), AsmOperand::createReg(VirtReg));
     return {VirtReg};
 }
@@ -330,7 +390,7 @@ AsmOperand::RegOp X86AsmBuilder::handleCALL(llvm::Instruction *I, AsmOperand::Me
     CallArgOffsetFromStackPointer = 0;
     auto *CB = llvm::cast<llvm::CallBase>(I);
     createCALLInst(Mem, /*DirectCall*/ false, CB->arg_size());
-    uint32_t VirtReg = Register::createVirtReg();
+    uint32_t VirtReg = createVirtReg();
     createMOVInst(AsmOperand::createReg(X86::RAX), AsmOperand::createReg(VirtReg));
     return {VirtReg};
 }
@@ -371,7 +431,7 @@ void X86AsmBuilder::handleARG(llvm::Instruction *CI, unsigned ArgNo,
         auto *CB = llvm::cast<llvm::CallBase>(CI);
         llvm::Type *Ty = CB->getArgOperand(ArgNo)->getType();
         uint64_t SizeInBytes = CB->getModule()->getDataLayout().getTypeAllocSize(Ty);
-        uint32_t VirtReg = Register::createVirtReg();
+        uint32_t VirtReg = createVirtReg();
         createMOVInst(Mem, AsmOperand::createReg(VirtReg));
         createMOVInst(AsmOperand::createReg(VirtReg),
                       AsmOperand::createMem(CallArgOffsetFromStackPointer, X86::RSP));
@@ -397,9 +457,29 @@ void X86AsmBuilder::handleLABEL(AsmOperand::LabelOp Label) {
     createLABELInst(Label);
 }
 
+// Two-address instructions overwrite their destination operand. The register
+// may only be overwritten if the value is dead after I, i.e. it is defined in
+// the same basic block and I is its only use. A value defined outside of I's
+// block may be live around a loop containing I, so work on a copy of it.
+AsmOperand::RegOp X86AsmBuilder::getClobberableReg(llvm::Instruction *I, unsigned OpNo,
+                                                   AsmOperand::RegOp Reg) {
+    auto *OpI = llvm::dyn_cast<llvm::Instruction>(I->getOperand(OpNo));
+    if (OpI && OpI->getParent() == I->getParent() && OpI->hasOneUse())
+        return Reg;
+    uint32_t VirtReg = createVirtReg();
+    createMOVInst(Reg, AsmOperand::createReg(VirtReg));
+    return {VirtReg};
+}
+
+// The quotient may be used in other basic blocks, keep it in a virtual
+// register rather than in RAX.
+AsmOperand::RegOp X86AsmBuilder::copyQuotient() {
+    uint32_t VirtReg = createVirtReg();
+    createMOVInst(AsmOperand::createReg(X86::RAX), AsmOperand::createReg(VirtReg));
+    return {VirtReg};
+}
+
 AsmInstruction *X86AsmBuilder::createMOVInst(AsmOperand Src, AsmOperand Dst) {
-    updateAsmOperandLiveRanges(Src);
-    updateAsmOperandLiveRanges(Dst);
     auto *I = AsmInstruction::create(X86::MOV, getCurrentFunction());
     I->addOperand(Src);
     I->addOperand(Dst);
@@ -407,8 +487,6 @@ AsmInstruction *X86AsmBuilder::createMOVInst(AsmOperand Src, AsmOperand Dst) {
 }
 
 AsmInstruction *X86AsmBuilder::createLEAInst(AsmOperand Src, AsmOperand Dst) {
-    updateAsmOperandLiveRanges(Src);
-    updateAsmOperandLiveRanges(Dst);
     auto *I = AsmInstruction::create(X86::LEA, getCurrentFunction());
     I->addOperand(Src);
     I->addOperand(Dst);
@@ -416,8 +494,6 @@ AsmInstruction *X86AsmBuilder::createLEAInst(AsmOperand Src, AsmOperand Dst) {
 }
 
 AsmInstruction *X86AsmBuilder::createCMPInst(AsmOperand Src, AsmOperand Dst) {
-    updateAsmOperandLiveRanges(Src);
-    updateAsmOperandLiveRanges(Dst);
     auto *I = AsmInstruction::create(X86::CMP, getCurrentFunction());
     I->addOperand(Src);
     I->addOperand(Dst);
@@ -425,15 +501,12 @@ AsmInstruction *X86AsmBuilder::createCMPInst(AsmOperand Src, AsmOperand Dst) {
 }
 
 AsmInstruction *X86AsmBuilder::createJMPInst(unsigned JmpOpcode, AsmOperand Op) {
-    updateAsmOperandLiveRanges(Op);
     auto *I = AsmInstruction::create(JmpOpcode, getCurrentFunction());
     I->addOperand(Op);
     return I;
 }
 
 AsmInstruction *X86AsmBuilder::createADDInst(AsmOperand Src, AsmOperand Dst) {
-    updateAsmOperandLiveRanges(Src);
-    updateAsmOperandLiveRanges(Dst);
     auto *I = AsmInstruction::create(X86::ADD, getCurrentFunction());
     I->addOperand(Src);
     I->addOperand(Dst);
@@ -441,8 +514,6 @@ AsmInstruction *X86AsmBuilder::createADDInst(AsmOperand Src, AsmOperand Dst) {
 }
 
 AsmInstruction *X86AsmBuilder::createSUBInst(AsmOperand Src, AsmOperand Dst) {
-    updateAsmOperandLiveRanges(Src);
-    updateAsmOperandLiveRanges(Dst);
     auto *I = AsmInstruction::create(X86::SUB, getCurrentFunction());
     I->addOperand(Src);
     I->addOperand(Dst);
@@ -450,8 +521,6 @@ AsmInstruction *X86AsmBuilder::createSUBInst(AsmOperand Src, AsmOperand Dst) {
 }
 
 AsmInstruction *X86AsmBuilder::createIMULInst(AsmOperand Src, AsmOperand Dst) {
-    updateAsmOperandLiveRanges(Src);
-    updateAsmOperandLiveRanges(Dst);
     auto *I = AsmInstruction::create(X86::IMUL, getCurrentFunction());
     I->addOperand(Src);
     I->addOperand(Dst);
@@ -459,34 +528,25 @@ AsmInstruction *X86AsmBuilder::createIMULInst(AsmOperand Src, AsmOperand Dst) {
 }
 
 AsmInstruction *X86AsmBuilder::createIDIVInst(AsmOperand Op) {
-    updateAsmOperandLiveRanges(Op);
-    updateRegLiveRanges(X86::RAX);
-    updateRegLiveRanges(X86::RDX);
     auto *I = AsmInstruction::create(X86::IDIV, getCurrentFunction());
     I->addOperand(Op);
     return I;
 }
 
 AsmInstruction *X86AsmBuilder::createCQTOInst() {
-    updateRegLiveRanges(X86::RAX);
-    updateRegLiveRanges(X86::RDX);
     auto *I = AsmInstruction::create(X86::CQTO, getCurrentFunction());
     return I;
 }
 
 AsmInstruction *X86AsmBuilder::createCALLInst(AsmOperand Callee, bool DirectCall,
                                               unsigned NumArgs) {
-    updateAsmOperandLiveRanges(Callee);
     auto *I = AsmInstruction::create(X86::CALL, getCurrentFunction());
     I->addOperand(Callee);
     I->addOperand(AsmOperand::createImm(NumArgs));
-    getCurrentCallInstIndexes().push_back(getCurrentFunction()->size());
     return I;
 }
 
 AsmInstruction *X86AsmBuilder::createXORInst(AsmOperand Src, AsmOperand Dst) {
-    updateAsmOperandLiveRanges(Src);
-    updateAsmOperandLiveRanges(Dst);
     auto *I = AsmInstruction::create(X86::XOR, getCurrentFunction());
     I->addOperand(Src);
     I->addOperand(Dst);
@@ -17,6 +17,13 @@ public:
 
     AsmOperand::MemOp handleALLOCA(uint32_t StackObjectIndex) override;
 
+    AsmOperand::RegOp handleFUNCARG(llvm::Argument *FuncArg) override;
+
+    void handleCOPY(AsmOperand::RegOp Src, AsmOperand::RegOp Dst) override;
+    void handleCOPY(AsmOperand::ImmOp Src, AsmOperand::RegOp Dst) override;
+    void handleCOPY(AsmOperand::MemOp Src, AsmOperand::RegOp Dst) override;
+    void handleCOPY(AsmOperand::LabelOp Src, AsmOperand::RegOp Dst) override;
+
     AsmOperand::RegOp handleLOAD(llvm::Instruction *I, AsmOperand::MemOp Mem) override;
     AsmOperand::RegOp handleLOAD(llvm::Instruction *I, AsmOperand::RegOp Reg) override;
 
@@ -53,6 +60,8 @@ public:
                     AsmOperand::ImmOp Imm) override;
     void handleICMP(llvm::Instruction *I, AsmOperand::ImmOp Imm,
                     AsmOperand::RegOp Reg) override;
+    void handleICMP(llvm::Instruction *I, AsmOperand::RegOp Reg,
+                    AsmOperand::LabelOp Label) override;
 
     void handleBR(llvm::Instruction *I, AsmOperand::LabelOp Label1,
                   AsmOperand::LabelOp Label2) override;
@@ -108,6 +117,10 @@ public:
     void handleLABEL(AsmOperand::LabelOp Label) override;
 
 private:
+    AsmOperand::RegOp getClobberableReg(llvm::Instruction *I, unsigned OpNo,
+                                        AsmOperand::RegOp Reg);
+    AsmOperand::RegOp copyQuotient();
+
     AsmInstruction *createMOVInst(AsmOperand Src, AsmOperand Dst);
     AsmInstruction *createLEAInst(AsmOperand Src, AsmOperand Dst);
     AsmInstruction *createCMPInst(AsmOperand Src, AsmOperand Dst);
@@ -11,7 +11,8 @@ private:
     int64_t NeededStackSizeInBytes {0};
 
 public:
-    X86AsmRewriter(const TargetInfo &TI): AsmRewriter(TI) {}
+    X86AsmRewriter(const TargetInfo &TI, RegAllocKind Kind = GreedyRegAlloc):
+        AsmRewriter(TI, Kind) {}
 
 private:
     void rewriteAsmInstVirtRegToPhysReg(
@@ -124,6 +125,27 @@ private:
         }
     }
 
+    void insertMove(AsmInstruction *InsertBefore, uint32_t Src, uint32_t Dst) override {
+        auto GetOperand = [&](uint32_t Reg) {
+            if (Register::isStackSlot(Reg))
+                return AsmOperand::create(AsmOperand::createMem(
+                    getStackSlotOffsetForSpilledReg(Reg), X86::RBP));
+            return AsmOperand::create(AsmOperand::createReg(Reg));
+        };
+        assert(!(Register::isStackSlot(Src) && Register::isStackSlot(Dst)));
+        auto *MI = AsmInstruction::create(X86::MOV, InsertBefore);
+        MI->addOperand(GetOperand(Src));
+        MI->addOperand(GetOperand(Dst));
+    }
+
+    int64_t getSavedRegsAreaSize(AsmFunction *F,
+                                 const llvm::SetVector<uint32_t> &UsedCalleeSavedRegs)
+        const override {
+        if (F->getName() == "main")
+            return 0;
+        return UsedCalleeSavedRegs.size() * X86::RegisterSize;
+    }
+
     void insertPrologue(AsmFunction *F,
                         llvm::SetVector<uint32_t> &UsedCalleeSavedRegs) override {
         AsmInstruction *InsertBefore = &F->front();
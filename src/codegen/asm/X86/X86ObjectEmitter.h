@@ -0,0 +1,382 @@
+#pragma once
+
+#include "codegen/asm/AsmFunction.h"
+#include "codegen/asm/ELFObjectWriter.h"
+#include "codegen/asm/X86/X86TargetInfo.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/IR/Function.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/MathExtras.h"
+#include <algorithm>
+
+namespace remniw {
+
+// Encode the X86 AsmFunctions into machine code and emit them into a
+// relocatable ELF object file. This is the counterpart of X86AsmPrinter which
+// emits textual assembly, the emitted object is the same as assembling the
+// output of X86AsmPrinter except that:
+// - jumps always use rel32 displacement, they are never relaxed to rel8.
+// - constant strings are placed in .rodata instead of .text.
+class X86ObjectEmitter {
+private:
+    ELFObjectWriter Writer {llvm::ELF::EM_X86_64};
+    ELFObjectWriter::Section *Text {nullptr};
+    ELFObjectWriter::Section *ROData {nullptr};
+    // Offsets of basic block labels in .text
+    llvm::DenseMap<const AsmSymbol *, uint64_t> LabelOffsets;
+    // Offsets of constant strings in .rodata
+    llvm::DenseMap<const AsmSymbol *, uint64_t> GlobalVariableOffsets;
+    // Offsets of the rel32 fields in .text which refer to basic block labels,
+    // they are resolved when all functions are emitted.
+    llvm::SmallVector<std::pair<uint64_t, const AsmSymbol *>> LabelFixups;
+
+public:
+    void
+    emitToStreamer(llvm::raw_ostream &Out,
+                   const llvm::SmallVector<std::unique_ptr<AsmFunction>> &AsmFunctions,
+                   const llvm::DenseMap<remniw::AsmSymbol *, llvm::StringRef> &GVs,
+                   const llvm::SmallVector<llvm::Function *> &GlobalCtors) {
+        using namespace llvm::ELF;
+        Text = Writer.createSection(".text", SHT_PROGBITS, SHF_ALLOC | SHF_EXECINSTR, 16);
+        ROData = Writer.createSection(".rodata", SHT_PROGBITS, SHF_ALLOC, 1);
+
+        // Constant strings are laid out first, so that their offsets are known
+        // when encoding instructions referring to them.
+        emitGlobalVariables(GVs);
+        for (const auto &AsmFunc : AsmFunctions)
+            emitFunction(AsmFunc.get());
+        resolveLabelFixups();
+        emitInitArray(GlobalCtors);
+
+        // Mark the stack as non-executable.
+        Writer.createSection(".note.GNU-stack", SHT_PROGBITS, 0, 1);
+
+        Writer.write(Out);
+    }
+
+private:
+    void emitGlobalVariables(
+        const llvm::DenseMap<remniw::AsmSymbol *, llvm::StringRef> &GVs) {
+        // Sort the constant strings by name to get a deterministic layout.
+        llvm::SmallVector<std::pair<std::string, AsmSymbol *>> SortedGVs;
+        for (auto &p : GVs)
+            SortedGVs.push_back({p.first->getName(), p.first});
+        std::sort(SortedGVs.begin(), SortedGVs.end());
+        for (auto &p : SortedGVs) {
+            GlobalVariableOffsets[p.second] = ROData->Data.size();
+            llvm::StringRef Str = GVs.lookup(p.second);
+            ROData->Data.append(Str.begin(), Str.end());
+            ROData->Data.push_back('\0');
+        }
+    }
+
+    void emitInitArray(const llvm::SmallVector<llvm::Function *> &GlobalCtors) {
+        if (GlobalCtors.empty())
+            return;
+        using namespace llvm::ELF;
+        auto *InitArray = Writer.createSection(".init_array", SHT_INIT_ARRAY,
+                                               SHF_ALLOC | SHF_WRITE, 8);
+        for (auto *F : GlobalCtors) {
+            Writer.addRelocation(InitArray, InitArray->Data.size(),
+                                 Writer.getOrCreateSymbol(F->getName()),
+                                 R_X86_64_64, 0);
+            InitArray->Data.append(8, '\0');
+        }
+    }
+
+    void emitFunction(const AsmFunction *F) {
+        uint64_t Start = offset();
+        for (auto &AsmInst : *F)
+            emitInstruction(AsmInst);
+        Writer.defineSymbol(Writer.getOrCreateSymbol(F->getName()), Text, Start,
+                            offset() - Start, llvm::ELF::STT_FUNC);
+    }
+
+    void resolveLabelFixups() {
+        for (auto &Fixup : LabelFixups) {
+            auto It = LabelOffsets.find(Fixup.second);
+            assert(It != LabelOffsets.end() && "Undefined basic block label");
+            int64_t Rel = (int64_t)It->second - (int64_t)(Fixup.first + 4);
+            writeLE32(Fixup.first, (uint32_t)Rel);
+        }
+    }
+
+    void emitInstruction(const AsmInstruction &I) {
+        switch (I.getOpcode()) {
+        case X86::MOV: emitMOV(I.getOperand(0), I.getOperand(1)); break;
+        case X86::LEA: emitLEA(I.getOperand(0), I.getOperand(1)); break;
+        case X86::CMP:
+            emitBinaryArith(0x39, 0x3B, 7, I.getOperand(0), I.getOperand(1));
+            break;
+        case X86::ADD:
+            emitBinaryArith(0x01, 0x03, 0, I.getOperand(0), I.getOperand(1));
+            break;
+        case X86::SUB:
+            emitBinaryArith(0x29, 0x2B, 5, I.getOperand(0), I.getOperand(1));
+            break;
+        case X86::XOR:
+            emitBinaryArith(0x31, 0x33, 6, I.getOperand(0), I.getOperand(1));
+            break;
+        case X86::IMUL: emitIMUL(I.getOperand(0), I.getOperand(1)); break;
+        case X86::IDIV: emitModRM({0xF7}, 7, I.getOperand(0)); break;
+        case X86::CQTO: emitBytes({0x48, 0x99}); break;
+        case X86::JMP: emitJump({0xE9}, I.getOperand(0)); break;
+        case X86::JE: emitJump({0x0F, 0x84}, I.getOperand(0)); break;
+        case X86::JNE: emitJump({0x0F, 0x85}, I.getOperand(0)); break;
+        case X86::JG: emitJump({0x0F, 0x8F}, I.getOperand(0)); break;
+        case X86::JLE: emitJump({0x0F, 0x8E}, I.getOperand(0)); break;
+        case X86::CALL: emitCALL(I.getOperand(0)); break;
+        case X86::PUSH: emitPushPop(0x50, I.getOperand(0)); break;
+        case X86::POP: emitPushPop(0x58, I.getOperand(0)); break;
+        case X86::RET: emitBytes({0xC3}); break;
+        case X86::LABEL: {
+            const AsmSymbol *Label = I.getOperand(0).getLabel();
+            assert(Label->isBasicblock() && "Label must be a basic block");
+            LabelOffsets[Label] = offset();
+            break;
+        }
+        default: llvm_unreachable("Invalid AsmInstruction");
+        }
+    }
+
+    // MOV Src, Dst
+    void emitMOV(const AsmOperand &Src, const AsmOperand &Dst) {
+        if (Src.isImm()) {
+            if (!llvm::isInt<32>(Src.Imm.Val) && Dst.isReg()) {
+                // movabs $imm64, %reg
+                uint8_t Reg = getRegEncoding(Dst.getReg());
+                emitBytes({(uint8_t)(0x48 | (Reg >> 3)), (uint8_t)(0xB8 + (Reg & 7))});
+                emitLE64(Src.Imm.Val);
+                return;
+            }
+            checkImm32(Src.Imm.Val);
+            emitModRM({0xC7}, 0, Dst);
+            emitLE32(Src.Imm.Val);
+            return;
+        }
+        emitBinaryArith(0x89, 0x8B, 0, Src, Dst);
+    }
+
+    // LEA Src, Dst
+    void emitLEA(const AsmOperand &Src, const AsmOperand &Dst) {
+        assert(Dst.isReg() && "The destination of LEA must be register");
+        emitModRM({0x8D}, getRegEncoding(Dst.getReg()), Src);
+    }
+
+    // Binary arithmetic instructions, e.g. ADD Src, Dst
+    // OpcodeMR: the form whose source is register, the destination is ModRM.
+    // OpcodeRM: the form whose source is ModRM, the destination is register.
+    // Digit: the ModRM.reg field of the form whose source is immediate.
+    void emitBinaryArith(uint8_t OpcodeMR, uint8_t OpcodeRM, uint8_t Digit,
+                         const AsmOperand &Src, const AsmOperand &Dst) {
+        if (Src.isImm()) {
+            int64_t Imm = Src.Imm.Val;
+            if (llvm::isInt<8>(Imm)) {
+                emitModRM({0x83}, Digit, Dst);
+                emitBytes({(uint8_t)Imm});
+            } else {
+                checkImm32(Imm);
+                emitModRM({0x81}, Digit, Dst);
+                emitLE32(Imm);
+            }
+        } else if (Src.isReg()) {
+            emitModRM({OpcodeMR}, getRegEncoding(Src.getReg()), Dst);
+        } else {
+            assert(Dst.isReg() && "Memory to memory operation is not supported");
+            emitModRM({OpcodeRM}, getRegEncoding(Dst.getReg()), Src);
+        }
+    }
+
+    // IMUL Src, Dst
+    void emitIMUL(const AsmOperand &Src, const AsmOperand &Dst) {
+        assert(Dst.isReg() && "The destination of IMUL must be register");
+        uint8_t Reg = getRegEncoding(Dst.getReg());
+        if (Src.isImm()) {
+            int64_t Imm = Src.Imm.Val;
+            if (llvm::isInt<8>(Imm)) {
+                emitModRM({0x6B}, Reg, Dst);
+                emitBytes({(uint8_t)Imm});
+            } else {
+                checkImm32(Imm);
+                emitModRM({0x69}, Reg, Dst);
+                emitLE32(Imm);
+            }
+            return;
+        }
+        emitModRM({0x0F, 0xAF}, Reg, Src);
+    }
+
+    void emitCALL(const AsmOperand &Callee) {
+        if (Callee.isLabel()) {
+            emitBytes({0xE8});
+            Writer.addRelocation(Text, offset(),
+                                 Writer.getOrCreateSymbol(Callee.getLabel()->getName()),
+                                 llvm::ELF::R_X86_64_PLT32, -4);
+            emitLE32(0);
+            return;
+        }
+        // Indirect call, the operand size is always 64-bit, no REX.W needed.
+        emitModRM({0xFF}, 2, Callee, /*RexW*/ false);
+    }
+
+    void emitPushPop(uint8_t Opcode, const AsmOperand &Op) {
+        uint8_t Reg = getRegEncoding(Op.getReg());
+        if (Reg >= 8)
+            emitBytes({0x41});
+        emitBytes({(uint8_t)(Opcode + (Reg & 7))});
+    }
+
+    void emitJump(std::initializer_list<uint8_t> Opcode, const AsmOperand &Target) {
+        emitBytes(Opcode);
+        LabelFixups.push_back({offset(), Target.getLabel()});
+        emitLE32(0);
+    }
+
+    // Emit REX prefix, opcode, ModRM byte, and the optional SIB byte and
+    // displacement. RegField is either a register or an opcode extension.
+    // RM is a register, a memory operand, or a label which is addressed
+    // relative to RIP.
+    void emitModRM(std::initializer_list<uint8_t> Opcode, uint8_t RegField,
+                   const AsmOperand &RM, bool RexW = true) {
+        uint8_t Rex = (RexW ? 0x48 : 0x40) | ((RegField >> 3) << 2);
+        if (RM.isReg()) {
+            uint8_t Reg = getRegEncoding(RM.getReg());
+            Rex |= Reg >> 3;
+            if (Rex != 0x40)
+                emitBytes({Rex});
+            emitBytes(Opcode);
+            emitBytes({makeModRM(3, RegField, Reg)});
+            return;
+        }
+
+        if (RM.isLabel()) {
+            if (Rex != 0x40)
+                emitBytes({Rex});
+            emitBytes(Opcode);
+            emitBytes({makeModRM(0, RegField, 5)});
+            emitRIPRelocation(RM.getLabel());
+            return;
+        }
+
+        assert(RM.isMem() && !RM.isStackObject() && "Invalid ModRM operand");
+        uint32_t BaseReg = RM.getMemBaseReg();
+        uint32_t IndexReg = RM.getMemIndexReg();
+        int64_t Disp = RM.Mem.Disp;
+        uint8_t Base = BaseReg ? getRegEncoding(BaseReg) : 0;
+        uint8_t Index = IndexReg ? getRegEncoding(IndexReg) : 0;
+        Rex |= ((Index >> 3) << 1) | (Base >> 3);
+        if (Rex != 0x40)
+            emitBytes({Rex});
+        emitBytes(Opcode);
+
+        if (!BaseReg) {
+            // [Index * Scale + disp32] or [disp32]
+            emitBytes({makeModRM(0, RegField, 4),
+                       makeSIB(RM.getMemScale(), IndexReg ? Index : 4, 5)});
+            checkImm32(Disp);
+            emitLE32(Disp);
+            return;
+        }
+
+        // [Base + Index * Scale + Disp], RBP and R13 as base need displacement.
+        uint8_t Mod;
+        if (Disp == 0 && (Base & 7) != 5)
+            Mod = 0;
+        else if (llvm::isInt<8>(Disp))
+            Mod = 1;
+        else
+            Mod = 2;
+        // RSP and R12 as base need SIB byte.
+        if (IndexReg || (Base & 7) == 4) {
+            emitBytes({makeModRM(Mod, RegField, 4),
+                       makeSIB(RM.getMemScale(), IndexReg ? Index : 4, Base)});
+        } else {
+            emitBytes({makeModRM(Mod, RegField, Base)});
+        }
+        if (Mod == 1) {
+            emitBytes({(uint8_t)Disp});
+        } else if (Mod == 2) {
+            checkImm32(Disp);
+            emitLE32(Disp);
+        }
+    }
+
+    void emitRIPRelocation(const AsmSymbol *Label) {
+        if (Label->isFunction()) {
+            Writer.addRelocation(Text, offset(),
+                                 Writer.getOrCreateSymbol(Label->getName()),
+                                 llvm::ELF::R_X86_64_PC32, -4);
+        } else if (Label->isGlobalVariable()) {
+            auto It = GlobalVariableOffsets.find(Label);
+            assert(It != GlobalVariableOffsets.end() && "Unknown global variable");
+            Writer.addRelocation(Text, offset(), Writer.getSectionSymbol(ROData),
+                                 llvm::ELF::R_X86_64_PC32, (int64_t)It->second - 4);
+        } else {
+            llvm_unreachable("Basic block label cannot be addressed relative to RIP");
+        }
+        emitLE32(0);
+    }
+
+    static uint8_t makeModRM(uint8_t Mod, uint8_t RegField, uint8_t RM) {
+        return (Mod << 6) | ((RegField & 7) << 3) | (RM & 7);
+    }
+
+    static uint8_t makeSIB(uint32_t Scale, uint8_t Index, uint8_t Base) {
+        uint8_t SS = Scale == 8 ? 3 : Scale == 4 ? 2 : Scale == 2 ? 1 : 0;
+        assert((1u << SS) == Scale && "Invalid scale");
+        return (SS << 6) | ((Index & 7) << 3) | (Base & 7);
+    }
+
+    static uint8_t getRegEncoding(uint32_t Reg) {
+        switch (Reg) {
+        case X86::RAX: return 0;
+        case X86::RCX: return 1;
+        case X86::RDX: return 2;
+        case X86::RBX: return 3;
+        case X86::RSP: return 4;
+        case X86::RBP: return 5;
+        case X86::RSI: return 6;
+        case X86::RDI: return 7;
+        case X86::R8: return 8;
+        case X86::R9: return 9;
+        case X86::R10: return 10;
+        case X86::R11: return 11;
+        case X86::R12: return 12;
+        case X86::R13: return 13;
+        case X86::R14: return 14;
+        case X86::R15: return 15;
+        default: llvm_unreachable("Invalid Register\n");
+        }
+    }
+
+    static void checkImm32(int64_t Imm) {
+        if (!llvm::isInt<32>(Imm))
+            llvm::report_fatal_error("immediate " + llvm::Twine(Imm) +
+                                     " does not fit in 32 bits");
+    }
+
+    uint64_t offset() const { return Text->Data.size(); }
+
+    void emitBytes(std::initializer_list<uint8_t> Bytes) {
+        for (uint8_t B : Bytes)
+            Text->Data.push_back((char)B);
+    }
+
+    void emitLE32(uint32_t V) {
+        for (unsigned i = 0; i < 4; ++i)
+            Text->Data.push_back((char)(V >> (i * 8)));
+    }
+
+    void emitLE64(uint64_t V) {
+        for (unsigned i = 0; i < 8; ++i)
+            Text->Data.push_back((char)(V >> (i * 8)));
+    }
+
+    void writeLE32(uint64_t Offset, uint32_t V) {
+        for (unsigned i = 0; i < 4; ++i)
+            Text->Data[Offset + i] = (char)(V >> (i * 8));
+    }
+};
+
+}  // namespace remniw
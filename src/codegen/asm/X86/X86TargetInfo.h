@@ -133,6 +133,82 @@ public:
     llvm::ArrayRef<uint32_t> getFreeRegistersForRegisterAllocator() const override {
         return X86::FreeRegs;
     }
+
+    bool readsRegOperand(const AsmInstruction &I, unsigned OpNo) const override {
+        switch (I.getOpcode()) {
+        case X86::MOV:
+        case X86::LEA: return OpNo == 0;
+        // xor %reg, %reg clears reg without depending on its value.
+        case X86::XOR: return !isSameReg(I.getOperand(0), I.getOperand(1));
+        default: return true;
+        }
+    }
+
+    bool writesRegOperand(const AsmInstruction &I, unsigned OpNo) const override {
+        switch (I.getOpcode()) {
+        case X86::MOV:
+        case X86::LEA:
+        case X86::ADD:
+        case X86::SUB:
+        case X86::IMUL:
+        case X86::XOR: return OpNo == 1;
+        case X86::POP: return true;
+        default: return false;
+        }
+    }
+
+    void getImplicitRegisters(const AsmInstruction &I,
+                              llvm::SmallVectorImpl<uint32_t> &Uses,
+                              llvm::SmallVectorImpl<uint32_t> &Defs) const override {
+        switch (I.getOpcode()) {
+        case X86::IDIV:
+            Uses.append({X86::RAX, X86::RDX});
+            Defs.append({X86::RAX, X86::RDX});
+            break;
+        case X86::CQTO:
+            Uses.push_back(X86::RAX);
+            Defs.push_back(X86::RDX);
+            break;
+        case X86::CALL:
+            // Second operand of X86::CALL instruction is NumArgs.
+            for (unsigned i = 0; i < I.getOperand(1).Imm.Val && i < X86::NumArgRegs; ++i)
+                Uses.push_back(X86::ArgRegs[i]);
+            Defs.append(std::begin(X86::CallerSavedRegs), std::end(X86::CallerSavedRegs));
+            break;
+        default: break;
+        }
+    }
+
+    bool isLabelInstruction(const AsmInstruction &I) const override {
+        return I.getOpcode() == X86::LABEL;
+    }
+
+    bool isBranchInstruction(const AsmInstruction &I) const override {
+        return X86::JMP <= I.getOpcode() && I.getOpcode() <= X86::JLE;
+    }
+
+    bool isUnconditionalBranchInstruction(const AsmInstruction &I) const override {
+        return I.getOpcode() == X86::JMP;
+    }
+
+    bool isCallInstruction(const AsmInstruction &I) const override {
+        return I.getOpcode() == X86::CALL;
+    }
+
+    bool isRegisterCopy(const AsmInstruction &I, uint32_t &Src,
+                        uint32_t &Dst) const override {
+        if (I.getOpcode() != X86::MOV || !I.getOperand(0).isReg() ||
+            !I.getOperand(1).isReg())
+            return false;
+        Src = I.getOperand(0).getReg();
+        Dst = I.getOperand(1).getReg();
+        return true;
+    }
+
+private:
+    static bool isSameReg(const AsmOperand &Op1, const AsmOperand &Op2) {
+        return Op1.isReg() && Op2.isReg() && Op1.getReg() == Op2.getReg();
+    }
 };
 
 }  // namespace remniw
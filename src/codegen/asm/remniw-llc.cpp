@@ -1,5 +1,6 @@
 #include "codegen/asm/AsmCodeGenetator.h"
 #include "codegen/asm/TargetInfo.h"
+#include "support/PhaseTimer.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IRReader/IRReader.h"
@@ -25,7 +26,45 @@ static llvm::cl::opt<remniw::Target> CodegenTarget(
                      clEnumVal(riscv, "emit RISCV assembly")),
     llvm::cl::init(x86));
 
+static llvm::cl::opt<remniw::FileType> OutputFileType(
+    "filetype", llvm::cl::desc("Choose a file type:"),
+    llvm::cl::values(clEnumValN(AssemblyFile, "asm", "Emit an assembly ('.s') file"),
+                     clEnumValN(ObjectFile, "obj", "Emit a native object ('.o') file")),
+    llvm::cl::init(AssemblyFile));
+
+static llvm::cl::opt<unsigned> NumThreads(
+    "j", llvm::cl::desc("Number of threads used by the backend, 0 means all cores"),
+    llvm::cl::init(1), llvm::cl::value_desc("N"));
+
+static llvm::cl::opt<bool> TimePhases(
+    "time-phases",
+    llvm::cl::desc("Report the time, heap growth and peak RSS of each backend phase"),
+    llvm::cl::init(false));
+
+static llvm::cl::opt<remniw::PhaseReportFormat> TimePhasesFormat(
+    "time-phases-format", llvm::cl::desc("Choose the format of the -time-phases report:"),
+    llvm::cl::values(clEnumValN(TableReport, "table", "human readable table"),
+                     clEnumValN(JSONReport, "json", "JSON")),
+    llvm::cl::init(TableReport));
+
+static llvm::cl::opt<std::string> TimePhasesFile(
+    "time-phases-file",
+    llvm::cl::desc("Write the -time-phases report to a file instead of stderr"),
+    llvm::cl::value_desc("filename"));
+
 int main(int argc, char *argv[]) {
+    // Created after renaming the -regalloc option of LLVM, see
+    // renameLLVMRegAllocOption().
+    renameLLVMRegAllocOption();
+    llvm::cl::opt<remniw::RegAllocKind> RegAlloc(
+        "regalloc", llvm::cl::desc("Choose the register allocator:"),
+        llvm::cl::values(
+            clEnumValN(GreedyRegAlloc, "greedy", "linear scan with interval splitting"),
+            clEnumValN(LinearScanRegAlloc, "linear", "linear scan, fastest"),
+            clEnumValN(GraphColoringRegAlloc, "graph",
+                       "graph coloring with coalescing, fewest spills and copies")),
+        llvm::cl::init(GreedyRegAlloc));
+
     // parse arguments from command line
     llvm::cl::ParseCommandLineOptions(argc, argv, "remniw-llc\n");
 
@@ -38,11 +77,23 @@ int main(int argc, char *argv[]) {
         return 1;
     }
 
+    if (OutputFileType == ObjectFile && CodegenTarget != x86) {
+        llvm::errs() << argv[0] << ": object file emission is only supported for x86\n";
+        return 1;
+    }
+
     std::error_code EC;
-    llvm::ToolOutputFile Out(OutputFilename, EC, llvm::sys::fs::OF_Text);
-    remniw::AsmCodeGenerator CG(CodegenTarget);
-    CG.compile(M.get(), Out.os());
+    llvm::ToolOutputFile Out(OutputFilename, EC,
+                             OutputFileType == ObjectFile ? llvm::sys::fs::OF_None
+                                                          : llvm::sys::fs::OF_Text);
+    std::unique_ptr<remniw::PhaseTimer> PT;
+    if (TimePhases)
+        PT = std::make_unique<remniw::PhaseTimer>();
+    remniw::AsmCodeGenerator CG(CodegenTarget, NumThreads, RegAlloc, PT.get());
+    CG.compile(M.get(), Out.os(), OutputFileType);
     Out.keep();
+    if (PT)
+        PT->print(TimePhasesFile, TimePhasesFormat);
 
     return 0;
 }
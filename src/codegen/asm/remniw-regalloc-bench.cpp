@@ -0,0 +1,92 @@
+#include "codegen/asm/LiveInterval.h"
+#include "codegen/asm/RISCV/RISCVTargetInfo.h"
+#include "codegen/asm/Register.h"
+#include "codegen/asm/RegisterAllocator.h"
+#include "codegen/asm/X86/X86TargetInfo.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+#include <chrono>
+#include <memory>
+#include <random>
+#include <unordered_map>
+
+// Micro-benchmark of the linear scan register allocator. It feeds generated live
+// ranges of functions with the given numbers of virtual registers to the allocator
+// and reports the allocation time, so that the scaling with the function size can
+// be checked.
+
+using namespace remniw;
+
+static llvm::cl::opt<remniw::Target> CodegenTarget(
+    "target", llvm::cl::desc("Choose codegen target:"),
+    llvm::cl::values(clEnumVal(x86, "use X86 registers"),
+                     clEnumVal(riscv, "use RISCV registers")),
+    llvm::cl::init(x86));
+
+static llvm::cl::list<unsigned>
+    NumVirtRegs("num-virt-regs",
+                llvm::cl::desc("Numbers of virtual registers of the generated "
+                               "functions (default 10000,100000,1000000)"),
+                llvm::cl::CommaSeparated, llvm::cl::value_desc("N"));
+
+static llvm::cl::opt<unsigned> Seed("seed",
+                                    llvm::cl::desc("Seed of the random generator"),
+                                    llvm::cl::init(42));
+
+// The generated code has a call every CallDistance instructions. Each instruction
+// defines one virtual register, most of them are used by the next few
+// instructions, a few stay live much longer, like values defined before a loop.
+// The first argument register is written right before each call.
+static constexpr uint32_t CallDistance = 50;
+
+static std::unordered_map<uint32_t, LiveRanges>
+generateLiveRanges(const TargetInfo &TI, unsigned N, std::mt19937 &Gen) {
+    std::unordered_map<uint32_t, LiveRanges> RegLiveRangesMap;
+    RegLiveRangesMap.reserve(N + 1);
+    std::uniform_int_distribution<uint32_t> ShortLength(1, 8);
+    std::uniform_int_distribution<uint32_t> LongLength(8, 1000);
+    std::uniform_int_distribution<uint32_t> Kind(0, 63);
+    uint32_t NumInsts = N;
+    for (uint32_t i = 0; i < N; ++i) {
+        uint32_t Length = Kind(Gen) == 0 ? LongLength(Gen) : ShortLength(Gen);
+        uint32_t EndPoint = std::min(i + Length, NumInsts) + 1;
+        // Live ranges containing a call are used across it.
+        bool UsedAcrossCall = (i / CallDistance) != ((EndPoint - 1) / CallDistance);
+        RegLiveRangesMap[Register::index2VirtReg(i)].Ranges.push_back(
+            {i, EndPoint, UsedAcrossCall});
+    }
+    auto &ArgRegRanges = RegLiveRangesMap[TI.getArgRegisters()[0]].Ranges;
+    for (uint32_t Call = CallDistance; Call < NumInsts; Call += CallDistance)
+        ArgRegRanges.push_back({Call - 1, Call, false});
+    return RegLiveRangesMap;
+}
+
+int main(int argc, char *argv[]) {
+    llvm::cl::ParseCommandLineOptions(argc, argv, "remniw-regalloc-bench\n");
+
+    std::unique_ptr<TargetInfo> TI;
+    if (CodegenTarget == x86)
+        TI = std::make_unique<X86TargetInfo>();
+    else
+        TI = std::make_unique<RISCVTargetInfo>();
+
+    llvm::SmallVector<unsigned> Sizes(NumVirtRegs.begin(), NumVirtRegs.end());
+    if (Sizes.empty())
+        Sizes = {10000, 100000, 1000000};
+
+    std::mt19937 Gen(Seed);
+    LinearScanRegisterAllocator LSRA(*TI);
+    llvm::outs() << "    VirtRegs     Time(ms)   ns/VirtReg      Spilled\n";
+    for (unsigned N : Sizes) {
+        auto RegLiveRangesMap = generateLiveRanges(*TI, N, Gen);
+        auto Start = std::chrono::steady_clock::now();
+        LSRA.doRegAlloc(RegLiveRangesMap);
+        auto End = std::chrono::steady_clock::now();
+        double Nanoseconds =
+            std::chrono::duration<double, std::nano>(End - Start).count();
+        llvm::outs() << llvm::format("%12u %12.2f %12.1f %12zu\n", N, Nanoseconds / 1e6,
+                                     Nanoseconds / N, LSRA.getSpilledRegCount());
+    }
+    return 0;
+}
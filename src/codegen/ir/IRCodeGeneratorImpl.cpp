@@ -216,8 +216,8 @@ Value *IRCodeGeneratorImpl::codegenNumberExpr(NumberExprAST *NumberExpr) {
 Value *IRCodeGeneratorImpl::codegenDeclRefExpr(DeclRefExprAST *DeclRefExpr) {
     auto *Decl = DeclRefExpr->getDecl();
     if (auto *VarDecl = llvm::dyn_cast<VarDeclAST>(Decl)) {
-        assert(LocalDeclMap.count(VarDecl));
-        AllocaInst *V = LocalDeclMap[VarDecl];
+        AllocaInst *V = LocalDeclMap.lookup(VarDecl);
+        assert(V);
         if (DeclRefExpr->isLValue()) {
             return V;
         } else {
@@ -226,7 +226,7 @@ Value *IRCodeGeneratorImpl::codegenDeclRefExpr(DeclRefExprAST *DeclRefExpr) {
         }
     } else if (auto *FuncDecl = llvm::dyn_cast<FunctionDeclAST>(Decl)) {
         assert(FunctionDeclMap.count(FuncDecl));
-        return FunctionDeclMap[FuncDecl];
+        return FunctionDeclMap.lookup(FuncDecl);
     }
 
     llvm_unreachable("Unknown DeclRefExprAST");
@@ -279,7 +279,7 @@ Value *IRCodeGeneratorImpl::codegenSizeofExpr(SizeofExprAST *SizeofExpr) {
 }
 
 Value *IRCodeGeneratorImpl::codegenAddrOfExpr(AddrOfExprAST *AddrOfExpr) {
-    assert(!TheModule->getFunction(AddrOfExpr->getVar()->getName()) &&
+    assert(llvm::isa<VarDeclAST>(AddrOfExpr->getVar()->getDecl()) &&
            "Operand of AddrOfExpr cannot be function");
     Value *Val = codegenDeclRefExpr(AddrOfExpr->getVar());
     return Val;
@@ -482,9 +482,9 @@ Value *IRCodeGeneratorImpl::codegenAssignmentStmt(AssignmentStmtAST *AssignmentS
 }
 
 Value *IRCodeGeneratorImpl::codegenFunction(FunctionDeclAST *Function) {
-    // Get the function from the module symbol table.
-    llvm::Function *F = TheModule->getFunction(Function->getName());
-    assert(F && "Function is not in the module symbol table");
+    // Get the function created for the prototype.
+    llvm::Function *F = FunctionDeclMap.lookup(Function);
+    assert(F && "Function has no prototype");
 
     // Create a new basic block to start insertion into.
     BasicBlock *BB = BasicBlock::Create(*TheLLVMContext, "entry", F);
@@ -492,7 +492,7 @@ Value *IRCodeGeneratorImpl::codegenFunction(FunctionDeclAST *Function) {
 
     LocalDeclMap.clear();
     // Create parameters declarations
-    std::vector<VarDeclAST *> ParamDecls = Function->getParamDecls();
+    llvm::ArrayRef<VarDeclAST *> ParamDecls = Function->getParamDecls();
     for (unsigned Idx = 0; Idx < F->arg_size(); ++Idx) {
         auto *Arg = F->getArg(Idx);
         Arg->setName(ParamDecls[Idx]->getName());
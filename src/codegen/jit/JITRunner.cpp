@@ -0,0 +1,88 @@
+#include "codegen/jit/JITRunner.h"
+#include "runtime/aphotic_shield/aphotic_shield_interface.h"
+#include "llvm/ExecutionEngine/Orc/ExecutionUtils.h"
+#include "llvm/ExecutionEngine/Orc/LLJIT.h"
+#include "llvm/ExecutionEngine/Orc/ThreadSafeModule.h"
+#include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/Timer.h"
+#include <cstdio>
+
+using namespace llvm;
+using namespace llvm::orc;
+
+namespace remniw {
+
+static Error addAphoticShieldSymbols(LLJIT &J) {
+    auto &ES = J.getExecutionSession();
+    const DataLayout &DL = J.getDataLayout();
+    MangleAndInterner Mangle(ES, DL);
+    SymbolMap Symbols;
+    Symbols[Mangle("as_init")] = JITEvaluatedSymbol(
+        pointerToJITTargetAddress(&as_init), JITSymbolFlags::Exported);
+    Symbols[Mangle("as_alloc")] = JITEvaluatedSymbol(
+        pointerToJITTargetAddress(&as_alloc), JITSymbolFlags::Exported);
+    Symbols[Mangle("as_dealloc")] = JITEvaluatedSymbol(
+        pointerToJITTargetAddress(&as_dealloc), JITSymbolFlags::Exported);
+    return J.getMainJITDylib().define(absoluteSymbols(std::move(Symbols)));
+}
+
+Expected<int> JITRunner::run(std::unique_ptr<Module> M,
+                             std::unique_ptr<LLVMContext> Ctx) {
+    TimerGroup TG("remniw-jit", "remniw JIT Timing");
+    Timer SetupTimer("setup", "Create JIT and add module", TG);
+    Timer CompileTimer("compile", "Compile, link and run initializers", TG);
+    Timer RunTimer("run", "Run main", TG);
+
+    InitializeNativeTarget();
+    InitializeNativeTargetAsmPrinter();
+
+    std::unique_ptr<LLJIT> J;
+    {
+        TimeRegion R(TimeRun ? &SetupTimer : nullptr);
+        auto JOrErr = LLJITBuilder().create();
+        if (!JOrErr)
+            return JOrErr.takeError();
+        J = std::move(*JOrErr);
+
+        // Resolve libc functions, e.g. printf, scanf and malloc, in the host process.
+        auto Generator = DynamicLibrarySearchGenerator::GetForCurrentProcess(
+            J->getDataLayout().getGlobalPrefix());
+        if (!Generator)
+            return Generator.takeError();
+        J->getMainJITDylib().addGenerator(std::move(*Generator));
+        if (auto Err = addAphoticShieldSymbols(*J))
+            return std::move(Err);
+
+        if (auto Err = J->addIRModule(ThreadSafeModule(std::move(M), std::move(Ctx))))
+            return std::move(Err);
+    }
+
+    int64_t (*Main)() = nullptr;
+    {
+        TimeRegion R(TimeRun ? &CompileTimer : nullptr);
+        auto MainSym = J->lookup("main");
+        if (!MainSym)
+            return MainSym.takeError();
+#if LLVM_VERSION_MAJOR < 15
+        Main = jitTargetAddressToFunction<int64_t (*)()>(MainSym->getAddress());
+#else
+        Main = MainSym->toPtr<int64_t (*)()>();
+#endif
+        // Run llvm.global_ctors, e.g. the aphotic_shield module constructor.
+        if (auto Err = J->initialize(J->getMainJITDylib()))
+            return std::move(Err);
+    }
+
+    int Ret;
+    {
+        TimeRegion R(TimeRun ? &RunTimer : nullptr);
+        Ret = (int)Main();
+        fflush(stdout);
+    }
+
+    if (auto Err = J->deinitialize(J->getMainJITDylib()))
+        return std::move(Err);
+    return Ret;
+}
+
+}  // namespace remniw
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/Error.h"
+#include <memory>
+
+namespace remniw {
+
+// Run the main function of a module in process with LLVM ORC LLJIT, instead of
+// emitting assembly and invoking clang to build an executable.
+// Library calls (printf, scanf, malloc, ...) are resolved to the host process,
+// the aphotic_shield runtime functions are resolved to the copy linked into the
+// compiler itself.
+class JITRunner {
+public:
+    // If TimeRun is true, a timing report of JIT compilation and execution is
+    // printed to stderr.
+    JITRunner(bool TimeRun = false): TimeRun(TimeRun) {}
+
+    // Return the return value of main.
+    llvm::Expected<int> run(std::unique_ptr<llvm::Module> M,
+                            std::unique_ptr<llvm::LLVMContext> Ctx);
+
+private:
+    bool TimeRun;
+};
+
+}  // namespace remniw
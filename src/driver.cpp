@@ -2,18 +2,24 @@
 #include "codegen/asm/AsmCodeGenetator.h"
 #include "codegen/asm/TargetInfo.h"
 #include "codegen/ir/IRCodeGenerator.h"
+#include "codegen/jit/JITRunner.h"
 #include "config.h"
 #include "frontend/AST.h"
 #include "frontend/ASTPrinter.h"
 #include "frontend/FrontEnd.h"
+#include "optimizer/Optimizer.h"
 #include "semantic/SymbolTable.h"
 #include "semantic/TypeAnalysis.h"
+#include "support/PhaseTimer.h"
+#include "llvm/ADT/ScopeExit.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/Program.h"
+#include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/ToolOutputFile.h"
 #include "llvm/Support/raw_ostream.h"
 // #include <unistd.h>
@@ -30,8 +36,32 @@ static llvm::cl::opt<bool> EmitLLVM(
     llvm::cl::desc("Output LLVM IR (human-readable LLVM assembly language format)"),
     llvm::cl::init(false), llvm::cl::cat(RemniwCat));
 
+static llvm::cl::opt<bool>
+    ASTDump("ast-dump", llvm::cl::desc("Print the AST to stdout and exit"),
+            llvm::cl::init(false), llvm::cl::cat(RemniwCat));
+
+static llvm::cl::opt<FrontEndKind> FrontEndType(
+    "frontend", llvm::cl::desc("Choose the lexer and parser:"), llvm::cl::cat(RemniwCat),
+    llvm::cl::values(clEnumValN(FastFrontEnd, "fast", "hand-written, fastest"),
+                     clEnumValN(ANTLRFrontEnd, "antlr", "generated by ANTLR")),
+    llvm::cl::init(ANTLRFrontEnd));
+
+static llvm::cl::opt<bool>
+    DisableOptimizations("O0", llvm::cl::desc("Disable the remniw optimizer"),
+                         llvm::cl::init(false), llvm::cl::cat(RemniwCat));
+
+static llvm::cl::opt<bool>
+    Run("run", llvm::cl::desc("Run the main function in process with JIT instead of "
+                              "generating an executable"),
+        llvm::cl::init(false), llvm::cl::cat(RemniwCat));
+
+static llvm::cl::opt<bool>
+    TimeRun("time-run", llvm::cl::desc("Print JIT compile and run time (with -run)"),
+            llvm::cl::init(false), llvm::cl::cat(RemniwCat));
+
 static llvm::cl::opt<std::string>
-    InputFilename(llvm::cl::Positional, llvm::cl::desc("<input remniw source code>"),
+    InputFilename(llvm::cl::Positional,
+                  llvm::cl::desc("<input remniw source code, - for stdin>"),
                   llvm::cl::cat(RemniwCat));
 
 static llvm::cl::opt<std::string>
@@ -44,48 +74,126 @@ static llvm::cl::opt<Target> CodegenTarget(
     llvm::cl::values(clEnumVal(x86, "X86 assembly"), clEnumVal(riscv, "RISCV assembly")),
     llvm::cl::init(x86));
 
+static llvm::cl::opt<FileType> CodegenFileType(
+    "filetype", llvm::cl::desc("Choose the file type passed to the linker:"),
+    llvm::cl::cat(RemniwCat),
+    llvm::cl::values(clEnumValN(AssemblyFile, "asm", "assembly file"),
+                     clEnumValN(ObjectFile, "obj", "object file, skip the assembler")),
+    llvm::cl::init(AssemblyFile));
+
+static llvm::cl::opt<unsigned> NumThreads(
+    "j", llvm::cl::desc("Number of threads used by the backend, 0 means all cores"),
+    llvm::cl::init(1), llvm::cl::value_desc("N"), llvm::cl::cat(RemniwCat));
+
+static llvm::cl::opt<bool> TimePhases(
+    "time-phases",
+    llvm::cl::desc("Report the time, heap growth and peak RSS of each compiler phase"),
+    llvm::cl::init(false), llvm::cl::cat(RemniwCat));
+
+static llvm::cl::opt<PhaseReportFormat> TimePhasesFormat(
+    "time-phases-format", llvm::cl::desc("Choose the format of the -time-phases report:"),
+    llvm::cl::cat(RemniwCat),
+    llvm::cl::values(clEnumValN(TableReport, "table", "human readable table"),
+                     clEnumValN(JSONReport, "json", "JSON")),
+    llvm::cl::init(TableReport));
+
+static llvm::cl::opt<std::string> TimePhasesFile(
+    "time-phases-file",
+    llvm::cl::desc("Write the -time-phases report to a file instead of stderr"),
+    llvm::cl::value_desc("filename"), llvm::cl::cat(RemniwCat));
+
 int main(int argc, char* argv[]) {
+    // Created after renaming the -regalloc option of LLVM, see
+    // renameLLVMRegAllocOption().
+    renameLLVMRegAllocOption();
+    llvm::cl::opt<RegAllocKind> RegAlloc(
+        "regalloc", llvm::cl::desc("Choose the register allocator:"),
+        llvm::cl::cat(RemniwCat),
+        llvm::cl::values(
+            clEnumValN(GreedyRegAlloc, "greedy", "linear scan with interval splitting"),
+            clEnumValN(LinearScanRegAlloc, "linear", "linear scan, fastest"),
+            clEnumValN(GraphColoringRegAlloc, "graph",
+                       "graph coloring with coalescing, fewest spills and copies")),
+        llvm::cl::init(GreedyRegAlloc));
+
     llvm::cl::HideUnrelatedOptions(RemniwCat);
     llvm::cl::SetVersionPrinter(
         [](llvm::raw_ostream& OS) { OS << "remniw compiler 0.1\n"; });
     llvm::cl::ParseCommandLineOptions(argc, argv, "remniw compiler\n");
 
-    llvm::LLVMContext TheLLVMContext;
-    remniw::TypeContext TheTypeContext;
+    std::unique_ptr<PhaseTimer> PT;
+    if (TimePhases)
+        PT = std::make_unique<PhaseTimer>();
+    auto PrintPhaseReport = llvm::make_scope_exit([&]() {
+        if (PT)
+            PT->print(TimePhasesFile, TimePhasesFormat);
+    });
 
-    std::ifstream Stream;
-    Stream.open(InputFilename);
-    if (!Stream.good()) {
+    // The source is mapped into memory and the lexers read it in place.
+    auto BufferOrErr = llvm::MemoryBuffer::getFileOrSTDIN(InputFilename);
+    if (!BufferOrErr) {
         llvm::errs() << "error: no such file: '" << InputFilename << "'\n";
         return 1;
     }
-    FrontEnd FE(TheTypeContext);
-    std::unique_ptr<ProgramAST> AST = FE.parse(Stream);
+    llvm::SourceMgr SrcMgr;
+    SrcMgr.AddNewSourceBuffer(std::move(*BufferOrErr), llvm::SMLoc());
+
+    auto TheLLVMContext = std::make_unique<llvm::LLVMContext>();
+    remniw::TypeContext TheTypeContext;
+    remniw::ASTContext TheASTContext;
+    FrontEnd FE(TheTypeContext, TheASTContext, FrontEndType);
+    ProgramAST *AST;
+    {
+        PhaseTimer::Scope S(PT.get(), "frontend", "FrontEnd");
+        AST = FE.parse(SrcMgr);
+    }
+    if (!AST)
+        return 1;
+
+    if (ASTDump) {
+        ASTPrinter PrettyPrinter(llvm::outs(), SrcMgr);
+        PrettyPrinter.print(AST);
+        return 0;
+    }
 
     LLVM_DEBUG({
         llvm::outs() << "===== AST Printer ===== \n";
-        ASTPrinter PrettyPrinter(llvm::outs());
-        PrettyPrinter.print(AST.get());
+        ASTPrinter PrettyPrinter(llvm::outs(), SrcMgr);
+        PrettyPrinter.print(AST);
     });
 
     LLVM_DEBUG(llvm::outs() << "===== Symbol Table ===== \n");
     SymbolTableBuilder SymTabBuilder;
-    SymTabBuilder.build(AST.get());
+    {
+        PhaseTimer::Scope S(PT.get(), "symbol-table", "SymbolTableBuilder");
+        SymTabBuilder.build(AST);
+    }
     LLVM_DEBUG(SymTabBuilder.getSymbolTale().print(llvm::outs()));
 
     LLVM_DEBUG(llvm::outs() << "===== Type Analysis ===== \n");
     TypeAnalysis TA(SymTabBuilder.getSymbolTale(), TheTypeContext);
-    bool TANoError = TA.solve(AST.get());
-    LLVM_DEBUG({
-        for (auto Constraint : TA.getConstraints())
-            Constraint.print(llvm::outs());
-    });
+    bool TANoError;
+    {
+        PhaseTimer::Scope S(PT.get(), "type-analysis", "TypeAnalysis");
+        TANoError = TA.solve(AST);
+    }
     if (!TANoError)
         return 1;
 
     LLVM_DEBUG(llvm::outs() << "===== IR Code Generator ===== \n");
-    IRCodeGenerator IRCG(&TheLLVMContext);
-    std::unique_ptr<llvm::Module> M = IRCG.emit(AST.get());
+    IRCodeGenerator IRCG(TheLLVMContext.get());
+    std::unique_ptr<llvm::Module> M;
+    {
+        PhaseTimer::Scope S(PT.get(), "ir-codegen", "IRCodeGenerator");
+        M = IRCG.emit(AST);
+    }
+
+    if (!DisableOptimizations) {
+        LLVM_DEBUG(llvm::outs() << "===== Optimizer ===== \n");
+        PhaseTimer::Scope S(PT.get(), "optimizer", "Optimizer");
+        Optimizer Opt;
+        Opt.optimize(*M);
+    }
 
     LLVM_DEBUG(M->print(llvm::outs(), nullptr));
     if (EmitLLVM) {
@@ -96,29 +204,48 @@ int main(int argc, char* argv[]) {
             return 1;
         }
         // WriteBitcodeToFile(*M.get(), Out.os());
+        PhaseTimer::Scope S(PT.get(), "ir-printer", "Print LLVM IR");
         M->print(Out.os(), nullptr);
         Out.keep();
         return 0;
     }
 
+    if (Run) {
+        LLVM_DEBUG(llvm::outs() << "===== JIT Runner ===== \n");
+        JITRunner JR(TimeRun);
+        PhaseTimer::Scope S(PT.get(), "jit", "JITRunner (compile and run)");
+        auto RetOrErr = JR.run(std::move(M), std::move(TheLLVMContext));
+        if (!RetOrErr) {
+            llvm::logAllUnhandledErrors(RetOrErr.takeError(), llvm::errs(), "error: ");
+            return 1;
+        }
+        return *RetOrErr;
+    }
+
+    if (CodegenFileType == ObjectFile && CodegenTarget != x86) {
+        llvm::errs() << "error: object file emission is only supported for x86\n";
+        return 1;
+    }
+
     LLVM_DEBUG(llvm::outs() << "===== Asm Code Generator ===== \n");
     llvm::SmallString<64> TempPath;
     int FD;
-    if (llvm::sys::fs::createTemporaryFile(llvm::sys::path::filename(OutputFilename), "s",
-                                           FD, TempPath)) {
+    if (llvm::sys::fs::createTemporaryFile(llvm::sys::path::filename(OutputFilename),
+                                           CodegenFileType == ObjectFile ? "o" : "s", FD,
+                                           TempPath)) {
         llvm::errs() << "createTemporaryFile failed\n";
         return 1;
     }
     llvm::raw_fd_ostream TmpOut(FD, /*shouldClose=*/true);
-    AsmCodeGenerator ASMCG(CodegenTarget);
-    ASMCG.compile(M.get(), TmpOut);
+    AsmCodeGenerator ASMCG(CodegenTarget, NumThreads, RegAlloc, PT.get());
+    ASMCG.compile(M.get(), TmpOut, CodegenFileType);
     TmpOut.close();
 
-    // Invoke clang to compile and link assembly code to executable file.
+    // Invoke clang to compile and link assembly code or object file to executable file.
     llvm::SmallVector<llvm::StringRef> CCParams;
     {
         CCParams.push_back("clang");
-        CCParams.push_back(TempPath.c_str());                    /* assembly filename */
+        CCParams.push_back(TempPath.c_str());                    /* asm/obj filename */
         CCParams.push_back("-L" CMAKE_LIBRARY_OUTPUT_DIRECTORY); /* see config.h.in */
         CCParams.push_back("-Wl,-whole-archive");
         CCParams.push_back("-laphotic_shield"); /* link aphotic_shield */
@@ -131,7 +258,13 @@ int main(int argc, char* argv[]) {
     llvm::ErrorOr<std::string> Program = llvm::sys::findProgramByName("clang");
     if (!Program)
         ErrMsg = Program.getError().message();
-    if (llvm::sys::ExecuteAndWait(Program.get(), CCParams, {}, {}, 0, 0, &ErrMsg)) {
+    int LinkResult;
+    {
+        PhaseTimer::Scope S(PT.get(), "link", "clang (assemble and link)");
+        LinkResult =
+            llvm::sys::ExecuteAndWait(Program.get(), CCParams, {}, {}, 0, 0, &ErrMsg);
+    }
+    if (LinkResult) {
         llvm::errs() << "execvp(clang) failed: " << ErrMsg << '\n';
         exit(EXIT_FAILURE);
     }
@@ -1,28 +1,48 @@
 #pragma once
 
 #include "frontend/Type.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Value.h"
+#include "llvm/Support/Allocator.h"
 #include "llvm/Support/Casting.h"
 #include <algorithm>
 #include <iostream>
 #include <memory>
+#include <type_traits>
 #include <vector>
 
 namespace remniw {
 
-template<typename T>
-std::vector<T *> rawPtrs(const std::vector<std::unique_ptr<T>> &v) {
-    std::vector<T *> r;
-    std::transform(v.begin(), v.end(), std::back_inserter(r),
-                   [](auto &up) { return up.get(); });
-    return r;
-}
-
+// The byte offset of the first character of an AST node in the source buffer. The
+// line and the column are only computed from the offset when they are printed, see
+// ASTPrinter. The nodes which don't correspond to source code have no location.
 struct SourceLocation {
-    size_t Line;
-    size_t Col;
+    static constexpr uint32_t InvalidOffset = ~0u;
+
+    uint32_t Offset = InvalidOffset;
+
+    bool isValid() const { return Offset != InvalidOffset; }
+};
+
+// An identifier interned in an ASTContext, see ASTContext::getIdentifier(). All
+// occurrences of a name are the same identifier, which has a dense ID, so the
+// phases after the frontend can index tables by it instead of hashing the name.
+class Identifier {
+public:
+    Identifier() = default;
+    explicit Identifier(const llvm::StringMapEntry<unsigned> *Entry): Entry(Entry) {}
+
+    llvm::StringRef getName() const { return Entry->getKey(); }
+    unsigned getID() const { return Entry->getValue(); }
+
+    bool operator==(Identifier Other) const { return Entry == Other.Entry; }
+    bool operator!=(Identifier Other) const { return Entry != Other.Entry; }
+
+private:
+    const llvm::StringMapEntry<unsigned> *Entry = nullptr;
 };
 
 class ASTNode {
@@ -58,12 +78,12 @@ public:
         AssignmentStmt,
     };
 
+    // AST nodes are allocated in an ASTContext and never destroyed one by one, see
+    // ASTContext::create().
     ASTNode(Kind K, SourceLocation Loc): ASTNodeKind(K), Loc(Loc) {}
-    virtual ~ASTNode() = default;
 
     Kind getKind() const { return ASTNodeKind; }
-    int getLine() const { return Loc.Line; }
-    int getCol() const { return Loc.Col; }
+    SourceLocation getLoc() const { return Loc; }
 
 private:
     const Kind ASTNodeKind;
@@ -72,7 +92,7 @@ private:
 
 class DeclAST: public ASTNode {
 public:
-    DeclAST(ASTNode::Kind K, SourceLocation Loc, std::string Name, remniw::Type *Ty):
+    DeclAST(ASTNode::Kind K, SourceLocation Loc, Identifier Name, remniw::Type *Ty):
         ASTNode(K, Loc), Name(Name), Ty(Ty) {}
 
     static bool classof(const ASTNode *Node) {
@@ -80,18 +100,19 @@ public:
                Node->getKind() <= ASTNode::FunctionDecl;
     }
 
-    llvm::StringRef getName() const { return Name; }
+    llvm::StringRef getName() const { return Name.getName(); }
+    Identifier getIdentifier() const { return Name; }
 
     remniw::Type *getType() const { return Ty; }
 
 private:
-    std::string Name;
+    Identifier Name;
     remniw::Type *Ty;
 };
 
 class VarDeclAST: public DeclAST {
 public:
-    VarDeclAST(SourceLocation Loc, std::string Name, remniw::Type *Ty):
+    VarDeclAST(SourceLocation Loc, Identifier Name, remniw::Type *Ty):
         DeclAST(ASTNode::VarDecl, Loc, Name, Ty) {}
 
     static bool classof(const ASTNode *Node) {
@@ -111,6 +132,8 @@ public:
 
     bool isLValue() const { return LValue; }
 
+    void setLValue(bool V) { LValue = V; }
+
     remniw::Type *getType() const { return Ty; }
 
 private:
@@ -144,13 +167,14 @@ private:
 };
 
 /// DeclRefExprAST - Expression class for referencing a variable or function, like "a".
+/// The frontend resolves the name to its declaration, the later phases only follow
+/// the link.
 class DeclRefExprAST: public ExprAST {
 public:
-    DeclRefExprAST(SourceLocation Loc, std::string Name, DeclAST *Decl, bool LValue):
-        ExprAST(ASTNode::DeclRefExpr, Loc, Decl->getType(), LValue), Decl(Decl),
-        Name(Name) {}
+    DeclRefExprAST(SourceLocation Loc, DeclAST *Decl, bool LValue):
+        ExprAST(ASTNode::DeclRefExpr, Loc, Decl->getType(), LValue), Decl(Decl) {}
 
-    llvm::StringRef getName() const { return Name; }
+    llvm::StringRef getName() const { return Decl->getName(); }
 
     DeclAST *getDecl() const { return Decl; }
 
@@ -159,21 +183,20 @@ public:
     }
 
 private:
-    std::string Name;
     DeclAST *Decl;
 };
 
 class FunctionCallExprAST: public ExprAST {
 public:
-    FunctionCallExprAST(SourceLocation Loc, remniw::Type *Ty,
-                        std::unique_ptr<ExprAST> Callee,
-                        std::vector<std::unique_ptr<ExprAST>> Args):
+    // Args must be allocated in the ASTContext of the node.
+    FunctionCallExprAST(SourceLocation Loc, remniw::Type *Ty, ExprAST *Callee,
+                        llvm::ArrayRef<ExprAST *> Args):
         ExprAST(ASTNode::FunctionCallExpr, Loc, Ty, /*LValue*/ false),
-        Callee(std::move(Callee)), Args(std::move(Args)) {}
+        Callee(Callee), Args(Args) {}
 
-    ExprAST *getCallee() const { return Callee.get(); }
+    ExprAST *getCallee() const { return Callee; }
 
-    std::vector<ExprAST *> getArgs() const { return rawPtrs(Args); }
+    llvm::ArrayRef<ExprAST *> getArgs() const { return Args; }
     size_t getArgSize() const { return Args.size(); }
 
     static bool classof(const ASTNode *Node) {
@@ -181,8 +204,8 @@ public:
     }
 
 private:
-    std::unique_ptr<ExprAST> Callee;
-    std::vector<std::unique_ptr<ExprAST>> Args;
+    ExprAST *Callee;
+    llvm::ArrayRef<ExprAST *> Args;
 };
 
 class NullExprAST: public ExprAST {
@@ -213,57 +236,52 @@ private:
 
 class AddrOfExprAST: public ExprAST {
 public:
-    AddrOfExprAST(SourceLocation Loc, remniw::Type *Ty,
-                  std::unique_ptr<DeclRefExprAST> Var):
-        ExprAST(ASTNode::AddrOfExpr, Loc, Ty, /*LValue*/ false),
-        Var(std::move(Var)) {}
+    AddrOfExprAST(SourceLocation Loc, remniw::Type *Ty, DeclRefExprAST *Var):
+        ExprAST(ASTNode::AddrOfExpr, Loc, Ty, /*LValue*/ false), Var(Var) {}
 
-    DeclRefExprAST *getVar() const { return Var.get(); }
+    DeclRefExprAST *getVar() const { return Var; }
 
     static bool classof(const ASTNode *Node) {
         return Node->getKind() == ASTNode::AddrOfExpr;
     }
 
 private:
-    std::unique_ptr<DeclRefExprAST> Var;
+    DeclRefExprAST *Var;
 };
 
 class DerefExprAST: public ExprAST {
 public:
-    DerefExprAST(SourceLocation Loc, remniw::Type *Ty, bool LValue,
-                 std::unique_ptr<ExprAST> Ptr):
-        ExprAST(ASTNode::DerefExpr, Loc, Ty, LValue),
-        Ptr(std::move(Ptr)) {}
+    DerefExprAST(SourceLocation Loc, remniw::Type *Ty, bool LValue, ExprAST *Ptr):
+        ExprAST(ASTNode::DerefExpr, Loc, Ty, LValue), Ptr(Ptr) {}
 
-    ExprAST *getPtr() const { return Ptr.get(); }
+    ExprAST *getPtr() const { return Ptr; }
 
     static bool classof(const ASTNode *Node) {
         return Node->getKind() == ASTNode::DerefExpr;
     }
 
 private:
-    std::unique_ptr<ExprAST> Ptr;
+    ExprAST *Ptr;
 };
 
 class ArraySubscriptExprAST: public ExprAST {
 public:
     ArraySubscriptExprAST(SourceLocation Loc, remniw::Type *Ty, bool LValue,
-                          std::unique_ptr<ExprAST> Base,
-                          std::unique_ptr<ExprAST> Selector):
-        ExprAST(ASTNode::ArraySubscriptExpr, Loc, Ty, LValue),
-        Base(std::move(Base)), Selector(std::move(Selector)) {}
+                          ExprAST *Base, ExprAST *Selector):
+        ExprAST(ASTNode::ArraySubscriptExpr, Loc, Ty, LValue), Base(Base),
+        Selector(Selector) {}
 
-    ExprAST *getBase() const { return Base.get(); }
+    ExprAST *getBase() const { return Base; }
 
-    ExprAST *getSelector() const { return Selector.get(); }
+    ExprAST *getSelector() const { return Selector; }
 
     static bool classof(const ASTNode *Node) {
         return Node->getKind() == ASTNode::ArraySubscriptExpr;
     }
 
 private:
-    std::unique_ptr<ExprAST> Base;
-    std::unique_ptr<ExprAST> Selector;
+    ExprAST *Base;
+    ExprAST *Selector;
 };
 
 class InputExprAST: public ExprAST {
@@ -303,10 +321,10 @@ public:
         Eq,
     };
 
-    BinaryExprAST(SourceLocation Loc, remniw::Type *Ty, OpKind Op,
-                  std::unique_ptr<ExprAST> LHS, std::unique_ptr<ExprAST> RHS):
-        ExprAST(ASTNode::BinaryExpr, Loc, Ty, /*LValue*/ false),
-        Op(Op), LHS(std::move(LHS)), RHS(std::move(RHS)) {}
+    BinaryExprAST(SourceLocation Loc, remniw::Type *Ty, OpKind Op, ExprAST *LHS,
+                  ExprAST *RHS):
+        ExprAST(ASTNode::BinaryExpr, Loc, Ty, /*LValue*/ false), Op(Op), LHS(LHS),
+        RHS(RHS) {}
 
     OpKind getOp() const { return Op; }
 
@@ -324,9 +342,9 @@ public:
         return OpStr;
     }
 
-    ExprAST *getLHS() const { return LHS.get(); }
+    ExprAST *getLHS() const { return LHS; }
 
-    ExprAST *getRHS() const { return RHS.get(); }
+    ExprAST *getRHS() const { return RHS; }
 
     static bool classof(const ASTNode *Node) {
         return Node->getKind() == ASTNode::BinaryExpr;
@@ -334,24 +352,23 @@ public:
 
 private:
     OpKind Op;
-    std::unique_ptr<ExprAST> LHS, RHS;
+    ExprAST *LHS, *RHS;
 };
 
 class LocalVarDeclStmtAST: public StmtAST {
 public:
-    LocalVarDeclStmtAST(SourceLocation Loc,
-                        std::vector<std::unique_ptr<VarDeclAST>> Vars):
-        StmtAST(ASTNode::LocalVarDeclStmt, Loc),
-        Vars(std::move(Vars)) {}
+    // Vars must be allocated in the ASTContext of the node.
+    LocalVarDeclStmtAST(SourceLocation Loc, llvm::ArrayRef<VarDeclAST *> Vars):
+        StmtAST(ASTNode::LocalVarDeclStmt, Loc), Vars(Vars) {}
 
-    std::vector<VarDeclAST *> getVars() const { return rawPtrs(Vars); }
+    llvm::ArrayRef<VarDeclAST *> getVars() const { return Vars; }
 
     static bool classof(const ASTNode *Node) {
         return Node->getKind() == ASTNode::LocalVarDeclStmt;
     }
 
 private:
-    std::vector<std::unique_ptr<VarDeclAST>> Vars;
+    llvm::ArrayRef<VarDeclAST *> Vars;
 };
 
 class EmptyStmtAST: public StmtAST {
@@ -365,186 +382,173 @@ public:
 
 class OutputStmtAST: public StmtAST {
 public:
-    OutputStmtAST(SourceLocation Loc, std::unique_ptr<ExprAST> Expr):
-        StmtAST(ASTNode::OutputStmt, Loc), Expr(std::move(Expr)) {}
+    OutputStmtAST(SourceLocation Loc, ExprAST *Expr):
+        StmtAST(ASTNode::OutputStmt, Loc), Expr(Expr) {}
 
-    ExprAST *getExpr() const { return Expr.get(); }
+    ExprAST *getExpr() const { return Expr; }
 
     static bool classof(const ASTNode *Node) {
         return Node->getKind() == ASTNode::OutputStmt;
     }
 
 private:
-    std::unique_ptr<ExprAST> Expr;
+    ExprAST *Expr;
 };
 
 class AllocStmtAST: public StmtAST {
 public:
-    AllocStmtAST(SourceLocation Loc, std::unique_ptr<ExprAST> Ptr,
-                 std::unique_ptr<ExprAST> Size):
-        StmtAST(ASTNode::AllocStmt, Loc),
-        Ptr(std::move(Ptr)), Size(std::move(Size)) {}
+    AllocStmtAST(SourceLocation Loc, ExprAST *Ptr, ExprAST *Size):
+        StmtAST(ASTNode::AllocStmt, Loc), Ptr(Ptr), Size(Size) {}
 
-    ExprAST *getPtr() const { return Ptr.get(); }
-    ExprAST *getSize() const { return Size.get(); }
+    ExprAST *getPtr() const { return Ptr; }
+    ExprAST *getSize() const { return Size; }
 
     static bool classof(const ASTNode *Node) {
         return Node->getKind() == ASTNode::AllocStmt;
     }
 
 private:
-    std::unique_ptr<ExprAST> Ptr;
-    std::unique_ptr<ExprAST> Size;
+    ExprAST *Ptr;
+    ExprAST *Size;
 };
 
 class DeallocStmtAST: public StmtAST {
 public:
-    DeallocStmtAST(SourceLocation Loc, std::unique_ptr<ExprAST> Expr):
-        StmtAST(ASTNode::DeallocStmt, Loc), Expr(std::move(Expr)) {}
+    DeallocStmtAST(SourceLocation Loc, ExprAST *Expr):
+        StmtAST(ASTNode::DeallocStmt, Loc), Expr(Expr) {}
 
-    ExprAST *getExpr() const { return Expr.get(); }
+    ExprAST *getExpr() const { return Expr; }
 
     static bool classof(const ASTNode *Node) {
         return Node->getKind() == ASTNode::DeallocStmt;
     }
 
 private:
-    std::unique_ptr<ExprAST> Expr;
+    ExprAST *Expr;
 };
 
 class BlockStmtAST: public StmtAST {
 public:
-    BlockStmtAST(SourceLocation Loc, std::vector<std::unique_ptr<StmtAST>> Stmts):
-        StmtAST(ASTNode::BlockStmt, Loc), Stmts(std::move(Stmts)) {}
+    // Stmts must be allocated in the ASTContext of the node.
+    BlockStmtAST(SourceLocation Loc, llvm::ArrayRef<StmtAST *> Stmts):
+        StmtAST(ASTNode::BlockStmt, Loc), Stmts(Stmts) {}
 
-    std::vector<StmtAST *> getStmts() const { return rawPtrs(Stmts); }
+    llvm::ArrayRef<StmtAST *> getStmts() const { return Stmts; }
 
     static bool classof(const ASTNode *Node) {
         return Node->getKind() == ASTNode::BlockStmt;
     }
 
 private:
-    std::vector<std::unique_ptr<StmtAST>> Stmts;
+    llvm::ArrayRef<StmtAST *> Stmts;
 };
 
 class ReturnStmtAST: public StmtAST {
 public:
-    ReturnStmtAST(SourceLocation Loc, std::unique_ptr<ExprAST> Expr):
-        StmtAST(ASTNode::ReturnStmt, Loc), Expr(std::move(Expr)) {}
+    ReturnStmtAST(SourceLocation Loc, ExprAST *Expr):
+        StmtAST(ASTNode::ReturnStmt, Loc), Expr(Expr) {}
 
-    ExprAST *getExpr() const { return Expr.get(); }
+    ExprAST *getExpr() const { return Expr; }
 
     static bool classof(const ASTNode *Node) {
         return Node->getKind() == ASTNode::ReturnStmt;
     }
 
 private:
-    std::unique_ptr<ExprAST> Expr;
+    ExprAST *Expr;
 };
 
 class IfStmtAST: public StmtAST {
 public:
-    IfStmtAST(SourceLocation Loc, std::unique_ptr<ExprAST> Cond,
-              std::unique_ptr<StmtAST> Then, std::unique_ptr<StmtAST> Else):
-        StmtAST(ASTNode::IfStmt, Loc),
-        Cond(std::move(Cond)), Then(std::move(Then)), Else(std::move(Else)) {}
+    IfStmtAST(SourceLocation Loc, ExprAST *Cond, StmtAST *Then, StmtAST *Else):
+        StmtAST(ASTNode::IfStmt, Loc), Cond(Cond), Then(Then), Else(Else) {}
 
-    ExprAST *getCond() const { return Cond.get(); }
+    ExprAST *getCond() const { return Cond; }
 
-    StmtAST *getThen() const { return Then.get(); }
+    StmtAST *getThen() const { return Then; }
 
-    StmtAST *getElse() const { return Else.get(); }
+    StmtAST *getElse() const { return Else; }
 
     static bool classof(const ASTNode *Node) {
         return Node->getKind() == ASTNode::IfStmt;
     }
 
 private:
-    std::unique_ptr<ExprAST> Cond;
-    std::unique_ptr<StmtAST> Then, Else;
+    ExprAST *Cond;
+    StmtAST *Then, *Else;
 };
 
 class WhileStmtAST: public StmtAST {
 public:
-    WhileStmtAST(SourceLocation Loc, std::unique_ptr<ExprAST> Cond,
-                 std::unique_ptr<StmtAST> Body):
-        StmtAST(ASTNode::WhileStmt, Loc),
-        Cond(std::move(Cond)), Body(std::move(Body)) {}
+    WhileStmtAST(SourceLocation Loc, ExprAST *Cond, StmtAST *Body):
+        StmtAST(ASTNode::WhileStmt, Loc), Cond(Cond), Body(Body) {}
 
-    ExprAST *getCond() const { return Cond.get(); }
+    ExprAST *getCond() const { return Cond; }
 
-    StmtAST *getBody() const { return Body.get(); }
+    StmtAST *getBody() const { return Body; }
 
     static bool classof(const ASTNode *Node) {
         return Node->getKind() == ASTNode::WhileStmt;
     }
 
 private:
-    std::unique_ptr<ExprAST> Cond;
-    std::unique_ptr<StmtAST> Body;
+    ExprAST *Cond;
+    StmtAST *Body;
 };
 
 class AssignmentStmtAST: public StmtAST {
 public:
-    AssignmentStmtAST(SourceLocation Loc, std::unique_ptr<ExprAST> LHS,
-                      std::unique_ptr<ExprAST> RHS):
-        StmtAST(ASTNode::AssignmentStmt, Loc),
-        LHS(std::move(LHS)), RHS(std::move(RHS)) {}
+    AssignmentStmtAST(SourceLocation Loc, ExprAST *LHS, ExprAST *RHS):
+        StmtAST(ASTNode::AssignmentStmt, Loc), LHS(LHS), RHS(RHS) {}
 
-    ExprAST *getLHS() const { return LHS.get(); }
+    ExprAST *getLHS() const { return LHS; }
 
-    ExprAST *getRHS() const { return RHS.get(); }
+    ExprAST *getRHS() const { return RHS; }
 
     static bool classof(const ASTNode *Node) {
         return Node->getKind() == ASTNode::AssignmentStmt;
     }
 
 private:
-    std::unique_ptr<ExprAST> LHS, RHS;
+    ExprAST *LHS, *RHS;
 };
 
 /// FunctionAST - This class represents a function definition itself.
 class FunctionDeclAST: public DeclAST {
 public:
-    FunctionDeclAST(SourceLocation Loc, std::string FuncName,
+    FunctionDeclAST(SourceLocation Loc, Identifier FuncName,
                     remniw::FunctionType *FuncTy):
         DeclAST(ASTNode::FunctionDecl, Loc, FuncName, FuncTy) {}
 
-    void setParamDecls(std::vector<std::unique_ptr<VarDeclAST>> ParamDecls) {
-        this->ParamDecls = std::move(ParamDecls);
-    }
+    // ParamDecls and Body must be allocated in the ASTContext of the node.
+    FunctionDeclAST(SourceLocation Loc, Identifier FuncName, remniw::FunctionType *FuncTy,
+                    llvm::ArrayRef<VarDeclAST *> ParamDecls,
+                    LocalVarDeclStmtAST *LocalVarDecls, llvm::ArrayRef<StmtAST *> Body,
+                    ReturnStmtAST *ReturnStmt):
+        DeclAST(ASTNode::FunctionDecl, Loc, FuncName, FuncTy), ParamDecls(ParamDecls),
+        LocalVarDecls(LocalVarDecls), Body(Body), ReturnStmt(ReturnStmt) {}
 
-    void setLocalVarDecls(std::unique_ptr<LocalVarDeclStmtAST> LocalVarDecls) {
-        this->LocalVarDecls = std::move(LocalVarDecls);
+    void setParamDecls(llvm::ArrayRef<VarDeclAST *> ParamDecls) {
+        this->ParamDecls = ParamDecls;
     }
 
-    void setBody(std::vector<std::unique_ptr<StmtAST>> Body) {
-        this->Body = std::move(Body);
+    void setLocalVarDecls(LocalVarDeclStmtAST *LocalVarDecls) {
+        this->LocalVarDecls = LocalVarDecls;
     }
 
-    void setReturnStmt(std::unique_ptr<ReturnStmtAST> ReturnStmt) {
-        this->ReturnStmt = std::move(ReturnStmt);
-    }
+    void setBody(llvm::ArrayRef<StmtAST *> Body) { this->Body = Body; }
 
-    FunctionDeclAST(SourceLocation Loc, std::string FuncName,
-                    remniw::FunctionType *FuncTy,
-                    std::vector<std::unique_ptr<VarDeclAST>> ParamDecls,
-                    std::unique_ptr<LocalVarDeclStmtAST> LocalVarDecls,
-                    std::vector<std::unique_ptr<StmtAST>> Body,
-                    std::unique_ptr<ReturnStmtAST> ReturnStmt):
-        DeclAST(ASTNode::FunctionDecl, Loc, FuncName, FuncTy),
-        ParamDecls(std::move(ParamDecls)), LocalVarDecls(std::move(LocalVarDecls)),
-        Body(std::move(Body)), ReturnStmt(std::move(ReturnStmt)) {}
+    void setReturnStmt(ReturnStmtAST *ReturnStmt) { this->ReturnStmt = ReturnStmt; }
 
-    std::vector<VarDeclAST *> getParamDecls() const { return rawPtrs(ParamDecls); }
+    llvm::ArrayRef<VarDeclAST *> getParamDecls() const { return ParamDecls; }
 
     std::size_t getParamSize() const { return ParamDecls.size(); }
 
-    LocalVarDeclStmtAST *getLocalVarDecls() const { return LocalVarDecls.get(); }
+    LocalVarDeclStmtAST *getLocalVarDecls() const { return LocalVarDecls; }
 
-    std::vector<StmtAST *> getBody() const { return rawPtrs(Body); }
+    llvm::ArrayRef<StmtAST *> getBody() const { return Body; }
 
-    ReturnStmtAST *getReturn() const { return ReturnStmt.get(); }
+    ReturnStmtAST *getReturn() const { return ReturnStmt; }
 
     llvm::ArrayRef<remniw::Type *> getParamTypes() const {
         return llvm::cast<remniw::FunctionType>(getType())->getParamTypes();
@@ -559,19 +563,19 @@ public:
     }
 
 private:
-    std::vector<std::unique_ptr<VarDeclAST>> ParamDecls;
-    std::unique_ptr<LocalVarDeclStmtAST> LocalVarDecls;
-    std::vector<std::unique_ptr<StmtAST>> Body;
-    std::unique_ptr<ReturnStmtAST> ReturnStmt;
+    llvm::ArrayRef<VarDeclAST *> ParamDecls;
+    LocalVarDeclStmtAST *LocalVarDecls {nullptr};
+    llvm::ArrayRef<StmtAST *> Body;
+    ReturnStmtAST *ReturnStmt {nullptr};
 };
 
 class ProgramAST: public ASTNode {
 public:
-    ProgramAST(std::vector<std::unique_ptr<FunctionDeclAST>> Functions):
-        ASTNode(ASTNode::Program, SourceLocation {0, 0}),
-        Functions(std::move(Functions)) {}
+    // Functions must be allocated in the ASTContext of the node.
+    ProgramAST(llvm::ArrayRef<FunctionDeclAST *> Functions):
+        ASTNode(ASTNode::Program, SourceLocation {}), Functions(Functions) {}
 
-    std::vector<FunctionDeclAST *> getFunctions() const { return rawPtrs(Functions); }
+    llvm::ArrayRef<FunctionDeclAST *> getFunctions() const { return Functions; }
 
     std::unique_ptr<llvm::Module> codegen(llvm::LLVMContext &);
 
@@ -580,7 +584,56 @@ public:
     }
 
 private:
-    std::vector<std::unique_ptr<FunctionDeclAST>> Functions;
+    llvm::ArrayRef<FunctionDeclAST *> Functions;
+};
+
+/// ASTContext - Owns the nodes of the ASTs built for one compilation. The nodes and
+/// the arrays of their children are allocated from a bump allocator, in the order
+/// the parser creates them, and are all freed at once when the ASTContext is
+/// destroyed. The names of the nodes are interned in the ASTContext.
+class ASTContext {
+public:
+    ASTContext() = default;
+    ASTContext(const ASTContext &) = delete;
+    ASTContext &operator=(const ASTContext &) = delete;
+
+    template<typename T, typename... ArgTys>
+    T *create(ArgTys &&...Args) {
+        static_assert(std::is_base_of_v<ASTNode, T>, "Expected an AST node");
+        // The destructors of the nodes are never run.
+        static_assert(std::is_trivially_destructible_v<T>,
+                      "AST nodes must be trivially destructible");
+        return new (Alloc.Allocate<T>()) T(std::forward<ArgTys>(Args)...);
+    }
+
+    // Copy the elements of a container of node pointers into the context.
+    template<typename Container>
+    auto copyArray(const Container &Elts)
+        -> llvm::ArrayRef<typename Container::value_type> {
+        using T = typename Container::value_type;
+        static_assert(std::is_trivially_copyable_v<T>);
+        if (Elts.empty())
+            return {};
+        T *Mem = Alloc.Allocate<T>(Elts.size());
+        std::copy(Elts.begin(), Elts.end(), Mem);
+        return llvm::ArrayRef<T>(Mem, Elts.size());
+    }
+
+    // Returns the identifier Name, the identifiers are numbered from 0 in the order
+    // they are first seen.
+    Identifier getIdentifier(llvm::StringRef Name) {
+        return Identifier(&*Identifiers.try_emplace(Name, Identifiers.size()).first);
+    }
+
+    unsigned getNumIdentifiers() const { return Identifiers.size(); }
+
+    size_t getTotalMemory() const {
+        return Alloc.getTotalMemory() + Identifiers.getAllocator().getTotalMemory();
+    }
+
+private:
+    llvm::BumpPtrAllocator Alloc;
+    llvm::StringMap<unsigned, llvm::BumpPtrAllocator> Identifiers;
 };
 
 }  // namespace remniw
@@ -1,18 +1,26 @@
 #include "frontend/ASTBuilder.h"
 #include "frontend/AST.h"
 #include "frontend/Type.h"
+#include "llvm/ADT/STLExtras.h"
 #include <type_traits>
 
 namespace remniw {
 
-static std::unique_ptr<ExprAST> visitedExpr = nullptr;
-static std::unique_ptr<StmtAST> visitedStmt = nullptr;
-static std::unique_ptr<ReturnStmtAST> visitedReturnStmt = nullptr;
+static ExprAST *visitedExpr = nullptr;
+static StmtAST *visitedStmt = nullptr;
+static ReturnStmtAST *visitedReturnStmt = nullptr;
 static Type *visitedType = nullptr;
 static bool exprIsLValue = false;
 
-std::unique_ptr<ProgramAST> ASTBuilder::build(RemniwParser::ProgramContext *Ctx) {
-    return std::move(visitProgram(Ctx).as<std::unique_ptr<ProgramAST>>());
+ASTBuilder::ASTBuilder(TypeContext &TyCtx, ASTContext &ASTCtx, llvm::StringRef Source):
+    TyCtx(TyCtx), ASTCtx(ASTCtx) {
+    if (llvm::all_of(Source, [](char C) { return static_cast<unsigned char>(C) < 0x80; }))
+        return;
+    for (size_t I = 0, E = Source.size(); I != E; ++I) {
+        // Skip the continuation bytes of UTF-8.
+        if ((Source[I] & 0xC0) != 0x80)
+            CodePointOffsets.push_back(I);
+    }
 }
 
 antlrcpp::Any ASTBuilder::visitIntType(RemniwParser::IntTypeContext *Ctx) {
@@ -53,83 +61,76 @@ antlrcpp::Any ASTBuilder::visitArrayType(RemniwParser::ArrayTypeContext *Ctx) {
     return nullptr;
 }
 
-antlrcpp::Any ASTBuilder::visitProgram(RemniwParser::ProgramContext *Ctx) {
-    std::vector<RemniwParser::FunContext *> FunctionContexts = Ctx->fun();
-    for (unsigned i = 0; i < FunctionContexts.size(); ++i) {
-        auto Function = visitFunctionPrototype(FunctionContexts[i]);
-        Functions.push_back(std::move(Function));
-    }
-    for (unsigned i = 0; i < FunctionContexts.size(); ++i) {
-        visitFunctionBody(FunctionContexts[i], Functions[i].get());
-    }
-    return std::make_unique<ProgramAST>(std::move(Functions));
-}
-
-std::unique_ptr<FunctionDeclAST>
-ASTBuilder::visitFunctionPrototype(RemniwParser::FunContext *Ctx) {
+void ASTBuilder::addFunctionPrototype(antlr4::Token *Func,
+                                      RemniwParser::IdContext *IdCtx,
+                                      RemniwParser::ParametersContext *ParamsCtx,
+                                      RemniwParser::ScalarTypeContext *RetTyCtx) {
     // function name
-    std::string FuncName = Ctx->id()->IDENTIFIER()->getText();
+    std::string FuncName = IdCtx->IDENTIFIER()->getText();
     // paramters type
     std::vector<Type *> ParamTypes;
-    assert(Ctx->parameters()->id().size() == Ctx->parameters()->paramType().size());
-    for (std::size_t i = 0; i < Ctx->parameters()->id().size(); ++i) {
-        auto *TypeCtx = Ctx->parameters()->paramType(i);
+    assert(ParamsCtx->id().size() == ParamsCtx->paramType().size());
+    for (auto *TypeCtx : ParamsCtx->paramType()) {
         visit(TypeCtx);
         ParamTypes.push_back(visitedType);
     }
     // return type
-    visit(Ctx->scalarType());
+    visit(RetTyCtx);
     Type *ReturnType = visitedType;
     // create function ast node
-    auto Function = std::make_unique<FunctionDeclAST>(
-        SourceLocation {Ctx->getStart()->getLine(),
-                        Ctx->getStart()->getCharPositionInLine()},
-        FuncName, Type::getFunctionType(ParamTypes, ReturnType));
-    return Function;
+    auto Function = ASTCtx.create<FunctionDeclAST>(
+        getLoc(Func), ASTCtx.getIdentifier(FuncName),
+        Type::getFunctionType(ParamTypes, ReturnType));
+    Functions.push_back(Function);
+    Scope.addFunction(Function);
 }
 
-void ASTBuilder::visitFunctionBody(RemniwParser::FunContext *Ctx,
-                                   FunctionDeclAST *Function) {
-    CurrentFunction = Function;
+ProgramAST *ASTBuilder::getProgram() {
+    return ASTCtx.create<ProgramAST>(ASTCtx.copyArray(Functions));
+}
+
+void ASTBuilder::addFunctionBody(RemniwParser::FunContext *Ctx, size_t I) {
+    FunctionDeclAST *Function = Functions[I];
     // param declarations
-    std::vector<std::unique_ptr<VarDeclAST>> ParamDecls;
+    llvm::SmallVector<VarDeclAST *, 8> ParamDecls;
     assert(Ctx->parameters()->id().size() == Ctx->parameters()->paramType().size());
     for (std::size_t i = 0; i < Ctx->parameters()->id().size(); ++i) {
         auto *IdCtx = Ctx->parameters()->id(i);
         auto *TypeCtx = Ctx->parameters()->paramType(i);
         visit(TypeCtx);
-        auto ParamDecl = std::make_unique<VarDeclAST>(
-            SourceLocation {IdCtx->getStart()->getLine(),
-                            IdCtx->getStart()->getCharPositionInLine()},
-            IdCtx->IDENTIFIER()->getText(), visitedType);
-        ParamDecls.push_back(std::move(ParamDecl));
+        auto ParamDecl = ASTCtx.create<VarDeclAST>(
+            getLoc(IdCtx->getStart()),
+            ASTCtx.getIdentifier(IdCtx->IDENTIFIER()->getText()), visitedType);
+        ParamDecls.push_back(ParamDecl);
+        Scope.addVariable(ParamDecl);
     }
-    Function->setParamDecls(std::move(ParamDecls));
+    Function->setParamDecls(ASTCtx.copyArray(ParamDecls));
     // var declarations
-    std::vector<std::unique_ptr<VarDeclAST>> Vars;
+    llvm::SmallVector<VarDeclAST *, 8> Vars;
     for (auto *VarDeclCtx : Ctx->varDeclarations()) {
         visit(VarDeclCtx->varType());
         for (auto *VarCtx : VarDeclCtx->id()) {
-            auto Var = std::make_unique<VarDeclAST>(
-                SourceLocation {VarCtx->getStart()->getLine(),
-                                VarCtx->getStart()->getCharPositionInLine()},
-                VarCtx->IDENTIFIER()->getText(), visitedType);
-            Vars.push_back(std::move(Var));
+            auto Var = ASTCtx.create<VarDeclAST>(
+                getLoc(VarCtx->getStart()),
+                ASTCtx.getIdentifier(VarCtx->IDENTIFIER()->getText()), visitedType);
+            Vars.push_back(Var);
+            Scope.addVariable(Var);
         }
     }
     auto LocalVarDecls =
-        std::make_unique<LocalVarDeclStmtAST>(SourceLocation {0, 0}, std::move(Vars));
-    Function->setLocalVarDecls(std::move(LocalVarDecls));
+        ASTCtx.create<LocalVarDeclStmtAST>(SourceLocation {}, ASTCtx.copyArray(Vars));
+    Function->setLocalVarDecls(LocalVarDecls);
     // function body
-    std::vector<std::unique_ptr<StmtAST>> Body;
+    llvm::SmallVector<StmtAST *, 8> Body;
     for (auto *StmtCtx : Ctx->stmt()) {
         visit(StmtCtx);
-        Body.push_back(std::move(visitedStmt));
+        Body.push_back(visitedStmt);
     }
-    Function->setBody(std::move(Body));
+    Function->setBody(ASTCtx.copyArray(Body));
     // return statement
     visit(Ctx->returnStmt());
-    Function->setReturnStmt(std::move(visitedReturnStmt));
+    Function->setReturnStmt(visitedReturnStmt);
+    Scope.leaveFunction();
 }
 
 template<typename T>
@@ -151,16 +152,14 @@ antlrcpp::Any ASTBuilder::visitBinaryExpr(T *Ctx) {
     };
     exprIsLValue = false;
     visit(Ctx->expr(0));
-    std::unique_ptr<ExprAST> LHS = std::move(visitedExpr);
+    ExprAST *LHS = visitedExpr;
     exprIsLValue = false;
     visit(Ctx->expr(1));
-    std::unique_ptr<ExprAST> RHS = std::move(visitedExpr);
+    ExprAST *RHS = visitedExpr;
     // The type of BinaryExpr is same as the type of LHS and the type of RHS.
     auto *Ty = LHS->getType();
-    visitedExpr = std::make_unique<BinaryExprAST>(
-        SourceLocation {Ctx->getStart()->getLine(),
-                        Ctx->getStart()->getCharPositionInLine()},
-        Ty, ParserBinOpToASTBinOp(Ctx->op->getType()), std::move(LHS), std::move(RHS));
+    visitedExpr = ASTCtx.create<BinaryExprAST>(
+        getLoc(Ctx->getStart()), Ty, ParserBinOpToASTBinOp(Ctx->op->getType()), LHS, RHS);
     return nullptr;
 }
 
@@ -188,12 +187,8 @@ antlrcpp::Any ASTBuilder::visitIdExpr(RemniwParser::IdExprContext *Ctx) {
 
 antlrcpp::Any ASTBuilder::visitId(RemniwParser::IdContext *Ctx) {
     bool LValue = exprIsLValue;
-    std::string Name = Ctx->IDENTIFIER()->getText();
-    auto *Decl = lookupDeclInScope(Name);
-    visitedExpr = std::make_unique<DeclRefExprAST>(
-        SourceLocation {Ctx->getStart()->getLine(),
-                        Ctx->getStart()->getCharPositionInLine()},
-        Ctx->IDENTIFIER()->getText(), Decl, LValue);
+    auto *Decl = Scope.lookup(ASTCtx.getIdentifier(Ctx->IDENTIFIER()->getText()));
+    visitedExpr = ASTCtx.create<DeclRefExprAST>(getLoc(Ctx->getStart()), Decl, LValue);
     return nullptr;
 }
 
@@ -204,16 +199,12 @@ antlrcpp::Any ASTBuilder::visitIntExpr(RemniwParser::IntExprContext *Ctx) {
     auto Val = std::strtoll(S.c_str(), nullptr, 10);
     if (errno == 0 && Val >= std::numeric_limits<int64_t>::min() &&
         Val <= std::numeric_limits<int64_t>::max()) {
-        visitedExpr = std::make_unique<NumberExprAST>(
-            SourceLocation {Ctx->getStart()->getLine(),
-                            Ctx->getStart()->getCharPositionInLine()},
-            Type::getIntType(TyCtx), Val);
+        visitedExpr = ASTCtx.create<NumberExprAST>(
+            getLoc(Ctx->getStart()), Type::getIntType(TyCtx), Val);
     } else {
         // integer falls out of range int64_t
-        visitedExpr = std::make_unique<NumberExprAST>(
-            SourceLocation {Ctx->getStart()->getLine(),
-                            Ctx->getStart()->getCharPositionInLine()},
-            Type::getIntType(TyCtx), Val);
+        visitedExpr = ASTCtx.create<NumberExprAST>(
+            getLoc(Ctx->getStart()), Type::getIntType(TyCtx), Val);
     }
     return nullptr;
 }
@@ -225,31 +216,22 @@ antlrcpp::Any ASTBuilder::visitNegIntExpr(RemniwParser::NegIntExprContext *Ctx)
     auto Val = std::strtoll(S.c_str(), nullptr, 10);
     if (errno == 0 && Val >= std::numeric_limits<int64_t>::min() &&
         Val <= std::numeric_limits<int64_t>::max()) {
-        visitedExpr = std::make_unique<NumberExprAST>(
-            SourceLocation {Ctx->getStart()->getLine(),
-                            Ctx->getStart()->getCharPositionInLine()},
-            Type::getIntType(TyCtx), Val);
+        visitedExpr = ASTCtx.create<NumberExprAST>(
+            getLoc(Ctx->getStart()), Type::getIntType(TyCtx), Val);
     } else {
         // integer falls out of range int64_t
-        visitedExpr = std::make_unique<NumberExprAST>(
-            SourceLocation {Ctx->getStart()->getLine(),
-                            Ctx->getStart()->getCharPositionInLine()},
-            Type::getIntType(TyCtx), Val);
+        visitedExpr = ASTCtx.create<NumberExprAST>(
+            getLoc(Ctx->getStart()), Type::getIntType(TyCtx), Val);
     }
     return nullptr;
 }
 
 antlrcpp::Any ASTBuilder::visitAddrOfExpr(RemniwParser::AddrOfExprContext *Ctx) {
-    auto *Decl = lookupDeclInScope(Ctx->id()->IDENTIFIER()->getText());
-    auto Var = std::make_unique<DeclRefExprAST>(
-        SourceLocation {Ctx->id()->getStart()->getLine(),
-                        Ctx->id()->getStart()->getCharPositionInLine()},
-        Ctx->id()->IDENTIFIER()->getText(), Decl, /*LValue*/ true);
+    auto *Decl = Scope.lookup(ASTCtx.getIdentifier(Ctx->id()->IDENTIFIER()->getText()));
+    auto Var = ASTCtx.create<DeclRefExprAST>(getLoc(Ctx->id()->getStart()), Decl,
+                                             /*LValue*/ true);
     auto *Ty = Decl->getType()->getPointerTo();
-    visitedExpr = std::make_unique<AddrOfExprAST>(
-        SourceLocation {Ctx->getStart()->getLine(),
-                        Ctx->getStart()->getCharPositionInLine()},
-        Ty, std::move(Var));
+    visitedExpr = ASTCtx.create<AddrOfExprAST>(getLoc(Ctx->getStart()), Ty, Var);
     return nullptr;
 }
 
@@ -259,10 +241,8 @@ antlrcpp::Any ASTBuilder::visitDerefExpr(RemniwParser::DerefExprContext *Ctx) {
     // If DerefExpr is rvalue, then the Ptr expr of DerefExpr is rvalue.
     visit(Ctx->expr());
     auto *Ty = visitedExpr->getType()->getPointerPointeeType();
-    visitedExpr = std::make_unique<DerefExprAST>(
-        SourceLocation {Ctx->getStart()->getLine(),
-                        Ctx->getStart()->getCharPositionInLine()},
-        Ty, LValue, std::move(visitedExpr));
+    visitedExpr = ASTCtx.create<DerefExprAST>(
+        getLoc(Ctx->getStart()), Ty, LValue, visitedExpr);
     return nullptr;
 }
 
@@ -271,15 +251,13 @@ ASTBuilder::visitArraySubscriptExpr(RemniwParser::ArraySubscriptExprContext *Ctx
     bool LValue = exprIsLValue;
     exprIsLValue = true;
     visit(Ctx->expr(0));
-    std::unique_ptr<ExprAST> Base = std::move(visitedExpr);
+    ExprAST *Base = visitedExpr;
     exprIsLValue = false;
     visit(Ctx->expr(1));
-    std::unique_ptr<ExprAST> Selector = std::move(visitedExpr);
+    ExprAST *Selector = visitedExpr;
     auto *Ty = Base->getType()->getArrayElementType();
-    visitedExpr = std::make_unique<ArraySubscriptExprAST>(
-        SourceLocation {Ctx->getStart()->getLine(),
-                        Ctx->getStart()->getCharPositionInLine()},
-        Ty, LValue, std::move(Base), std::move(Selector));
+    visitedExpr = ASTCtx.create<ArraySubscriptExprAST>(
+        getLoc(Ctx->getStart()), Ty, LValue, Base, Selector);
     return nullptr;
 }
 
@@ -291,18 +269,16 @@ antlrcpp::Any ASTBuilder::visitParenExpr(RemniwParser::ParenExprContext *Ctx) {
 antlrcpp::Any ASTBuilder::visitFuncCallExpr(RemniwParser::FuncCallExprContext *Ctx) {
     exprIsLValue = false;
     visit(Ctx->expr());
-    std::unique_ptr<ExprAST> Callee = std::move(visitedExpr);
-    std::vector<std::unique_ptr<ExprAST>> Args;
+    ExprAST *Callee = visitedExpr;
+    llvm::SmallVector<ExprAST *, 8> Args;
     for (auto *Arg : Ctx->arguments()->expr()) {
         exprIsLValue = false;
         visit(Arg);
-        Args.push_back(std::move(visitedExpr));
+        Args.push_back(visitedExpr);
     }
     auto *Ty = Callee->getType()->getFunctionReturnType();
-    visitedExpr = std::make_unique<FunctionCallExprAST>(
-        SourceLocation {Ctx->getStart()->getLine(),
-                        Ctx->getStart()->getCharPositionInLine()},
-        Ty, std::move(Callee), std::move(Args));
+    visitedExpr = ASTCtx.create<FunctionCallExprAST>(
+        getLoc(Ctx->getStart()), Ty, Callee, ASTCtx.copyArray(Args));
     return nullptr;
 }
 
@@ -319,111 +295,87 @@ antlrcpp::Any ASTBuilder::visitFuncCallExpr(RemniwParser::FuncCallExprContext *C
 // }
 
 antlrcpp::Any ASTBuilder::visitNullExpr(RemniwParser::NullExprContext *Ctx) {
-    visitedExpr = std::make_unique<NullExprAST>(SourceLocation {
-        Ctx->getStart()->getLine(), Ctx->getStart()->getCharPositionInLine()});
+    visitedExpr = ASTCtx.create<NullExprAST>(getLoc(Ctx->getStart()));
     return nullptr;
 }
 
 antlrcpp::Any ASTBuilder::visitSizeofExpr(RemniwParser::SizeofExprContext *Ctx) {
     visit(Ctx->varType());
-    visitedExpr = std::make_unique<SizeofExprAST>(
-        SourceLocation {Ctx->getStart()->getLine(),
-                        Ctx->getStart()->getCharPositionInLine()},
-        Type::getIntType(TyCtx), visitedType);
+    visitedExpr = ASTCtx.create<SizeofExprAST>(
+        getLoc(Ctx->getStart()), Type::getIntType(TyCtx), visitedType);
     return nullptr;
 }
 
 antlrcpp::Any ASTBuilder::visitInputExpr(RemniwParser::InputExprContext *Ctx) {
-    visitedExpr = std::make_unique<InputExprAST>(
-        SourceLocation {Ctx->getStart()->getLine(),
-                        Ctx->getStart()->getCharPositionInLine()},
-        Type::getIntType(TyCtx));
+    visitedExpr = ASTCtx.create<InputExprAST>(
+        getLoc(Ctx->getStart()), Type::getIntType(TyCtx));
     return nullptr;
 }
 
 antlrcpp::Any ASTBuilder::visitEmptyStmt(RemniwParser::EmptyStmtContext *Ctx) {
-    visitedStmt = std::make_unique<EmptyStmtAST>(SourceLocation {
-        Ctx->getStart()->getLine(), Ctx->getStart()->getCharPositionInLine()});
+    visitedStmt = ASTCtx.create<EmptyStmtAST>(getLoc(Ctx->getStart()));
     return nullptr;
 }
 
 antlrcpp::Any ASTBuilder::visitOutputStmt(RemniwParser::OutputStmtContext *Ctx) {
     exprIsLValue = false;
     visit(Ctx->expr());
-    visitedStmt = std::make_unique<OutputStmtAST>(
-        SourceLocation {Ctx->getStart()->getLine(),
-                        Ctx->getStart()->getCharPositionInLine()},
-        std::move(visitedExpr));
+    visitedStmt = ASTCtx.create<OutputStmtAST>(getLoc(Ctx->getStart()), visitedExpr);
     return nullptr;
 }
 
 antlrcpp::Any ASTBuilder::visitAllocStmt(RemniwParser::AllocStmtContext *Ctx) {
     exprIsLValue = true;
     visit(Ctx->expr(0));
-    std::unique_ptr<ExprAST> Ptr = std::move(visitedExpr);
+    ExprAST *Ptr = visitedExpr;
     exprIsLValue = false;
     visit(Ctx->expr(1));
-    std::unique_ptr<ExprAST> Size = std::move(visitedExpr);
-    visitedStmt = std::make_unique<AllocStmtAST>(
-        SourceLocation {Ctx->getStart()->getLine(),
-                        Ctx->getStart()->getCharPositionInLine()},
-        std::move(Ptr), std::move(Size));
+    ExprAST *Size = visitedExpr;
+    visitedStmt = ASTCtx.create<AllocStmtAST>(getLoc(Ctx->getStart()), Ptr, Size);
     return nullptr;
 }
 
 antlrcpp::Any ASTBuilder::visitDeallocStmt(RemniwParser::DeallocStmtContext *Ctx) {
     exprIsLValue = false;
     visit(Ctx->expr());
-    visitedStmt = std::make_unique<DeallocStmtAST>(
-        SourceLocation {Ctx->getStart()->getLine(),
-                        Ctx->getStart()->getCharPositionInLine()},
-        std::move(visitedExpr));
+    visitedStmt = ASTCtx.create<DeallocStmtAST>(getLoc(Ctx->getStart()), visitedExpr);
     return nullptr;
 }
 
 antlrcpp::Any ASTBuilder::visitBlockStmt(RemniwParser::BlockStmtContext *Ctx) {
-    std::vector<std::unique_ptr<StmtAST>> Stmts;
+    llvm::SmallVector<StmtAST *, 8> Stmts;
     for (auto *StmtCtx : Ctx->stmt()) {
         visit(StmtCtx);
-        Stmts.push_back(std::move(visitedStmt));
+        Stmts.push_back(visitedStmt);
     }
-    visitedStmt = std::make_unique<BlockStmtAST>(
-        SourceLocation {Ctx->getStart()->getLine(),
-                        Ctx->getStart()->getCharPositionInLine()},
-        std::move(Stmts));
+    visitedStmt = ASTCtx.create<BlockStmtAST>(
+        getLoc(Ctx->getStart()), ASTCtx.copyArray(Stmts));
     return nullptr;
 }
 
 antlrcpp::Any ASTBuilder::visitReturnStmt(RemniwParser::ReturnStmtContext *Ctx) {
     exprIsLValue = false;
     visit(Ctx->expr());
-    visitedReturnStmt = std::make_unique<ReturnStmtAST>(
-        SourceLocation {Ctx->getStart()->getLine(),
-                        Ctx->getStart()->getCharPositionInLine()},
-        std::move(visitedExpr));
+    visitedReturnStmt = ASTCtx.create<ReturnStmtAST>(
+        getLoc(Ctx->getStart()), visitedExpr);
     return nullptr;
 }
 
 antlrcpp::Any ASTBuilder::visitIfStmt(RemniwParser::IfStmtContext *Ctx) {
     exprIsLValue = false;
     visit(Ctx->expr());
-    std::unique_ptr<ExprAST> Cond = std::move(visitedExpr);
+    ExprAST *Cond = visitedExpr;
     if (Ctx->stmt().size() == 2) {
         visit(Ctx->stmt(0));
-        std::unique_ptr<StmtAST> Then = std::move(visitedStmt);
+        StmtAST *Then = visitedStmt;
         visit(Ctx->stmt(1));
-        std::unique_ptr<StmtAST> Else = std::move(visitedStmt);
-        visitedStmt = std::make_unique<IfStmtAST>(
-            SourceLocation {Ctx->getStart()->getLine(),
-                            Ctx->getStart()->getCharPositionInLine()},
-            std::move(Cond), std::move(Then), std::move(Else));
+        StmtAST *Else = visitedStmt;
+        visitedStmt = ASTCtx.create<IfStmtAST>(getLoc(Ctx->getStart()), Cond, Then, Else);
     } else if (Ctx->stmt().size() == 1) {
         visit(Ctx->stmt(0));
-        std::unique_ptr<StmtAST> Then = std::move(visitedStmt);
-        visitedStmt = std::make_unique<IfStmtAST>(
-            SourceLocation {Ctx->getStart()->getLine(),
-                            Ctx->getStart()->getCharPositionInLine()},
-            std::move(Cond), std::move(Then), nullptr);
+        StmtAST *Then = visitedStmt;
+        visitedStmt = ASTCtx.create<IfStmtAST>(
+            getLoc(Ctx->getStart()), Cond, Then, nullptr);
     } else {
         assert(0 && "Unexpected IfStmtContext stmt().size()");
     }
@@ -433,43 +385,21 @@ antlrcpp::Any ASTBuilder::visitIfStmt(RemniwParser::IfStmtContext *Ctx) {
 antlrcpp::Any ASTBuilder::visitWhileStmt(RemniwParser::WhileStmtContext *Ctx) {
     exprIsLValue = false;
     visit(Ctx->expr());
-    std::unique_ptr<ExprAST> Cond = std::move(visitedExpr);
+    ExprAST *Cond = visitedExpr;
     visit(Ctx->stmt());
-    std::unique_ptr<StmtAST> Body = std::move(visitedStmt);
-    visitedStmt = std::make_unique<WhileStmtAST>(
-        SourceLocation {Ctx->getStart()->getLine(),
-                        Ctx->getStart()->getCharPositionInLine()},
-        std::move(Cond), std::move(Body));
+    StmtAST *Body = visitedStmt;
+    visitedStmt = ASTCtx.create<WhileStmtAST>(getLoc(Ctx->getStart()), Cond, Body);
     return nullptr;
 }
 
 antlrcpp::Any ASTBuilder::visitAssignmentStmt(RemniwParser::AssignmentStmtContext *Ctx) {
     exprIsLValue = true;
     visit(Ctx->expr(0));
-    std::unique_ptr<ExprAST> LHS = std::move(visitedExpr);
+    ExprAST *LHS = visitedExpr;
     exprIsLValue = false;
     visit(Ctx->expr(1));
-    std::unique_ptr<ExprAST> RHS = std::move(visitedExpr);
-    visitedStmt = std::make_unique<AssignmentStmtAST>(
-        SourceLocation {Ctx->getStart()->getLine(),
-                        Ctx->getStart()->getCharPositionInLine()},
-        std::move(LHS), std::move(RHS));
-    return nullptr;
-}
-
-DeclAST *ASTBuilder::lookupDeclInScope(std::string Name) {
-    for (auto *Param : CurrentFunction->getParamDecls()) {
-        if (Param->getName().equals(Name))
-            return Param;
-    }
-    for (auto *LocalVar : CurrentFunction->getLocalVarDecls()->getVars()) {
-        if (LocalVar->getName().equals(Name))
-            return LocalVar;
-    }
-    for (const auto &Function : Functions) {
-        if (Function->getName().equals(Name))
-            return Function.get();
-    }
+    ExprAST *RHS = visitedExpr;
+    visitedStmt = ASTCtx.create<AssignmentStmtAST>(getLoc(Ctx->getStart()), LHS, RHS);
     return nullptr;
 }
 
@@ -3,6 +3,7 @@
 #include "RemniwBaseVisitor.h"
 #include "antlr4-runtime.h"
 #include "frontend/AST.h"
+#include "frontend/Scope.h"
 #include "frontend/Type.h"
 #include <memory>
 
@@ -11,13 +12,34 @@ namespace remniw {
 class ASTBuilder: public RemniwBaseVisitor {
 private:
     TypeContext &TyCtx;
-    std::vector<std::unique_ptr<FunctionDeclAST>> Functions;
-    FunctionDeclAST *CurrentFunction = nullptr;
+    ASTContext &ASTCtx;
+    std::vector<FunctionDeclAST *> Functions;
+    DeclScope Scope;
+    // The byte offset of each code point of the source, if it is not ASCII.
+    std::vector<uint32_t> CodePointOffsets;
+
+    // ANTLR indexes the code points of the source, convert to a byte offset.
+    SourceLocation getLoc(antlr4::Token *Tok) const {
+        size_t Index = Tok->getStartIndex();
+        return SourceLocation {static_cast<uint32_t>(
+            CodePointOffsets.empty() ? Index : CodePointOffsets[Index])};
+    }
 
 public:
-    ASTBuilder(TypeContext &TyCtx): TyCtx(TyCtx) {}
+    ASTBuilder(TypeContext &TyCtx, ASTContext &ASTCtx, llvm::StringRef Source);
 
-    std::unique_ptr<ProgramAST> build(RemniwParser::ProgramContext *Ctx);
+    // Add the prototype of a function from its header `func Id Params RetTy`, so the
+    // bodies of all functions can refer to it. Func is the `func` token.
+    void addFunctionPrototype(antlr4::Token *Func, RemniwParser::IdContext *IdCtx,
+                              RemniwParser::ParametersContext *ParamsCtx,
+                              RemniwParser::ScalarTypeContext *RetTyCtx);
+
+    // Add the body of the I-th function, whose prototype has been added.
+    void addFunctionBody(RemniwParser::FunContext *Ctx, size_t I);
+
+    size_t getNumFunctions() const { return Functions.size(); }
+
+    ProgramAST *getProgram();
 
     virtual antlrcpp::Any visitIntType(RemniwParser::IntTypeContext *Ctx);
 
@@ -33,8 +55,6 @@ public:
 
     // virtual antlrcpp::Any visitParamType(RemniwParser::ParamTypeContext *Ctx);
 
-    virtual antlrcpp::Any visitProgram(RemniwParser::ProgramContext *Ctx);
-
     // virtual antlrcpp::Any visitFun(RemniwParser::FunContext *Ctx);
 
     virtual antlrcpp::Any
@@ -100,10 +120,6 @@ public:
 private:
     template<typename T>
     antlrcpp::Any visitBinaryExpr(T *ctx);
-    std::unique_ptr<FunctionDeclAST>
-    visitFunctionPrototype(RemniwParser::FunContext *Ctx);
-    void visitFunctionBody(RemniwParser::FunContext *Ctx, FunctionDeclAST *Function);
-    DeclAST *lookupDeclInScope(std::string Name);
 };
 
 }  // namespace remniw
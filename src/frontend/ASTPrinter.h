@@ -1,7 +1,9 @@
 #pragma once
 
 #include "frontend/RecursiveASTVisitor.h"
+#include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/raw_ostream.h"
+#include <string>
 
 namespace remniw {
 
@@ -9,23 +11,39 @@ class ASTPrinter: public RecursiveASTVisitor<ASTPrinter> {
 private:
     unsigned Ind;
     llvm::raw_ostream &Out;
+    const llvm::SourceMgr &SrcMgr;
+
+    // The line (from 1) and the column (in bytes, from 0) of Node in the main file of
+    // SrcMgr, or 0:0 if Node has no location.
+    std::string getLoc(ASTNode *Node) const {
+        SourceLocation Loc = Node->getLoc();
+        if (!Loc.isValid())
+            return "0:0";
+        unsigned MainFileID = SrcMgr.getMainFileID();
+        const char *Ptr =
+            SrcMgr.getMemoryBuffer(MainFileID)->getBufferStart() + Loc.Offset;
+        auto LineAndCol =
+            SrcMgr.getLineAndColumn(llvm::SMLoc::getFromPointer(Ptr), MainFileID);
+        return std::to_string(LineAndCol.first) + ':' +
+               std::to_string(LineAndCol.second - 1);
+    }
 
 public:
-    ASTPrinter(llvm::raw_ostream &Out): RecursiveASTVisitor(), Ind(0), Out(Out) {}
+    ASTPrinter(llvm::raw_ostream &Out, const llvm::SourceMgr &SrcMgr):
+        RecursiveASTVisitor(), Ind(0), Out(Out), SrcMgr(SrcMgr) {}
 
     void print(ProgramAST *AST) { visitProgram(AST); }
 
     bool actBeforeVisitVarDeclNode(VarDeclAST *Node) {
         Out.indent(Ind) << "VarDecl " << Node << " '" << Node->getName() << "' "
-                        << *Node->getType() << " <" << Node->getLine() << ':'
-                        << Node->getCol() << ">\n";
+                        << *Node->getType() << " <" << getLoc(Node) << ">\n";
         return false;
     }
 
     bool actBeforeVisitNumberExpr(NumberExprAST *Node) {
         Out.indent(Ind) << "NumberExpr " << Node << " '" << Node->getValue() << "' "
-                        << (Node->isLValue() ? "lvalue" : "rvalue") << " <"
-                        << Node->getLine() << ':' << Node->getCol() << "> ";
+                        << (Node->isLValue() ? "lvalue" : "rvalue")
+                        << " <" << getLoc(Node) << "> ";
         if (auto *Ty = Node->getType())
             Out << *Ty;
         Out << "\n";
@@ -34,8 +52,8 @@ public:
 
     bool actBeforeVisitDeclRefExpr(DeclRefExprAST *Node) {
         Out.indent(Ind) << "DeclRefExpr " << Node << " '" << Node->getName() << "' "
-                        << (Node->isLValue() ? "lvalue" : "rvalue") << " <"
-                        << Node->getLine() << ':' << Node->getCol() << "> ";
+                        << (Node->isLValue() ? "lvalue" : "rvalue")
+                        << " <" << getLoc(Node) << "> ";
         if (auto *Ty = Node->getType())
             Out << *Ty;
         Out << "\n";
@@ -43,8 +61,7 @@ public:
     }
 
     void visitFunctionCallExpr(FunctionCallExprAST *Node) {
-        Out.indent(Ind) << "FunctionCallExpr " << Node << " <" << Node->getLine() << ':'
-                        << Node->getCol() << ">\n";
+        Out.indent(Ind) << "FunctionCallExpr " << Node << " <" << getLoc(Node) << ">\n";
         Out.indent(Ind + 1) << "Callee:\n";
         Ind += 2;
         visitExpr(Node->getCallee());
@@ -58,15 +75,15 @@ public:
 
     bool actBeforeVisitNullExpr(NullExprAST *Node) {
         Out.indent(Ind) << "NullExpr " << Node << ", "
-                        << (Node->isLValue() ? "lvalue" : "rvalue") << " <"
-                        << Node->getLine() << ':' << Node->getCol() << ">\n";
+                        << (Node->isLValue() ? "lvalue" : "rvalue")
+                        << " <" << getLoc(Node) << ">\n";
         return false;
     }
 
     bool actBeforeVisitAddrOfExpr(AddrOfExprAST *Node) {
         Out.indent(Ind) << "AddrOfExpr " << Node << ", "
-                        << (Node->isLValue() ? "lvalue" : "rvalue") << " <"
-                        << Node->getLine() << ':' << Node->getCol() << "> ";
+                        << (Node->isLValue() ? "lvalue" : "rvalue")
+                        << " <" << getLoc(Node) << "> ";
         if (auto *Ty = Node->getType())
             Out << *Ty;
         Out << "\n";
@@ -78,8 +95,8 @@ public:
 
     bool actBeforeVisitDerefExpr(DerefExprAST *Node) {
         Out.indent(Ind) << "DerefExpr " << Node << ", "
-                        << (Node->isLValue() ? "lvalue" : "rvalue") << " <"
-                        << Node->getLine() << ':' << Node->getCol() << "> ";
+                        << (Node->isLValue() ? "lvalue" : "rvalue")
+                        << " <" << getLoc(Node) << "> ";
         if (auto *Ty = Node->getType())
             Out << *Ty;
         Out << "\n";
@@ -91,8 +108,8 @@ public:
 
     bool actBeforeVisitArraySubscriptExpr(ArraySubscriptExprAST *Node) {
         Out.indent(Ind) << "ArraySubscriptExpr " << Node << ", "
-                        << (Node->isLValue() ? "lvalue" : "rvalue") << " <"
-                        << Node->getLine() << ':' << Node->getCol() << "> ";
+                        << (Node->isLValue() ? "lvalue" : "rvalue")
+                        << " <" << getLoc(Node) << "> ";
         if (auto *Ty = Node->getType())
             Out << *Ty;
         Out << "\n";
@@ -104,8 +121,8 @@ public:
 
     bool actBeforeVisitInputExpr(InputExprAST *Node) {
         Out.indent(Ind) << "InputExpr " << Node << ", "
-                        << (Node->isLValue() ? "lvalue" : "rvalue") << " <"
-                        << Node->getLine() << ':' << Node->getCol() << "> ";
+                        << (Node->isLValue() ? "lvalue" : "rvalue")
+                        << " <" << getLoc(Node) << "> ";
         if (auto *Ty = Node->getType())
             Out << *Ty;
         Out << "\n";
@@ -114,8 +131,8 @@ public:
 
     bool actBeforeVisitBinaryExpr(BinaryExprAST *Node) {
         Out.indent(Ind) << "BinaryExpr " << Node << " '" << Node->getOpString() << "' "
-                        << (Node->isLValue() ? "lvalue" : "rvalue") << " <"
-                        << Node->getLine() << ':' << Node->getCol() << "> ";
+                        << (Node->isLValue() ? "lvalue" : "rvalue")
+                        << " <" << getLoc(Node) << "> ";
         if (auto *Ty = Node->getType())
             Out << *Ty;
         Out << "\n";
@@ -126,8 +143,7 @@ public:
     void actAfterVisitBinaryExpr(BinaryExprAST *) { Ind -= 1; }
 
     bool actBeforeVisitLocalVarDeclStmt(LocalVarDeclStmtAST *Node) {
-        Out.indent(Ind) << "LocalVarDeclStmt " << Node << " <" << Node->getLine() << ':'
-                        << Node->getCol() << ">\n";
+        Out.indent(Ind) << "LocalVarDeclStmt " << Node << " <" << getLoc(Node) << ">\n";
         Ind += 1;
         return false;
     }
@@ -135,14 +151,12 @@ public:
     void actAfterVisitLocalVarDeclStmt(LocalVarDeclStmtAST *) { Ind -= 1; }
 
     bool actBeforeVisitEmptyStmt(EmptyStmtAST *Node) {
-        Out.indent(Ind) << "EmptyStmt " << Node << " <" << Node->getLine() << ':'
-                        << Node->getCol() << ">\n";
+        Out.indent(Ind) << "EmptyStmt " << Node << " <" << getLoc(Node) << ">\n";
         return false;
     }
 
     bool actBeforeVisitOutputStmt(OutputStmtAST *Node) {
-        Out.indent(Ind) << "OutputStmt " << Node << " <" << Node->getLine() << ':'
-                        << Node->getCol() << ">\n";
+        Out.indent(Ind) << "OutputStmt " << Node << " <" << getLoc(Node) << ">\n";
         Ind += 1;
         return false;
     }
@@ -150,8 +164,7 @@ public:
     void actAfterVisitOutputStmt(OutputStmtAST *) { Ind -= 1; }
 
     bool actBeforeVisitAllocStmt(AllocStmtAST *Node) {
-        Out.indent(Ind) << "AllocStmt " << Node << " <" << Node->getLine() << ':'
-                        << Node->getCol() << ">\n";
+        Out.indent(Ind) << "AllocStmt " << Node << " <" << getLoc(Node) << ">\n";
         Ind += 1;
         return false;
     }
@@ -159,8 +172,7 @@ public:
     void actAfterVisitAllocStmt(AllocStmtAST *) { Ind -= 1; }
 
     bool actBeforeVisitDeallocStmt(DeallocStmtAST *Node) {
-        Out.indent(Ind) << "DeallocStmt " << Node << " <" << Node->getLine() << ':'
-                        << Node->getCol() << ">\n";
+        Out.indent(Ind) << "DeallocStmt " << Node << " <" << getLoc(Node) << ">\n";
         Ind += 1;
         return false;
     }
@@ -168,8 +180,7 @@ public:
     void actAfterVisitDeallocStmt(DeallocStmtAST *) { Ind -= 1; }
 
     bool actBeforeVisitBlockStmtAST(BlockStmtAST *Node) {
-        Out.indent(Ind) << "BlockStmt " << Node << " <" << Node->getLine() << ':'
-                        << Node->getCol() << ">\n";
+        Out.indent(Ind) << "BlockStmt " << Node << " <" << getLoc(Node) << ">\n";
         Ind += 1;
         return false;
     }
@@ -177,8 +188,7 @@ public:
     void actAfterVisitBlockStmtAST(BlockStmtAST *) { Ind -= 1; }
 
     bool actBeforeVisitReturnStmt(ReturnStmtAST *Node) {
-        Out.indent(Ind) << "ReturnStmt " << Node << " <" << Node->getLine() << ':'
-                        << Node->getCol() << ">\n";
+        Out.indent(Ind) << "ReturnStmt " << Node << " <" << getLoc(Node) << ">\n";
         Ind += 1;
         return false;
     }
@@ -186,8 +196,7 @@ public:
     void actAfterVisitReturnStmt(ReturnStmtAST *) { Ind -= 1; }
 
     void visitIfStmt(IfStmtAST *Node) {
-        Out.indent(Ind) << "IfStmt " << Node << " <" << Node->getLine() << ':'
-                        << Node->getCol() << ">\n";
+        Out.indent(Ind) << "IfStmt " << Node << " <" << getLoc(Node) << ">\n";
         Out.indent(Ind + 1) << "Cond:\n";
         Ind += 2;
         visitExpr(Node->getCond());
@@ -205,8 +214,7 @@ public:
     }
 
     void visitWhileStmt(WhileStmtAST *Node) {
-        Out.indent(Ind) << "WhileStmt" << Node << " <" << Node->getLine() << ':'
-                        << Node->getCol() << ">\n";
+        Out.indent(Ind) << "WhileStmt" << Node << " <" << getLoc(Node) << ">\n";
         Out.indent(Ind + 1) << "Cond:\n";
         Ind += 2;
         visitExpr(Node->getCond());
@@ -218,8 +226,7 @@ public:
     }
 
     bool actBeforeVisitAssignmentStmt(AssignmentStmtAST *Node) {
-        Out.indent(Ind) << "AssignmentStmt " << Node << " <" << Node->getLine() << ':'
-                        << Node->getCol() << ">\n";
+        Out.indent(Ind) << "AssignmentStmt " << Node << " <" << getLoc(Node) << ">\n";
         Ind += 1;
         return false;
     }
@@ -228,8 +235,7 @@ public:
 
     void visitFunction(FunctionDeclAST *Node) {
         Out.indent(Ind) << "Function " << Node << " '" << Node->getName() << "' "
-                        << *Node->getType() << " <" << Node->getLine() << ':'
-                        << Node->getCol() << ">\n";
+                        << *Node->getType() << " <" << getLoc(Node) << ">\n";
         Out.indent(Ind + 1) << "ParamDecls:\n";
         Ind += 2;
         for (auto *ParmDecl : Node->getParamDecls())
@@ -3,7 +3,11 @@
 #include "RemniwParser.h"
 #include "antlr4-runtime.h"
 #include "frontend/ASTBuilder.h"
+#include "frontend/Parser.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/ErrorHandling.h"
+#include <memory>
+#include <string>
 
 using namespace antlr4;
 
@@ -11,29 +15,173 @@ using namespace antlr4;
 
 namespace remniw {
 
-std::unique_ptr<ProgramAST> FrontEnd::parse(std::istream& Stream) {
-    ANTLRInputStream Input(Stream);
+namespace {
+
+// Parses a program one function at a time. The parse trees are owned by the parser
+// and only freed by Parser::reset(), so the parser is reset before each function and
+// the parse tree of a function lives only until its AST has been built.
+//
+// Each parse first runs with SLL prediction and the BailErrorStrategy. SLL prediction
+// is much faster than full LL(*) prediction and it only fails on syntax errors or on
+// the rare inputs which need the full context, so only then the input is parsed again
+// with LL prediction. Syntax errors are not reported here, the program is parsed
+// again with error recovery then, see FrontEnd::parseWithANTLR.
+class TwoStageParser {
+private:
+    CommonTokenStream &Tokens;
+    RemniwParser Parser;
+    size_t LBraceType;
+    size_t RBraceType;
+    size_t FuncType;
+
+    size_t getLiteralType(const std::string &Literal) const {
+        const dfa::Vocabulary &Vocab = Parser.getVocabulary();
+        for (size_t Type = 1; Type <= Vocab.getMaxTokenType(); ++Type) {
+            if (Vocab.getLiteralName(Type) == "'" + Literal + "'")
+                return Type;
+        }
+        llvm_unreachable("Unknown literal token");
+    }
+
+    // Free the parse trees built so far and continue parsing at the token Index.
+    void reset(size_t Index) {
+        Parser.reset();
+        Tokens.seek(Index);
+    }
+
+    // Run Parse at the current token, which calls rules of the parser, first with SLL
+    // prediction. Only if that fails, Parse runs again with LL prediction. Returns
+    // false on syntax errors.
+    template<typename ParseFn>
+    bool parse(ParseFn Parse) {
+        size_t Start = Tokens.index();
+        reset(Start);
+        auto *Interpreter = Parser.getInterpreter<atn::ParserATNSimulator>();
+        Interpreter->setPredictionMode(atn::PredictionMode::SLL);
+        Parser.removeErrorListeners();
+        Parser.setErrorHandler(std::make_shared<BailErrorStrategy>());
+        try {
+            Parse();
+            return true;
+        } catch (ParseCancellationException &) {
+        }
+
+        reset(Start);
+        Interpreter->setPredictionMode(atn::PredictionMode::LL);
+        try {
+            Parse();
+            return true;
+        } catch (ParseCancellationException &) {
+        }
+        return false;
+    }
+
+    // Parse the headers of all functions and skip their bodies by matching braces,
+    // so a body can refer to the functions defined after it. Returns false on
+    // syntax errors.
+    bool parsePrototypes(ASTBuilder &Builder) {
+        reset(0);
+        while (Tokens.LA(1) == FuncType) {
+            bool Parsed = parse(
+                [&] {
+                    // fun: 'func' id parameters scalarType '{' ...
+                    antlr4::Token *Func = Tokens.LT(1);
+                    Tokens.consume();
+                    auto *IdCtx = Parser.id();
+                    auto *ParamsCtx = Parser.parameters();
+                    auto *RetTyCtx = Parser.scalarType();
+                    Builder.addFunctionPrototype(Func, IdCtx, ParamsCtx, RetTyCtx);
+                });
+            if (!Parsed || Tokens.LA(1) != LBraceType)
+                return false;
+            for (size_t Depth = 0;;) {
+                size_t Type = Tokens.LA(1);
+                if (Type == antlr4::Token::EOF)
+                    return false;
+                Tokens.consume();
+                if (Type == LBraceType)
+                    ++Depth;
+                else if (Type == RBraceType && --Depth == 0)
+                    break;
+            }
+        }
+        return Tokens.LA(1) == antlr4::Token::EOF;
+    }
+
+public:
+    TwoStageParser(CommonTokenStream &Tokens):
+        Tokens(Tokens), Parser(&Tokens), LBraceType(getLiteralType("{")),
+        RBraceType(getLiteralType("}")), FuncType(getLiteralType("func")) {}
+
+    // Returns nullptr on syntax errors.
+    ProgramAST *parseProgram(ASTBuilder &Builder) {
+        if (!parsePrototypes(Builder))
+            return nullptr;
+        reset(0);
+        // program: fun+
+        size_t NumFunctions = 0;
+        do {
+            RemniwParser::FunContext *FunCtx = nullptr;
+            if (!parse([&] { FunCtx = Parser.fun(); }))
+                return nullptr;
+            LLVM_DEBUG({
+                llvm::outs() << "===== Parser ===== \n";
+                llvm::outs() << FunCtx->toStringTree(&Parser, true) << "\n";
+            });
+            assert(NumFunctions < Builder.getNumFunctions());
+            Builder.addFunctionBody(FunCtx, NumFunctions++);
+        } while (Tokens.LA(1) != antlr4::Token::EOF);
+        // Free the parse tree of the last function.
+        Parser.reset();
+        return Builder.getProgram();
+    }
+};
+
+}  // namespace
+
+ProgramAST* FrontEnd::parse(llvm::SourceMgr& SrcMgr) {
+    if (Kind == ANTLRFrontEnd)
+        return parseWithANTLR(
+            SrcMgr.getMemoryBuffer(SrcMgr.getMainFileID())->getBuffer());
+    Parser P(SrcMgr, TheTypeContext, TheASTContext);
+    return P.parseProgram();
+}
+
+ProgramAST* FrontEnd::parseWithANTLR(llvm::StringRef Buffer) {
+    // ANTLRInputStream decodes the buffer to UTF-32.
+    ANTLRInputStream Input(Buffer.data(), Buffer.size());
     RemniwLexer Lexer(&Input);
+    // The parser pulls the tokens from the lexer as it needs them.
     CommonTokenStream Tokens(&Lexer);
-    Tokens.fill();
     LLVM_DEBUG({
+        Tokens.fill();
         llvm::outs() << "===== Lexer ===== \n";
         for (auto token : Tokens.getTokens()) {
             llvm::outs() << token->toString() << "\n";
         }
     });
 
+    {
+        ASTBuilder Builder(TheTypeContext, TheASTContext, Buffer);
+        TwoStageParser Parser(Tokens);
+        if (ProgramAST* Program = Parser.parseProgram(Builder))
+            return Program;
+    }
+
+    // There are syntax errors. Parse the whole program again with the default error
+    // strategy, which reports them and recovers from them, and build the AST from the
+    // recovered parse tree.
+    LLVM_DEBUG(llvm::errs() << "===== Parser Failed ===== \n");
+    Tokens.seek(0);
     RemniwParser Parser(&Tokens);
     RemniwParser::ProgramContext* Program = Parser.program();
-    LLVM_DEBUG({
-        llvm::outs() << "===== Parser ===== \n";
-        llvm::outs() << Program->toStringTree(&Parser, true) << "\n";
-        if (Parser.getNumberOfSyntaxErrors())
-            llvm::errs() << "===== Parser Failed ===== \n";
-    });
-
-    ASTBuilder Builder(TheTypeContext);
-    return Builder.build(Program);
+    ASTBuilder Builder(TheTypeContext, TheASTContext, Buffer);
+    for (auto* FunCtx : Program->fun())
+        Builder.addFunctionPrototype(FunCtx->getStart(), FunCtx->id(),
+                                     FunCtx->parameters(), FunCtx->scalarType());
+    for (size_t I = 0; I < Program->fun().size(); ++I)
+        Builder.addFunctionBody(Program->fun(I), I);
+    return Builder.getProgram();
 }
 
 }  // namespace remniw
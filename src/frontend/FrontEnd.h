@@ -1,18 +1,36 @@
 #pragma once
 
 #include "frontend/AST.h"
+#include "llvm/Support/SourceMgr.h"
 
 namespace remniw {
 
+enum FrontEndKind {
+    // The hand-written lexer and recursive-descent parser, see frontend/Parser.h.
+    FastFrontEnd,
+    // The lexer and parser generated by ANTLR from grammar/Remniw.g4.
+    ANTLRFrontEnd
+};
+
 class FrontEnd {
 private:
     TypeContext& TheTypeContext;
+    ASTContext& TheASTContext;
+    FrontEndKind Kind;
+
+    ProgramAST* parseWithANTLR(llvm::StringRef Buffer);
 
 public:
-    FrontEnd(TypeContext& TheTypeContext): TheTypeContext(TheTypeContext) {}
+    FrontEnd(TypeContext& TheTypeContext, ASTContext& TheASTContext,
+             FrontEndKind Kind = ANTLRFrontEnd):
+        TheTypeContext(TheTypeContext), TheASTContext(TheASTContext), Kind(Kind) {}
 
-    // Parse an input stream and return an AST.
-    std::unique_ptr<ProgramAST> parse(std::istream& Stream);
+    // Parse the main file of SrcMgr and return an AST, which is owned by the
+    // ASTContext. The source locations of the AST are offsets in the main file.
+    // Syntax errors are reported to stderr. The ANTLR frontend recovers from them,
+    // the hand-written one returns nullptr.
+    // Both kinds of frontend build the same AST.
+    ProgramAST* parse(llvm::SourceMgr& SrcMgr);
 };
 
 }  // namespace remniw
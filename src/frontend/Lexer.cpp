@@ -0,0 +1,126 @@
+#include "frontend/Lexer.h"
+#include "llvm/ADT/StringSwitch.h"
+#include "llvm/Support/raw_ostream.h"
+
+namespace remniw {
+
+static bool isIdentifierHead(char C) {
+    return (C >= 'a' && C <= 'z') || (C >= 'A' && C <= 'Z') || C == '_';
+}
+
+static bool isIdentifierBody(char C) {
+    return isIdentifierHead(C) || (C >= '0' && C <= '9');
+}
+
+static bool isDigit(char C) {
+    return C >= '0' && C <= '9';
+}
+
+void Lexer::skipWhitespaceAndComments() {
+    const char *End = Buffer.end();
+    while (Cur != End) {
+        char C = *Cur;
+        if (C == ' ' || C == '\t' || C == '\r' || C == '\n') {
+            ++Cur;
+        } else if (C == '/' && Cur + 1 != End && Cur[1] == '/') {
+            while (Cur != End && *Cur != '\n' && *Cur != '\r')
+                ++Cur;
+        } else if (C == '/' && Cur + 1 != End && Cur[1] == '*') {
+            // An unterminated block comment is not a comment for ANTLR either,
+            // leave it to be lexed as '/' '*'.
+            llvm::StringRef Rest(Cur + 2, End - Cur - 2);
+            size_t Pos = Rest.find("*/");
+            if (Pos == llvm::StringRef::npos)
+                return;
+            Cur += 2 + Pos + 2;
+        } else {
+            return;
+        }
+    }
+}
+
+Token Lexer::lex() {
+    skipWhitespaceAndComments();
+
+    Token Tok;
+    Tok.Loc = getLoc();
+    const char *Start = Cur;
+    const char *End = Buffer.end();
+    if (Cur == End) {
+        Tok.K = Token::Eof;
+        Tok.Text = llvm::StringRef(Cur, 0);
+        return Tok;
+    }
+
+    auto formToken = [&](Token::Kind K) {
+        Tok.K = K;
+        Tok.Text = llvm::StringRef(Start, Cur - Start);
+        return Tok;
+    };
+
+    char C = *Cur;
+    if (isIdentifierHead(C)) {
+        while (Cur != End && isIdentifierBody(*Cur))
+            ++Cur;
+        llvm::StringRef Text(Start, Cur - Start);
+        return formToken(llvm::StringSwitch<Token::Kind>(Text)
+                             .Case("func", Token::KwFunc)
+                             .Case("var", Token::KwVar)
+                             .Case("return", Token::KwReturn)
+                             .Case("if", Token::KwIf)
+                             .Case("else", Token::KwElse)
+                             .Case("while", Token::KwWhile)
+                             .Case("int", Token::KwInt)
+                             .Default(Token::Identifier));
+    }
+
+    if (isDigit(C)) {
+        while (Cur != End && isDigit(*Cur))
+            ++Cur;
+        return formToken(Token::Number);
+    }
+
+    if (C == '%') {
+        ++Cur;
+        while (Cur != End && isIdentifierBody(*Cur))
+            ++Cur;
+        llvm::StringRef Text(Start, Cur - Start);
+        return formToken(llvm::StringSwitch<Token::Kind>(Text)
+                             .Case("%sizeof", Token::KwSizeof)
+                             .Case("%input", Token::KwInput)
+                             .Case("%nil", Token::KwNil)
+                             .Case("%output", Token::KwOutput)
+                             .Case("%alloc", Token::KwAlloc)
+                             .Case("%dealloc", Token::KwDealloc)
+                             .Default(Token::Unknown));
+    }
+
+    ++Cur;
+    switch (C) {
+    case '(': return formToken(Token::LParen);
+    case ')': return formToken(Token::RParen);
+    case '{': return formToken(Token::LBrace);
+    case '}': return formToken(Token::RBrace);
+    case '[': return formToken(Token::LSquare);
+    case ']': return formToken(Token::RSquare);
+    case ',': return formToken(Token::Comma);
+    case ';': return formToken(Token::Semi);
+    case ':': return formToken(Token::Colon);
+    case '.': return formToken(Token::Period);
+    case '&': return formToken(Token::Amp);
+    case '*': return formToken(Token::Star);
+    case '/': return formToken(Token::Slash);
+    case '+': return formToken(Token::Plus);
+    case '-': return formToken(Token::Minus);
+    case '>': return formToken(Token::Greater);
+    case '=':
+        if (Cur != End && *Cur == '=') {
+            ++Cur;
+            return formToken(Token::EqualEqual);
+        }
+        return formToken(Token::Equal);
+    default: return formToken(Token::Unknown);
+    }
+}
+
+}  // namespace remniw
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "frontend/AST.h"
+#include "llvm/ADT/StringRef.h"
+
+namespace remniw {
+
+struct Token {
+    enum Kind {
+        Eof,
+        Unknown,
+        Identifier,
+        Number,
+        // Keywords
+        KwFunc,
+        KwVar,
+        KwReturn,
+        KwIf,
+        KwElse,
+        KwWhile,
+        KwInt,
+        KwSizeof,
+        KwInput,
+        KwNil,
+        KwOutput,
+        KwAlloc,
+        KwDealloc,
+        // Punctuators
+        LParen,
+        RParen,
+        LBrace,
+        RBrace,
+        LSquare,
+        RSquare,
+        Comma,
+        Semi,
+        Colon,
+        Period,
+        Amp,
+        Star,
+        Slash,
+        Plus,
+        Minus,
+        Greater,
+        EqualEqual,
+        Equal,
+    };
+
+    Kind K = Eof;
+    // Points into the source buffer, empty at the end of the buffer.
+    llvm::StringRef Text;
+    SourceLocation Loc;
+
+    bool is(Kind Other) const { return K == Other; }
+    bool isNot(Kind Other) const { return K != Other; }
+};
+
+/// Lexer - Hand-written lexer for remniw source code. It accepts the same
+/// tokens as the ANTLR lexer generated from grammar/Remniw.g4. The text of a
+/// token is a range of the source buffer and its location is the byte offset
+/// of the range, so lexing doesn't copy the source or count lines.
+class Lexer {
+public:
+    Lexer(llvm::StringRef Buffer): Buffer(Buffer), Cur(Buffer.begin()) {}
+
+    Token lex();
+
+private:
+    void skipWhitespaceAndComments();
+    SourceLocation getLoc() const {
+        return SourceLocation {static_cast<uint32_t>(Cur - Buffer.begin())};
+    }
+
+    llvm::StringRef Buffer;
+    const char *Cur;
+};
+
+}  // namespace remniw
@@ -0,0 +1,503 @@
+#include "frontend/Parser.h"
+#include "llvm/Support/raw_ostream.h"
+#include <cerrno>
+#include <limits>
+
+namespace remniw {
+
+// Binding power of the operators, it follows the precedence ANTLR derives
+// from the order of the alternatives of rule 'expr' in grammar/Remniw.g4.
+namespace prec {
+enum : unsigned {
+    Lowest = 0,
+    Equal = 6,
+    Relational = 7,
+    Additive = 8,
+    Multiplicative = 9,
+    ArraySubscript = 13,
+    Deref = 14,
+    FuncCall = 17,
+};
+}  // namespace prec
+
+static unsigned getBinaryPrecedence(Token::Kind K) {
+    switch (K) {
+    case Token::Star:
+    case Token::Slash: return prec::Multiplicative;
+    case Token::Plus:
+    case Token::Minus: return prec::Additive;
+    case Token::Greater: return prec::Relational;
+    case Token::EqualEqual: return prec::Equal;
+    default: return prec::Lowest;
+    }
+}
+
+static BinaryExprAST::OpKind getBinaryOpKind(Token::Kind K) {
+    switch (K) {
+    case Token::Star: return BinaryExprAST::Mul;
+    case Token::Slash: return BinaryExprAST::Div;
+    case Token::Plus: return BinaryExprAST::Add;
+    case Token::Minus: return BinaryExprAST::Sub;
+    case Token::Greater: return BinaryExprAST::Gt;
+    case Token::EqualEqual: return BinaryExprAST::Eq;
+    default: llvm_unreachable("Invalid BinaryExpr");
+    }
+}
+
+// Only the first error is reported, the parser doesn't recover from errors.
+void Parser::error(const Token &At, const llvm::Twine &Msg) {
+    if (!HadError)
+        SrcMgr.PrintMessage(llvm::SMLoc::getFromPointer(At.Text.begin()),
+                            llvm::SourceMgr::DK_Error, Msg);
+    HadError = true;
+}
+
+bool Parser::expect(Token::Kind K, const char *What) {
+    if (Tok.is(K)) {
+        consume();
+        return true;
+    }
+    error(Tok, llvm::Twine("expected '") + What + "'");
+    return false;
+}
+
+ProgramAST *Parser::parseProgram() {
+    // Function bodies may refer to any function of the program, so parse all
+    // the function prototypes first, skip the bodies and come back to them
+    // once every function is declared.
+    struct FunctionSkeleton {
+        FunctionDeclAST *Function;
+        ParamList Params;
+        Lexer BodyLexer;
+        Token BodyBegin;
+    };
+    std::vector<FunctionSkeleton> Skeletons;
+    do {
+        ParamList Params;
+        auto Function = parseFunctionPrototype(Params);
+        if (!Function)
+            return nullptr;
+        Skeletons.push_back({Function, Params, Lex, Tok});
+        Functions.push_back(Function);
+        Scope.addFunction(Function);
+        if (!expect(Token::LBrace, "{"))
+            return nullptr;
+        for (unsigned Depth = 1; Depth;) {
+            if (Tok.is(Token::Eof)) {
+                error(Tok, "expected '}'");
+                return nullptr;
+            }
+            if (Tok.is(Token::LBrace))
+                ++Depth;
+            else if (Tok.is(Token::RBrace))
+                --Depth;
+            consume();
+        }
+    } while (Tok.isNot(Token::Eof));
+
+    for (auto &Skeleton : Skeletons) {
+        Lex = Skeleton.BodyLexer;
+        Tok = Skeleton.BodyBegin;
+        if (!parseFunctionBody(Skeleton.Function, Skeleton.Params))
+            return nullptr;
+        Scope.leaveFunction();
+    }
+    return ASTCtx.create<ProgramAST>(ASTCtx.copyArray(Functions));
+}
+
+FunctionDeclAST *Parser::parseFunctionPrototype(ParamList &Params) {
+    Token FuncTok = Tok;
+    if (!expect(Token::KwFunc, "func"))
+        return nullptr;
+    Token NameTok = Tok;
+    if (!expect(Token::Identifier, "identifier") || !expect(Token::LParen, "("))
+        return nullptr;
+    std::vector<Type *> ParamTypes;
+    if (Tok.isNot(Token::RParen)) {
+        do {
+            Token ParamTok = Tok;
+            if (!expect(Token::Identifier, "identifier"))
+                return nullptr;
+            Type *ParamTy = parseScalarType();
+            if (!ParamTy)
+                return nullptr;
+            Params.emplace_back(ParamTok, ParamTy);
+            ParamTypes.push_back(ParamTy);
+        } while (consumeIf(Token::Comma));
+    }
+    if (!expect(Token::RParen, ")"))
+        return nullptr;
+    Type *ReturnType = parseScalarType();
+    if (!ReturnType)
+        return nullptr;
+    return ASTCtx.create<FunctionDeclAST>(FuncTok.Loc, ASTCtx.getIdentifier(NameTok.Text),
+                                          Type::getFunctionType(ParamTypes, ReturnType));
+}
+
+bool Parser::parseFunctionBody(FunctionDeclAST *Function, const ParamList &Params) {
+    // param declarations
+    llvm::SmallVector<VarDeclAST *, 8> ParamDecls;
+    for (auto &Param : Params) {
+        ParamDecls.push_back(ASTCtx.create<VarDeclAST>(
+            Param.first.Loc, ASTCtx.getIdentifier(Param.first.Text), Param.second));
+        Scope.addVariable(ParamDecls.back());
+    }
+    Function->setParamDecls(ASTCtx.copyArray(ParamDecls));
+    if (!expect(Token::LBrace, "{"))
+        return false;
+    // var declarations
+    llvm::SmallVector<VarDeclAST *, 8> Vars;
+    while (consumeIf(Token::KwVar)) {
+        std::vector<Token> IdToks;
+        do {
+            IdToks.push_back(Tok);
+            if (!expect(Token::Identifier, "identifier"))
+                return false;
+        } while (consumeIf(Token::Comma));
+        Type *VarTy = parseVarType();
+        if (!VarTy || !expect(Token::Semi, ";"))
+            return false;
+        for (auto &IdTok : IdToks) {
+            Vars.push_back(ASTCtx.create<VarDeclAST>(
+                IdTok.Loc, ASTCtx.getIdentifier(IdTok.Text), VarTy));
+            Scope.addVariable(Vars.back());
+        }
+    }
+    auto LocalVarDecls =
+        ASTCtx.create<LocalVarDeclStmtAST>(SourceLocation {}, ASTCtx.copyArray(Vars));
+    Function->setLocalVarDecls(LocalVarDecls);
+    // function body
+    llvm::SmallVector<StmtAST *, 8> Body;
+    while (Tok.isNot(Token::KwReturn)) {
+        auto Stmt = parseStmt();
+        if (!Stmt)
+            return false;
+        Body.push_back(Stmt);
+    }
+    Function->setBody(ASTCtx.copyArray(Body));
+    // return statement
+    auto ReturnStmt = parseReturnStmt();
+    if (!ReturnStmt || !expect(Token::RBrace, "}"))
+        return false;
+    Function->setReturnStmt(ReturnStmt);
+    return true;
+}
+
+Type *Parser::parseVarType() {
+    if (Tok.isNot(Token::LSquare))
+        return parseScalarType();
+    consume();
+    Token NumTok = Tok;
+    if (!expect(Token::Number, "number") || !expect(Token::RSquare, "]"))
+        return nullptr;
+    Type *ElementTy = parseVarType();
+    if (!ElementTy)
+        return nullptr;
+    uint64_t NumElements = 0;
+    errno = 0;
+    auto Val = std::strtoull(NumTok.Text.str().c_str(), nullptr, 10);
+    if (errno == 0)
+        NumElements = Val;
+    return Type::getArrayType(ElementTy, NumElements);
+}
+
+Type *Parser::parseScalarType() {
+    switch (Tok.K) {
+    case Token::KwInt: consume(); return Type::getIntType(TyCtx);
+    case Token::Star: {
+        consume();
+        Type *PointeeTy = parseVarType();
+        return PointeeTy ? PointeeTy->getPointerTo() : nullptr;
+    }
+    case Token::KwFunc: {
+        consume();
+        if (!expect(Token::LParen, "("))
+            return nullptr;
+        std::vector<Type *> ParamTys;
+        if (Tok.isNot(Token::RParen)) {
+            do {
+                Type *ParamTy = parseScalarType();
+                if (!ParamTy)
+                    return nullptr;
+                ParamTys.push_back(ParamTy);
+            } while (consumeIf(Token::Comma));
+        }
+        if (!expect(Token::RParen, ")"))
+            return nullptr;
+        Type *RetTy = parseScalarType();
+        return RetTy ? Type::getFunctionType(ParamTys, RetTy) : nullptr;
+    }
+    default: error(Tok, "expected type"); return nullptr;
+    }
+}
+
+ReturnStmtAST *Parser::parseReturnStmt() {
+    Token ReturnTok = Tok;
+    if (!expect(Token::KwReturn, "return"))
+        return nullptr;
+    auto Expr = parseExpr(/*LValue*/ false);
+    if (!Expr || !expect(Token::Semi, ";"))
+        return nullptr;
+    return ASTCtx.create<ReturnStmtAST>(ReturnTok.Loc, Expr);
+}
+
+StmtAST *Parser::parseStmt() {
+    Token StartTok = Tok;
+    switch (Tok.K) {
+    case Token::Semi: consume(); return ASTCtx.create<EmptyStmtAST>(StartTok.Loc);
+    case Token::KwOutput: {
+        consume();
+        auto Expr = parseExpr(/*LValue*/ false);
+        if (!Expr || !expect(Token::Semi, ";"))
+            return nullptr;
+        return ASTCtx.create<OutputStmtAST>(StartTok.Loc, Expr);
+    }
+    case Token::KwAlloc: {
+        consume();
+        if (!expect(Token::LParen, "("))
+            return nullptr;
+        auto Ptr = parseExpr(/*LValue*/ true);
+        if (!Ptr || !expect(Token::Comma, ","))
+            return nullptr;
+        auto Size = parseExpr(/*LValue*/ false);
+        if (!Size || !expect(Token::RParen, ")") || !expect(Token::Semi, ";"))
+            return nullptr;
+        return ASTCtx.create<AllocStmtAST>(StartTok.Loc, Ptr, Size);
+    }
+    case Token::KwDealloc: {
+        consume();
+        if (!expect(Token::LParen, "("))
+            return nullptr;
+        auto Expr = parseExpr(/*LValue*/ false);
+        if (!Expr || !expect(Token::RParen, ")") || !expect(Token::Semi, ";"))
+            return nullptr;
+        return ASTCtx.create<DeallocStmtAST>(StartTok.Loc, Expr);
+    }
+    case Token::LBrace: {
+        consume();
+        llvm::SmallVector<StmtAST *, 8> Stmts;
+        while (!consumeIf(Token::RBrace)) {
+            auto Stmt = parseStmt();
+            if (!Stmt)
+                return nullptr;
+            Stmts.push_back(Stmt);
+        }
+        return ASTCtx.create<BlockStmtAST>(StartTok.Loc, ASTCtx.copyArray(Stmts));
+    }
+    case Token::KwIf: {
+        consume();
+        if (!expect(Token::LParen, "("))
+            return nullptr;
+        auto Cond = parseExpr(/*LValue*/ false);
+        if (!Cond || !expect(Token::RParen, ")"))
+            return nullptr;
+        auto Then = parseStmt();
+        if (!Then)
+            return nullptr;
+        StmtAST *Else = nullptr;
+        if (consumeIf(Token::KwElse)) {
+            Else = parseStmt();
+            if (!Else)
+                return nullptr;
+        }
+        return ASTCtx.create<IfStmtAST>(StartTok.Loc, Cond, Then, Else);
+    }
+    case Token::KwWhile: {
+        consume();
+        if (!expect(Token::LParen, "("))
+            return nullptr;
+        auto Cond = parseExpr(/*LValue*/ false);
+        if (!Cond || !expect(Token::RParen, ")"))
+            return nullptr;
+        auto Body = parseStmt();
+        if (!Body)
+            return nullptr;
+        return ASTCtx.create<WhileStmtAST>(StartTok.Loc, Cond, Body);
+    }
+    default: {
+        auto LHS = parseExpr(/*LValue*/ true);
+        if (!LHS || !expect(Token::Equal, "="))
+            return nullptr;
+        auto RHS = parseExpr(/*LValue*/ false);
+        if (!RHS || !expect(Token::Semi, ";"))
+            return nullptr;
+        return ASTCtx.create<AssignmentStmtAST>(StartTok.Loc, LHS, RHS);
+    }
+    }
+}
+
+// Whether an expression is an lvalue is decided by its context, which is only
+// known after the expression is parsed, e.g. the base of an ArraySubscriptExpr.
+// Propagate the lvalue-ness top-down the same way ASTBuilder does.
+void Parser::markLValue(ExprAST *Expr, bool LValue) {
+    switch (Expr->getKind()) {
+    case ASTNode::DeclRefExpr: Expr->setLValue(LValue); break;
+    case ASTNode::DerefExpr: {
+        Expr->setLValue(LValue);
+        markLValue(llvm::cast<DerefExprAST>(Expr)->getPtr(), LValue);
+        break;
+    }
+    case ASTNode::ArraySubscriptExpr: {
+        auto *ArraySubscriptExpr = llvm::cast<ArraySubscriptExprAST>(Expr);
+        Expr->setLValue(LValue);
+        markLValue(ArraySubscriptExpr->getBase(), true);
+        markLValue(ArraySubscriptExpr->getSelector(), false);
+        break;
+    }
+    case ASTNode::FunctionCallExpr: {
+        auto *FunctionCallExpr = llvm::cast<FunctionCallExprAST>(Expr);
+        markLValue(FunctionCallExpr->getCallee(), false);
+        for (auto *Arg : FunctionCallExpr->getArgs())
+            markLValue(Arg, false);
+        break;
+    }
+    case ASTNode::BinaryExpr: {
+        auto *BinaryExpr = llvm::cast<BinaryExprAST>(Expr);
+        markLValue(BinaryExpr->getLHS(), false);
+        markLValue(BinaryExpr->getRHS(), false);
+        break;
+    }
+    default: break;
+    }
+}
+
+ExprAST *Parser::parseExpr(bool LValue) {
+    SourceLocation StartLoc;
+    auto Expr = parseExprWithPrec(prec::Lowest, StartLoc);
+    if (Expr)
+        markLValue(Expr, LValue);
+    return Expr;
+}
+
+ExprAST *Parser::parseExprWithPrec(unsigned MinPrec, SourceLocation &StartLoc) {
+    auto LHS = parsePrimaryExpr(StartLoc);
+    if (!LHS)
+        return nullptr;
+    // Like ANTLR, a postfix or binary expression starts at the first token of
+    // its leftmost operand, including any parentheses around it.
+    while (true) {
+        if (Tok.is(Token::LParen) && prec::FuncCall >= MinPrec) {
+            consume();
+            llvm::SmallVector<ExprAST *, 8> Args;
+            if (Tok.isNot(Token::RParen)) {
+                do {
+                    SourceLocation ArgLoc;
+                    auto Arg = parseExprWithPrec(prec::Lowest, ArgLoc);
+                    if (!Arg)
+                        return nullptr;
+                    Args.push_back(Arg);
+                } while (consumeIf(Token::Comma));
+            }
+            if (!expect(Token::RParen, ")"))
+                return nullptr;
+            auto *Ty = LHS->getType()->getFunctionReturnType();
+            LHS = ASTCtx.create<FunctionCallExprAST>(StartLoc, Ty, LHS,
+                                                     ASTCtx.copyArray(Args));
+            continue;
+        }
+        if (Tok.is(Token::LSquare) && prec::ArraySubscript >= MinPrec) {
+            consume();
+            SourceLocation SelectorLoc;
+            auto Selector = parseExprWithPrec(prec::Lowest, SelectorLoc);
+            if (!Selector || !expect(Token::RSquare, "]"))
+                return nullptr;
+            auto *Ty = LHS->getType()->getArrayElementType();
+            LHS = ASTCtx.create<ArraySubscriptExprAST>(StartLoc, Ty, /*LValue*/ false,
+                                                       LHS, Selector);
+            continue;
+        }
+        unsigned Prec = getBinaryPrecedence(Tok.K);
+        if (Prec == prec::Lowest || Prec < MinPrec)
+            break;
+        Token::Kind Op = Tok.K;
+        consume();
+        // All binary operators are left associative.
+        SourceLocation RHSLoc;
+        auto RHS = parseExprWithPrec(Prec + 1, RHSLoc);
+        if (!RHS)
+            return nullptr;
+        // The type of BinaryExpr is same as the type of LHS and the type of RHS.
+        auto *Ty = LHS->getType();
+        LHS = ASTCtx.create<BinaryExprAST>(StartLoc, Ty, getBinaryOpKind(Op), LHS, RHS);
+    }
+    return LHS;
+}
+
+ExprAST *Parser::parsePrimaryExpr(SourceLocation &StartLoc) {
+    Token StartTok = Tok;
+    StartLoc = StartTok.Loc;
+    switch (Tok.K) {
+    case Token::Number: consume(); return parseNumber(StartTok, false, StartTok.Loc);
+    case Token::Minus: {
+        consume();
+        Token NumTok = Tok;
+        if (!expect(Token::Number, "number"))
+            return nullptr;
+        return parseNumber(NumTok, true, StartTok.Loc);
+    }
+    case Token::Identifier: consume(); return createDeclRef(StartTok);
+    case Token::Amp: {
+        consume();
+        Token IdTok = Tok;
+        if (!expect(Token::Identifier, "identifier"))
+            return nullptr;
+        auto Var = createDeclRef(IdTok);
+        if (!Var)
+            return nullptr;
+        Var->setLValue(true);
+        auto *Ty = Var->getDecl()->getType()->getPointerTo();
+        return ASTCtx.create<AddrOfExprAST>(StartTok.Loc, Ty, Var);
+    }
+    case Token::Star: {
+        consume();
+        SourceLocation PtrLoc;
+        auto Ptr = parseExprWithPrec(prec::Deref, PtrLoc);
+        if (!Ptr)
+            return nullptr;
+        auto *Ty = Ptr->getType()->getPointerPointeeType();
+        return ASTCtx.create<DerefExprAST>(StartTok.Loc, Ty, /*LValue*/ false, Ptr);
+    }
+    case Token::LParen: {
+        consume();
+        SourceLocation InnerLoc;
+        auto Expr = parseExprWithPrec(prec::Lowest, InnerLoc);
+        if (!Expr || !expect(Token::RParen, ")"))
+            return nullptr;
+        return Expr;
+    }
+    case Token::KwSizeof: {
+        consume();
+        Type *DataTy = parseVarType();
+        if (!DataTy)
+            return nullptr;
+        return ASTCtx.create<SizeofExprAST>(StartTok.Loc, Type::getIntType(TyCtx),
+                                            DataTy);
+    }
+    case Token::KwInput:
+        consume();
+        return ASTCtx.create<InputExprAST>(StartTok.Loc, Type::getIntType(TyCtx));
+    case Token::KwNil: consume(); return ASTCtx.create<NullExprAST>(StartTok.Loc);
+    case Token::LBrace: error(Tok, "record is not supported"); return nullptr;
+    default: error(Tok, "expected expression"); return nullptr;
+    }
+}
+
+NumberExprAST *Parser::parseNumber(const Token &NumTok, bool Negative,
+                                  SourceLocation Loc) {
+    // strtoll returns long long >= 64 bits, the value is clamped to the range of
+    // int64_t if it is out of range.
+    std::string S = (Negative ? "-" : "") + NumTok.Text.str();
+    int64_t Val = std::strtoll(S.c_str(), nullptr, 10);
+    return ASTCtx.create<NumberExprAST>(Loc, Type::getIntType(TyCtx), Val);
+}
+
+DeclRefExprAST *Parser::createDeclRef(const Token &IdTok) {
+    auto *Decl = Scope.lookup(ASTCtx.getIdentifier(IdTok.Text));
+    if (!Decl) {
+        error(IdTok, "use of undeclared identifier '" + IdTok.Text + "'");
+        return nullptr;
+    }
+    return ASTCtx.create<DeclRefExprAST>(IdTok.Loc, Decl, /*LValue*/ false);
+}
+
+}  // namespace remniw
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "frontend/AST.h"
+#include "frontend/Lexer.h"
+#include "frontend/Scope.h"
+#include "frontend/Type.h"
+#include "llvm/Support/SourceMgr.h"
+#include <vector>
+
+namespace remniw {
+
+/// Parser - Recursive-descent parser for remniw, with a Pratt (precedence
+/// climbing) expression parser. It builds the same AST as ASTBuilder does
+/// from the ANTLR parse tree, including lvalue/rvalue marks, types, source
+/// locations and the resolved declarations of DeclRefExprAST.
+class Parser {
+public:
+    /// Parse the main file of SrcMgr, which also reports the syntax errors.
+    Parser(llvm::SourceMgr &SrcMgr, TypeContext &TyCtx, ASTContext &ASTCtx):
+        SrcMgr(SrcMgr), Lex(SrcMgr.getMemoryBuffer(SrcMgr.getMainFileID())->getBuffer()),
+        TyCtx(TyCtx), ASTCtx(ASTCtx) {
+        consume();
+    }
+
+    /// Parse the whole program, return nullptr if there is any syntax error.
+    ProgramAST *parseProgram();
+
+private:
+    void consume() { Tok = Lex.lex(); }
+    bool expect(Token::Kind K, const char *What);
+    bool consumeIf(Token::Kind K) {
+        if (Tok.isNot(K))
+            return false;
+        consume();
+        return true;
+    }
+    void error(const Token &At, const llvm::Twine &Msg);
+
+    using ParamList = std::vector<std::pair<Token, Type *>>;
+    FunctionDeclAST *parseFunctionPrototype(ParamList &Params);
+    bool parseFunctionBody(FunctionDeclAST *Function, const ParamList &Params);
+
+    Type *parseVarType();
+    Type *parseScalarType();
+
+    StmtAST *parseStmt();
+    ReturnStmtAST *parseReturnStmt();
+
+    ExprAST *parseExpr(bool LValue);
+    ExprAST *parseExprWithPrec(unsigned MinPrec, SourceLocation &StartLoc);
+    ExprAST *parsePrimaryExpr(SourceLocation &StartLoc);
+    NumberExprAST *parseNumber(const Token &NumTok, bool Negative, SourceLocation Loc);
+    DeclRefExprAST *createDeclRef(const Token &IdTok);
+    static void markLValue(ExprAST *Expr, bool LValue);
+
+    llvm::SourceMgr &SrcMgr;
+    Lexer Lex;
+    Token Tok;
+    TypeContext &TyCtx;
+    ASTContext &ASTCtx;
+    bool HadError = false;
+    std::vector<FunctionDeclAST *> Functions;
+    DeclScope Scope;
+};
+
+}  // namespace remniw
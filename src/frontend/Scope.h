@@ -0,0 +1,61 @@
+#pragma once
+
+#include "frontend/AST.h"
+#include <utility>
+#include <vector>
+
+namespace remniw {
+
+/// DeclScope - Resolves the identifiers of a program to their declarations while
+/// it is parsed. The declarations are kept in one array indexed by the IDs of the
+/// identifiers: the functions are visible in the whole program, and the parameters
+/// and local variables of the function being parsed hide them until the function
+/// is left. So a lookup takes constant time, however many functions there are.
+class DeclScope {
+public:
+    // Only the first function of a name is visible.
+    void addFunction(FunctionDeclAST *Function) {
+        DeclAST *&Slot = getSlot(Function->getIdentifier());
+        if (!Slot)
+            Slot = Function;
+    }
+
+    // Declare a parameter or a local variable of the current function. The first
+    // variable of a name declared in a function is visible in the function.
+    void addVariable(VarDeclAST *Var) {
+        Identifier Name = Var->getIdentifier();
+        DeclAST *&Slot = getSlot(Name);
+        if (Slot && llvm::isa<VarDeclAST>(Slot))
+            return;
+        Hidden.emplace_back(Name.getID(), Slot);
+        Slot = Var;
+    }
+
+    // Forget the variables of the current function.
+    void leaveFunction() {
+        for (auto &[ID, Decl] : Hidden)
+            Decls[ID] = Decl;
+        Hidden.clear();
+    }
+
+    // Returns nullptr if Name is not declared.
+    DeclAST *lookup(Identifier Name) const {
+        unsigned ID = Name.getID();
+        return ID < Decls.size() ? Decls[ID] : nullptr;
+    }
+
+private:
+    DeclAST *&getSlot(Identifier Name) {
+        unsigned ID = Name.getID();
+        if (ID >= Decls.size())
+            Decls.resize(ID + 1);
+        return Decls[ID];
+    }
+
+    // Indexed by the IDs of the identifiers.
+    std::vector<DeclAST *> Decls;
+    // The declarations hidden by the variables of the current function.
+    std::vector<std::pair<unsigned, DeclAST *>> Hidden;
+};
+
+}  // namespace remniw
@@ -3,6 +3,11 @@
 
 namespace remniw {
 
+Type::Type(TypeKind TyKind, TypeContext &C):
+    TyKind(TyKind), Context(C), ID(C.Types.size()) {
+    C.Types.push_back(this);
+}
+
 void Type::print(llvm::raw_ostream &OS) const {
     switch (getTypeKind()) {
     case Type::TK_VARTYPE: {
@@ -7,6 +7,7 @@
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/Support/Allocator.h"
 #include "llvm/Support/raw_ostream.h"
+#include <vector>
 
 namespace remniw {
 
@@ -30,12 +31,15 @@ public:
     };
 
 public:
-    Type(TypeKind TyKind, TypeContext &C): TyKind(TyKind), Context(C) {}
+    Type(TypeKind TyKind, TypeContext &C);
 
     void print(llvm::raw_ostream &OS) const;
 
     TypeContext &getContext() const { return Context; }
     TypeKind getTypeKind() const { return TyKind; }
+    // The types of a TypeContext are numbered densely from 0 in the order they are
+    // created, so analyses can keep the data of a type in arrays indexed by its ID.
+    unsigned getID() const { return ID; }
 
     static IntType *getIntType(TypeContext &C);
     static PointerType *getIntPtrType(TypeContext &C);
@@ -50,6 +54,7 @@ public:
 private:
     const TypeKind TyKind;
     TypeContext &Context;
+    const unsigned ID;
 };
 
 // Class to represent type variable.
@@ -228,6 +233,11 @@ class TypeContext {
 public:
     TypeContext(): IntTy(*this) {}
 
+    unsigned getNumTypes() const { return Types.size(); }
+    Type *getType(unsigned ID) const { return Types[ID]; }
+
+    // Indexed by the ID of the types, see Type::getID().
+    std::vector<Type *> Types;
     llvm::BumpPtrAllocator Alloc;
     IntType IntTy;
     llvm::DenseMap<Type *, PointerType *> PointerTypes;
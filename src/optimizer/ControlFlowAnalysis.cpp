@@ -0,0 +1,256 @@
+#include "optimizer/ControlFlowAnalysis.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/raw_ostream.h"
+
+#define DEBUG_TYPE "remniw-cfa"
+
+using namespace llvm;
+
+namespace remniw {
+
+class ControlFlowSolver {
+private:
+    Module &M;
+    ControlFlowInfo &Info;
+    // The successors of a node, whose sets include the set of the node.
+    std::vector<SmallVector<unsigned, 2>> Succs;
+    // The indirect call sites whose callee is the node.
+    std::vector<SmallVector<CallBase *, 1>> CallSites;
+    DenseSet<std::pair<unsigned, unsigned>> Edges;
+    // The stack slots whose address is only used to load and store them.
+    DenseMap<const AllocaInst *, unsigned> SlotToNode;
+    DenseMap<const Function *, unsigned> ReturnToNode;
+    // The call sites which have been bound to the arguments and return value of a
+    // function.
+    DenseSet<std::pair<CallBase *, Function *>> BoundCalls;
+    SmallVector<Function *> AddressTakenFunctions;
+    bool HasUnknownCall = false;
+    SmallVector<unsigned> Worklist;
+    std::vector<bool> InWorklist;
+
+    unsigned createNode() {
+        Info.Nodes.emplace_back();
+        Succs.emplace_back();
+        CallSites.emplace_back();
+        InWorklist.push_back(false);
+        return Info.Nodes.size() - 1;
+    }
+
+    unsigned getNode(const Value *V) {
+        auto It = Info.ValueToNode.find(V);
+        if (It != Info.ValueToNode.end())
+            return It->second;
+        unsigned N = createNode();
+        Info.ValueToNode[V] = N;
+        return N;
+    }
+
+    unsigned getReturnNode(const Function *F) {
+        auto It = ReturnToNode.find(F);
+        if (It != ReturnToNode.end())
+            return It->second;
+        unsigned N = createNode();
+        ReturnToNode[F] = N;
+        return N;
+    }
+
+    void push(unsigned N) {
+        if (!InWorklist[N]) {
+            InWorklist[N] = true;
+            Worklist.push_back(N);
+        }
+    }
+
+    void addFunction(unsigned N, Function *F) {
+        if (!Info.Nodes[N].Unknown && Info.Nodes[N].Functions.insert(F))
+            push(N);
+    }
+
+    void markUnknown(unsigned N) {
+        if (Info.Nodes[N].Unknown)
+            return;
+        Info.Nodes[N].Unknown = true;
+        Info.Nodes[N].Functions.clear();
+        push(N);
+    }
+
+    void addEdge(unsigned From, unsigned To) {
+        if (From == To || !Edges.insert({From, To}).second)
+            return;
+        Succs[From].push_back(To);
+        if (Info.Nodes[From].Unknown || !Info.Nodes[From].Functions.empty())
+            push(From);
+    }
+
+    // The set of To includes the functions V may hold.
+    void addFlow(Value *V, unsigned To) {
+        V = V->stripPointerCasts();
+        if (auto *F = dyn_cast<Function>(V))
+            addFunction(To, F);
+        else if (isa<Instruction>(V) || isa<Argument>(V))
+            addEdge(getNode(V), To);
+        else if (!isa<ConstantPointerNull>(V) && !isa<UndefValue>(V))
+            markUnknown(To);
+    }
+
+    static bool isPointer(const Value *V) { return V->getType()->isPointerTy(); }
+
+    static bool isPromotableSlot(const AllocaInst &AI) {
+        for (const User *U : AI.users()) {
+            if (auto *SI = dyn_cast<StoreInst>(U)) {
+                if (SI->getValueOperand() == &AI)
+                    return false;
+            } else if (!isa<LoadInst>(U)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void bindCall(CallBase &CB, Function *F) {
+        if (!BoundCalls.insert({&CB, F}).second)
+            return;
+        // The runtime functions do not return functions of the module.
+        if (F->isDeclaration()) {
+            if (isPointer(&CB))
+                markUnknown(getNode(&CB));
+            return;
+        }
+        if (F->arg_size() != CB.arg_size())
+            return;
+        for (unsigned I = 0, E = CB.arg_size(); I != E; ++I) {
+            if (isPointer(F->getArg(I)))
+                addFlow(CB.getArgOperand(I), getNode(F->getArg(I)));
+        }
+        if (isPointer(&CB))
+            addEdge(getReturnNode(F), getNode(&CB));
+    }
+
+    // CB may call any function whose address is taken, with any arguments.
+    void bindUnknownCall(CallBase &CB) {
+        if (isPointer(&CB))
+            markUnknown(getNode(&CB));
+        if (HasUnknownCall)
+            return;
+        HasUnknownCall = true;
+        for (Function *F : AddressTakenFunctions) {
+            for (Argument &Arg : F->args()) {
+                if (isPointer(&Arg))
+                    markUnknown(getNode(&Arg));
+            }
+        }
+    }
+
+    void addConstraints(Instruction &I) {
+        if (auto *CB = dyn_cast<CallBase>(&I)) {
+            Value *Callee = CB->getCalledOperand()->stripPointerCasts();
+            if (auto *F = dyn_cast<Function>(Callee)) {
+                bindCall(*CB, F);
+            } else if (isa<Instruction>(Callee) || isa<Argument>(Callee)) {
+                unsigned N = getNode(Callee);
+                CallSites[N].push_back(CB);
+                push(N);
+            } else {
+                bindUnknownCall(*CB);
+            }
+        } else if (auto *SI = dyn_cast<StoreInst>(&I)) {
+            auto *AI = dyn_cast<AllocaInst>(SI->getPointerOperand());
+            if (isPointer(SI->getValueOperand()) && AI && SlotToNode.count(AI))
+                addFlow(SI->getValueOperand(), SlotToNode[AI]);
+        } else if (auto *RI = dyn_cast<ReturnInst>(&I)) {
+            if (RI->getReturnValue() && isPointer(RI->getReturnValue()))
+                addFlow(RI->getReturnValue(), getReturnNode(RI->getFunction()));
+        } else if (!isPointer(&I) || isa<AllocaInst>(I) || isa<GetElementPtrInst>(I)) {
+            // The addresses of data do not hold functions.
+        } else if (auto *PN = dyn_cast<PHINode>(&I)) {
+            for (Value *V : PN->incoming_values())
+                addFlow(V, getNode(PN));
+        } else if (auto *SI = dyn_cast<SelectInst>(&I)) {
+            addFlow(SI->getTrueValue(), getNode(SI));
+            addFlow(SI->getFalseValue(), getNode(SI));
+        } else if (isa<BitCastInst>(I) || isa<AddrSpaceCastInst>(I)) {
+            addFlow(I.getOperand(0), getNode(&I));
+        } else if (auto *LI = dyn_cast<LoadInst>(&I)) {
+            auto *AI = dyn_cast<AllocaInst>(LI->getPointerOperand());
+            if (AI && SlotToNode.count(AI))
+                addEdge(SlotToNode[AI], getNode(LI));
+            else
+                markUnknown(getNode(LI));
+        } else {
+            markUnknown(getNode(&I));
+        }
+    }
+
+    void propagate(unsigned N) {
+        for (unsigned S : Succs[N]) {
+            if (Info.Nodes[N].Unknown) {
+                markUnknown(S);
+                continue;
+            }
+            for (Function *F : Info.Nodes[N].Functions)
+                addFunction(S, F);
+        }
+        // Binding a call site creates nodes, so the sets are copied first.
+        SmallVector<CallBase *, 1> Calls(CallSites[N].begin(), CallSites[N].end());
+        if (Info.Nodes[N].Unknown) {
+            for (CallBase *CB : Calls)
+                bindUnknownCall(*CB);
+            return;
+        }
+        SmallVector<Function *, 4> Callees(Info.Nodes[N].Functions.begin(),
+                                           Info.Nodes[N].Functions.end());
+        for (CallBase *CB : Calls) {
+            for (Function *F : Callees)
+                bindCall(*CB, F);
+        }
+    }
+
+public:
+    ControlFlowSolver(Module &M, ControlFlowInfo &Info): M(M), Info(Info) {}
+
+    void solve() {
+        for (Function &F : M) {
+            if (!F.isDeclaration() && F.hasAddressTaken())
+                AddressTakenFunctions.push_back(&F);
+            for (Instruction &I : instructions(F)) {
+                auto *AI = dyn_cast<AllocaInst>(&I);
+                if (AI && isPromotableSlot(*AI))
+                    SlotToNode[AI] = createNode();
+            }
+        }
+        for (Function &F : M) {
+            for (Instruction &I : instructions(F))
+                addConstraints(I);
+        }
+        while (!Worklist.empty()) {
+            unsigned N = Worklist.pop_back_val();
+            InWorklist[N] = false;
+            propagate(N);
+        }
+        LLVM_DEBUG(llvm::outs() << "ControlFlowAnalysis: " << Info.Nodes.size()
+                                << " nodes, " << Edges.size() << " edges\n");
+    }
+};
+
+const ControlFlowInfo::FunctionSet *
+ControlFlowInfo::getCallees(const CallBase &CB) const {
+    auto It = ValueToNode.find(CB.getCalledOperand()->stripPointerCasts());
+    if (It == ValueToNode.end() || Nodes[It->second].Unknown)
+        return nullptr;
+    return &Nodes[It->second].Functions;
+}
+
+AnalysisKey ControlFlowAnalysis::Key;
+
+ControlFlowInfo ControlFlowAnalysis::run(Module &M, ModuleAnalysisManager &AM) {
+    ControlFlowInfo Info;
+    ControlFlowSolver(M, Info).solve();
+    return Info;
+}
+
+}  // namespace remniw
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SetVector.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/InstrTypes.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/PassManager.h"
+#include <vector>
+
+namespace remniw {
+
+// The functions the values of the module may hold, computed by ControlFlowAnalysis.
+class ControlFlowInfo {
+public:
+    using FunctionSet = llvm::SetVector<llvm::Function *>;
+
+    // The functions the indirect call site CB may call, or nullptr if its callee
+    // may hold a function the analysis does not know about, e.g. a value loaded
+    // from an array.
+    const FunctionSet *getCallees(const llvm::CallBase &CB) const;
+
+private:
+    friend class ControlFlowSolver;
+
+    struct Node {
+        FunctionSet Functions;
+        // The node may hold a function which is not in Functions.
+        bool Unknown = false;
+    };
+
+    llvm::DenseMap<const llvm::Value *, unsigned> ValueToNode;
+    std::vector<Node> Nodes;
+};
+
+// 0-CFA over the module: a flow-insensitive, context-insensitive analysis of which
+// functions every pointer value may hold.
+//
+// Every pointer value, every stack slot whose address does not escape and the
+// return value of every function is a node holding a set of functions. A function
+// used as a value is added to the set of its user, and the copies through phi,
+// select, casts, the stack slots, arguments and return values add subset
+// constraints between the nodes. The sets are propagated to a fixed point with a
+// worklist. The constraints of a call through a pointer are added on the fly, each
+// time a new function reaches its callee.
+//
+// Values loaded from other memory, e.g. arrays or pointer parameters, hold unknown
+// functions. A call through such a value may call every function whose address is
+// taken, so their parameters hold unknown functions too.
+class ControlFlowAnalysis: public llvm::AnalysisInfoMixin<ControlFlowAnalysis> {
+    friend llvm::AnalysisInfoMixin<ControlFlowAnalysis>;
+    static llvm::AnalysisKey Key;
+
+public:
+    using Result = ControlFlowInfo;
+
+    ControlFlowInfo run(llvm::Module &M, llvm::ModuleAnalysisManager &AM);
+};
+
+}  // namespace remniw
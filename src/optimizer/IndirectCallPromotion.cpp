@@ -0,0 +1,64 @@
+#include "optimizer/IndirectCallPromotion.h"
+#include "optimizer/ControlFlowAnalysis.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/Utils/CallPromotionUtils.h"
+
+#define DEBUG_TYPE "remniw-icp"
+
+using namespace llvm;
+
+extern cl::OptionCategory RemniwCat;
+
+static cl::opt<unsigned> ICPMaxTargets(
+    "icp-max-targets",
+    cl::desc("Promote an indirect call site which may call at most this many functions"),
+    cl::init(3), cl::cat(RemniwCat));
+
+namespace remniw {
+
+PreservedAnalyses IndirectCallPromotionPass::run(Module &M, ModuleAnalysisManager &AM) {
+    auto &CFI = AM.getResult<ControlFlowAnalysis>(M);
+
+    // The call sites and their callees are collected first, since promoting a call
+    // site splits its basic block.
+    SmallVector<std::pair<CallBase *, SmallVector<Function *, 4>>> Promotions;
+    for (Function &F : M) {
+        for (Instruction &I : instructions(F)) {
+            auto *CB = dyn_cast<CallBase>(&I);
+            if (!CB || !CB->isIndirectCall())
+                continue;
+            const ControlFlowInfo::FunctionSet *Callees = CFI.getCallees(*CB);
+            if (!Callees || Callees->empty() || Callees->size() > ICPMaxTargets)
+                continue;
+            bool IsLegal = llvm::all_of(
+                *Callees, [CB](Function *Callee) { return isLegalToPromote(*CB, Callee); });
+            if (IsLegal)
+                Promotions.push_back(
+                    {CB, SmallVector<Function *, 4>(Callees->begin(), Callees->end())});
+        }
+    }
+
+    for (auto &[CB, Callees] : Promotions) {
+        LLVM_DEBUG(llvm::outs() << "IndirectCallPromotion: " << Callees.size()
+                                << " callees in " << CB->getFunction()->getName()
+                                << "\n");
+        if (Callees.size() == 1) {
+            promoteCall(*CB, Callees.front());
+            continue;
+        }
+        // The original call site is moved into the else block of each guard.
+        for (Function *Callee : Callees)
+            promoteCallWithIfThenElse(*CB, Callee);
+    }
+
+    if (Promotions.empty())
+        return PreservedAnalyses::all();
+    return PreservedAnalyses::none();
+}
+
+}  // namespace remniw
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "llvm/IR/Module.h"
+#include "llvm/IR/PassManager.h"
+
+namespace remniw {
+
+// Turn calls through function values into direct calls.
+//
+// ControlFlowAnalysis finds the functions every indirect call site may call. A call
+// site which may only call one function calls it directly. A call site which may
+// call at most -icp-max-targets functions compares its callee with each of them in
+// turn and calls the equal one directly, the indirect call is kept as the last
+// fallback. The direct calls can then be inlined by InlinerPass.
+class IndirectCallPromotionPass: public llvm::PassInfoMixin<IndirectCallPromotionPass> {
+public:
+    llvm::PreservedAnalyses run(llvm::Module &M, llvm::ModuleAnalysisManager &AM);
+};
+
+}  // namespace remniw
@@ -0,0 +1,237 @@
+#include "optimizer/Inliner.h"
+#include "optimizer/SCCP.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/SCCIterator.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Analysis/CallGraph.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+#include <vector>
+
+#define DEBUG_TYPE "remniw-inliner"
+
+using namespace llvm;
+
+extern cl::OptionCategory RemniwCat;
+
+static cl::opt<int>
+    InlineThreshold("inliner-threshold",
+                    cl::desc("Inline a call site if its cost is at most this"),
+                    cl::init(25), cl::cat(RemniwCat));
+
+static cl::opt<unsigned> InlineMaxDepth(
+    "inliner-max-depth",
+    cl::desc("Unroll a recursive function by inlining at most this many levels"),
+    cl::init(2), cl::cat(RemniwCat));
+
+static cl::opt<bool> InlineRemarks("inliner-remarks",
+                                   cl::desc("Print the inlining decisions to stderr"),
+                                   cl::init(false), cl::cat(RemniwCat));
+
+namespace remniw {
+
+namespace {
+
+// The cost of the call instruction, the return and the frame setup of the callee,
+// which are saved by inlining. Passing an argument costs one more.
+constexpr int CallPenalty = 3;
+
+class Inliner {
+private:
+    Module &M;
+    FunctionAnalysisManager &FAM;
+    // The functions of the components which contain a cycle.
+    DenseSet<Function *> RecursiveFunctions;
+    // The sizes of the functions which did not change since they were computed.
+    DenseMap<Function *, int> Sizes;
+    // The number of inlined bodies which enclose a call site of the function being
+    // visited, a call site which is not in the map was there before.
+    DenseMap<CallBase *, unsigned> Depths;
+    bool Changed = false;
+
+    // The size of F in instructions the backend emits code for. The allocas in the
+    // entry block are part of the stack frame, and the unconditional branches
+    // mostly disappear when the blocks are merged, so they are free.
+    int getSize(Function &F) {
+        auto It = Sizes.find(&F);
+        if (It != Sizes.end())
+            return It->second;
+        int Size = 0;
+        for (Instruction &I : instructions(F)) {
+            if (isa<AllocaInst>(I))
+                continue;
+            if (auto *BI = dyn_cast<BranchInst>(&I); BI && BI->isUnconditional())
+                continue;
+            ++Size;
+        }
+        Sizes[&F] = Size;
+        return Size;
+    }
+
+    // The instructions of the callee which fold to a constant when the parameter
+    // Param is a constant: the arithmetic and comparisons with a constant operand.
+    static int getNumFoldedUsers(Argument &Param) {
+        int NumFolded = 0;
+        for (User *U : Param.users()) {
+            if (!isa<BinaryOperator>(U) && !isa<CmpInst>(U))
+                continue;
+            auto *I = cast<Instruction>(U);
+            if (isa<Constant>(I->getOperand(0)) || isa<Constant>(I->getOperand(1)) ||
+                I->getOperand(0) == I->getOperand(1))
+                ++NumFolded;
+        }
+        return NumFolded;
+    }
+
+    // The size of Body, which is inlined at CB, less the benefit of inlining it.
+    int getCost(CallBase &CB, Function &Body) {
+        int Cost = getSize(Body) - CallPenalty - static_cast<int>(CB.arg_size());
+        for (unsigned I = 0, E = CB.arg_size(); I != E; ++I) {
+            if (isa<Constant>(CB.getArgOperand(I)))
+                Cost -= getNumFoldedUsers(*Body.getArg(I));
+        }
+        return Cost;
+    }
+
+    void remark(Function &Callee, Function &Caller, const Twine &Message,
+                const Twine &Reason) {
+        if (InlineRemarks)
+            errs() << "remark: " << Message << " '" << Callee.getName() << "' into '"
+                   << Caller.getName() << "': " << Reason << "\n";
+    }
+
+    // Inline the calls in F, and the calls in the inlined bodies, until the cost
+    // model rejects them. Snapshots maps the functions of a recursive component to
+    // copies of their bodies from before the component was visited.
+    void visitFunction(Function &F, const DenseMap<Function *, Function *> &Snapshots) {
+        SmallVector<CallBase *> Worklist;
+        for (Instruction &I : instructions(F)) {
+            if (auto *CB = dyn_cast<CallBase>(&I))
+                Worklist.push_back(CB);
+        }
+
+        bool Inlined = false;
+        for (size_t Idx = 0; Idx < Worklist.size(); ++Idx) {
+            CallBase *CB = Worklist[Idx];
+            Function *Callee = CB->getCalledFunction();
+            if (!Callee || Callee->isDeclaration() || Callee->isVarArg())
+                continue;
+
+            unsigned Depth = Depths.lookup(CB);
+            if (RecursiveFunctions.count(Callee) && Depth >= InlineMaxDepth) {
+                remark(*Callee, F, "not inlined", "recursion depth " + Twine(Depth) +
+                                                      " reached the limit " +
+                                                      Twine(InlineMaxDepth));
+                continue;
+            }
+
+            // F can not be copied into itself while it changes, so the copy made
+            // before its component was visited is inlined instead.
+            Function *Body = Callee == &F ? Snapshots.lookup(Callee) : Callee;
+            assert(Body && "Missing the snapshot of a recursive function");
+            int Cost = getCost(*CB, *Body);
+            if (Cost > InlineThreshold) {
+                remark(*Callee, F, "not inlined",
+                       "cost " + Twine(Cost) + " exceeds the threshold " +
+                           Twine(InlineThreshold));
+                continue;
+            }
+
+            CB->setCalledFunction(Body);
+            InlineFunctionInfo IFI;
+            // The backends do not lower the lifetime intrinsics.
+#if LLVM_VERSION_MAJOR < 15
+            InlineResult Result =
+                InlineFunction(*CB, IFI, /*CalleeAAR*/ nullptr, /*InsertLifetime*/ false);
+#else
+            InlineResult Result =
+                InlineFunction(*CB, IFI, /*MergeAttributes*/ false, /*CalleeAAR*/ nullptr,
+                               /*InsertLifetime*/ false);
+#endif
+            if (!Result.isSuccess()) {
+                CB->setCalledFunction(Callee);
+                remark(*Callee, F, "not inlined", Result.getFailureReason());
+                continue;
+            }
+            remark(*Callee, F, "inlined",
+                   "cost " + Twine(Cost) + ", threshold " + Twine(InlineThreshold));
+            LLVM_DEBUG(llvm::outs() << "Inliner: inlined " << Callee->getName()
+                                    << " into " << F.getName() << " at depth " << Depth
+                                    << "\n");
+            Depths.erase(CB);
+            for (CallBase *NewCB : IFI.InlinedCallSites) {
+                Depths[NewCB] = Depth + 1;
+                Worklist.push_back(NewCB);
+            }
+            Inlined = true;
+        }
+        Depths.clear();
+
+        if (!Inlined)
+            return;
+        Changed = true;
+        // Simplify F before its callers consider to inline it.
+        FAM.invalidate(F, PreservedAnalyses::none());
+        PreservedAnalyses PA = SCCPPass().run(F, FAM);
+        FAM.invalidate(F, PA);
+        Sizes.erase(&F);
+    }
+
+public:
+    Inliner(Module &M, FunctionAnalysisManager &FAM): M(M), FAM(FAM) {}
+
+    bool run() {
+        // The components in post-order, computed before the call graph goes stale.
+        std::vector<std::vector<Function *>> Components;
+        {
+            CallGraph CG(M);
+            for (auto It = scc_begin(&CG); !It.isAtEnd(); ++It) {
+                std::vector<Function *> Functions;
+                for (CallGraphNode *Node : *It) {
+                    Function *F = Node->getFunction();
+                    if (F && !F->isDeclaration())
+                        Functions.push_back(F);
+                }
+                if (It.hasCycle())
+                    RecursiveFunctions.insert(Functions.begin(), Functions.end());
+                if (!Functions.empty())
+                    Components.push_back(std::move(Functions));
+            }
+        }
+
+        for (auto &Functions : Components) {
+            DenseMap<Function *, Function *> Snapshots;
+            if (RecursiveFunctions.count(Functions.front())) {
+                for (Function *F : Functions) {
+                    ValueToValueMapTy VMap;
+                    Snapshots[F] = CloneFunction(F, VMap);
+                }
+            }
+            for (Function *F : Functions)
+                visitFunction(*F, Snapshots);
+            for (auto &[F, Snapshot] : Snapshots) {
+                Sizes.erase(Snapshot);
+                Snapshot->eraseFromParent();
+            }
+        }
+        return Changed;
+    }
+};
+
+}  // namespace
+
+PreservedAnalyses InlinerPass::run(Module &M, ModuleAnalysisManager &AM) {
+    auto &FAM = AM.getResult<FunctionAnalysisManagerModuleProxy>(M).getManager();
+    Inliner TheInliner(M, FAM);
+    if (!TheInliner.run())
+        return PreservedAnalyses::all();
+    return PreservedAnalyses::none();
+}
+
+}  // namespace remniw
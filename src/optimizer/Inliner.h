@@ -0,0 +1,29 @@
+#pragma once
+
+#include "llvm/IR/Module.h"
+#include "llvm/IR/PassManager.h"
+
+namespace remniw {
+
+// Inline direct calls to small functions.
+//
+// The functions are visited bottom-up in the call graph: the strongly connected
+// components are visited in post-order, so the calls in a callee have been
+// inlined and the callee has been simplified by SCCPPass before its callers
+// decide whether to inline it. The cost of a call site is the size of the callee
+// less the benefit of inlining it: the call overhead and the instructions of the
+// callee that fold with the constant arguments. A call site is inlined if the
+// cost is at most -inliner-threshold.
+//
+// A call to a function of a recursive component is only inlined while fewer than
+// -inliner-max-depth inlined bodies enclose it, and a function inlined into itself
+// is copied from its body as it was before its component was visited. So a
+// recursive function like fib is unrolled a few levels instead of without bound.
+//
+// -inliner-remarks prints the decision about every call site to stderr.
+class InlinerPass: public llvm::PassInfoMixin<InlinerPass> {
+public:
+    llvm::PreservedAnalyses run(llvm::Module &M, llvm::ModuleAnalysisManager &AM);
+};
+
+}  // namespace remniw
@@ -0,0 +1,163 @@
+#include "optimizer/LICM.h"
+#include "optimizer/NaturalLoopAnalysis.h"
+#include "optimizer/PointsToAnalysis.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/raw_ostream.h"
+
+#define DEBUG_TYPE "remniw-licm"
+
+using namespace llvm;
+
+namespace remniw {
+
+namespace {
+
+class LoopInvariantCodeMotion {
+private:
+    Function &F;
+    const NaturalLoopInfo &LI;
+    DominatorTree &DT;
+    const PointsToInfo &PTI;
+    // The instructions of the loop being visited which may write to memory.
+    SmallVector<StoreInst *, 8> Stores;
+    SmallVector<CallBase *, 4> Calls;
+    bool HasOtherWrites = false;
+    SmallVector<BasicBlock *, 4> ExitingBlocks;
+
+    void collectLoopInfo(const NaturalLoop &L) {
+        Stores.clear();
+        Calls.clear();
+        HasOtherWrites = false;
+        ExitingBlocks.clear();
+        L.getExitingBlocks(ExitingBlocks);
+        for (BasicBlock *BB : L.getBlocks()) {
+            for (Instruction &I : *BB) {
+                if (auto *SI = dyn_cast<StoreInst>(&I))
+                    Stores.push_back(SI);
+                else if (auto *CB = dyn_cast<CallBase>(&I))
+                    Calls.push_back(CB);
+                else if (I.mayWriteToMemory())
+                    HasOtherWrites = true;
+            }
+        }
+    }
+
+    // A division traps if its divisor is 0, or overflows if it is -1.
+    static bool isSafeToSpeculate(const BinaryOperator &BO) {
+        auto *Divisor = dyn_cast<ConstantInt>(BO.getOperand(1));
+        switch (BO.getOpcode()) {
+        case Instruction::SDiv:
+        case Instruction::SRem:
+            return Divisor && !Divisor->isZero() && !Divisor->isMinusOne();
+        case Instruction::UDiv:
+        case Instruction::URem: return Divisor && !Divisor->isZero();
+        default: return true;
+        }
+    }
+
+    bool isInvariantLoad(const LoadInst &Load, const NaturalLoop &L) {
+        if (Load.isVolatile() || HasOtherWrites)
+            return false;
+        // The load may only be executed in the preheader if it would have been
+        // executed anyway, e.g. not a load of an element in the body of a loop which
+        // checks the bounds of the index in its header.
+        const BasicBlock *BB = Load.getParent();
+        if (BB != L.getHeader() &&
+            (ExitingBlocks.empty() || !llvm::all_of(ExitingBlocks, [&](BasicBlock *E) {
+                return DT.dominates(BB, E);
+            })))
+            return false;
+        const Value *Ptr = Load.getPointerOperand();
+        if (llvm::any_of(Stores, [&](StoreInst *SI) {
+                return PTI.mayAlias(SI->getPointerOperand(), Ptr);
+            }))
+            return false;
+        return llvm::none_of(Calls,
+                             [&](CallBase *CB) { return PTI.mayModify(*CB, Ptr); });
+    }
+
+    bool canHoist(Instruction &I, const NaturalLoop &L) {
+        if (!llvm::all_of(I.operands(),
+                          [&](const Use &U) { return L.isLoopInvariant(U.get()); }))
+            return false;
+        if (auto *BO = dyn_cast<BinaryOperator>(&I))
+            return isSafeToSpeculate(*BO);
+        if (isa<GetElementPtrInst>(I) || isa<CastInst>(I))
+            return true;
+        if (auto *Load = dyn_cast<LoadInst>(&I))
+            return isInvariantLoad(*Load, L);
+        return false;
+    }
+
+    void hoist(const NaturalLoop &L) {
+        BasicBlock *Preheader = L.getPreheader();
+        if (!Preheader)
+            return;
+        collectLoopInfo(L);
+        // The instructions of the inner loops have been hoisted to their preheaders,
+        // which are blocks of L. The blocks are in reverse post-order, so the operands
+        // of an instruction are hoisted before it.
+        for (BasicBlock *BB : L.getBlocks()) {
+            if (LI.getLoopFor(BB) != &L)
+                continue;
+            for (Instruction &I : make_early_inc_range(*BB)) {
+                if (!canHoist(I, L))
+                    continue;
+                LLVM_DEBUG(llvm::outs() << "LICM: hoist" << I << " to "
+                                        << Preheader->getName() << "\n");
+                I.moveBefore(Preheader->getTerminator());
+                ++NumHoisted;
+            }
+        }
+    }
+
+public:
+    unsigned NumHoisted = 0;
+
+    LoopInvariantCodeMotion(Function &F, const NaturalLoopInfo &LI, DominatorTree &DT,
+                            const PointsToInfo &PTI):
+        F(F), LI(LI), DT(DT), PTI(PTI) {}
+
+    void run() {
+        for (NaturalLoop *L : LI.getLoopsInnermostFirst())
+            hoist(*L);
+        LLVM_DEBUG(llvm::outs() << "LICM: " << NumHoisted << " instructions hoisted in "
+                                << F.getName() << "\n");
+    }
+};
+
+}  // namespace
+
+PreservedAnalyses LICMPass::run(Module &M, ModuleAnalysisManager &AM) {
+    auto &PTI = AM.getResult<PointsToAnalysis>(M);
+    auto &FAM = AM.getResult<FunctionAnalysisManagerModuleProxy>(M).getManager();
+    bool Changed = false;
+    for (Function &F : M) {
+        if (F.isDeclaration())
+            continue;
+        if (FAM.getResult<NaturalLoopAnalysis>(F).empty())
+            continue;
+        if (insertLoopPreheaders(F, FAM.getResult<NaturalLoopAnalysis>(F))) {
+            FAM.invalidate(F, PreservedAnalyses::none());
+            Changed = true;
+        }
+        LoopInvariantCodeMotion Hoister(F, FAM.getResult<NaturalLoopAnalysis>(F),
+                                        FAM.getResult<DominatorTreeAnalysis>(F), PTI);
+        Hoister.run();
+        Changed |= Hoister.NumHoisted != 0;
+    }
+    if (!Changed)
+        return PreservedAnalyses::all();
+    // Moving instructions between blocks keeps the CFG and the points-to sets.
+    PreservedAnalyses PA;
+    PA.preserveSet<CFGAnalyses>();
+    PA.preserve<PointsToAnalysis>();
+    return PA;
+}
+
+}  // namespace remniw
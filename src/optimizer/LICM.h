@@ -0,0 +1,25 @@
+#pragma once
+
+#include "llvm/IR/Module.h"
+#include "llvm/IR/PassManager.h"
+
+namespace remniw {
+
+// Loop-invariant code motion.
+//
+// The loops found by NaturalLoopAnalysis are visited from the innermost ones, and an
+// instruction whose operands are all computed outside the loop is moved to the end of
+// its preheader, so it is executed once instead of in every iteration. The code
+// hoisted out of an inner loop may then be hoisted out of the outer loop as well.
+//
+// Arithmetic, casts and getelementptrs are hoisted, except a division whose divisor
+// may be 0 or -1. A load is hoisted if no store or call in the loop may write to the
+// memory it reads, as told by PointsToAnalysis, and it is executed whenever the loop
+// is entered, i.e. its block dominates every block the loop exits from. Comparisons
+// stay in the loop, since the backends emit them right before the branch on them.
+class LICMPass: public llvm::PassInfoMixin<LICMPass> {
+public:
+    llvm::PreservedAnalyses run(llvm::Module &M, llvm::ModuleAnalysisManager &AM);
+};
+
+}  // namespace remniw
@@ -0,0 +1,330 @@
+#include "optimizer/Mem2Reg.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SetVector.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Analysis/ConstantFolding.h"
+#include "llvm/IR/CFG.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/raw_ostream.h"
+
+#define DEBUG_TYPE "remniw-mem2reg"
+
+using namespace llvm;
+
+namespace remniw {
+
+namespace {
+
+// An alloca can be promoted if it holds a single integer or pointer, and it is
+// only loaded from and stored to, i.e. its address never escapes.
+bool isAllocaPromotable(const AllocaInst *AI) {
+    if (AI->isArrayAllocation())
+        return false;
+    llvm::Type *Ty = AI->getAllocatedType();
+    if (!Ty->isIntegerTy() && !Ty->isPointerTy())
+        return false;
+    for (const User *U : AI->users()) {
+        if (const auto *LI = dyn_cast<LoadInst>(U)) {
+            if (LI->isVolatile() || LI->getType() != Ty)
+                return false;
+        } else if (const auto *SI = dyn_cast<StoreInst>(U)) {
+            if (SI->getValueOperand() == AI || SI->isVolatile() ||
+                SI->getValueOperand()->getType() != Ty)
+                return false;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+class AllocaPromoter {
+private:
+    Function &F;
+    DominatorTree &DT;
+    SmallVector<AllocaInst *> Allocas;
+    DenseMap<AllocaInst *, unsigned> AllocaIndex;
+    // The phi nodes inserted by the promoter, mapped to the alloca they stand for.
+    DenseMap<PHINode *, unsigned> PhiToAllocaIndex;
+    SmallVector<PHINode *> Phis;
+    DenseMap<BasicBlock *, SmallSetVector<BasicBlock *, 4>> DominanceFrontiers;
+    SmallPtrSet<BasicBlock *, 32> Visited;
+
+public:
+    AllocaPromoter(Function &F, DominatorTree &DT, ArrayRef<AllocaInst *> Allocas):
+        F(F), DT(DT), Allocas(Allocas.begin(), Allocas.end()) {
+        for (unsigned i = 0, e = this->Allocas.size(); i != e; ++i)
+            AllocaIndex[this->Allocas[i]] = i;
+    }
+
+    void run() {
+        computeDominanceFrontiers();
+        insertPhis();
+        rename();
+        cleanupUnreachableBlocks();
+        for (auto *AI : Allocas)
+            AI->eraseFromParent();
+        removeDeadPhis();
+        removeTrivialPhis();
+        foldConstants();
+    }
+
+private:
+    // The dominance frontier algorithm of Cooper, Harvey and Kennedy: a join
+    // point is in the dominance frontier of every block on the dominator tree
+    // path from each of its predecessors up to (but excluding) its idom.
+    void computeDominanceFrontiers() {
+        for (BasicBlock &BB : F) {
+            if (!DT.isReachableFromEntry(&BB) || !BB.hasNPredecessorsOrMore(2))
+                continue;
+            BasicBlock *IDom = DT.getNode(&BB)->getIDom()->getBlock();
+            for (BasicBlock *Pred : predecessors(&BB)) {
+                if (!DT.isReachableFromEntry(Pred))
+                    continue;
+                for (BasicBlock *Runner = Pred; Runner != IDom;
+                     Runner = DT.getNode(Runner)->getIDom()->getBlock())
+                    DominanceFrontiers[Runner].insert(&BB);
+            }
+        }
+    }
+
+    // Place phi nodes at the iterated dominance frontier of the defining blocks.
+    void insertPhis() {
+        for (unsigned Idx = 0, e = Allocas.size(); Idx != e; ++Idx) {
+            AllocaInst *AI = Allocas[Idx];
+            SmallVector<BasicBlock *> Worklist;
+            SmallPtrSet<BasicBlock *, 16> OnWorklist;
+            for (User *U : AI->users()) {
+                if (auto *SI = dyn_cast<StoreInst>(U)) {
+                    BasicBlock *BB = SI->getParent();
+                    if (DT.isReachableFromEntry(BB) && OnWorklist.insert(BB).second)
+                        Worklist.push_back(BB);
+                }
+            }
+            SmallPtrSet<BasicBlock *, 16> HasPhi;
+            while (!Worklist.empty()) {
+                BasicBlock *BB = Worklist.pop_back_val();
+                auto It = DominanceFrontiers.find(BB);
+                if (It == DominanceFrontiers.end())
+                    continue;
+                for (BasicBlock *Frontier : It->second) {
+                    if (!HasPhi.insert(Frontier).second)
+                        continue;
+                    auto *PN =
+                        PHINode::Create(AI->getAllocatedType(), pred_size(Frontier),
+                                        AI->getName(), &Frontier->front());
+                    PhiToAllocaIndex[PN] = Idx;
+                    Phis.push_back(PN);
+                    // A phi node is a new definition of the variable.
+                    if (OnWorklist.insert(Frontier).second)
+                        Worklist.push_back(Frontier);
+                }
+            }
+        }
+    }
+
+    // Walk the CFG from the entry block, carrying the current value of every
+    // promoted variable, replace loads with it and record stores into it.
+    void rename() {
+        struct RenameItem {
+            BasicBlock *BB;
+            BasicBlock *Pred;
+            SmallVector<Value *> Values;
+        };
+
+        SmallVector<Value *> InitialValues;
+        for (auto *AI : Allocas)
+            InitialValues.push_back(Constant::getNullValue(AI->getAllocatedType()));
+
+        SmallVector<RenameItem> Worklist;
+        Worklist.push_back({&F.getEntryBlock(), nullptr, std::move(InitialValues)});
+        while (!Worklist.empty()) {
+            RenameItem Item = std::move(Worklist.back());
+            Worklist.pop_back();
+            BasicBlock *BB = Item.BB;
+
+            for (PHINode &PN : BB->phis()) {
+                auto It = PhiToAllocaIndex.find(&PN);
+                if (It != PhiToAllocaIndex.end())
+                    PN.addIncoming(Item.Values[It->second], Item.Pred);
+            }
+            if (!Visited.insert(BB).second)
+                continue;
+            for (PHINode &PN : BB->phis()) {
+                auto It = PhiToAllocaIndex.find(&PN);
+                if (It != PhiToAllocaIndex.end())
+                    Item.Values[It->second] = &PN;
+            }
+
+            for (auto It = BB->begin(), End = BB->end(); It != End;) {
+                Instruction *I = &*It++;
+                if (auto *LI = dyn_cast<LoadInst>(I)) {
+                    auto AIt = AllocaIndex.find(
+                        dyn_cast<AllocaInst>(LI->getPointerOperand()));
+                    if (AIt == AllocaIndex.end())
+                        continue;
+                    LI->replaceAllUsesWith(Item.Values[AIt->second]);
+                    LI->eraseFromParent();
+                } else if (auto *SI = dyn_cast<StoreInst>(I)) {
+                    auto AIt = AllocaIndex.find(
+                        dyn_cast<AllocaInst>(SI->getPointerOperand()));
+                    if (AIt == AllocaIndex.end())
+                        continue;
+                    Item.Values[AIt->second] = SI->getValueOperand();
+                    SI->eraseFromParent();
+                }
+            }
+
+            for (BasicBlock *Succ : successors(BB))
+                Worklist.push_back({Succ, BB, Item.Values});
+        }
+    }
+
+    // Loads and stores in unreachable blocks are not visited by rename().
+    // Give the phi nodes an incoming value for edges out of those blocks too.
+    void cleanupUnreachableBlocks() {
+        for (BasicBlock &BB : F) {
+            if (Visited.count(&BB))
+                continue;
+            for (auto It = BB.begin(), End = BB.end(); It != End;) {
+                Instruction *I = &*It++;
+                Value *Ptr = nullptr;
+                if (auto *LI = dyn_cast<LoadInst>(I))
+                    Ptr = LI->getPointerOperand();
+                else if (auto *SI = dyn_cast<StoreInst>(I))
+                    Ptr = SI->getPointerOperand();
+                auto *AI = dyn_cast_or_null<AllocaInst>(Ptr);
+                if (!AI || !AllocaIndex.count(AI))
+                    continue;
+                if (!I->getType()->isVoidTy())
+                    I->replaceAllUsesWith(Constant::getNullValue(I->getType()));
+                I->eraseFromParent();
+            }
+        }
+        for (auto *PN : Phis) {
+            for (BasicBlock *Pred : predecessors(PN->getParent()))
+                if (!Visited.count(Pred))
+                    PN->addIncoming(Constant::getNullValue(PN->getType()), Pred);
+        }
+    }
+
+    // Phi nodes are placed wherever a variable has more than one reaching
+    // definition, even if the variable is dead there. Only keep the phi nodes
+    // that (transitively) feed an instruction other than our phi nodes.
+    void removeDeadPhis() {
+        SmallPtrSet<PHINode *, 32> Live;
+        SmallVector<PHINode *> Worklist;
+        for (auto *PN : Phis) {
+            for (User *U : PN->users()) {
+                auto *UserPN = dyn_cast<PHINode>(U);
+                if (!UserPN || !PhiToAllocaIndex.count(UserPN)) {
+                    Live.insert(PN);
+                    Worklist.push_back(PN);
+                    break;
+                }
+            }
+        }
+        while (!Worklist.empty()) {
+            PHINode *PN = Worklist.pop_back_val();
+            for (Value *V : PN->incoming_values()) {
+                auto *IncomingPN = dyn_cast<PHINode>(V);
+                if (IncomingPN && PhiToAllocaIndex.count(IncomingPN) &&
+                    Live.insert(IncomingPN).second)
+                    Worklist.push_back(IncomingPN);
+            }
+        }
+
+        SmallVector<PHINode *> Dead;
+        for (auto *PN : Phis)
+            if (!Live.count(PN))
+                Dead.push_back(PN);
+        for (auto *PN : Dead)
+            PN->dropAllReferences();
+        for (auto *PN : Dead) {
+            PhiToAllocaIndex.erase(PN);
+            PN->eraseFromParent();
+        }
+        llvm::erase_if(Phis, [&](PHINode *PN) { return !Live.count(PN); });
+    }
+
+    // A phi node whose incoming values are all the same value (or the phi
+    // itself) is replaced by that value.
+    void removeTrivialPhis() {
+        bool Changed = true;
+        while (Changed) {
+            Changed = false;
+            for (auto *&PN : Phis) {
+                if (!PN)
+                    continue;
+                Value *Same = nullptr;
+                bool Trivial = true;
+                for (Value *V : PN->incoming_values()) {
+                    if (V == PN || V == Same)
+                        continue;
+                    if (Same) {
+                        Trivial = false;
+                        break;
+                    }
+                    Same = V;
+                }
+                if (!Trivial || !Same)
+                    continue;
+                PN->replaceAllUsesWith(Same);
+                PN->eraseFromParent();
+                PN = nullptr;
+                Changed = true;
+            }
+        }
+        llvm::erase_if(Phis, [](PHINode *PN) { return PN == nullptr; });
+    }
+
+    // Loads of constant-initialized variables are now replaced by constants.
+    // Fold the instructions with only constant operands, the backend does not
+    // select instructions for them.
+    void foldConstants() {
+        const DataLayout &DL = F.getParent()->getDataLayout();
+        SmallSetVector<Instruction *, 16> Worklist;
+        for (BasicBlock &BB : F)
+            for (Instruction &I : BB)
+                Worklist.insert(&I);
+        while (!Worklist.empty()) {
+            Instruction *I = Worklist.pop_back_val();
+            Constant *C = ConstantFoldInstruction(I, DL);
+            // Do not fold into undef or poison, e.g. a division by zero.
+            if (!C || !isa<ConstantInt>(C))
+                continue;
+            for (User *U : I->users())
+                Worklist.insert(cast<Instruction>(U));
+            I->replaceAllUsesWith(C);
+            I->eraseFromParent();
+        }
+    }
+};
+
+}  // namespace
+
+PreservedAnalyses Mem2RegPass::run(Function &F, FunctionAnalysisManager &AM) {
+    SmallVector<AllocaInst *> Allocas;
+    for (Instruction &I : F.getEntryBlock())
+        if (auto *AI = dyn_cast<AllocaInst>(&I))
+            if (isAllocaPromotable(AI))
+                Allocas.push_back(AI);
+    if (Allocas.empty())
+        return PreservedAnalyses::all();
+
+    LLVM_DEBUG(llvm::outs() << "Mem2Reg: promote " << Allocas.size()
+                            << " allocas in function " << F.getName() << "\n");
+    auto &DT = AM.getResult<DominatorTreeAnalysis>(F);
+    AllocaPromoter(F, DT, Allocas).run();
+
+    PreservedAnalyses PA;
+    PA.preserveSet<CFGAnalyses>();
+    return PA;
+}
+
+}  // namespace remniw
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "llvm/IR/Function.h"
+#include "llvm/IR/PassManager.h"
+
+namespace remniw {
+
+// Promote the stack slots of scalar local variables to SSA registers.
+//
+// IRCodeGenerator gives every variable an alloca in the entry block and
+// accesses it through loads and stores. An alloca whose only users are loads
+// and stores of the variable itself is removed: phi nodes are placed at the
+// iterated dominance frontier of the blocks that store to it, then every load
+// is replaced by the value that reaches it.
+//
+// Reading a variable before it is assigned yields 0, so that the promoted IR
+// does not contain undef values the backend can not lower.
+class Mem2RegPass: public llvm::PassInfoMixin<Mem2RegPass> {
+public:
+    llvm::PreservedAnalyses run(llvm::Function &F, llvm::FunctionAnalysisManager &AM);
+};
+
+}  // namespace remniw
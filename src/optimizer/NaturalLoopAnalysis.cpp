@@ -0,0 +1,143 @@
+#include "optimizer/NaturalLoopAnalysis.h"
+#include "llvm/ADT/PostOrderIterator.h"
+#include "llvm/IR/CFG.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/Instruction.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/Utils/BasicBlockUtils.h"
+
+#define DEBUG_TYPE "remniw-loops"
+
+using namespace llvm;
+
+namespace remniw {
+
+BasicBlock *NaturalLoop::getPreheader() const {
+    BasicBlock *Preheader = nullptr;
+    for (BasicBlock *Pred : predecessors(getHeader())) {
+        if (contains(Pred))
+            continue;
+        if (Preheader && Preheader != Pred)
+            return nullptr;
+        Preheader = Pred;
+    }
+    if (!Preheader || Preheader->getTerminator()->getNumSuccessors() != 1)
+        return nullptr;
+    return Preheader;
+}
+
+void NaturalLoop::getExitingBlocks(SmallVectorImpl<BasicBlock *> &Exiting) const {
+    for (BasicBlock *BB : Blocks) {
+        if (llvm::any_of(successors(BB), [&](BasicBlock *S) { return !contains(S); }))
+            Exiting.push_back(BB);
+    }
+}
+
+bool NaturalLoop::isLoopInvariant(const Value *V) const {
+    auto *I = dyn_cast<Instruction>(V);
+    return !I || !contains(I);
+}
+
+unsigned NaturalLoop::getLoopDepth() const {
+    unsigned Depth = 1;
+    for (NaturalLoop *L = Parent; L; L = L->Parent)
+        ++Depth;
+    return Depth;
+}
+
+SmallVector<NaturalLoop *, 8> NaturalLoopInfo::getLoopsInnermostFirst() const {
+    SmallVector<NaturalLoop *, 8> Result;
+    for (auto &L : Loops)
+        Result.push_back(L.get());
+    return Result;
+}
+
+AnalysisKey NaturalLoopAnalysis::Key;
+
+NaturalLoopInfo NaturalLoopAnalysis::run(Function &F, FunctionAnalysisManager &AM) {
+    auto &DT = AM.getResult<DominatorTreeAnalysis>(F);
+    NaturalLoopInfo LI;
+
+    // The outermost loop found so far which contains the loop L.
+    auto GetOutermost = [](NaturalLoop *L) {
+        while (L->Parent)
+            L = L->Parent;
+        return L;
+    };
+
+    for (DomTreeNode *Node : post_order(DT.getRootNode())) {
+        BasicBlock *Header = Node->getBlock();
+        SmallVector<BasicBlock *, 4> Worklist;
+        for (BasicBlock *Pred : predecessors(Header)) {
+            if (DT.isReachableFromEntry(Pred) && DT.dominates(Header, Pred))
+                Worklist.push_back(Pred);
+        }
+        if (Worklist.empty())
+            continue;
+
+        LI.Loops.push_back(std::make_unique<NaturalLoop>());
+        NaturalLoop *L = LI.Loops.back().get();
+        L->Latches.append(Worklist.begin(), Worklist.end());
+        LI.BlockToLoop[Header] = L;
+        while (!Worklist.empty()) {
+            BasicBlock *BB = Worklist.pop_back_val();
+            if (!DT.isReachableFromEntry(BB))
+                continue;
+            NaturalLoop *Inner = LI.BlockToLoop.lookup(BB);
+            if (!Inner) {
+                LI.BlockToLoop[BB] = L;
+                Worklist.append(pred_begin(BB), pred_end(BB));
+                continue;
+            }
+            Inner = GetOutermost(Inner);
+            if (Inner == L)
+                continue;
+            Inner->Parent = L;
+            L->SubLoops.push_back(Inner);
+            // The blocks of the inner loop are only entered through its header. Its
+            // latches are found to be in L again and skipped.
+            BasicBlock *InnerHeader = Inner->Blocks.front();
+            Worklist.append(pred_begin(InnerHeader), pred_end(InnerHeader));
+        }
+        // The other blocks are added in reverse post-order once all the loops are
+        // found, the walks of the outer loops only need the header.
+        L->Blocks.push_back(Header);
+        L->BlockSet.insert(Header);
+    }
+
+    for (BasicBlock *BB : ReversePostOrderTraversal<Function *>(&F)) {
+        for (NaturalLoop *L = LI.BlockToLoop.lookup(BB); L; L = L->Parent) {
+            if (L->BlockSet.insert(BB).second)
+                L->Blocks.push_back(BB);
+        }
+    }
+    for (auto &L : LI.Loops) {
+        if (!L->Parent)
+            LI.TopLevelLoops.push_back(L.get());
+    }
+
+    LLVM_DEBUG(llvm::outs() << "NaturalLoopAnalysis: " << LI.Loops.size()
+                            << " loops in " << F.getName() << "\n");
+    return LI;
+}
+
+bool insertLoopPreheaders(Function &F, const NaturalLoopInfo &LI) {
+    bool Changed = false;
+    for (NaturalLoop *L : LI.getLoopsInnermostFirst()) {
+        if (L->getPreheader())
+            continue;
+        SmallVector<BasicBlock *, 2> OutsidePreds;
+        for (BasicBlock *Pred : predecessors(L->getHeader())) {
+            if (!L->contains(Pred) && !is_contained(OutsidePreds, Pred))
+                OutsidePreds.push_back(Pred);
+        }
+        if (OutsidePreds.empty())
+            continue;
+        SplitBlockPredecessors(L->getHeader(), OutsidePreds, ".preheader");
+        Changed = true;
+    }
+    return Changed;
+}
+
+}  // namespace remniw
@@ -0,0 +1,109 @@
+#pragma once
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/IR/BasicBlock.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/PassManager.h"
+#include <memory>
+#include <vector>
+
+namespace remniw {
+
+// A natural loop: the blocks which reach the sources of the back edges to the header
+// without going through the header, where the header dominates the sources.
+class NaturalLoop {
+public:
+    llvm::BasicBlock *getHeader() const { return Blocks.front(); }
+
+    // The blocks of the loop and of its inner loops in reverse post-order, so the
+    // header is the first one and a block comes after the blocks dominating it.
+    llvm::ArrayRef<llvm::BasicBlock *> getBlocks() const { return Blocks; }
+
+    // The sources of the back edges.
+    llvm::ArrayRef<llvm::BasicBlock *> getLatches() const { return Latches; }
+
+    // The only latch, or nullptr if the loop has several back edges.
+    llvm::BasicBlock *getLatch() const {
+        return Latches.size() == 1 ? Latches.front() : nullptr;
+    }
+
+    // The only predecessor of the header outside the loop, if the header is its only
+    // successor, or nullptr. Code placed there runs once before the loop is entered.
+    llvm::BasicBlock *getPreheader() const;
+
+    // The blocks of the loop with a successor outside the loop.
+    void getExitingBlocks(llvm::SmallVectorImpl<llvm::BasicBlock *> &Exiting) const;
+
+    bool contains(const llvm::BasicBlock *BB) const { return BlockSet.count(BB); }
+    bool contains(const llvm::Instruction *I) const { return contains(I->getParent()); }
+
+    // V is computed outside the loop, so it has the same value in every iteration.
+    bool isLoopInvariant(const llvm::Value *V) const;
+
+    NaturalLoop *getParentLoop() const { return Parent; }
+    llvm::ArrayRef<NaturalLoop *> getSubLoops() const { return SubLoops; }
+
+    // 1 for the outermost loops.
+    unsigned getLoopDepth() const;
+
+private:
+    friend class NaturalLoopAnalysis;
+
+    llvm::SmallVector<llvm::BasicBlock *, 8> Blocks;
+    llvm::SmallPtrSet<const llvm::BasicBlock *, 8> BlockSet;
+    llvm::SmallVector<llvm::BasicBlock *, 1> Latches;
+    NaturalLoop *Parent = nullptr;
+    llvm::SmallVector<NaturalLoop *, 2> SubLoops;
+};
+
+// The natural loops of a function, computed by NaturalLoopAnalysis.
+class NaturalLoopInfo {
+public:
+    // The innermost loop BB is in, or nullptr.
+    NaturalLoop *getLoopFor(const llvm::BasicBlock *BB) const {
+        return BlockToLoop.lookup(BB);
+    }
+
+    // All the loops, an inner loop comes before the loops containing it.
+    llvm::SmallVector<NaturalLoop *, 8> getLoopsInnermostFirst() const;
+
+    llvm::ArrayRef<NaturalLoop *> getTopLevelLoops() const { return TopLevelLoops; }
+
+    bool empty() const { return Loops.empty(); }
+
+private:
+    friend class NaturalLoopAnalysis;
+
+    std::vector<std::unique_ptr<NaturalLoop>> Loops;
+    llvm::SmallVector<NaturalLoop *, 4> TopLevelLoops;
+    llvm::DenseMap<const llvm::BasicBlock *, NaturalLoop *> BlockToLoop;
+};
+
+// Find the natural loops of a function from the back edges of its CFG.
+//
+// An edge is a back edge if its target dominates its source. The headers are visited
+// in post-order of the dominator tree, so the loops nested in a loop are found before
+// it. The body of a loop is found by walking backwards from its latches to the
+// header; an inner loop found on the way is added as a whole, and the walk continues
+// from the predecessors of its header. The loops of a header with several back edges
+// are merged into one. Cycles which are not entered through a single block, i.e. in
+// irreducible control flow, are not loops.
+class NaturalLoopAnalysis: public llvm::AnalysisInfoMixin<NaturalLoopAnalysis> {
+    friend llvm::AnalysisInfoMixin<NaturalLoopAnalysis>;
+    static llvm::AnalysisKey Key;
+
+public:
+    using Result = NaturalLoopInfo;
+
+    NaturalLoopInfo run(llvm::Function &F, llvm::FunctionAnalysisManager &AM);
+};
+
+// Give every loop which has none a preheader, a new block between the predecessors
+// of the header outside the loop and the header. Returns true if the CFG changed, the
+// analyses of F are then stale.
+bool insertLoopPreheaders(llvm::Function &F, const NaturalLoopInfo &LI);
+
+}  // namespace remniw
@@ -0,0 +1,47 @@
+#include "optimizer/Optimizer.h"
+#include "optimizer/ControlFlowAnalysis.h"
+#include "optimizer/IndirectCallPromotion.h"
+#include "optimizer/Inliner.h"
+#include "optimizer/LICM.h"
+#include "optimizer/Mem2Reg.h"
+#include "optimizer/NaturalLoopAnalysis.h"
+#include "optimizer/PointsToAnalysis.h"
+#include "optimizer/RedundantLoadElimination.h"
+#include "optimizer/SCCP.h"
+#include "optimizer/StrengthReduction.h"
+#include "llvm/IR/PassManager.h"
+#include "llvm/Passes/PassBuilder.h"
+
+namespace remniw {
+
+void Optimizer::optimize(llvm::Module &M) {
+    llvm::LoopAnalysisManager LAM;
+    llvm::FunctionAnalysisManager FAM;
+    llvm::CGSCCAnalysisManager CGAM;
+    llvm::ModuleAnalysisManager MAM;
+
+    llvm::PassBuilder PB;
+    MAM.registerPass([] { return ControlFlowAnalysis(); });
+    MAM.registerPass([] { return PointsToAnalysis(); });
+    FAM.registerPass([] { return NaturalLoopAnalysis(); });
+    PB.registerModuleAnalyses(MAM);
+    PB.registerCGSCCAnalyses(CGAM);
+    PB.registerFunctionAnalyses(FAM);
+    PB.registerLoopAnalyses(LAM);
+    PB.crossRegisterProxies(LAM, FAM, CGAM, MAM);
+
+    llvm::FunctionPassManager FPM;
+    FPM.addPass(Mem2RegPass());
+    FPM.addPass(SCCPPass());
+
+    llvm::ModulePassManager MPM;
+    MPM.addPass(llvm::createModuleToFunctionPassAdaptor(std::move(FPM)));
+    MPM.addPass(IndirectCallPromotionPass());
+    MPM.addPass(InlinerPass());
+    MPM.addPass(RedundantLoadEliminationPass());
+    MPM.addPass(LICMPass());
+    MPM.addPass(llvm::createModuleToFunctionPassAdaptor(StrengthReductionPass()));
+    MPM.run(M, MAM);
+}
+
+}  // namespace remniw
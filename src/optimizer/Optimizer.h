@@ -0,0 +1,14 @@
+#pragma once
+
+#include "llvm/IR/Module.h"
+
+namespace remniw {
+
+// The remniw optimization pipeline, run on the LLVM IR emitted by
+// IRCodeGenerator before it is handed to a backend.
+class Optimizer {
+public:
+    void optimize(llvm::Module &M);
+};
+
+}  // namespace remniw
@@ -0,0 +1,541 @@
+#include "optimizer/PointsToAnalysis.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Operator.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+
+#define DEBUG_TYPE "remniw-points-to"
+
+using namespace llvm;
+
+namespace remniw {
+
+class PointsToSolver {
+private:
+    using ObjectSet = PointsToInfo::ObjectSet;
+    static constexpr unsigned UnknownObject = PointsToInfo::UnknownObject;
+
+    Module &M;
+    PointsToInfo &Info;
+
+    // The nodes of the constraint graph. A node which has been merged into another
+    // one by cycle collapsing is not its own parent, find() returns the node that
+    // represents it.
+    std::vector<unsigned> Parent;
+    std::vector<ObjectSet> Pts;
+    // The part of Pts which has been propagated to the successors and the load,
+    // store and call constraints of the node.
+    std::vector<ObjectSet> Done;
+    std::vector<SparseBitVector<>> Succs;
+    // Loads[N] are the nodes p of p = *N, Stores[N] are the nodes q of *N = q.
+    std::vector<SmallVector<unsigned, 1>> Loads;
+    std::vector<SmallVector<unsigned, 1>> Stores;
+    // The call sites whose callee is N.
+    std::vector<SmallVector<CallBase *, 1>> CallSites;
+
+    DenseMap<const Value *, unsigned> ValueToNode;
+    DenseMap<const Function *, unsigned> ReturnToNode;
+    // The node of the contents of every object.
+    std::vector<unsigned> ObjectToContent;
+    unsigned NullNode;
+
+    DenseSet<std::pair<CallBase *, const Function *>> BoundCalls;
+    SmallVector<Function *> AddressTakenFunctions;
+    bool HasUnknownCall = false;
+    // The edges a cycle has been searched from.
+    DenseSet<std::pair<unsigned, unsigned>> CheckedEdges;
+    SmallVector<unsigned> Worklist;
+    std::vector<bool> InWorklist;
+    unsigned NumCollapsed = 0;
+
+    unsigned createNode() {
+        Parent.push_back(Parent.size());
+        Pts.emplace_back();
+        Done.emplace_back();
+        Succs.emplace_back();
+        Loads.emplace_back();
+        Stores.emplace_back();
+        CallSites.emplace_back();
+        InWorklist.push_back(false);
+        return Parent.size() - 1;
+    }
+
+    unsigned find(unsigned N) {
+        while (Parent[N] != N) {
+            Parent[N] = Parent[Parent[N]];
+            N = Parent[N];
+        }
+        return N;
+    }
+
+    void push(unsigned N) {
+        if (!InWorklist[N]) {
+            InWorklist[N] = true;
+            Worklist.push_back(N);
+        }
+    }
+
+    unsigned getObject(const Value *Site) {
+        auto It = Info.SiteToObject.find(Site);
+        if (It != Info.SiteToObject.end())
+            return It->second;
+        unsigned Obj = Info.Objects.size();
+        Info.Objects.push_back(Site);
+        Info.SiteToObject[Site] = Obj;
+        ObjectToContent.push_back(createNode());
+        return Obj;
+    }
+
+    void addAddr(unsigned N, unsigned Obj) {
+        N = find(N);
+        if (Pts[N].test_and_set(Obj))
+            push(N);
+    }
+
+    unsigned getNode(const Value *V) {
+        auto It = ValueToNode.find(V);
+        if (It != ValueToNode.end())
+            return It->second;
+        if (isa<Constant>(V)) {
+            const Value *C = V->stripPointerCasts();
+            if (auto *GEP = dyn_cast<GEPOperator>(C))
+                return getNode(GEP->getPointerOperand());
+            if (isa<ConstantPointerNull>(C) || isa<UndefValue>(C))
+                return NullNode;
+        }
+        unsigned N = createNode();
+        ValueToNode[V] = N;
+        if (auto *C = dyn_cast<Constant>(V)) {
+            C = C->stripPointerCasts();
+            if (isa<Function>(C) || isa<GlobalVariable>(C))
+                addAddr(N, getObject(C));
+            else
+                addAddr(N, UnknownObject);
+        }
+        return N;
+    }
+
+    unsigned getReturnNode(const Function *F) {
+        auto It = ReturnToNode.find(F);
+        if (It != ReturnToNode.end())
+            return It->second;
+        unsigned N = createNode();
+        ReturnToNode[F] = N;
+        return N;
+    }
+
+    void addEdge(unsigned From, unsigned To) {
+        From = find(From);
+        To = find(To);
+        if (From == To || !Succs[From].test_and_set(To))
+            return;
+        if (Pts[To] |= Pts[From])
+            push(To);
+    }
+
+    void addLoad(unsigned Ptr, unsigned Dst) {
+        Ptr = find(Ptr);
+        Loads[Ptr].push_back(Dst);
+        for (unsigned Obj : Done[Ptr])
+            addEdge(ObjectToContent[Obj], Dst);
+    }
+
+    void addStore(unsigned Ptr, unsigned Src) {
+        Ptr = find(Ptr);
+        Stores[Ptr].push_back(Src);
+        for (unsigned Obj : Done[Ptr])
+            addEdge(Src, ObjectToContent[Obj]);
+    }
+
+    void addCallSite(unsigned Callee, CallBase &CB) {
+        Callee = find(Callee);
+        CallSites[Callee].push_back(&CB);
+        // Binding a call site creates nodes, so the set is copied first.
+        ObjectSet Objs = Done[Callee];
+        for (unsigned Obj : Objs)
+            bindObject(CB, Obj);
+    }
+
+    static bool isPointer(const Value *V) { return V->getType()->isPointerTy(); }
+
+    static bool isHeapAllocation(const Function *F) {
+        return F->getName() == "malloc" || F->getName() == "as_alloc";
+    }
+
+    void bindCall(CallBase &CB, const Function *F) {
+        if (!BoundCalls.insert({&CB, F}).second)
+            return;
+        if (isHeapAllocation(F)) {
+            if (isPointer(&CB))
+                addAddr(getNode(&CB), getObject(&CB));
+            return;
+        }
+        if (F->isDeclaration()) {
+            if (isPointer(&CB))
+                addAddr(getNode(&CB), UnknownObject);
+            return;
+        }
+        if (F->arg_size() != CB.arg_size())
+            return;
+        for (unsigned I = 0, E = CB.arg_size(); I != E; ++I) {
+            if (isPointer(F->getArg(I)))
+                addEdge(getNode(CB.getArgOperand(I)), getNode(F->getArg(I)));
+        }
+        if (isPointer(&CB))
+            addEdge(getReturnNode(F), getNode(&CB));
+    }
+
+    // CB may call any function whose address is taken, with any arguments.
+    void bindUnknownCall(CallBase &CB) {
+        if (isPointer(&CB))
+            addAddr(getNode(&CB), UnknownObject);
+        if (HasUnknownCall)
+            return;
+        HasUnknownCall = true;
+        for (Function *F : AddressTakenFunctions) {
+            for (Argument &Arg : F->args()) {
+                if (isPointer(&Arg))
+                    addAddr(getNode(&Arg), UnknownObject);
+            }
+        }
+    }
+
+    // The callee of CB may point to the object Obj.
+    void bindObject(CallBase &CB, unsigned Obj) {
+        if (Obj == UnknownObject)
+            bindUnknownCall(CB);
+        else if (auto *F = dyn_cast<Function>(Info.Objects[Obj]))
+            bindCall(CB, F);
+    }
+
+    void addConstraints(Instruction &I) {
+        if (auto *CB = dyn_cast<CallBase>(&I)) {
+            Value *Callee = CB->getCalledOperand()->stripPointerCasts();
+            if (auto *F = dyn_cast<Function>(Callee))
+                bindCall(*CB, F);
+            else if (isa<Instruction>(Callee) || isa<Argument>(Callee))
+                addCallSite(getNode(Callee), *CB);
+            else
+                bindUnknownCall(*CB);
+        } else if (auto *SI = dyn_cast<StoreInst>(&I)) {
+            if (isPointer(SI->getValueOperand()))
+                addStore(getNode(SI->getPointerOperand()), getNode(SI->getValueOperand()));
+        } else if (auto *RI = dyn_cast<ReturnInst>(&I)) {
+            if (RI->getReturnValue() && isPointer(RI->getReturnValue()))
+                addEdge(getNode(RI->getReturnValue()), getReturnNode(RI->getFunction()));
+        } else if (!isPointer(&I)) {
+            // Integers are not tracked.
+        } else if (isa<AllocaInst>(I)) {
+            addAddr(getNode(&I), getObject(&I));
+        } else if (auto *LI = dyn_cast<LoadInst>(&I)) {
+            addLoad(getNode(LI->getPointerOperand()), getNode(LI));
+        } else if (auto *PN = dyn_cast<PHINode>(&I)) {
+            for (Value *V : PN->incoming_values())
+                addEdge(getNode(V), getNode(PN));
+        } else if (auto *SI = dyn_cast<SelectInst>(&I)) {
+            addEdge(getNode(SI->getTrueValue()), getNode(SI));
+            addEdge(getNode(SI->getFalseValue()), getNode(SI));
+        } else if (isa<BitCastInst>(I) || isa<AddrSpaceCastInst>(I)) {
+            addEdge(getNode(I.getOperand(0)), getNode(&I));
+        } else if (auto *GEP = dyn_cast<GetElementPtrInst>(&I)) {
+            // The analysis does not distinguish the elements of an object.
+            addEdge(getNode(GEP->getPointerOperand()), getNode(GEP));
+        } else {
+            addAddr(getNode(&I), UnknownObject);
+        }
+    }
+
+    // Merge the node B into the node A.
+    void merge(unsigned A, unsigned B) {
+        A = find(A);
+        B = find(B);
+        if (A == B)
+            return;
+        Parent[B] = A;
+        Pts[A] |= Pts[B];
+        // The constraints of A and B have both been applied to the intersection.
+        Done[A] &= Done[B];
+        Succs[A] |= Succs[B];
+        Loads[A].append(Loads[B].begin(), Loads[B].end());
+        Stores[A].append(Stores[B].begin(), Stores[B].end());
+        CallSites[A].append(CallSites[B].begin(), CallSites[B].end());
+        Pts[B].clear();
+        Done[B].clear();
+        Succs[B].clear();
+        Loads[B].clear();
+        Stores[B].clear();
+        CallSites[B].clear();
+        push(A);
+        ++NumCollapsed;
+    }
+
+    // Find the strongly connected components reachable from Start with Tarjan's
+    // algorithm, and collapse each cycle into one node. Returns true if a cycle is
+    // found.
+    bool collapseCycles(unsigned Start) {
+        struct Frame {
+            unsigned N;
+            SmallVector<unsigned, 4> Succs;
+            unsigned Next = 0;
+        };
+        DenseMap<unsigned, unsigned> Index;
+        DenseMap<unsigned, unsigned> LowLink;
+        DenseSet<unsigned> OnStack;
+        SmallVector<unsigned> Stack;
+        SmallVector<Frame> DFSStack;
+        SmallVector<SmallVector<unsigned, 4>> Cycles;
+        unsigned NextIndex = 0;
+
+        auto Enter = [&](unsigned N) {
+            Index[N] = LowLink[N] = NextIndex++;
+            Stack.push_back(N);
+            OnStack.insert(N);
+            Frame F {N, {}};
+            for (unsigned S : Succs[N]) {
+                if (find(S) != N)
+                    F.Succs.push_back(find(S));
+            }
+            DFSStack.push_back(std::move(F));
+        };
+
+        Enter(Start);
+        while (!DFSStack.empty()) {
+            Frame &F = DFSStack.back();
+            if (F.Next < F.Succs.size()) {
+                unsigned N = F.N;
+                unsigned S = F.Succs[F.Next++];
+                if (!Index.count(S))
+                    Enter(S);
+                else if (OnStack.count(S))
+                    LowLink[N] = std::min(LowLink[N], Index[S]);
+                continue;
+            }
+            unsigned N = F.N;
+            DFSStack.pop_back();
+            if (!DFSStack.empty()) {
+                unsigned P = DFSStack.back().N;
+                LowLink[P] = std::min(LowLink[P], LowLink[N]);
+            }
+            if (LowLink[N] != Index[N])
+                continue;
+            SmallVector<unsigned, 4> SCC;
+            unsigned W;
+            do {
+                W = Stack.pop_back_val();
+                OnStack.erase(W);
+                SCC.push_back(W);
+            } while (W != N);
+            if (SCC.size() > 1)
+                Cycles.push_back(std::move(SCC));
+        }
+
+        for (auto &SCC : Cycles) {
+            for (unsigned I = 1, E = SCC.size(); I != E; ++I)
+                merge(SCC[0], SCC[I]);
+        }
+        return !Cycles.empty();
+    }
+
+    void propagate(unsigned N) {
+        if (find(N) != N)
+            return;
+        ObjectSet Delta = Pts[N];
+        Delta.intersectWithComplement(Done[N]);
+        if (Delta.empty())
+            return;
+
+        SmallVector<CallBase *, 1> Calls(CallSites[N].begin(), CallSites[N].end());
+        for (unsigned Obj : Delta) {
+            unsigned Content = ObjectToContent[Obj];
+            for (unsigned Dst : Loads[N])
+                addEdge(Content, Dst);
+            for (unsigned Src : Stores[N])
+                addEdge(Src, Content);
+            for (CallBase *CB : Calls)
+                bindObject(*CB, Obj);
+        }
+
+        SmallVector<unsigned, 8> Targets;
+        for (unsigned T : Succs[N])
+            Targets.push_back(T);
+        for (unsigned T : Targets) {
+            unsigned S = find(T);
+            if (S == N)
+                continue;
+            // The ends of an edge in a cycle end up with the same set, so an edge
+            // whose ends have the same set is likely in a cycle. Once the cycle is
+            // collapsed, the merged node is visited again.
+            if (Pts[S] == Pts[N] && CheckedEdges.insert({N, S}).second &&
+                collapseCycles(N)) {
+                push(find(N));
+                return;
+            }
+            if (Pts[S] |= Delta)
+                push(S);
+        }
+        Done[N] |= Delta;
+    }
+
+    void computeMods() {
+        struct CallMod {
+            CallBase *CB;
+            Function *Caller;
+            SmallVector<const Function *, 2> Callees;
+            // The objects the runtime functions it calls may write to.
+            ObjectSet Mod;
+        };
+        std::vector<CallMod> Calls;
+        DenseMap<const Function *, ObjectSet> FunctionMods;
+
+        for (Function &F : M) {
+            for (Instruction &I : instructions(F)) {
+                if (auto *SI = dyn_cast<StoreInst>(&I)) {
+                    FunctionMods[&F] |= Pts[find(getNode(SI->getPointerOperand()))];
+                    continue;
+                }
+                auto *CB = dyn_cast<CallBase>(&I);
+                if (!CB)
+                    continue;
+                CallMod Call {CB, &F, {}, {}};
+                Value *Callee = CB->getCalledOperand()->stripPointerCasts();
+                if (auto *CalleeF = dyn_cast<Function>(Callee)) {
+                    Call.Callees.push_back(CalleeF);
+                } else {
+                    for (unsigned Obj : Pts[find(getNode(Callee))]) {
+                        if (Obj == UnknownObject)
+                            Call.Mod.set(UnknownObject);
+                        else if (auto *CalleeF = dyn_cast<Function>(Info.Objects[Obj]))
+                            Call.Callees.push_back(CalleeF);
+                    }
+                }
+                // A runtime function may write to the memory its arguments point to.
+                for (const Function *CalleeF : Call.Callees) {
+                    if (!CalleeF->isDeclaration() || isHeapAllocation(CalleeF))
+                        continue;
+                    for (Value *Arg : CB->args()) {
+                        if (isPointer(Arg))
+                            Call.Mod |= Pts[find(getNode(Arg))];
+                    }
+                }
+                Calls.push_back(std::move(Call));
+            }
+        }
+
+        bool Changed = true;
+        while (Changed) {
+            Changed = false;
+            for (CallMod &Call : Calls) {
+                for (const Function *CalleeF : Call.Callees) {
+                    auto It = FunctionMods.find(CalleeF);
+                    if (It != FunctionMods.end())
+                        Call.Mod |= It->second;
+                }
+                Changed |= FunctionMods[Call.Caller] |= Call.Mod;
+            }
+        }
+        for (CallMod &Call : Calls)
+            Info.CallMods[Call.CB] = std::move(Call.Mod);
+    }
+
+public:
+    PointsToSolver(Module &M, PointsToInfo &Info): M(M), Info(Info) {
+        NullNode = createNode();
+        // Loading from unknown memory yields a pointer to unknown memory.
+        ObjectToContent.push_back(createNode());
+        Pts[ObjectToContent[UnknownObject]].set(UnknownObject);
+    }
+
+    void solve() {
+        for (GlobalVariable &GV : M.globals())
+            getObject(&GV);
+        for (Function &F : M) {
+            getObject(&F);
+            if (!F.isDeclaration() && F.hasAddressTaken())
+                AddressTakenFunctions.push_back(&F);
+        }
+        for (Function &F : M) {
+            for (Instruction &I : instructions(F))
+                addConstraints(I);
+        }
+        while (!Worklist.empty()) {
+            unsigned N = Worklist.pop_back_val();
+            InWorklist[N] = false;
+            propagate(N);
+        }
+
+        for (auto &[V, N] : ValueToNode)
+            Info.PointsTo[V] = Pts[find(N)];
+        computeMods();
+        LLVM_DEBUG(llvm::outs() << "PointsToAnalysis: " << Parent.size() << " nodes, "
+                                << Info.Objects.size() << " objects, " << NumCollapsed
+                                << " nodes collapsed\n");
+    }
+};
+
+PointsToInfo::ObjectSet PointsToInfo::getPointsTo(const Value *P) const {
+    ObjectSet Pts;
+    if (isa<Constant>(P)) {
+        const Value *C = P->stripPointerCasts();
+        if (auto *GEP = dyn_cast<GEPOperator>(C))
+            return getPointsTo(GEP->getPointerOperand());
+        if (isa<ConstantPointerNull>(C) || isa<UndefValue>(C))
+            return Pts;
+        auto It = SiteToObject.find(C);
+        Pts.set(It != SiteToObject.end() ? It->second : UnknownObject);
+        return Pts;
+    }
+    auto It = PointsTo.find(P);
+    if (It != PointsTo.end())
+        return It->second;
+    // A value created after the analysis.
+    Pts.set(UnknownObject);
+    return Pts;
+}
+
+bool PointsToInfo::mayAlias(const Value *P1, const Value *P2) const {
+    ObjectSet Pts1 = getPointsTo(P1);
+    ObjectSet Pts2 = getPointsTo(P2);
+    if (Pts1.empty() || Pts2.empty())
+        return false;
+    if (Pts1.test(UnknownObject) || Pts2.test(UnknownObject))
+        return true;
+    return Pts1.intersects(Pts2);
+}
+
+bool PointsToInfo::mayModify(const CallBase &CB, const Value *P) const {
+    auto It = CallMods.find(&CB);
+    if (It == CallMods.end())
+        return true;
+    const ObjectSet &Mod = It->second;
+    ObjectSet Pts = getPointsTo(P);
+    if (Mod.empty() || Pts.empty())
+        return false;
+    if (Mod.test(UnknownObject) || Pts.test(UnknownObject))
+        return true;
+    return Mod.intersects(Pts);
+}
+
+bool PointsToInfo::getPointees(const Value *P,
+                               SmallVectorImpl<const Value *> &Sites) const {
+    ObjectSet Pts = getPointsTo(P);
+    if (Pts.test(UnknownObject))
+        return false;
+    for (unsigned Obj : Pts)
+        Sites.push_back(Objects[Obj]);
+    return true;
+}
+
+AnalysisKey PointsToAnalysis::Key;
+
+PointsToInfo PointsToAnalysis::run(Module &M, ModuleAnalysisManager &AM) {
+    PointsToInfo Info;
+    PointsToSolver(M, Info).solve();
+    return Info;
+}
+
+}  // namespace remniw
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SparseBitVector.h"
+#include "llvm/IR/InstrTypes.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/PassManager.h"
+#include <vector>
+
+namespace remniw {
+
+// The memory objects the pointers of the module may point to, computed by
+// PointsToAnalysis.
+class PointsToInfo {
+public:
+    // Whether the memory P1 and P2 point to may overlap.
+    bool mayAlias(const llvm::Value *P1, const llvm::Value *P2) const;
+
+    // Whether the call CB, or a function it calls, may write to the memory P points
+    // to.
+    bool mayModify(const llvm::CallBase &CB, const llvm::Value *P) const;
+
+    // The allocation sites P may point to: allocas, heap allocation calls, global
+    // variables and functions. Returns false if P may point to memory the analysis
+    // does not know about.
+    bool getPointees(const llvm::Value *P,
+                     llvm::SmallVectorImpl<const llvm::Value *> &Sites) const;
+
+private:
+    friend class PointsToSolver;
+
+    using ObjectSet = llvm::SparseBitVector<>;
+    // The object 0 stands for every memory location the analysis does not model.
+    static constexpr unsigned UnknownObject = 0;
+
+    std::vector<const llvm::Value *> Objects {nullptr};
+    llvm::DenseMap<const llvm::Value *, unsigned> SiteToObject;
+    llvm::DenseMap<const llvm::Value *, ObjectSet> PointsTo;
+    // The objects every call site may write to.
+    llvm::DenseMap<const llvm::CallBase *, ObjectSet> CallMods;
+
+    ObjectSet getPointsTo(const llvm::Value *P) const;
+};
+
+// Andersen's inclusion-based points-to analysis over the module.
+//
+// Every pointer value, the contents of every memory object and the return value of
+// every function is a node of a constraint graph. An object is an alloca, a call to
+// malloc or as_alloc, a global variable or a function; the elements of an array
+// are one object. The constraints are
+//     p = &o      pts(p) includes o
+//     p = q       pts(q) is a subset of pts(p), an edge q -> p
+//     p = *q      for every o in pts(q), an edge o -> p
+//     *p = q      for every o in pts(p), an edge q -> o
+// The copies come from phi, select, casts, getelementptr, arguments and return
+// values. The load and store constraints, and the calls through a function pointer,
+// add edges as the points-to sets grow. Only the difference since a node was last
+// visited is propagated through them.
+//
+// Cycles in the graph are collapsed into one node with a union-find, since every
+// node of a cycle has the same points-to set. A cycle is searched for lazily from
+// an edge whose both ends have the same points-to set.
+//
+// Once the points-to sets are solved, the objects every function may write to,
+// directly or through its callees, are computed to answer mayModify.
+class PointsToAnalysis: public llvm::AnalysisInfoMixin<PointsToAnalysis> {
+    friend llvm::AnalysisInfoMixin<PointsToAnalysis>;
+    static llvm::AnalysisKey Key;
+
+public:
+    using Result = PointsToInfo;
+
+    PointsToInfo run(llvm::Module &M, llvm::ModuleAnalysisManager &AM);
+};
+
+}  // namespace remniw
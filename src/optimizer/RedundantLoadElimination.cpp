@@ -0,0 +1,178 @@
+#include "optimizer/RedundantLoadElimination.h"
+#include "optimizer/PointsToAnalysis.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SetVector.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Analysis/ConstantFolding.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/raw_ostream.h"
+
+#define DEBUG_TYPE "remniw-rle"
+
+using namespace llvm;
+
+extern cl::OptionCategory RemniwCat;
+
+static cl::opt<bool> RLEFoldConstants(
+    "rle-fold-constants",
+    cl::desc("Fold the instructions whose operands become constants after a load "
+             "is replaced by a stored constant"),
+    cl::init(true), cl::cat(RemniwCat));
+
+namespace remniw {
+
+namespace {
+
+// The value Val is in memory at the address Ptr.
+struct AvailableValue {
+    Value *Ptr;
+    Value *Val;
+};
+
+class LoadEliminator {
+private:
+    Function &F;
+    DominatorTree &DT;
+    const PointsToInfo &PTI;
+    // The getelementptrs which have been visited, by their pointer operand.
+    DenseMap<Value *, SmallVector<GetElementPtrInst *, 2>> GEPs;
+    // The folded instructions, erased after the walk since they may follow the
+    // instruction being visited in its block.
+    SmallSetVector<Instruction *, 8> Folded;
+
+    GetElementPtrInst *findDominatingGEP(GetElementPtrInst *GEP) {
+        auto It = GEPs.find(GEP->getPointerOperand());
+        if (It == GEPs.end())
+            return nullptr;
+        for (GetElementPtrInst *Other : It->second) {
+            if (Other->getSourceElementType() == GEP->getSourceElementType() &&
+                Other->getType() == GEP->getType() &&
+                Other->isInBounds() == GEP->isInBounds() &&
+                std::equal(Other->op_begin(), Other->op_end(), GEP->op_begin(),
+                           GEP->op_end()) &&
+                DT.dominates(Other, GEP))
+                return Other;
+        }
+        return nullptr;
+    }
+
+    void visitBlock(BasicBlock &BB, SmallVectorImpl<AvailableValue> &Avail) {
+        for (Instruction &I : make_early_inc_range(BB)) {
+            if (auto *GEP = dyn_cast<GetElementPtrInst>(&I)) {
+                if (GetElementPtrInst *Other = findDominatingGEP(GEP)) {
+                    GEP->replaceAllUsesWith(Other);
+                    GEP->eraseFromParent();
+                    ++NumGEPs;
+                } else {
+                    GEPs[GEP->getPointerOperand()].push_back(GEP);
+                }
+            } else if (auto *LI = dyn_cast<LoadInst>(&I)) {
+                Value *Ptr = LI->getPointerOperand();
+                auto It = llvm::find_if(Avail, [&](const AvailableValue &AV) {
+                    return AV.Ptr == Ptr && AV.Val->getType() == LI->getType();
+                });
+                if (It != Avail.end()) {
+                    SmallVector<Instruction *, 8> Users;
+                    if (isa<Constant>(It->Val) && RLEFoldConstants)
+                        for (User *U : LI->users())
+                            Users.push_back(cast<Instruction>(U));
+                    LI->replaceAllUsesWith(It->Val);
+                    LI->eraseFromParent();
+                    ++NumLoads;
+                    foldConstants(Users);
+                } else {
+                    Avail.push_back({Ptr, LI});
+                }
+            } else if (auto *SI = dyn_cast<StoreInst>(&I)) {
+                Value *Ptr = SI->getPointerOperand();
+                llvm::erase_if(Avail, [&](const AvailableValue &AV) {
+                    return PTI.mayAlias(AV.Ptr, Ptr);
+                });
+                Avail.push_back({Ptr, SI->getValueOperand()});
+            } else if (auto *CB = dyn_cast<CallBase>(&I)) {
+                llvm::erase_if(Avail, [&](const AvailableValue &AV) {
+                    return PTI.mayModify(*CB, AV.Ptr);
+                });
+            } else if (I.mayWriteToMemory()) {
+                Avail.clear();
+            }
+        }
+    }
+
+    // A stored constant which replaces a load may make its users constant too,
+    // e.g. mul i64 7, 7. Fold them, and their users in turn, to integer constants.
+    // Divisions by zero fold to poison and are left alone, as in SCCP.
+    void foldConstants(SmallVectorImpl<Instruction *> &Worklist) {
+        const DataLayout &DL = F.getParent()->getDataLayout();
+        while (!Worklist.empty()) {
+            Instruction *I = Worklist.pop_back_val();
+            if (Folded.count(I) ||
+                !(isa<BinaryOperator>(I) || isa<CmpInst>(I) || isa<CastInst>(I)))
+                continue;
+            auto *C = dyn_cast_or_null<ConstantInt>(ConstantFoldInstruction(I, DL));
+            if (!C)
+                continue;
+            for (User *U : I->users())
+                Worklist.push_back(cast<Instruction>(U));
+            I->replaceAllUsesWith(C);
+            Folded.insert(I);
+        }
+    }
+
+public:
+    unsigned NumGEPs = 0;
+    unsigned NumLoads = 0;
+
+    LoadEliminator(Function &F, DominatorTree &DT, const PointsToInfo &PTI):
+        F(F), DT(DT), PTI(PTI) {}
+
+    void run() {
+        struct WorkItem {
+            DomTreeNode *Node;
+            SmallVector<AvailableValue, 8> Avail;
+        };
+        SmallVector<WorkItem> Worklist;
+        Worklist.push_back({DT.getRootNode(), {}});
+        while (!Worklist.empty()) {
+            WorkItem Item = Worklist.pop_back_val();
+            BasicBlock *BB = Item.Node->getBlock();
+            visitBlock(*BB, Item.Avail);
+            for (DomTreeNode *Child : Item.Node->children()) {
+                if (Child->getBlock()->getSinglePredecessor() == BB)
+                    Worklist.push_back({Child, Item.Avail});
+                else
+                    Worklist.push_back({Child, {}});
+            }
+        }
+        for (Instruction *I : Folded)
+            I->eraseFromParent();
+        LLVM_DEBUG(llvm::outs() << "RedundantLoadElimination: " << NumLoads
+                                << " loads, " << NumGEPs << " getelementptrs, "
+                                << Folded.size() << " constants in "
+                                << F.getName() << "\n");
+    }
+};
+
+}  // namespace
+
+PreservedAnalyses RedundantLoadEliminationPass::run(Module &M, ModuleAnalysisManager &AM) {
+    auto &PTI = AM.getResult<PointsToAnalysis>(M);
+    auto &FAM = AM.getResult<FunctionAnalysisManagerModuleProxy>(M).getManager();
+    bool Changed = false;
+    for (Function &F : M) {
+        if (F.isDeclaration())
+            continue;
+        LoadEliminator Eliminator(F, FAM.getResult<DominatorTreeAnalysis>(F), PTI);
+        Eliminator.run();
+        Changed |= Eliminator.NumLoads || Eliminator.NumGEPs;
+    }
+    if (!Changed)
+        return PreservedAnalyses::all();
+    return PreservedAnalyses::none();
+}
+
+}  // namespace remniw
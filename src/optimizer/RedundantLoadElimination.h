@@ -0,0 +1,26 @@
+#pragma once
+
+#include "llvm/IR/Module.h"
+#include "llvm/IR/PassManager.h"
+
+namespace remniw {
+
+// Remove the loads of values which are already in registers.
+//
+// The blocks of every function are walked down the dominator tree. An address
+// computed by a getelementptr is replaced by the same address computed in a
+// dominating block. A load is replaced by the value an earlier load read from the
+// same address, or an earlier store wrote to it, if the memory it reads may not have
+// been written in between: stores and calls clobber the values of the addresses
+// that may alias the memory they write, as told by PointsToAnalysis. The values
+// flow from a block only to the blocks it is the single predecessor of, since a
+// block with more predecessors may be reached along a path that writes to memory,
+// e.g. the back edge of a loop. The instructions which become constant because a
+// load was replaced by a stored constant are folded as well.
+class RedundantLoadEliminationPass
+    : public llvm::PassInfoMixin<RedundantLoadEliminationPass> {
+public:
+    llvm::PreservedAnalyses run(llvm::Module &M, llvm::ModuleAnalysisManager &AM);
+};
+
+}  // namespace remniw
@@ -0,0 +1,389 @@
+#include "optimizer/SCCP.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Analysis/ConstantFolding.h"
+#include "llvm/IR/CFG.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/raw_ostream.h"
+
+#define DEBUG_TYPE "remniw-sccp"
+
+using namespace llvm;
+
+namespace remniw {
+
+namespace {
+
+// The lattice of a value: Unknown is above every constant, which are above
+// Overdefined. Values only move down.
+struct LatticeValue {
+    enum Kind { Unknown, Constant, Overdefined };
+
+    Kind K = Unknown;
+    ConstantInt *C = nullptr;
+
+    bool isUnknown() const { return K == Unknown; }
+    bool isConstant() const { return K == Constant; }
+    bool isOverdefined() const { return K == Overdefined; }
+};
+
+class SCCPSolver {
+private:
+    Function &F;
+    const DataLayout &DL;
+    // The lattice values of the instructions, an instruction which is not in the
+    // map is Unknown.
+    DenseMap<Instruction *, LatticeValue> Values;
+    SmallPtrSet<BasicBlock *, 32> ExecutableBlocks;
+    DenseSet<std::pair<BasicBlock *, BasicBlock *>> ExecutableEdges;
+    SmallVector<BasicBlock *> BlockWorklist;
+    SmallVector<Instruction *> InstWorklist;
+
+public:
+    SCCPSolver(Function &F): F(F), DL(F.getParent()->getDataLayout()) {}
+
+    void solve() {
+        ExecutableBlocks.insert(&F.getEntryBlock());
+        BlockWorklist.push_back(&F.getEntryBlock());
+        do {
+            propagate();
+        } while (resolveUnknownBranches());
+    }
+
+    LatticeValue getValue(Value *V) const {
+        if (auto *CI = dyn_cast<ConstantInt>(V))
+            return {LatticeValue::Constant, CI};
+        // Arguments, globals, constant expressions and undef are not tracked.
+        auto *I = dyn_cast<Instruction>(V);
+        if (!I)
+            return {LatticeValue::Overdefined, nullptr};
+        auto It = Values.find(I);
+        return It == Values.end() ? LatticeValue() : It->second;
+    }
+
+    bool isExecutable(BasicBlock *BB) const { return ExecutableBlocks.count(BB); }
+
+    bool isEdgeExecutable(BasicBlock *From, BasicBlock *To) const {
+        return ExecutableEdges.count({From, To});
+    }
+
+private:
+    void propagate() {
+        while (!BlockWorklist.empty() || !InstWorklist.empty()) {
+            while (!InstWorklist.empty())
+                visit(*InstWorklist.pop_back_val());
+            while (!BlockWorklist.empty()) {
+                BasicBlock *BB = BlockWorklist.pop_back_val();
+                for (Instruction &I : *BB)
+                    visit(I);
+            }
+        }
+    }
+
+    // A conditional branch in an executable block whose condition is still
+    // Unknown once nothing changes would leave both successors unexecuted, e.g.
+    // if the condition only depends on itself through a loop. Assume it may go
+    // either way. Returns true if any branch is resolved.
+    bool resolveUnknownBranches() {
+        bool Resolved = false;
+        for (BasicBlock *BB : ExecutableBlocks) {
+            auto *BI = dyn_cast<BranchInst>(BB->getTerminator());
+            if (!BI || BI->isUnconditional())
+                continue;
+            if (getValue(BI->getCondition()).isUnknown()) {
+                markOverdefined(cast<Instruction>(BI->getCondition()));
+                Resolved = true;
+            }
+        }
+        return Resolved;
+    }
+
+    void pushUsers(Instruction *I) {
+        for (User *U : I->users()) {
+            auto *UI = dyn_cast<Instruction>(U);
+            if (UI && isExecutable(UI->getParent()))
+                InstWorklist.push_back(UI);
+        }
+    }
+
+    void markOverdefined(Instruction *I) {
+        LatticeValue &LV = Values[I];
+        if (LV.isOverdefined())
+            return;
+        LV = {LatticeValue::Overdefined, nullptr};
+        pushUsers(I);
+    }
+
+    void markConstant(Instruction *I, ConstantInt *C) {
+        LatticeValue &LV = Values[I];
+        if (LV.isOverdefined() || (LV.isConstant() && LV.C == C))
+            return;
+        if (LV.isConstant()) {
+            markOverdefined(I);
+            return;
+        }
+        LV = {LatticeValue::Constant, C};
+        pushUsers(I);
+    }
+
+    void markEdgeExecutable(BasicBlock *From, BasicBlock *To) {
+        if (!ExecutableEdges.insert({From, To}).second)
+            return;
+        if (ExecutableBlocks.insert(To).second) {
+            BlockWorklist.push_back(To);
+        } else {
+            // The phi nodes of To meet one more incoming value.
+            for (PHINode &PN : To->phis())
+                InstWorklist.push_back(&PN);
+        }
+    }
+
+    void visit(Instruction &I) {
+        if (auto *PN = dyn_cast<PHINode>(&I))
+            visitPHINode(*PN);
+        else if (auto *BI = dyn_cast<BranchInst>(&I))
+            visitBranchInst(*BI);
+        else if (I.isTerminator())
+            for (BasicBlock *Succ : successors(I.getParent()))
+                markEdgeExecutable(I.getParent(), Succ);
+        else if (I.getType()->isIntegerTy() &&
+                 (isa<BinaryOperator>(I) || isa<CmpInst>(I) || isa<CastInst>(I) ||
+                  isa<SelectInst>(I)))
+            visitFoldable(I);
+        else if (!I.getType()->isVoidTy())
+            markOverdefined(&I);
+    }
+
+    // The meet of the values flowing in through the executable edges.
+    void visitPHINode(PHINode &PN) {
+        if (getValue(&PN).isOverdefined())
+            return;
+        ConstantInt *C = nullptr;
+        for (unsigned i = 0, e = PN.getNumIncomingValues(); i != e; ++i) {
+            if (!isEdgeExecutable(PN.getIncomingBlock(i), PN.getParent()))
+                continue;
+            LatticeValue LV = getValue(PN.getIncomingValue(i));
+            if (LV.isUnknown())
+                continue;
+            if (LV.isOverdefined() || (C && C != LV.C)) {
+                markOverdefined(&PN);
+                return;
+            }
+            C = LV.C;
+        }
+        if (C)
+            markConstant(&PN, C);
+    }
+
+    // Only the successor taken on a constant condition becomes executable.
+    void visitBranchInst(BranchInst &BI) {
+        BasicBlock *BB = BI.getParent();
+        if (BI.isUnconditional()) {
+            markEdgeExecutable(BB, BI.getSuccessor(0));
+            return;
+        }
+        LatticeValue Cond = getValue(BI.getCondition());
+        if (Cond.isUnknown())
+            return;
+        if (Cond.isConstant()) {
+            markEdgeExecutable(BB, BI.getSuccessor(Cond.C->isZero() ? 1 : 0));
+            return;
+        }
+        markEdgeExecutable(BB, BI.getSuccessor(0));
+        markEdgeExecutable(BB, BI.getSuccessor(1));
+    }
+
+    void visitFoldable(Instruction &I) {
+        if (getValue(&I).isOverdefined())
+            return;
+        SmallVector<Constant *, 4> Ops;
+        for (Value *Op : I.operands()) {
+            LatticeValue LV = getValue(Op);
+            if (LV.isUnknown())
+                return;
+            if (LV.isOverdefined()) {
+                markOverdefined(&I);
+                return;
+            }
+            Ops.push_back(LV.C);
+        }
+        Constant *C;
+        if (auto *Cmp = dyn_cast<CmpInst>(&I))
+            C = ConstantFoldCompareInstOperands(Cmp->getPredicate(), Ops[0], Ops[1], DL);
+        else
+            C = ConstantFoldInstOperands(&I, Ops, DL);
+        // Do not fold into undef or poison, e.g. a division by zero.
+        if (auto *CI = dyn_cast_or_null<ConstantInt>(C))
+            markConstant(&I, CI);
+        else
+            markOverdefined(&I);
+    }
+};
+
+class SCCPRewriter {
+private:
+    Function &F;
+    SCCPSolver &Solver;
+
+public:
+    unsigned NumConstants = 0;
+    unsigned NumBranchesFolded = 0;
+    unsigned NumBlocksDeleted = 0;
+    unsigned NumBlocksMerged = 0;
+
+    SCCPRewriter(Function &F, SCCPSolver &Solver): F(F), Solver(Solver) {}
+
+    void run() {
+        replaceConstants();
+        foldBranches();
+        deleteUnreachableBlocks();
+        removeTrivialPhis();
+        mergeBlocks();
+    }
+
+    bool changed() const {
+        return NumConstants || NumBranchesFolded || NumBlocksDeleted || NumBlocksMerged;
+    }
+
+private:
+    void replaceConstants() {
+        for (BasicBlock &BB : F) {
+            if (!Solver.isExecutable(&BB))
+                continue;
+            for (Instruction &I : llvm::make_early_inc_range(BB)) {
+                LatticeValue LV = Solver.getValue(&I);
+                if (!LV.isConstant())
+                    continue;
+                if (!I.use_empty()) {
+                    I.replaceAllUsesWith(LV.C);
+                    ++NumConstants;
+                }
+                if (!I.mayHaveSideEffects())
+                    I.eraseFromParent();
+            }
+        }
+    }
+
+    // A conditional branch with only one executable edge jumps to its target.
+    void foldBranches() {
+        for (BasicBlock &BB : F) {
+            auto *BI = dyn_cast<BranchInst>(BB.getTerminator());
+            if (!Solver.isExecutable(&BB) || !BI || BI->isUnconditional())
+                continue;
+            BasicBlock *TrueBB = BI->getSuccessor(0);
+            BasicBlock *FalseBB = BI->getSuccessor(1);
+            bool TrueTaken = Solver.isEdgeExecutable(&BB, TrueBB);
+            bool FalseTaken = Solver.isEdgeExecutable(&BB, FalseBB);
+            if (TrueTaken == FalseTaken)
+                continue;
+            BasicBlock *Taken = TrueTaken ? TrueBB : FalseBB;
+            BasicBlock *NotTaken = TrueTaken ? FalseBB : TrueBB;
+            NotTaken->removePredecessor(&BB, /*KeepOneInputPHIs*/ true);
+            BranchInst::Create(Taken, BI);
+            BI->eraseFromParent();
+            ++NumBranchesFolded;
+        }
+    }
+
+    void deleteUnreachableBlocks() {
+        SmallVector<BasicBlock *> Dead;
+        for (BasicBlock &BB : F)
+            if (!Solver.isExecutable(&BB))
+                Dead.push_back(&BB);
+        for (BasicBlock *BB : Dead)
+            for (BasicBlock *Succ : successors(BB))
+                if (Solver.isExecutable(Succ))
+                    Succ->removePredecessor(BB, /*KeepOneInputPHIs*/ true);
+        // The dead blocks may use the values of each other.
+        for (BasicBlock *BB : Dead)
+            BB->dropAllReferences();
+        for (BasicBlock *BB : Dead)
+            BB->eraseFromParent();
+        NumBlocksDeleted += Dead.size();
+    }
+
+    // A phi node whose incoming values are all the same value (or the phi
+    // itself), e.g. after the incoming values of deleted edges are removed, is
+    // replaced by that value.
+    void removeTrivialPhis() {
+        bool Changed = true;
+        while (Changed) {
+            Changed = false;
+            for (BasicBlock &BB : F) {
+                for (PHINode &PN : llvm::make_early_inc_range(BB.phis())) {
+                    Value *Same = nullptr;
+                    bool Trivial = true;
+                    for (Value *V : PN.incoming_values()) {
+                        if (V == &PN || V == Same)
+                            continue;
+                        if (Same) {
+                            Trivial = false;
+                            break;
+                        }
+                        Same = V;
+                    }
+                    if (!Trivial || !Same)
+                        continue;
+                    PN.replaceAllUsesWith(Same);
+                    PN.eraseFromParent();
+                    Changed = true;
+                }
+            }
+        }
+    }
+
+    // Merge a block into its only predecessor if it is the only successor of the
+    // predecessor, which removes the jump between them.
+    void mergeBlocks() {
+        for (auto It = F.begin(); It != F.end();) {
+            BasicBlock *BB = &*It;
+            auto *BI = dyn_cast<BranchInst>(BB->getTerminator());
+            BasicBlock *Succ = nullptr;
+            if (BI && BI->isUnconditional())
+                Succ = BI->getSuccessor(0);
+            if (!Succ || Succ == BB || Succ->getSinglePredecessor() != BB) {
+                ++It;
+                continue;
+            }
+            while (auto *PN = dyn_cast<PHINode>(&Succ->front())) {
+                PN->replaceAllUsesWith(PN->getIncomingValue(0));
+                PN->eraseFromParent();
+            }
+            BI->eraseFromParent();
+            Succ->replaceSuccessorsPhiUsesWith(Succ, BB);
+            while (!Succ->empty())
+                Succ->front().moveBefore(*BB, BB->end());
+            Succ->eraseFromParent();
+            ++NumBlocksMerged;
+        }
+    }
+};
+
+}  // namespace
+
+PreservedAnalyses SCCPPass::run(Function &F, FunctionAnalysisManager &AM) {
+    if (F.isDeclaration())
+        return PreservedAnalyses::all();
+
+    SCCPSolver Solver(F);
+    Solver.solve();
+    SCCPRewriter Rewriter(F, Solver);
+    Rewriter.run();
+    if (!Rewriter.changed())
+        return PreservedAnalyses::all();
+
+    LLVM_DEBUG(llvm::outs() << "SCCP: " << Rewriter.NumConstants << " constants, "
+                            << Rewriter.NumBranchesFolded << " branches folded, "
+                            << Rewriter.NumBlocksDeleted << " blocks deleted, "
+                            << Rewriter.NumBlocksMerged << " blocks merged in function "
+                            << F.getName() << "\n");
+    return PreservedAnalyses::none();
+}
+
+}  // namespace remniw
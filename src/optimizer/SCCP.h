@@ -0,0 +1,26 @@
+#pragma once
+
+#include "llvm/IR/Function.h"
+#include "llvm/IR/PassManager.h"
+
+namespace remniw {
+
+// Sparse conditional constant propagation.
+//
+// The algorithm of Wegman and Zadeck: every integer SSA value starts as
+// unknown and is lowered to a constant or to overdefined, while only the CFG
+// edges which may be taken are followed from the entry block. A phi node meets
+// the values of its executable incoming edges only, and a conditional branch
+// on a constant only makes the taken edge executable, so constants are found
+// through loops and branches which a single folding pass misses.
+//
+// Afterwards the values proven constant are replaced, the branches on
+// constants become unconditional, the blocks which are never executed are
+// deleted and a block is merged into its only predecessor if it is the only
+// successor of that predecessor.
+class SCCPPass: public llvm::PassInfoMixin<SCCPPass> {
+public:
+    llvm::PreservedAnalyses run(llvm::Function &F, llvm::FunctionAnalysisManager &AM);
+};
+
+}  // namespace remniw
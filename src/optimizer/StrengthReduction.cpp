@@ -0,0 +1,239 @@
+#include "optimizer/StrengthReduction.h"
+#include "optimizer/NaturalLoopAnalysis.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SetVector.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/Utils/Local.h"
+
+#define DEBUG_TYPE "remniw-sr"
+
+using namespace llvm;
+
+namespace remniw {
+
+namespace {
+
+// A phi node of the loop header, which is Start when the loop is entered and is
+// increased by Step in every iteration.
+struct InductionVariable {
+    PHINode *Phi;
+    Value *Start;
+    int64_t Step;
+};
+
+// An address indexed by the induction variable plus Offset, or minus Offset if
+// Negative. Offset is nullptr if the index is the induction variable itself.
+struct ReducibleGEP {
+    GetElementPtrInst *GEP;
+    Value *Offset;
+    bool Negative;
+};
+
+class StrengthReducer {
+private:
+    Function &F;
+    const NaturalLoopInfo &LI;
+    // The pointer phi nodes created for the loop being visited, by the getelementptr
+    // they were created for.
+    SmallVector<std::pair<GetElementPtrInst *, PHINode *>, 4> Pointers;
+
+    static bool getInductionVariable(PHINode &Phi, const NaturalLoop &L,
+                                     BasicBlock *Preheader, BasicBlock *Latch,
+                                     InductionVariable &IV) {
+        if (!Phi.getType()->isIntegerTy() || Phi.getNumIncomingValues() != 2)
+            return false;
+        auto *Next = dyn_cast<BinaryOperator>(Phi.getIncomingValueForBlock(Latch));
+        if (!Next || !L.contains(Next))
+            return false;
+        ConstantInt *Step = nullptr;
+        if (Next->getOpcode() == Instruction::Add) {
+            if (Next->getOperand(0) == &Phi)
+                Step = dyn_cast<ConstantInt>(Next->getOperand(1));
+            else if (Next->getOperand(1) == &Phi)
+                Step = dyn_cast<ConstantInt>(Next->getOperand(0));
+        } else if (Next->getOpcode() == Instruction::Sub && Next->getOperand(0) == &Phi) {
+            Step = dyn_cast<ConstantInt>(Next->getOperand(1));
+        }
+        if (!Step)
+            return false;
+        int64_t StepVal = Step->getSExtValue();
+        if (Next->getOpcode() == Instruction::Sub)
+            StepVal = -StepVal;
+        IV = {&Phi, Phi.getIncomingValueForBlock(Preheader), StepVal};
+        return true;
+    }
+
+    // GEP computes an address inside the loop from a base address and indices which
+    // are the same in every iteration, except the last index, which is Index.
+    static bool isReducible(GetElementPtrInst *GEP, Value *Index, const NaturalLoop &L) {
+        unsigned LastOp = GEP->getNumOperands() - 1;
+        if (!L.contains(GEP) || GEP->getOperand(LastOp) != Index)
+            return false;
+        for (unsigned I = 0; I != LastOp; ++I) {
+            if (!L.isLoopInvariant(GEP->getOperand(I)))
+                return false;
+        }
+        return true;
+    }
+
+    void collectReducibleGEPs(const InductionVariable &IV, const NaturalLoop &L,
+                              SmallVectorImpl<ReducibleGEP> &GEPs) {
+        for (User *U : IV.Phi->users()) {
+            if (auto *GEP = dyn_cast<GetElementPtrInst>(U)) {
+                if (isReducible(GEP, IV.Phi, L))
+                    GEPs.push_back({GEP, nullptr, false});
+                continue;
+            }
+            // i + k, k + i or i - k, where k is computed outside the loop.
+            auto *BO = dyn_cast<BinaryOperator>(U);
+            if (!BO || !L.contains(BO))
+                continue;
+            Value *Offset = nullptr;
+            bool Negative = false;
+            if (BO->getOpcode() == Instruction::Add) {
+                Offset = BO->getOperand(0) == IV.Phi ? BO->getOperand(1)
+                                                     : BO->getOperand(0);
+            } else if (BO->getOpcode() == Instruction::Sub &&
+                       BO->getOperand(0) == IV.Phi) {
+                Offset = BO->getOperand(1);
+                Negative = true;
+            }
+            if (!Offset || Offset == IV.Phi || !L.isLoopInvariant(Offset))
+                continue;
+            for (User *BOUser : BO->users()) {
+                auto *GEP = dyn_cast<GetElementPtrInst>(BOUser);
+                if (GEP && isReducible(GEP, BO, L))
+                    GEPs.push_back({GEP, Offset, Negative});
+            }
+        }
+    }
+
+    PHINode *findPointer(GetElementPtrInst *GEP) {
+        for (auto &[Other, Phi] : Pointers) {
+            if (Other->getSourceElementType() == GEP->getSourceElementType() &&
+                Other->getType() == GEP->getType() &&
+                std::equal(Other->op_begin(), Other->op_end(), GEP->op_begin(),
+                           GEP->op_end()))
+                return Phi;
+        }
+        return nullptr;
+    }
+
+    PHINode *createPointer(const ReducibleGEP &R, const InductionVariable &IV,
+                           const NaturalLoop &L) {
+        BasicBlock *Preheader = L.getPreheader();
+        BasicBlock *Latch = L.getLatch();
+        GetElementPtrInst *GEP = R.GEP;
+        unsigned LastOp = GEP->getNumOperands() - 1;
+
+        // The address of the element the loop starts with.
+        IRBuilder<> Builder(Preheader->getTerminator());
+        Value *StartIndex = IV.Start;
+        auto *StartConst = dyn_cast<ConstantInt>(IV.Start);
+        if (R.Offset && StartConst && StartConst->isZero())
+            StartIndex = R.Negative ? Builder.CreateNeg(R.Offset) : R.Offset;
+        else if (R.Offset)
+            StartIndex = R.Negative ? Builder.CreateSub(IV.Start, R.Offset)
+                                    : Builder.CreateAdd(IV.Start, R.Offset);
+        auto *Init = cast<GetElementPtrInst>(GEP->clone());
+        Init->setOperand(LastOp, StartIndex);
+        // The loop may not be executed, then the first element may be out of bounds.
+        Init->setIsInBounds(false);
+        Builder.Insert(Init, GEP->getName() + ".init");
+
+        PHINode *Phi = PHINode::Create(GEP->getType(), 2, GEP->getName() + ".ptr",
+                                       &*L.getHeader()->getFirstInsertionPt());
+        auto *Next = GetElementPtrInst::Create(
+            GEP->getResultElementType(), Phi,
+            ConstantInt::get(GEP->getOperand(LastOp)->getType(), IV.Step, true),
+            GEP->getName() + ".next", Latch->getTerminator());
+        Phi->addIncoming(Init, Preheader);
+        Phi->addIncoming(Next, Latch);
+        Pointers.push_back({GEP, Phi});
+        return Phi;
+    }
+
+    void reduce(const NaturalLoop &L) {
+        BasicBlock *Preheader = L.getPreheader();
+        BasicBlock *Latch = L.getLatch();
+        if (!Preheader || !Latch)
+            return;
+        SmallVector<InductionVariable, 2> IVs;
+        for (PHINode &Phi : L.getHeader()->phis()) {
+            InductionVariable IV;
+            if (getInductionVariable(Phi, L, Preheader, Latch, IV))
+                IVs.push_back(IV);
+        }
+        // The replaced getelementptrs are erased at the end, findPointer() compares
+        // the later ones with them.
+        Pointers.clear();
+        SmallVector<GetElementPtrInst *, 8> Replaced;
+        SmallSetVector<Instruction *, 4> Indices;
+        for (InductionVariable &IV : IVs) {
+            SmallVector<ReducibleGEP, 4> GEPs;
+            collectReducibleGEPs(IV, L, GEPs);
+            for (ReducibleGEP &R : GEPs) {
+                PHINode *Phi = findPointer(R.GEP);
+                if (!Phi)
+                    Phi = createPointer(R, IV, L);
+                LLVM_DEBUG(llvm::outs() << "StrengthReduction: replace" << *R.GEP
+                                        << " with" << *Phi << "\n");
+                R.GEP->replaceAllUsesWith(Phi);
+                Replaced.push_back(R.GEP);
+                if (R.Offset)
+                    Indices.insert(cast<Instruction>(
+                        R.GEP->getOperand(R.GEP->getNumOperands() - 1)));
+            }
+        }
+        NumReduced += Replaced.size();
+        for (GetElementPtrInst *GEP : Replaced)
+            GEP->eraseFromParent();
+        for (Instruction *Index : Indices) {
+            if (Index->use_empty())
+                Index->eraseFromParent();
+        }
+        // An induction variable is dead if it was only used by the addresses and by
+        // its own increment.
+        for (InductionVariable &IV : IVs)
+            RecursivelyDeleteDeadPHINode(IV.Phi);
+    }
+
+public:
+    unsigned NumReduced = 0;
+
+    StrengthReducer(Function &F, const NaturalLoopInfo &LI): F(F), LI(LI) {}
+
+    void run() {
+        for (NaturalLoop *L : LI.getLoopsInnermostFirst())
+            reduce(*L);
+        LLVM_DEBUG(llvm::outs() << "StrengthReduction: " << NumReduced
+                                << " getelementptrs in " << F.getName() << "\n");
+    }
+};
+
+}  // namespace
+
+PreservedAnalyses StrengthReductionPass::run(Function &F, FunctionAnalysisManager &AM) {
+    if (AM.getResult<NaturalLoopAnalysis>(F).empty())
+        return PreservedAnalyses::all();
+    bool Changed = false;
+    if (insertLoopPreheaders(F, AM.getResult<NaturalLoopAnalysis>(F))) {
+        AM.invalidate(F, PreservedAnalyses::none());
+        Changed = true;
+    }
+    StrengthReducer Reducer(F, AM.getResult<NaturalLoopAnalysis>(F));
+    Reducer.run();
+    Changed |= Reducer.NumReduced != 0;
+    if (!Changed)
+        return PreservedAnalyses::all();
+    PreservedAnalyses PA;
+    PA.preserveSet<CFGAnalyses>();
+    return PA;
+}
+
+}  // namespace remniw
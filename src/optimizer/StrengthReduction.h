@@ -0,0 +1,25 @@
+#pragma once
+
+#include "llvm/IR/Function.h"
+#include "llvm/IR/PassManager.h"
+
+namespace remniw {
+
+// Induction variable strength reduction.
+//
+// A basic induction variable is a phi node in the header of a loop which starts with
+// a value computed outside the loop and is increased by a constant step along the
+// back edge, e.g. `i = i + 1`. An array element `a[i]`, or `a[i + k]` with k computed
+// outside the loop, is the address of a plus i times the size of the element, so the
+// address also changes by a constant in each iteration. It is replaced by a pointer
+// phi node, which starts with the address of the first element in the preheader and
+// is advanced by the step along the back edge: the multiplication, and the base
+// address which is computed again for every access, become one pointer increment per
+// loop. The getelementptrs of the same element share the pointer. The induction
+// variable itself is removed if it is no longer used, e.g. by the loop condition.
+class StrengthReductionPass: public llvm::PassInfoMixin<StrengthReductionPass> {
+public:
+    llvm::PreservedAnalyses run(llvm::Function &F, llvm::FunctionAnalysisManager &AM);
+};
+
+}  // namespace remniw
@@ -16,11 +16,13 @@ void initAphoticShield() {
     aphotic_shield::installSegvSignalHandler(&GuardedAlloc);
 }
 
-// If cannot allocate in GuardedPoolAllocator(e.g. Size > 4096, no free slot,
-// GuardedPoolAllocator is not enabled), fallback to malloc.
+// Only sampled allocations are tried in GuardedPoolAllocator. If cannot allocate
+// in GuardedPoolAllocator(e.g. Size > 4096, no free slot, GuardedPoolAllocator is
+// not enabled), fallback to malloc.
 void *AphoticShieldAllocate(size_t Size, size_t Alignment) {
-    if (void *Ptr = GuardedAlloc.allocate(Size, Alignment)) {
-        return Ptr;
+    if (APHOTIC_SHIELD_UNLIKELY(GuardedAlloc.shouldSample())) {
+        if (void *Ptr = GuardedAlloc.allocate(Size, Alignment))
+            return Ptr;
     }
     return malloc(Size);
 }
@@ -82,11 +82,11 @@ bool AllocatorState::isGuardPage(uintptr_t Ptr) const {
 void AllocationMetadata::RecordAllocation(uintptr_t AllocAddr, size_t AllocSize) {
     Addr = AllocAddr;
     Size = AllocSize;
-    IsDeallocated = false;
+    IsDeallocated.store(false, std::memory_order_release);
 }
 
-void AllocationMetadata::RecordDeallocation() {
-    IsDeallocated = true;
+bool AllocationMetadata::RecordDeallocation() {
+    return !IsDeallocated.exchange(true, std::memory_order_acq_rel);
 }
 
 void GuardedPoolAllocator::init(const options::Options &Opts) {
@@ -114,8 +114,41 @@ void GuardedPoolAllocator::init(const options::Options &Opts) {
     Metadata = reinterpret_cast<AllocationMetadata *>(map(MetadataBytesRequired));
 
     size_t FreeSlotsBytesRequired =
-        roundUpTo(State.MaxSimultaneousAllocations * sizeof(*FreeSlots), PageSize);
-    FreeSlots = reinterpret_cast<size_t *>(map(FreeSlotsBytesRequired));
+        roundUpTo(State.MaxSimultaneousAllocations * sizeof(*FreeSlotsNext), PageSize);
+    FreeSlotsNext =
+        reinterpret_cast<std::atomic<uint32_t> *>(map(FreeSlotsBytesRequired));
+
+    // Small pools are not cached, otherwise a few threads could hold all free slots.
+    ThreadCacheLength = State.MaxSimultaneousAllocations / 64;
+    if (ThreadCacheLength > ThreadCache::kMaxLength)
+        ThreadCacheLength = ThreadCache::kMaxLength;
+
+    Check(pthread_key_create(&ThreadCacheKey, destroyThreadCache) == 0,
+          "APHOTIC_SHIELD Error: Failed to create the thread cache key.");
+
+    Check(Opts.SampleRate > 0, "APHOTIC_SHIELD Error: SampleRate is <= 0.");
+    SampleRate = Opts.SampleRate;
+}
+
+bool GuardedPoolAllocator::shouldSampleSlow(ThreadCache &Cache) {
+    assert(SampleRate != 0);
+
+    // The first allocation of the thread is sampled only if it is the end of the
+    // first random distance, like all the others.
+    if (Cache.NextSampleCounter == 0) {
+        Cache.NextSampleCounter = getSampleDistance(Cache);
+        if (Cache.NextSampleCounter > 1) {
+            --Cache.NextSampleCounter;
+            return false;
+        }
+    }
+
+    Cache.NextSampleCounter = getSampleDistance(Cache);
+    return true;
+}
+
+uint32_t GuardedPoolAllocator::getSampleDistance(ThreadCache &Cache) {
+    return getRandomUnsigned32(Cache) % (2 * SampleRate - 1) + 1;
 }
 
 void *GuardedPoolAllocator::allocate(size_t Size, size_t Alignment) {
@@ -133,11 +166,8 @@ void *GuardedPoolAllocator::allocate(size_t Size, size_t Alignment) {
         Size > State.maximumAllocationSize())
         return nullptr;
 
-    size_t Index;
-    {
-        ScopedLock L(PoolMutex);
-        Index = reserveSlot();
-    }
+    ThreadCache &Cache = getThreadCache();
+    size_t Index = reserveSlot(Cache);
 
     if (Index == kInvalidSlotID)
         return nullptr;
@@ -148,7 +178,7 @@ void *GuardedPoolAllocator::allocate(size_t Size, size_t Alignment) {
     uintptr_t UserPtr;
     // Randomly choose whether to left-align or right-align the allocation, and
     // then apply the necessary adjustments to get an aligned pointer.
-    if (getRandomUnsigned32() % 2 == 0)
+    if (getRandomUnsigned32(Cache) % 2 == 0)
         UserPtr = alignUp(SlotStart, Alignment);
     else
         UserPtr = alignDown(SlotEnd - Size, Alignment);
@@ -171,30 +201,23 @@ void GuardedPoolAllocator::deallocate(void *Ptr) {
     AllocationMetadata *Meta = addrToMetadata(UPtr);
     if (Meta->Addr != UPtr) {
         // If multiple errors occur at the same time, use the first one.
-        ScopedLock L(PoolMutex);
+        ScopedLock L(FailureMutex);
         trapOnAddress(UPtr, Error::INVALID_FREE);
     }
 
-    // Intentionally scope the mutex here, so that other threads can access the
-    // pool during the expensive markInaccessible() call.
-    {
-        ScopedLock L(PoolMutex);
-        if (Meta->IsDeallocated) {
-            trapOnAddress(UPtr, Error::DOUBLE_FREE);
-        }
-
-        // Ensure that the deallocation is recorded before marking the page as
-        // inaccessible. Otherwise, a racy use-after-free will have inconsistent
-        // metadata.
-        Meta->RecordDeallocation();
+    // Ensure that the deallocation is recorded before marking the page as
+    // inaccessible. Otherwise, a racy use-after-free will have inconsistent
+    // metadata.
+    if (!Meta->RecordDeallocation()) {
+        ScopedLock L(FailureMutex);
+        trapOnAddress(UPtr, Error::DOUBLE_FREE);
     }
 
     deallocateInGuardedPool(reinterpret_cast<void *>(SlotStart),
                             State.maximumAllocationSize());
 
-    // And finally, lock again to release the slot back into the pool.
-    ScopedLock L(PoolMutex);
-    freeSlot(Slot);
+    // And finally, release the slot back into the pool.
+    freeSlot(getThreadCache(), Slot);
 }
 
 AllocationMetadata *GuardedPoolAllocator::addrToMetadata(uintptr_t Ptr) const {
@@ -222,23 +245,96 @@ void *GuardedPoolAllocator::map(size_t Size) const {
     return Ptr;
 }
 
-size_t GuardedPoolAllocator::reserveSlot() {
+void GuardedPoolAllocator::destroyThreadCache(void *Allocator) {
+    ThreadCache &Cache = getThreadCache();
+    static_cast<GuardedPoolAllocator *>(Allocator)->flushThreadCache(Cache, Cache.Length);
+}
+
+size_t GuardedPoolAllocator::reserveSlot(ThreadCache &Cache) {
     // We won't reuse a slot until we have made at least a single allocation in each slot.
-    if (NumAllocations < State.MaxSimultaneousAllocations)
-        return NumAllocations++;
+    size_t MaxSlots = State.MaxSimultaneousAllocations;
+    if (NumAllocations.load(std::memory_order_relaxed) < MaxSlots) {
+        size_t SlotIndex = NumAllocations.fetch_add(1, std::memory_order_relaxed);
+        if (SlotIndex < MaxSlots)
+            return SlotIndex;
+    }
 
-    if (FreeSlotsLength == 0)
+    if (ThreadCacheLength == 0) {
+        uint32_t SlotIndex = popFreeSlot();
+        return SlotIndex == kNoFreeSlot ? kInvalidSlotID : SlotIndex;
+    }
+
+    if (Cache.Length == 0)
+        refillThreadCache(Cache);
+    if (Cache.Length == 0)
         return kInvalidSlotID;
 
-    size_t ReservedIndex = getRandomUnsigned32() % FreeSlotsLength;
-    size_t SlotIndex = FreeSlots[ReservedIndex];
-    FreeSlots[ReservedIndex] = FreeSlots[--FreeSlotsLength];
+    size_t ReservedIndex = getRandomUnsigned32(Cache) % Cache.Length;
+    size_t SlotIndex = Cache.Slots[ReservedIndex];
+    Cache.Slots[ReservedIndex] = Cache.Slots[--Cache.Length];
     return SlotIndex;
 }
 
-void GuardedPoolAllocator::freeSlot(size_t SlotIndex) {
-    assert(FreeSlotsLength < State.MaxSimultaneousAllocations);
-    FreeSlots[FreeSlotsLength++] = SlotIndex;
+void GuardedPoolAllocator::freeSlot(ThreadCache &Cache, size_t SlotIndex) {
+    if (ThreadCacheLength == 0) {
+        pushFreeSlot(SlotIndex);
+        return;
+    }
+
+    if (Cache.Length == ThreadCacheLength)
+        flushThreadCache(Cache, (ThreadCacheLength + 1) / 2);
+    registerThreadCache(Cache);
+    Cache.Slots[Cache.Length++] = SlotIndex;
+}
+
+void GuardedPoolAllocator::refillThreadCache(ThreadCache &Cache) {
+    registerThreadCache(Cache);
+    while (Cache.Length < (ThreadCacheLength + 1) / 2) {
+        uint32_t SlotIndex = popFreeSlot();
+        if (SlotIndex == kNoFreeSlot)
+            break;
+        Cache.Slots[Cache.Length++] = SlotIndex;
+    }
+}
+
+void GuardedPoolAllocator::flushThreadCache(ThreadCache &Cache, size_t Length) {
+    assert(Length <= Cache.Length);
+    for (; Length != 0; --Length)
+        pushFreeSlot(Cache.Slots[--Cache.Length]);
+}
+
+void GuardedPoolAllocator::registerThreadCache(ThreadCache &Cache) {
+    if (Cache.Registered)
+        return;
+    Cache.Registered = true;
+    pthread_setspecific(ThreadCacheKey, this);
+}
+
+uint32_t GuardedPoolAllocator::popFreeSlot() {
+    uint64_t Top = FreeSlotsTop.load(std::memory_order_acquire);
+    while (true) {
+        uint32_t SlotIndex = static_cast<uint32_t>(Top);
+        if (SlotIndex == kNoFreeSlot)
+            return kNoFreeSlot;
+        // If another thread pops SlotIndex and pushes it again, the count in the
+        // high bits has changed, and the stale Next is not installed.
+        uint64_t Next = FreeSlotsNext[SlotIndex].load(std::memory_order_relaxed);
+        uint64_t NewTop = (((Top >> 32) + 1) << 32) | Next;
+        if (FreeSlotsTop.compare_exchange_weak(Top, NewTop, std::memory_order_acquire,
+                                               std::memory_order_acquire))
+            return SlotIndex;
+    }
+}
+
+void GuardedPoolAllocator::pushFreeSlot(uint32_t SlotIndex) {
+    uint64_t Top = FreeSlotsTop.load(std::memory_order_relaxed);
+    uint64_t NewTop;
+    do {
+        FreeSlotsNext[SlotIndex].store(static_cast<uint32_t>(Top),
+                                       std::memory_order_relaxed);
+        NewTop = (((Top >> 32) + 1) << 32) | SlotIndex;
+    } while (!FreeSlotsTop.compare_exchange_weak(Top, NewTop, std::memory_order_release,
+                                                 std::memory_order_relaxed));
 }
 
 void GuardedPoolAllocator::allocateInGuardedPool(void *Ptr, size_t Size) const {
@@ -259,7 +355,11 @@ void GuardedPoolAllocator::deallocateInGuardedPool(void *Ptr, size_t Size) const
           "Failed to deallocate in guarded pool allocator memory");
 }
 
-uint32_t GuardedPoolAllocator::getRandomUnsigned32() {
+uint32_t GuardedPoolAllocator::getRandomUnsigned32(ThreadCache &Cache) {
+    uint32_t &RandomState = Cache.RandomState;
+    // Seed with a non-zero value that differs between threads.
+    if (RandomState == 0)
+        RandomState = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(&Cache)) | 1;
     RandomState ^= RandomState << 13;
     RandomState ^= RandomState >> 17;
     RandomState ^= RandomState << 5;
@@ -11,6 +11,8 @@
 #include "mutex.h"
 #include "options.h"
 #include "utils.h"
+#include <atomic>
+#include <pthread.h>
 
 namespace aphotic_shield {
 
@@ -55,16 +57,18 @@ struct AllocatorState {
 struct AllocationMetadata {
     // Records the given allocation metadata into this struct.
     void RecordAllocation(uintptr_t Addr, size_t Size);
-    // Record that this allocation is now deallocated.
-    void RecordDeallocation();
+    // Record that this allocation is now deallocated. Returns false if it has
+    // already been deallocated.
+    bool RecordDeallocation();
 
     // The address of this allocation. If zero, the rest of this struct isn't
     // valid, as the allocation has never occurred.
     uintptr_t Addr = 0;
     // Represents the actual size of the allocation.
     size_t Size = 0;
-    // Whether this allocation has been deallocated yet.
-    bool IsDeallocated = false;
+    // Whether this allocation has been deallocated yet. Only one of the threads
+    // deallocating the same allocation concurrently can set it.
+    std::atomic<bool> IsDeallocated {false};
 };
 
 class GuardedPoolAllocator {
@@ -100,23 +104,63 @@ public:
         return State.pointerIsMine(Ptr);
     }
 
+    // Returns whether the next allocation of the calling thread should be served
+    // by this pool. Only one in SampleRate allocations on average is sampled, the
+    // others just count down a per-thread counter. Nothing is sampled if the pool
+    // is disabled, which is checked first so that the counter of a thread is never
+    // set and every allocation would take the slow path.
+    APHOTIC_SHIELD_ALWAYS_INLINE bool shouldSample() {
+        if (APHOTIC_SHIELD_UNLIKELY(SampleRate == 0))
+            return false;
+        ThreadCache &Cache = getThreadCache();
+        if (APHOTIC_SHIELD_LIKELY(Cache.NextSampleCounter > 1)) {
+            --Cache.NextSampleCounter;
+            return false;
+        }
+        return shouldSampleSlow(Cache);
+    }
+
 private:
     static constexpr size_t kInvalidSlotID = ~0;
+    static constexpr uint32_t kNoFreeSlot = ~0U;
+
+    // Freed slots cached by a thread, so that most allocations and deallocations
+    // don't touch the free slots stack shared by all threads. The cache is refilled
+    // from and flushed to the shared stack in batches, and flushed when the thread
+    // exits. It also holds the other per-thread state of the allocator.
+    struct ThreadCache {
+        static constexpr size_t kMaxLength = 32;
+        uint32_t Slots[kMaxLength];
+        size_t Length;
+        // The state of the per-thread random number generator, zero until seeded.
+        uint32_t RandomState;
+        // The number of allocations until the next sampled one, zero until the
+        // first allocation of the thread.
+        uint32_t NextSampleCounter;
+        // Whether the cache is flushed when the thread exits.
+        bool Registered;
+    };
 
     AllocatorState State;
     // Record the number allocations that we've made.
-    size_t NumAllocations = 0;
+    std::atomic<size_t> NumAllocations {0};
     //  Pointer to the allocation metadata.
     AllocationMetadata *Metadata = nullptr;
-    // Pointer to the free slots list which stores the indexes of freed slot in
-    // GuardedPagePool.
-    size_t *FreeSlots = nullptr;
-    // The current length of the free slots list.
-    size_t FreeSlotsLength = 0;
-    // RandomState initialized with non-zero seed
-    uint32_t RandomState = 0xacd979ce;
-    // A mutex to protect the guarded slot and metadata pool.
-    Mutex PoolMutex;
+    // The freed slots which are not cached by any thread are kept in a lock-free
+    // stack. FreeSlotsNext[N] is the slot below slot N in the stack.
+    std::atomic<uint32_t> *FreeSlotsNext = nullptr;
+    // The low 32 bits are the slot on the top of the stack, the high 32 bits count
+    // the updates of the stack to avoid the ABA problem.
+    std::atomic<uint64_t> FreeSlotsTop {kNoFreeSlot};
+    // The maximum number of slots cached by a thread, at most ThreadCache::kMaxLength.
+    size_t ThreadCacheLength = 0;
+    // Sample one in SampleRate allocations, zero if the pool is disabled.
+    uint32_t SampleRate = 0;
+    // The key used to flush the cache of a thread when it exits.
+    pthread_key_t ThreadCacheKey = 0;
+    // A mutex to report only the first error if multiple errors occur at the same
+    // time.
+    Mutex FailureMutex;
 
     // Get the page size using sysconf(_SC_PAGESIZE).
     // We should only call this function once, and cahe the result in
@@ -135,16 +179,50 @@ private:
 
     void *map(size_t Size) const;
 
+    // Returns the cache of the calling thread.
+    static ThreadCache &getThreadCache() {
+        // Zero-initialized, so that no TLS initialization function is needed.
+        static thread_local ThreadCache Cache;
+        return Cache;
+    }
+
+    // Called by shouldSample() when the counter of the thread runs out, only if the
+    // pool is enabled.
+    bool shouldSampleSlow(ThreadCache &Cache);
+
+    // Returns the number of allocations until the next sampled one, which is
+    // uniformly distributed in [1, 2 * SampleRate - 1].
+    uint32_t getSampleDistance(ThreadCache &Cache);
+
+    // Flush the cache of a thread when it exits.
+    static void destroyThreadCache(void *Allocator);
+
     // Reserve a slot in GuardedPagePool for a new allocation.
     // Returns kInvalidSlotID if no slot is available to be reserved.
-    size_t reserveSlot();
+    size_t reserveSlot(ThreadCache &Cache);
 
     // Unreserve the guarded slot.
-    void freeSlot(size_t SlotIndex);
+    void freeSlot(ThreadCache &Cache, size_t SlotIndex);
+
+    // Move up to half of ThreadCacheLength slots from the free slots stack to the
+    // cache.
+    void refillThreadCache(ThreadCache &Cache);
+
+    // Move the last Length slots of the cache to the free slots stack.
+    void flushThreadCache(ThreadCache &Cache, size_t Length);
+
+    // Make sure that the cache is flushed when the calling thread exits.
+    void registerThreadCache(ThreadCache &Cache);
+
+    // Pop a slot from the free slots stack, returns kNoFreeSlot if it is empty.
+    uint32_t popFreeSlot();
+
+    // Push a slot onto the free slots stack.
+    void pushFreeSlot(uint32_t SlotIndex);
 
     // Use xorshift32, a class of pseudorandom number generators, see
-    // https://en.wikipedia.org/wiki/Xorshift.
-    uint32_t getRandomUnsigned32();
+    // https://en.wikipedia.org/wiki/Xorshift. Each thread has its own state.
+    static uint32_t getRandomUnsigned32(ThreadCache &Cache);
 
     // Raise a SEGV and set the `FailureType` and `FailureAddress` fields in the
     // Allocator's State in order to diagnose what error happened. Used when
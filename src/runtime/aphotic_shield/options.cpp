@@ -217,6 +217,12 @@ void initOptions(const char *OptionsStr) {
                "APHOTIC-SHIELD is enabled.\n");
         o->Enabled = false;
     }
+
+    if (o->SampleRate <= 0) {
+        printf("APHOTIC-SHIELD ERROR: SampleRate must be > 0 when APHOTIC-SHIELD is "
+               "enabled.\n");
+        o->Enabled = false;
+    }
 }
 
 Options &getOptions() {
@@ -10,6 +10,8 @@
 #include <cstdio>
 
 #define APHOTIC_SHIELD_ALWAYS_INLINE inline __attribute__((always_inline))
+#define APHOTIC_SHIELD_LIKELY(X) __builtin_expect(!!(X), 1)
+#define APHOTIC_SHIELD_UNLIKELY(X) __builtin_expect(!!(X), 0)
 
 namespace {
 void die(const char *Message) {
@@ -4,55 +4,68 @@
 #include "frontend/RecursiveASTVisitor.h"
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/DenseMapInfo.h"
+#include <vector>
 
 namespace remniw {
 
+// The names declared in a function. They are keyed by the IDs of their
+// identifiers, so a lookup hashes an integer and not the name.
+struct FunctionScope {
+    // < Identifier ID, VarDeclAST* > of the parameters and local variables
+    llvm::DenseMap<unsigned, VarDeclAST *> Variables;
+};
+
 struct SymbolTable {
     SymbolTable() {}
 
-    bool addFunction(llvm::StringRef FunctionName, FunctionDeclAST *Function) {
-        return Functions.insert({FunctionName, Function}).second;
+    bool addFunction(Identifier FunctionName, FunctionDeclAST *Function) {
+        unsigned ID = FunctionName.getID();
+        if (ID >= Functions.size())
+            Functions.resize(ID + 1);
+        if (Functions[ID])
+            return false;
+        Functions[ID] = Function;
+        return true;
     }
 
-    bool addVariable(llvm::StringRef VariableName, VarDeclAST *Variable,
+    bool addVariable(Identifier VariableName, VarDeclAST *Variable,
                      FunctionDeclAST *Function) {
-        return VariableDecls.insert({std::make_pair(VariableName, Function), Variable})
-            .second;
+        return Scopes[Function].Variables.insert({VariableName.getID(), Variable}).second;
     }
 
     bool addReturnExpr(ExprAST *ReturnExpr, FunctionDeclAST *Function) {
         return ReturnExprs.insert({ReturnExpr, Function}).second;
     }
 
-    FunctionDeclAST *getFunction(llvm::StringRef FunctionName) {
-        if (Functions.count(FunctionName))
-            return Functions[FunctionName];
-        return nullptr;
+    FunctionDeclAST *getFunction(Identifier FunctionName) const {
+        unsigned ID = FunctionName.getID();
+        return ID < Functions.size() ? Functions[ID] : nullptr;
     }
 
-    VarDeclAST *getVariable(llvm::StringRef VariableName, FunctionDeclAST *Function) {
-        auto Key = std::make_pair(VariableName, Function);
-        if (VariableDecls.count(Key))
-            return VariableDecls[Key];
-        return nullptr;
+    VarDeclAST *getVariable(Identifier VariableName, FunctionDeclAST *Function) const {
+        auto Scope = Scopes.find(Function);
+        if (Scope == Scopes.end())
+            return nullptr;
+        return Scope->second.Variables.lookup(VariableName.getID());
     }
 
     void print(llvm::raw_ostream &OS) {
-        for (auto &p : Functions)
-            OS << "Function: '" << p.first << "' " << p.second << "\n";
-        for (auto &p : VariableDecls)
-            OS << "Variable: '" << p.first.first << "' " << p.second << " (of function '"
-               << p.first.second->getName() << "')\n";
+        for (auto *Function : Functions)
+            if (Function)
+                OS << "Function: '" << Function->getName() << "' " << Function << "\n";
+        for (auto &p : Scopes)
+            for (auto &q : p.second.Variables)
+                OS << "Variable: '" << q.second->getName() << "' " << q.second
+                   << " (of function '" << p.first->getName() << "')\n";
         for (auto &p : ReturnExprs)
             OS << "ReturnExpr: '" << p.first << "' (of function '" << p.second->getName()
                << "')\n";
     }
 
-    // < FunctionName, FunctionDeclAST* >
-    llvm::DenseMap<llvm::StringRef, FunctionDeclAST *> Functions;
-    // < <VariableName, FunctionDeclAST*>, VarDeclAST* >
-    llvm::DenseMap<std::pair<llvm::StringRef, FunctionDeclAST *>, VarDeclAST *>
-        VariableDecls;
+    // Indexed by the ID of the identifier of a function.
+    std::vector<FunctionDeclAST *> Functions;
+    // < FunctionDeclAST*, FunctionScope >
+    llvm::DenseMap<FunctionDeclAST *, FunctionScope> Scopes;
     // < ExprAST of ReturnStmt, FunctionDeclAST* >
     llvm::DenseMap<ExprAST *, FunctionDeclAST *> ReturnExprs;
 };
@@ -67,7 +80,7 @@ public:
 
     bool actBeforeVisitProgram(ProgramAST *Program) {
         for (auto *Function : Program->getFunctions())
-            SymTab.addFunction(Function->getName(), Function);
+            SymTab.addFunction(Function->getIdentifier(), Function);
         return false;
     }
 
@@ -77,7 +90,7 @@ public:
     }
 
     void actAfterVisitVarDeclNode(VarDeclAST *VarDeclNode) {
-        SymTab.addVariable(VarDeclNode->getName(), VarDeclNode, CurrentFunction);
+        SymTab.addVariable(VarDeclNode->getIdentifier(), VarDeclNode, CurrentFunction);
     }
 
     void actAfterVisitReturnStmt(ReturnStmtAST *ReturnStmt) {
@@ -2,8 +2,11 @@
 #include "frontend/AST.h"
 #include "frontend/Type.h"
 #include "llvm/Support/Casting.h"
+#include "llvm/Support/Debug.h"
 #include "llvm/Support/ErrorHandling.h"
 
+#define DEBUG_TYPE "remniw-TypeAnalysis"
+
 namespace remniw {
 
 Type *TypeAnalysis::ASTNodeToType(const ASTNode *Node) const {
@@ -23,38 +26,38 @@ Type *TypeAnalysis::ASTNodeToType(const ASTNode *Node) const {
 }
 
 bool TypeAnalysis::unify(Type *Ty1, Type *Ty2) {
-    Type *Ty1r = TheUnionFind->find(Ty1);
-    Type *Ty2r = TheUnionFind->find(Ty2);
+    Type *Ty1r = TheUnionFind.find(Ty1);
+    Type *Ty2r = TheUnionFind.find(Ty2);
     if (Ty1r != Ty2r) {
         if (llvm::isa<VarType>(Ty1r) && llvm::isa<VarType>(Ty2r)) {
-            TheUnionFind->unionTypes(Ty1r, Ty2r);
+            TheUnionFind.unionTypes(Ty1r, Ty2r);
         } else if (llvm::isa<VarType>(Ty1r) && !llvm::isa<VarType>(Ty2r)) {
-            TheUnionFind->unionTypes(Ty1r, Ty2r);
+            TheUnionFind.unionTypes(Ty1r, Ty2r);
         } else if (!llvm::isa<VarType>(Ty1r) && llvm::isa<VarType>(Ty2r)) {
-            TheUnionFind->unionTypes(Ty2r, Ty1r);
+            TheUnionFind.unionTypes(Ty2r, Ty1r);
         } else if (!llvm::isa<VarType>(Ty1r) && !llvm::isa<VarType>(Ty2r)) {
             /* Check if Ty1r and Ty2r are same type constructor */
             if (llvm::isa<IntType>(Ty1r) && llvm::isa<IntType>(Ty2r)) {
-                TheUnionFind->unionTypes(Ty1r, Ty2r);
+                TheUnionFind.unionTypes(Ty1r, Ty2r);
             } else if (llvm::isa<PointerType>(Ty1r) && llvm::isa<PointerType>(Ty2r)) {
-                TheUnionFind->unionTypes(Ty1r, Ty2r);
+                TheUnionFind.unionTypes(Ty1r, Ty2r);
                 auto *PointerTy1 = llvm::dyn_cast<PointerType>(Ty1r);
                 auto *PointerTy2 = llvm::dyn_cast<PointerType>(Ty2r);
                 unify(PointerTy1->getPointeeType(), PointerTy2->getPointeeType());
             } else if (llvm::isa<ArrayType>(Ty1r) && llvm::isa<ArrayType>(Ty2r)) {
-                TheUnionFind->unionTypes(Ty1r, Ty2r);
+                TheUnionFind.unionTypes(Ty1r, Ty2r);
                 auto *ArrayTy1 = llvm::dyn_cast<ArrayType>(Ty1r);
                 auto *ArrayTy2 = llvm::dyn_cast<ArrayType>(Ty2r);
                 if (ArrayTy1->getNumElements() != ArrayTy2->getNumElements())
                     return false;
                 unify(ArrayTy1->getElementType(), ArrayTy2->getElementType());
             } else if (llvm::isa<PointerType>(Ty1r) && llvm::isa<ArrayType>(Ty2r)) {
-                TheUnionFind->unionTypes(Ty1r, Ty2r);
+                TheUnionFind.unionTypes(Ty1r, Ty2r);
                 auto *PointerTy = llvm::dyn_cast<PointerType>(Ty1r);
                 auto *ArrayTy = llvm::dyn_cast<ArrayType>(Ty2r);
                 unify(PointerTy->getPointeeType(), ArrayTy->getElementType());
             } else if (llvm::isa<ArrayType>(Ty1r) && llvm::isa<PointerType>(Ty2r)) {
-                TheUnionFind->unionTypes(Ty1r, Ty2r);
+                TheUnionFind.unionTypes(Ty1r, Ty2r);
                 auto *ArrayTy = llvm::dyn_cast<ArrayType>(Ty1r);
                 auto *PointerTy = llvm::dyn_cast<PointerType>(Ty2r);
                 unify(ArrayTy->getElementType(), PointerTy->getPointeeType());
@@ -65,7 +68,7 @@ bool TypeAnalysis::unify(Type *Ty1, Type *Ty2) {
                 auto ParamsTy2 = FunctionTy2->getParamTypes();
                 if (ParamsTy1.size() != ParamsTy2.size())
                     return false;
-                TheUnionFind->unionTypes(Ty1r, Ty2r);
+                TheUnionFind.unionTypes(Ty1r, Ty2r);
                 for (int i = 0; i < ParamsTy1.size(); ++i) {
                     unify(ParamsTy1[i], ParamsTy2[i]);
                 }
@@ -82,18 +85,20 @@ bool TypeAnalysis::unify(Type *Ty1, Type *Ty2) {
     return true;
 }
 
-bool TypeAnalysis::solve(ProgramAST *AST) {
-    visitProgram(AST);
-
-    for (TypeConstraint &Constraint : Constraints) {
-        if (!unify(Constraint.LHS, Constraint.RHS)) {
-            llvm::errs() << "TypeAnalysis failed!\n";
-            Constraint.print(llvm::errs());
-            return false;
-        }
+void TypeAnalysis::addConstraint(Type *LHS, Type *RHS) {
+    LLVM_DEBUG(TypeConstraint(LHS, RHS).print(llvm::outs()));
+    if (Failed)
+        return;
+    if (!unify(LHS, RHS)) {
+        llvm::errs() << "TypeAnalysis failed!\n";
+        TypeConstraint(LHS, RHS).print(llvm::errs());
+        Failed = true;
     }
+}
 
-    return true;
+bool TypeAnalysis::solve(ProgramAST *AST) {
+    visitProgram(AST);
+    return !Failed;
 }
 
 }  // namespace remniw
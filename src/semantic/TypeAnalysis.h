@@ -3,8 +3,9 @@
 #include "frontend/RecursiveASTVisitor.h"
 #include "frontend/Type.h"
 #include "semantic/SymbolTable.h"
-#include "llvm/ADT/DenseMap.h"
 #include "llvm/Support/Casting.h"
+#include <cstdint>
+#include <utility>
 #include <vector>
 
 namespace remniw {
@@ -23,43 +24,85 @@ struct TypeConstraint {
     Type *RHS;
 };
 
+// A union-find over the types of a TypeContext. The sets are kept in arrays indexed
+// by the IDs of the types, merged by rank and find() compresses the paths without
+// recursion, so any sequence of operations takes almost linear time. The arrays
+// grow on demand, since the type analysis creates types while it unifies.
 class UnionFind {
 public:
-    void unionTypes(Type *Ty1, Type *Ty2) {
-        auto Ty1r = find(Ty1);
-        auto Ty2r = find(Ty2);
-        if (Ty1r != Ty2r)
-            Parent[Ty1r] = Ty2r;
-    }
-
-    void makeSet(Type *Ty) {
-        if (Parent.find(Ty) == Parent.end())
-            Parent[Ty] = Ty;
-    }
+    UnionFind(TypeContext &TypeCtx): TypeCtx(TypeCtx) {}
 
+    // Merges the sets of Ty1 and Ty2. The representative of the set of Ty2 becomes
+    // the representative of the merged set.
+    void unionTypes(Type *Ty1, Type *Ty2) {
+        unsigned Root1 = findRoot(Ty1->getID());
+        unsigned Root2 = findRoot(Ty2->getID());
+        if (Root1 == Root2)
+            return;
+        unsigned Repr = Representative[Root2];
+        if (Rank[Root1] < Rank[Root2])
+            std::swap(Root1, Root2);
+        else if (Rank[Root1] == Rank[Root2])
+            ++Rank[Root1];
+        Parent[Root2] = Root1;
+        Representative[Root1] = Repr;
+    }
+
+    // Returns the representative of the set of Ty.
     Type *find(Type *Ty) {
-        makeSet(Ty);
-        if (Parent[Ty] != Ty)
-            Parent[Ty] = find(Parent[Ty]);
-        return Parent[Ty];
+        return TypeCtx.getType(Representative[findRoot(Ty->getID())]);
     }
 
 private:
-    // Parents[x] = y means the parent of x is y
-    llvm::DenseMap<Type *, Type *> Parent;
+    unsigned findRoot(unsigned ID) {
+        if (ID >= Parent.size())
+            grow();
+        unsigned Root = ID;
+        while (Parent[Root] != Root)
+            Root = Parent[Root];
+        while (Parent[ID] != Root) {
+            unsigned Next = Parent[ID];
+            Parent[ID] = Root;
+            ID = Next;
+        }
+        return Root;
+    }
+
+    // Make a singleton set of each type created since the last call.
+    void grow() {
+        unsigned OldSize = Parent.size();
+        unsigned NewSize = TypeCtx.getNumTypes();
+        Parent.resize(NewSize);
+        Rank.resize(NewSize, 0);
+        Representative.resize(NewSize);
+        for (unsigned ID = OldSize; ID != NewSize; ++ID) {
+            Parent[ID] = ID;
+            Representative[ID] = ID;
+        }
+    }
+
+    TypeContext &TypeCtx;
+    // Parent[x] = y means the parent of x is y, the roots are their own parents.
+    std::vector<unsigned> Parent;
+    // An upper bound of the height of the tree of a root, at most log2 of its size.
+    std::vector<uint8_t> Rank;
+    // The representative of the set of a root, which is not always the root.
+    std::vector<unsigned> Representative;
 };
 
 class TypeAnalysis: public RecursiveASTVisitor<TypeAnalysis> {
 public:
     TypeAnalysis(SymbolTable &SymTab, TypeContext &TypeCtx):
-        SymTab(SymTab), TypeCtx(TypeCtx),
-        TheUnionFind(std::move(std::make_unique<UnionFind>())) {}
+        SymTab(SymTab), TypeCtx(TypeCtx), TheUnionFind(TypeCtx) {}
 
     bool unify(Type *Ty1, Type *Ty2);
 
     bool solve(ProgramAST *AST);
 
-    std::vector<TypeConstraint> getConstraints() { return Constraints; }
+    // Unify the constraint LHS == RHS as soon as the traversal generates it, so the
+    // constraints are never stored. The constraints after the first one which can
+    // not be unified are ignored.
+    void addConstraint(Type *LHS, Type *RHS);
 
     // main(X1,...,Xn){ ...return E; }: [[X1]] = ...[[Xn]] = [[E]] = int
     // X(X1,...,Xn){ ...return E; }: [[X]] = ([[X1]],...,[[Xn]])->[[E]]
@@ -69,47 +112,46 @@ public:
         if (Function->getName() == "main") {
             for (auto *Param : Function->getParamDecls()) {
                 ParamTypes.push_back(ASTNodeToType(Param));
-                Constraints.emplace_back(ASTNodeToType(Param), Type::getIntType(TypeCtx));
+                addConstraint(ASTNodeToType(Param), Type::getIntType(TypeCtx));
             }
-            Constraints.emplace_back(ASTNodeToType(Ret->getExpr()),
-                                     Type::getIntType(TypeCtx));
+            addConstraint(ASTNodeToType(Ret->getExpr()),
+                          Type::getIntType(TypeCtx));
         } else {
             for (auto *Param : Function->getParamDecls()) {
                 ParamTypes.push_back(ASTNodeToType(Param));
             }
         }
-        Constraints.emplace_back(
-            ASTNodeToType(Function),
-            Type::getFunctionType(ParamTypes, ASTNodeToType(Ret->getExpr())));
+        addConstraint(ASTNodeToType(Function),
+                      Type::getFunctionType(ParamTypes, ASTNodeToType(Ret->getExpr())));
     }
 
     // X = E: [[X]] = [[E]]
     void actAfterVisitAssignmentStmt(AssignmentStmtAST *AssignmentStmt) {
-        Constraints.emplace_back(ASTNodeToType(AssignmentStmt->getLHS()),
-                                 ASTNodeToType(AssignmentStmt->getRHS()));
+        addConstraint(ASTNodeToType(AssignmentStmt->getLHS()),
+                      ASTNodeToType(AssignmentStmt->getRHS()));
     }
 
     // output E: [[E]] = int
     void actAfterVisitOutputStmt(OutputStmtAST *OutputStmt) {
-        Constraints.emplace_back(ASTNodeToType(OutputStmt->getExpr()),
-                                 Type::getIntType(TypeCtx));
+        addConstraint(ASTNodeToType(OutputStmt->getExpr()),
+                      Type::getIntType(TypeCtx));
     }
 
     // if (E) S1 else S2: [[E]] = int
     void actAfterVisitIfStmt(IfStmtAST *IfStmt) {
-        Constraints.emplace_back(ASTNodeToType(IfStmt->getCond()),
-                                 Type::getIntType(TypeCtx));
+        addConstraint(ASTNodeToType(IfStmt->getCond()),
+                      Type::getIntType(TypeCtx));
     }
 
     // while (E) S: [[E]] = int
     void actAfterVisitWhileStmt(WhileStmtAST *WhileStmt) {
-        Constraints.emplace_back(ASTNodeToType(WhileStmt->getCond()),
-                                 Type::getIntType(TypeCtx));
+        addConstraint(ASTNodeToType(WhileStmt->getCond()),
+                      Type::getIntType(TypeCtx));
     }
 
     // I: [[I]] = int
     void actAfterVisitNumberExpr(NumberExprAST *NumberExpr) {
-        Constraints.emplace_back(ASTNodeToType(NumberExpr), Type::getIntType(TypeCtx));
+        addConstraint(ASTNodeToType(NumberExpr), Type::getIntType(TypeCtx));
     }
 
     // E(E1,...,En): [[E]] = ([[E1]],...,[[En]])->[[E(E1,...,En)]]
@@ -118,57 +160,56 @@ public:
         for (auto *Arg : FunctionCallExpr->getArgs()) {
             ArgTypes.push_back(ASTNodeToType(Arg));
         }
-        Constraints.emplace_back(
-            ASTNodeToType(FunctionCallExpr->getCallee()),
-            Type::getFunctionType(ArgTypes, ASTNodeToType(FunctionCallExpr)));
+        addConstraint(ASTNodeToType(FunctionCallExpr->getCallee()),
+                      Type::getFunctionType(ArgTypes, ASTNodeToType(FunctionCallExpr)));
     }
 
     // TODO: [[null]] = &α
     void actAfterVisitNullExpr(NullExprAST *NullExpr) {
-        // Constraints.emplace_back(ASTNodeToType(&NullExpr),
-        //                          std::make_shared<PointerType>(std::make_shared<AlphaType>(&NullExpr)));
+        // addConstraint(ASTNodeToType(&NullExpr),
+        //               std::make_shared<PointerType>(std::make_shared<AlphaType>(&NullExpr)));
     }
 
     // &X: [[&X]] = &[[X]]
     void actAfterVisitAddrOfExpr(AddrOfExprAST *AddrOfExpr) {
-        Constraints.emplace_back(ASTNodeToType(AddrOfExpr),
-                                 ASTNodeToType(AddrOfExpr->getVar())->getPointerTo());
+        addConstraint(ASTNodeToType(AddrOfExpr),
+                      ASTNodeToType(AddrOfExpr->getVar())->getPointerTo());
     }
 
     // *E: [[E]] = &[[*E]]
     void actAfterVisitDerefExpr(DerefExprAST *DerefExpr) {
-        Constraints.emplace_back(ASTNodeToType(DerefExpr->getPtr()),
-                                 ASTNodeToType(DerefExpr)->getPointerTo());
+        addConstraint(ASTNodeToType(DerefExpr->getPtr()),
+                      ASTNodeToType(DerefExpr)->getPointerTo());
     }
 
     // E[E1]: [[E1]] = int, [[E[E1]]] = [[E]]->getElementType()
     void actAfterVisitArraySubscriptExpr(ArraySubscriptExprAST *ArraySubscriptExpr) {
-        Constraints.emplace_back(ASTNodeToType(ArraySubscriptExpr->getSelector()),
-                                 Type::getIntType(TypeCtx));
+        addConstraint(ASTNodeToType(ArraySubscriptExpr->getSelector()),
+                      Type::getIntType(TypeCtx));
 
         auto *BaseTy = ASTNodeToType(ArraySubscriptExpr->getBase());
         // Note here, we decay arrayType to pointerType in type analysis
-        Constraints.emplace_back(ASTNodeToType(ArraySubscriptExpr->getBase()),
-                                 ASTNodeToType(ArraySubscriptExpr)->getPointerTo());
+        addConstraint(ASTNodeToType(ArraySubscriptExpr->getBase()),
+                      ASTNodeToType(ArraySubscriptExpr)->getPointerTo());
     }
 
     // [[input]] = int
     void actAfterVisitInputExpr(InputExprAST *InputExpr) {
         // Type constraint for InputExpr:
-        Constraints.emplace_back(ASTNodeToType(InputExpr), Type::getIntType(TypeCtx));
+        addConstraint(ASTNodeToType(InputExpr), Type::getIntType(TypeCtx));
     }
 
     // E1 op E2: [[E1]] = [[E2]] = [[E1 op E2]] = int
     // E1 == E2: [[E1]] = [[E2]] ^ [[E1 == E2]] = int
     void actAfterVisitBinaryExpr(BinaryExprAST *BinaryExpr) {
         auto *IntTy = Type::getIntType(TypeCtx);
-        Constraints.emplace_back(ASTNodeToType(BinaryExpr), IntTy);
+        addConstraint(ASTNodeToType(BinaryExpr), IntTy);
         if (BinaryExpr->getOp() == BinaryExprAST::OpKind::Eq) {
-            Constraints.emplace_back(ASTNodeToType(BinaryExpr->getLHS()),
-                                     ASTNodeToType(BinaryExpr->getRHS()));
+            addConstraint(ASTNodeToType(BinaryExpr->getLHS()),
+                          ASTNodeToType(BinaryExpr->getRHS()));
         } else {
-            Constraints.emplace_back(ASTNodeToType(BinaryExpr->getLHS()), IntTy);
-            Constraints.emplace_back(ASTNodeToType(BinaryExpr->getRHS()), IntTy);
+            addConstraint(ASTNodeToType(BinaryExpr->getLHS()), IntTy);
+            addConstraint(ASTNodeToType(BinaryExpr->getRHS()), IntTy);
         }
     }
 
@@ -178,8 +219,8 @@ private:
 private:
     SymbolTable &SymTab;
     TypeContext &TypeCtx;
-    std::unique_ptr<UnionFind> TheUnionFind;
-    std::vector<TypeConstraint> Constraints;
+    UnionFind TheUnionFind;
+    bool Failed = false;
 };
 
 }  // namespace remniw
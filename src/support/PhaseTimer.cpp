@@ -0,0 +1,197 @@
+#include "support/PhaseTimer.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/JSON.h"
+#include "llvm/Support/Process.h"
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <sys/resource.h>
+
+namespace remniw {
+
+struct PhaseTimer::Phase {
+    Phase(llvm::StringRef Name, llvm::StringRef Description, llvm::TimerGroup &TG):
+        T(Name, Description, TG) {}
+
+    llvm::Timer T;
+    int64_t HeapDeltaBytes {0};
+    uint64_t PeakRSS {0};
+    // Indexed like getCounters().
+    std::vector<uint64_t> Counts;
+};
+
+// All the PhaseCounters of the program. They are registered during static
+// initialization, so the list does not change once main() is entered.
+static std::vector<PhaseCounter *> &getCounters() {
+    static std::vector<PhaseCounter *> Counters;
+    return Counters;
+}
+
+PhaseCounter::PhaseCounter(const char *Name, const char *Description):
+    Name(Name), Description(Description) {
+    getCounters().push_back(this);
+}
+
+// Writing 5 to /proc/self/clear_refs resets the peak RSS of the process to its
+// current RSS, since Linux 4.0.
+static void resetPeakRSS() {
+#ifdef __linux__
+    std::ofstream ClearRefs("/proc/self/clear_refs");
+    ClearRefs << "5";
+#endif
+}
+
+// Returns the peak RSS in bytes since the last resetPeakRSS(). Where it can not be
+// reset, this is the peak RSS of the process.
+static uint64_t getPeakRSS() {
+#ifdef __linux__
+    std::ifstream Status("/proc/self/status");
+    std::string Line;
+    while (std::getline(Status, Line)) {
+        if (Line.compare(0, 6, "VmHWM:") == 0)
+            return std::stoull(Line.substr(6)) * 1024;
+    }
+#endif
+    struct rusage Usage;
+    if (getrusage(RUSAGE_SELF, &Usage) != 0)
+        return 0;
+#ifdef __APPLE__
+    return Usage.ru_maxrss;
+#else
+    return static_cast<uint64_t>(Usage.ru_maxrss) * 1024;
+#endif
+}
+
+PhaseTimer::Scope::Scope(PhaseTimer *PT, llvm::StringRef Name,
+                         llvm::StringRef Description):
+    PT(PT) {
+    if (!PT)
+        return;
+    P = &PT->getPhase(Name, Description);
+    // Resetting the peak RSS loses the peak of the enclosing phases so far.
+    if (!PT->ActiveScopes.empty()) {
+        uint64_t Peak = getPeakRSS();
+        for (Scope *S : PT->ActiveScopes)
+            S->PeakRSS = std::max(S->PeakRSS, Peak);
+    }
+    resetPeakRSS();
+    PT->ActiveScopes.push_back(this);
+    MallocUsageAtStart = llvm::sys::Process::GetMallocUsage();
+    for (PhaseCounter *C : getCounters())
+        CountersAtStart.push_back(C->getValue());
+    P->T.startTimer();
+}
+
+PhaseTimer::Scope::~Scope() {
+    if (!P)
+        return;
+    P->T.stopTimer();
+    assert(PT->ActiveScopes.back() == this && "Phases must nest");
+    PT->ActiveScopes.pop_back();
+    P->HeapDeltaBytes += static_cast<int64_t>(llvm::sys::Process::GetMallocUsage()) -
+                         static_cast<int64_t>(MallocUsageAtStart);
+    P->PeakRSS = std::max({P->PeakRSS, PeakRSS, getPeakRSS()});
+    const auto &Counters = getCounters();
+    P->Counts.resize(Counters.size());
+    for (size_t I = 0, E = Counters.size(); I != E; ++I)
+        P->Counts[I] += Counters[I]->getValue() - CountersAtStart[I];
+}
+
+PhaseTimer::PhaseTimer(): TG("remniw-phases", "remniw Phase Report") {}
+
+PhaseTimer::~PhaseTimer() {
+    // The report is printed by print(), don't let the TimerGroup print it again
+    // when it is destroyed.
+    TG.clear();
+}
+
+PhaseTimer::Phase &PhaseTimer::getPhase(llvm::StringRef Name,
+                                        llvm::StringRef Description) {
+    for (auto &P : Phases)
+        if (P->T.getName() == Name)
+            return *P;
+    Phases.push_back(std::make_unique<Phase>(Name, Description, TG));
+    return *Phases.back();
+}
+
+void PhaseTimer::print(llvm::raw_ostream &OS, PhaseReportFormat Format) const {
+    if (Format == JSONReport) {
+        llvm::json::OStream J(OS, 2);
+        J.object([&] {
+            J.attributeArray("phases", [&] {
+                for (auto &P : Phases) {
+                    llvm::TimeRecord Time = P->T.getTotalTime();
+                    J.object([&] {
+                        J.attribute("name", P->T.getName());
+                        J.attribute("description", P->T.getDescription());
+                        J.attribute("wall_seconds", Time.getWallTime());
+                        J.attribute("user_seconds", Time.getUserTime());
+                        J.attribute("system_seconds", Time.getSystemTime());
+                        J.attribute("heap_delta_bytes", P->HeapDeltaBytes);
+                        J.attribute("peak_rss_bytes", static_cast<int64_t>(P->PeakRSS));
+                        J.attributeObject("counters", [&] {
+                            const auto &Counters = getCounters();
+                            for (size_t I = 0, E = P->Counts.size(); I != E; ++I)
+                                J.attribute(Counters[I]->getName(),
+                                            static_cast<int64_t>(P->Counts[I]));
+                        });
+                    });
+                }
+            });
+        });
+        OS << "\n";
+        return;
+    }
+
+    OS << "===" << std::string(73, '-') << "===\n";
+    OS << "                          remniw Phase Report\n";
+    OS << "===" << std::string(73, '-') << "===\n";
+    OS << "   Wall(s)    User(s)  System(s) HeapDelta(KiB) PeakRSS(KiB)  Phase\n";
+    llvm::TimeRecord Total;
+    for (auto &P : Phases) {
+        llvm::TimeRecord Time = P->T.getTotalTime();
+        Total += Time;
+        OS << llvm::format("%10.4f %10.4f %10.4f %14lld %12llu  ", Time.getWallTime(),
+                           Time.getUserTime(), Time.getSystemTime(),
+                           static_cast<long long>(P->HeapDeltaBytes / 1024),
+                           static_cast<unsigned long long>(P->PeakRSS / 1024))
+           << P->T.getDescription() << "\n";
+    }
+    OS << llvm::format("%10.4f %10.4f %10.4f", Total.getWallTime(), Total.getUserTime(),
+                       Total.getSystemTime())
+       << std::string(30, ' ') << "Total\n";
+
+    // List the counters which changed while a phase ran, in the order of phases.
+    bool PrintedHeader = false;
+    const auto &Counters = getCounters();
+    for (auto &P : Phases) {
+        for (size_t I = 0, E = P->Counts.size(); I != E; ++I) {
+            if (!P->Counts[I])
+                continue;
+            if (!PrintedHeader) {
+                OS << "\n        Count  Counter (Phase)\n";
+                PrintedHeader = true;
+            }
+            OS << llvm::format("%13llu  ", static_cast<unsigned long long>(P->Counts[I]))
+               << Counters[I]->getDescription() << " (" << P->T.getDescription()
+               << ")\n";
+        }
+    }
+}
+
+void PhaseTimer::print(llvm::StringRef Filename, PhaseReportFormat Format) const {
+    if (Filename.empty()) {
+        print(llvm::errs(), Format);
+        return;
+    }
+    std::error_code EC;
+    llvm::raw_fd_ostream OS(Filename, EC, llvm::sys::fs::OF_Text);
+    if (EC) {
+        llvm::errs() << "error: " << Filename << ": " << EC.message() << "\n";
+        return;
+    }
+    print(OS, Format);
+}
+
+}  // namespace remniw
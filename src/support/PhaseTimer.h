@@ -0,0 +1,93 @@
+#pragma once
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Timer.h"
+#include "llvm/Support/raw_ostream.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace remniw {
+
+enum PhaseReportFormat { TableReport, JSONReport };
+
+// A counter of events, e.g. allocations, which -time-phases reports per phase:
+// the increase of the counter while a phase runs is accounted to the phase. Like
+// llvm::Statistic, a counter must have static storage duration, and it may be
+// incremented from several threads.
+class PhaseCounter {
+public:
+    PhaseCounter(const char *Name, const char *Description);
+    PhaseCounter(const PhaseCounter &) = delete;
+    PhaseCounter &operator=(const PhaseCounter &) = delete;
+
+    PhaseCounter &operator++() {
+        Value.fetch_add(1, std::memory_order_relaxed);
+        return *this;
+    }
+
+    PhaseCounter &operator+=(uint64_t N) {
+        Value.fetch_add(N, std::memory_order_relaxed);
+        return *this;
+    }
+
+    uint64_t getValue() const { return Value.load(std::memory_order_relaxed); }
+    const char *getName() const { return Name; }
+    const char *getDescription() const { return Description; }
+
+private:
+    const char *Name;
+    const char *Description;
+    std::atomic<uint64_t> Value {0};
+};
+
+// Measures the phases of the compiler for the -time-phases option. Each phase has
+// an llvm::Timer in a TimerGroup, and records the change of the PhaseCounters and
+// the peak RSS while it runs. It also records the net change of the heap in use as
+// told by malloc, which is not the number of bytes the phase allocated, and which
+// is negative if the phase frees more than it allocates. The peak RSS is reset when
+// a phase starts, after it has been recorded in the enclosing phases, so phases may
+// nest. A phase which runs several times accumulates its times, heap deltas and
+// counts and keeps the highest peak RSS.
+class PhaseTimer {
+    struct Phase;
+
+public:
+    // Measures the lifetime of the scope as the phase Name. Nothing is measured
+    // if PT is null.
+    class Scope {
+    public:
+        Scope(PhaseTimer *PT, llvm::StringRef Name, llvm::StringRef Description);
+        ~Scope();
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+
+    private:
+        PhaseTimer *PT {nullptr};
+        Phase *P {nullptr};
+        size_t MallocUsageAtStart {0};
+        // The peak RSS before the nested phases reset it.
+        uint64_t PeakRSS {0};
+        std::vector<uint64_t> CountersAtStart;
+    };
+
+    PhaseTimer();
+    ~PhaseTimer();
+
+    void print(llvm::raw_ostream &OS, PhaseReportFormat Format) const;
+
+    // Print the report to the file Filename, or to stderr if Filename is empty.
+    void print(llvm::StringRef Filename, PhaseReportFormat Format) const;
+
+private:
+    Phase &getPhase(llvm::StringRef Name, llvm::StringRef Description);
+
+    llvm::TimerGroup TG;
+    // In the order the phases first ran.
+    std::vector<std::unique_ptr<Phase>> Phases;
+    // The scopes which are running, innermost last.
+    std::vector<Scope *> ActiveScopes;
+};
+
+}  // namespace remniw
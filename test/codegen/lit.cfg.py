@@ -34,6 +34,10 @@ config.test_source_root = os.path.dirname(__file__)
 # test_exec_root: The root path where tests should be run.
 config.test_exec_root = os.path.join(config.obj_root, 'test')
 
+# The remniw driver is built with the frontend generated by ANTLR.
+if getattr(config, 'antlr_found', False):
+  config.available_features.add('antlr')
+
 # replaced %remniw -emit-llvm by the path to the tool executable.
 config.substitutions.append(('%remniw',
     os.path.join(config.obj_root, 'bin/remniw')))
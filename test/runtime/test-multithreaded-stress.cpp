@@ -0,0 +1,103 @@
+// RUN: %cxx_aphotic_shield -pthread %s -o %t
+// RUN: %t 2>&1 | FileCheck %s
+// RUN: env APHOTIC_SHIELD_OPTIONS=SampleRate=1000 %t --check-scaling 2>&1 | \
+// RUN:     FileCheck %s --check-prefix=SCALING
+
+// Allocate and deallocate from an increasing number of threads. Each thread fills
+// its allocations with its own pattern and checks it before deallocating, so two
+// live allocations sharing a slot are detected. The allocation throughput for each
+// number of threads is printed.
+//
+// With --check-scaling, the throughput must grow with the number of threads, up to
+// the number of hardware threads: N threads must reach at least a quarter of N
+// times the throughput of one thread. Every allocation of the default SampleRate
+// changes the page protection, which the kernel serializes, so this runs with a
+// SampleRate which leaves the per-thread fast path of the allocator to dominate.
+// An allocator serialized on a lock fails it on a machine with several cores.
+
+// CHECK: threads: 1, allocations/s: {{[0-9]+}}
+// CHECK: threads: 2, allocations/s: {{[0-9]+}}
+// CHECK: threads: 4, allocations/s: {{[0-9]+}}
+// CHECK: threads: 8, allocations/s: {{[0-9]+}}
+// CHECK: PASS
+
+// SCALING: threads: 1, allocations/s: {{[0-9]+}}
+// SCALING: threads: 8, allocations/s: {{[0-9]+}}
+// SCALING-NOT: too slow
+// SCALING: PASS
+
+#include "aphotic_shield/aphotic_shield_interface.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+static constexpr int kLiveAllocations = 8;
+static constexpr size_t kAllocationSize = 64;
+
+static std::atomic<bool> Failed {false};
+
+static void stress(unsigned char Pattern, int Iterations) {
+    char *Live[kLiveAllocations] = {};
+    for (int i = 0; i < Iterations; ++i) {
+        char *&Ptr = Live[i % kLiveAllocations];
+        if (Ptr) {
+            for (size_t j = 0; j < kAllocationSize; ++j)
+                if (static_cast<unsigned char>(Ptr[j]) != Pattern)
+                    Failed = true;
+            as_dealloc(Ptr);
+        }
+        Ptr = static_cast<char *>(as_alloc(kAllocationSize));
+        memset(Ptr, Pattern, kAllocationSize);
+    }
+    for (char *Ptr : Live)
+        as_dealloc(Ptr);
+}
+
+// Returns the allocations per second of NumThreads threads, the best of Repeats runs.
+static double measure(unsigned NumThreads, int Iterations, int Repeats) {
+    double Best = 0;
+    for (int r = 0; r < Repeats; ++r) {
+        auto Start = std::chrono::steady_clock::now();
+        std::vector<std::thread> Threads;
+        for (unsigned t = 0; t < NumThreads; ++t)
+            Threads.emplace_back(stress, static_cast<unsigned char>(t + 1), Iterations);
+        for (auto &T : Threads)
+            T.join();
+        std::chrono::duration<double> Seconds = std::chrono::steady_clock::now() - Start;
+        Best = std::max(Best, NumThreads * Iterations / Seconds.count());
+    }
+    return Best;
+}
+
+int main(int argc, char **argv) {
+    bool CheckScaling = argc > 1 && strcmp(argv[1], "--check-scaling") == 0;
+    int Iterations = CheckScaling ? 1000000 : 20000;
+    int Repeats = CheckScaling ? 3 : 1;
+    unsigned HardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+
+    as_init();
+
+    double SingleThread = 0;
+    for (unsigned NumThreads = 1; NumThreads <= 8; NumThreads *= 2) {
+        double Throughput = measure(NumThreads, Iterations, Repeats);
+        printf("threads: %u, allocations/s: %.0f\n", NumThreads, Throughput);
+        if (NumThreads == 1)
+            SingleThread = Throughput;
+        if (!CheckScaling)
+            continue;
+        double Expected = std::min(NumThreads, HardwareThreads) * SingleThread / 4;
+        if (Throughput < Expected) {
+            printf("too slow: %u threads on %u hardware threads, expected at least "
+                   "%.0f allocations/s\n",
+                   NumThreads, HardwareThreads, Expected);
+            Failed = true;
+        }
+    }
+
+    printf(Failed ? "FAIL\n" : "PASS\n");
+    return 0;
+}
@@ -0,0 +1,29 @@
+// RUN: %cxx_aphotic_shield %s -o %t
+// RUN: env APHOTIC_SHIELD_OPTIONS=SampleRate=100 %expect_crash %t 2>&1 | FileCheck %s
+
+// With SampleRate=100, about one in a hundred allocations is guarded, so reading
+// all of the freed allocations hits a guarded one.
+
+// CHECK: APHOTIC-SHIELD detected a memory error
+// CHECK: Use After Free on address 0x{{[a-f0-9]+}}
+
+#include "aphotic_shield/aphotic_shield_interface.h"
+
+static constexpr int kNumAllocations = 10000;
+
+static char *Ptrs[kNumAllocations];
+
+int main() {
+    as_init();
+
+    for (int i = 0; i < kNumAllocations; ++i)
+        Ptrs[i] = (char *)as_alloc(16);
+    for (int i = 0; i < kNumAllocations; ++i)
+        as_dealloc(Ptrs[i]);
+
+    volatile char ch;
+    for (int i = 0; i < kNumAllocations; ++i)
+        ch = *Ptrs[i];
+
+    return 0;
+}